@@ -28,6 +28,8 @@
 
 #include <float.h>
 #include <math.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -41,10 +43,23 @@ struct animation_node_s
     animation_node next, prev;
 };
 
+/** \brief the values of all nodes converted to numbers to interpolate without strings */
+typedef struct
+{
+    int state;        /**< 1 if valid, 0 if stale, or -1 if the values are not all numbers */
+    mlt_rect *values; /**< a value for each node in the order of the index */
+} animation_values;
+
 /** \brief Property Animation class
  *
  * This is the animation engine for a Property object. It is dependent upon
  * the mlt_property API and used by the various mlt_property_anim_* functions.
+ *
+ * Alongside the linked list, the animation keeps an array of the nodes that
+ * is searched by binary search and starts from the node found last, which
+ * makes sequential playback constant time. Numeric and rectangle values are
+ * converted once so that mlt_animation_get_double() and
+ * mlt_animation_get_rect() do not need to parse strings.
  */
 
 struct mlt_animation_s
@@ -54,6 +69,15 @@ struct mlt_animation_s
     double fps;          /**< framerate to use when converting time clock strings to frame units */
     mlt_locale_t locale; /**< pointer to a locale to use when converting strings to numeric values */
     animation_node nodes; /**< a linked list of keyframes (and possibly non-keyframe values) */
+    pthread_mutex_t mutex;  /**< protects the index, cursor, and converted values */
+    animation_node *index;  /**< the nodes in list order */
+    int index_count;        /**< the number of nodes in the index */
+    int index_size;         /**< the allocated size of the index */
+    int index_valid;        /**< whether the index matches the linked list */
+    int index_sorted;       /**< whether the frames of the nodes are in increasing order */
+    int cursor;             /**< the index of the node found most recently */
+    animation_values doubles; /**< the values as real numbers */
+    animation_values rects;   /**< the values as rectangles */
 };
 
 /** \brief Keyframe type to string mapping
@@ -111,6 +135,16 @@ static int interpolate_item(mlt_animation_item item,
                             mlt_animation_item p[],
                             double fps,
                             mlt_locale_t locale);
+static inline double interpolate_value(double x0,
+                                       double y0,
+                                       double x1,
+                                       double y1,
+                                       double x2,
+                                       double y2,
+                                       double x3,
+                                       double y3,
+                                       double t,
+                                       mlt_keyframe_type type);
 
 static const char *keyframe_type_to_str(mlt_keyframe_type t)
 {
@@ -145,9 +179,197 @@ static mlt_keyframe_type str_to_keyframe_type(const char *s)
 mlt_animation mlt_animation_new()
 {
     mlt_animation self = calloc(1, sizeof(*self));
+    if (self) {
+        pthread_mutex_init(&self->mutex, NULL);
+        self->index_valid = 1;
+        self->index_sorted = 1;
+    }
     return self;
 }
 
+/** Mark the converted values as out of date.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ */
+
+static void values_invalidate(mlt_animation self)
+{
+    self->doubles.state = 0;
+    self->rects.state = 0;
+}
+
+/** Mark the index and the converted values as out of date.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ */
+
+static void index_invalidate(mlt_animation self)
+{
+    pthread_mutex_lock(&self->mutex);
+    self->index_valid = 0;
+    values_invalidate(self);
+    pthread_mutex_unlock(&self->mutex);
+}
+
+/** Make sure the index has room for another node.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \return true if there was an error
+ */
+
+static int index_reserve(mlt_animation self)
+{
+    if (self->index_count >= self->index_size) {
+        int size = self->index_size ? self->index_size * 2 : 16;
+        animation_node *index = realloc(self->index, size * sizeof(*index));
+        mlt_rect *doubles = realloc(self->doubles.values, size * sizeof(mlt_rect));
+        if (doubles)
+            self->doubles.values = doubles;
+        mlt_rect *rects = realloc(self->rects.values, size * sizeof(mlt_rect));
+        if (rects)
+            self->rects.values = rects;
+        if (!index || !doubles || !rects) {
+            if (index)
+                self->index = index;
+            return 1;
+        }
+        self->index = index;
+        self->index_size = size;
+    }
+    return 0;
+}
+
+/** Rebuild the index from the linked list if it is out of date.
+ *
+ * The caller must hold the mutex.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \return true if there was an error
+ */
+
+static int index_update(mlt_animation self)
+{
+    if (self->index_valid)
+        return 0;
+
+    self->index_count = 0;
+    self->index_sorted = 1;
+    self->cursor = 0;
+    values_invalidate(self);
+    for (animation_node node = self->nodes; node; node = node->next) {
+        if (index_reserve(self))
+            return 1;
+        if (node->prev && node->prev->item.frame >= node->item.frame)
+            self->index_sorted = 0;
+        self->index[self->index_count++] = node;
+    }
+    self->index_valid = 1;
+    return 0;
+}
+
+/** Find the node that applies to a position.
+ *
+ * This finds the same node as walking the linked list from the start: the
+ * last node whose frame is not after the position, or the first node if
+ * the position precedes them all. The caller must hold the mutex and have
+ * updated the index.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \param position a frame number
+ * \return an index into the index or -1 if there are no nodes
+ */
+
+static int index_find(mlt_animation self, int position)
+{
+    animation_node *index = self->index;
+    int count = self->index_count;
+    int i = self->cursor;
+
+    if (count == 0)
+        return -1;
+
+    if (!self->index_sorted) {
+        // Walk the list as the nodes may be out of order.
+        for (i = 0; i + 1 < count && position >= index[i + 1]->item.frame; i++)
+            ;
+        return i;
+    }
+
+    // Try the previous result and the one following it for sequential access.
+    if (i < count && index[i]->item.frame <= position) {
+        if (i + 1 == count || position < index[i + 1]->item.frame)
+            return i;
+        if (i + 2 == count || position < index[i + 2]->item.frame)
+            return self->cursor = i + 1;
+    }
+
+    // Binary search for the last node with a frame not after the position.
+    int low = 0, high = count - 1;
+    while (low < high) {
+        int middle = low + (high - low + 1) / 2;
+        if (index[middle]->item.frame <= position)
+            low = middle;
+        else
+            high = middle - 1;
+    }
+    return self->cursor = low;
+}
+
+/** Find the first node with a frame that is not before a position.
+ *
+ * The caller must hold the mutex and have updated the index.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \param position a frame number
+ * \return an index into the index, which equals the count if there is none
+ */
+
+static int index_lower_bound(mlt_animation self, int position)
+{
+    int low = 0, high = self->index_count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (self->index[middle]->item.frame < position)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/** Find the node that applies to a position.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \param position a frame number
+ * \return the last node whose frame is not after the position, the first node if the
+ * position precedes them all, or NULL if there are no nodes
+ */
+
+static animation_node find_node(mlt_animation self, int position)
+{
+    animation_node node = NULL;
+
+    pthread_mutex_lock(&self->mutex);
+    if (!index_update(self)) {
+        int i = index_find(self, position);
+        node = i >= 0 ? self->index[i] : NULL;
+        pthread_mutex_unlock(&self->mutex);
+    } else {
+        pthread_mutex_unlock(&self->mutex);
+        node = self->nodes;
+        while (node && node->next && position >= node->next->item.frame)
+            node = node->next;
+    }
+    return node;
+}
+
 /** Re-interpolate non-keyframe nodes after a series of insertions or removals.
  *
  * \public \memberof mlt_animation_s
@@ -158,6 +380,9 @@ void mlt_animation_interpolate(mlt_animation self)
 {
     // Parse all items to ensure non-keyframes are calculated correctly.
     if (self && self->nodes) {
+        pthread_mutex_lock(&self->mutex);
+        values_invalidate(self);
+        pthread_mutex_unlock(&self->mutex);
         animation_node current = self->nodes;
         while (current) {
             if (!current->item.is_key) {
@@ -200,6 +425,21 @@ void mlt_animation_interpolate(mlt_animation self)
 
 static int mlt_animation_drop(mlt_animation self, animation_node node)
 {
+    pthread_mutex_lock(&self->mutex);
+    int i = self->index_valid && self->index_sorted ? index_lower_bound(self, node->item.frame)
+                                                    : self->index_count;
+    if (i < self->index_count && self->index[i] == node) {
+        memmove(&self->index[i],
+                &self->index[i + 1],
+                (self->index_count - i - 1) * sizeof(*self->index));
+        self->index_count--;
+        self->cursor = 0;
+        values_invalidate(self);
+    } else {
+        self->index_valid = 0;
+    }
+    pthread_mutex_unlock(&self->mutex);
+
     if (node == self->nodes) {
         self->nodes = node->next;
         if (self->nodes) {
@@ -233,8 +473,15 @@ static void mlt_animation_clean(mlt_animation self)
 
     free(self->data);
     self->data = NULL;
+    index_invalidate(self);
     while (self->nodes)
         mlt_animation_drop(self, self->nodes);
+    pthread_mutex_lock(&self->mutex);
+    self->index_count = 0;
+    self->index_valid = 1;
+    self->index_sorted = 1;
+    self->cursor = 0;
+    pthread_mutex_unlock(&self->mutex);
 }
 
 /** Parse a string representing an animation.
@@ -457,11 +704,7 @@ int mlt_animation_get_item(mlt_animation self, mlt_animation_item item, int posi
 
     int error = 0;
     // Need to find the nearest keyframe to the position specified
-    animation_node node = self->nodes;
-
-    // Iterate through the keyframes until we reach last or have
-    while (node && node->next && position >= node->next->item.frame)
-        node = node->next;
+    animation_node node = find_node(self, position);
 
     if (node) {
         item->keyframe_type = node->item.keyframe_type;
@@ -506,6 +749,173 @@ int mlt_animation_get_item(mlt_animation self, mlt_animation_item item, int posi
     return error;
 }
 
+/** Convert the values of all nodes to numbers if they are out of date.
+ *
+ * The caller must hold the mutex and have updated the index.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \param values the converted values to update
+ * \param is_rect whether to convert to rectangles instead of real numbers
+ * \return true if the values are not all numbers
+ */
+
+static int values_update(mlt_animation self, animation_values *values, int is_rect)
+{
+    if (values->state == 0 && self->index_count > 0) {
+        values->state = 1;
+        for (int i = 0; i < self->index_count && values->state == 1; i++) {
+            mlt_property property = self->index[i]->item.property;
+            // Colors and strings are interpolated differently.
+            if (mlt_property_is_color(property)) {
+                values->state = -1;
+            } else if (is_rect) {
+                values->values[i] = mlt_property_get_rect(property, self->locale);
+            } else if (mlt_property_is_numeric(property, self->locale)) {
+                values->values[i].x = mlt_property_get_double(property, self->fps, self->locale);
+            } else {
+                values->state = -1;
+            }
+        }
+    }
+    return values->state != 1;
+}
+
+/** Interpolate a converted value.
+ *
+ * This matches the results of mlt_animation_get_item() for the same values.
+ * The caller must hold the mutex and have updated the index.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \param values the converted values
+ * \param i the index of the node that applies to the position
+ * \param position the frame number for the point in time
+ * \param field the offset of the field within mlt_rect to interpolate
+ * \return the value
+ */
+
+static double values_interpolate(
+    mlt_animation self, animation_values *values, int i, int position, size_t field)
+{
+    animation_node *index = self->index;
+    int n = self->index_count;
+    const double *v[4];
+    int p[4] = {i > 0 ? i - 1 : i, i, i + 1, i + 2 < n ? i + 2 : i + 1};
+
+    for (int j = 0; j < 4; j++)
+        v[j] = (const double *) ((const char *) &values->values[p[j]] + field);
+    return interpolate_value(index[p[0]]->item.frame,
+                             *v[0],
+                             index[p[1]]->item.frame,
+                             *v[1],
+                             index[p[2]]->item.frame,
+                             *v[2],
+                             index[p[3]]->item.frame,
+                             *v[3],
+                             (double) (position - index[i]->item.frame)
+                                 / (double) (index[i + 1]->item.frame - index[i]->item.frame),
+                             index[i]->item.keyframe_type);
+}
+
+/** Determine if a position requires interpolation between two nodes.
+ *
+ * \private \memberof mlt_animation_s
+ * \param self an animation
+ * \param i the index of the node that applies to the position
+ * \param position the frame number for the point in time
+ * \return true if the value must be interpolated
+ */
+
+static inline int needs_interpolation(mlt_animation self, int i, int position)
+{
+    animation_node node = self->index[i];
+    return position > node->item.frame && i + 1 < self->index_count
+           && node->item.keyframe_type != mlt_keyframe_discrete;
+}
+
+/** Get the value at a position as a real number without converting strings.
+ *
+ * This is equivalent to getting the item at the position with
+ * mlt_animation_get_item() and converting its property to a real number.
+ * The values of the keyframes are converted once and reused until the
+ * animation changes.
+ *
+ * \public \memberof mlt_animation_s
+ * \param self an animation
+ * \param fps the frame rate, which may be needed for converting a time string to frame units
+ * \param locale the locale, which may be needed for converting a string to a real number
+ * \param position the frame number for the point in time
+ * \param[out] value the value at the position
+ * \return true if the animation is empty, its values are not all numbers, or it was parsed
+ * with a different frame rate or locale, in which case use mlt_animation_get_item()
+ */
+
+int mlt_animation_get_double(
+    mlt_animation self, double fps, mlt_locale_t locale, int position, double *value)
+{
+    if (!self || !value)
+        return 1;
+
+    int error = 1;
+    pthread_mutex_lock(&self->mutex);
+    if (fps == self->fps && locale == self->locale && !index_update(self) && self->index_sorted
+        && !values_update(self, &self->doubles, 0)) {
+        int i = index_find(self, position);
+        if (i >= 0) {
+            if (needs_interpolation(self, i, position))
+                *value = values_interpolate(self, &self->doubles, i, position, 0);
+            else
+                *value = self->doubles.values[i].x;
+            error = 0;
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return error;
+}
+
+/** Get the value at a position as a rectangle without converting strings.
+ *
+ * This is equivalent to getting the item at the position with
+ * mlt_animation_get_item() into a rectangle property and converting it.
+ *
+ * \public \memberof mlt_animation_s
+ * \param self an animation
+ * \param locale the locale, which may be needed for converting a string to a real number
+ * \param position the frame number for the point in time
+ * \param[out] value the value at the position
+ * \return true if the animation is empty, its values are colors, or it was parsed with a
+ * different locale, in which case use mlt_animation_get_item()
+ */
+
+int mlt_animation_get_rect(mlt_animation self, mlt_locale_t locale, int position, mlt_rect *value)
+{
+    if (!self || !value)
+        return 1;
+
+    int error = 1;
+    pthread_mutex_lock(&self->mutex);
+    if (locale == self->locale && !index_update(self) && self->index_sorted
+        && !values_update(self, &self->rects, 1)) {
+        int i = index_find(self, position);
+        if (i >= 0) {
+            if (needs_interpolation(self, i, position)) {
+                animation_values *rects = &self->rects;
+                value->x = values_interpolate(self, rects, i, position, offsetof(mlt_rect, x));
+                value->y = values_interpolate(self, rects, i, position, offsetof(mlt_rect, y));
+                value->w = values_interpolate(self, rects, i, position, offsetof(mlt_rect, w));
+                value->h = values_interpolate(self, rects, i, position, offsetof(mlt_rect, h));
+                value->o = values_interpolate(self, rects, i, position, offsetof(mlt_rect, o));
+            } else {
+                *value = self->rects.values[i];
+            }
+            error = 0;
+        }
+    }
+    pthread_mutex_unlock(&self->mutex);
+    return error;
+}
+
 /** Insert an animation item.
  *
  * \public \memberof mlt_animation_s
@@ -530,13 +940,32 @@ int mlt_animation_insert(mlt_animation self, mlt_animation_item item)
         mlt_property_pass(node->item.property, item->property);
 
     // Determine if we need to insert or append to the list, or if it's a new list
+    pthread_mutex_lock(&self->mutex);
+    int i = self->index_valid && self->index_sorted ? index_lower_bound(self, item->frame) : -1;
+    if (i < 0 || index_reserve(self))
+        self->index_valid = 0;
+    values_invalidate(self);
     if (self->nodes) {
         // Get the first item
         animation_node current = self->nodes;
 
         // Locate an existing nearby item
-        while (current->next && item->frame > current->item.frame)
-            current = current->next;
+        if (self->index_valid) {
+            current = self->index[MIN(i, self->index_count - 1)];
+        } else {
+            while (current->next && item->frame > current->item.frame)
+                current = current->next;
+        }
+
+        if (item->frame != current->item.frame && self->index_valid) {
+            // Add the new node to the index.
+            memmove(&self->index[i + 1],
+                    &self->index[i],
+                    (self->index_count - i) * sizeof(*self->index));
+            self->index[i] = node;
+            self->index_count++;
+            self->cursor = 0;
+        }
 
         if (item->frame < current->item.frame) {
             if (current == self->nodes)
@@ -564,7 +993,13 @@ int mlt_animation_insert(mlt_animation self, mlt_animation_item item)
     } else {
         // Set the first item
         self->nodes = node;
+        if (self->index_valid) {
+            self->index[0] = node;
+            self->index_count = 1;
+            self->cursor = 0;
+        }
     }
+    pthread_mutex_unlock(&self->mutex);
     mlt_animation_clear_string(self);
 
     return error;
@@ -586,8 +1021,15 @@ int mlt_animation_remove(mlt_animation self, int position)
     int error = 1;
     animation_node node = self->nodes;
 
-    while (node && position != node->item.frame)
-        node = node->next;
+    pthread_mutex_lock(&self->mutex);
+    if (!index_update(self) && self->index_sorted) {
+        int i = index_lower_bound(self, position);
+        node = i < self->index_count ? self->index[i] : NULL;
+    } else {
+        while (node && position != node->item.frame)
+            node = node->next;
+    }
+    pthread_mutex_unlock(&self->mutex);
 
     if (node && position == node->item.frame)
         error = mlt_animation_drop(self, node);
@@ -613,8 +1055,15 @@ int mlt_animation_next_key(mlt_animation self, mlt_animation_item item, int posi
 
     animation_node node = self->nodes;
 
-    while (node && position > node->item.frame)
-        node = node->next;
+    pthread_mutex_lock(&self->mutex);
+    if (!index_update(self) && self->index_sorted) {
+        int i = index_lower_bound(self, position);
+        node = i < self->index_count ? self->index[i] : NULL;
+    } else {
+        while (node && position > node->item.frame)
+            node = node->next;
+    }
+    pthread_mutex_unlock(&self->mutex);
 
     if (node) {
         item->frame = node->item.frame;
@@ -641,12 +1090,9 @@ int mlt_animation_prev_key(mlt_animation self, mlt_animation_item item, int posi
     if (!self || !item)
         return 1;
 
-    animation_node node = self->nodes;
-
-    while (node && node->next && position >= node->next->item.frame)
-        node = node->next;
+    animation_node node = find_node(self, position);
 
-    if (position < node->item.frame)
+    if (node && position < node->item.frame)
         node = NULL;
 
     if (node) {
@@ -851,9 +1297,15 @@ int mlt_animation_key_count(mlt_animation self)
 {
     int count = -1;
     if (self) {
-        animation_node node = self->nodes;
-        for (count = 0; node; ++count)
-            node = node->next;
+        pthread_mutex_lock(&self->mutex);
+        if (!index_update(self)) {
+            count = self->index_count;
+        } else {
+            animation_node node = self->nodes;
+            for (count = 0; node; ++count)
+                node = node->next;
+        }
+        pthread_mutex_unlock(&self->mutex);
     }
     return count;
 }
@@ -875,10 +1327,16 @@ int mlt_animation_key_get(mlt_animation self, mlt_animation_item item, int index
     int error = 0;
     animation_node node = self->nodes;
 
-    // Iterate through the keyframes.
-    int i = index;
-    while (i-- && node)
-        node = node->next;
+    pthread_mutex_lock(&self->mutex);
+    if (!index_update(self)) {
+        node = index >= 0 && index < self->index_count ? self->index[index] : NULL;
+    } else {
+        // Iterate through the keyframes.
+        int i = index;
+        while (i-- && node)
+            node = node->next;
+    }
+    pthread_mutex_unlock(&self->mutex);
 
     if (node) {
         item->is_key = node->item.is_key;
@@ -904,6 +1362,10 @@ void mlt_animation_close(mlt_animation self)
 {
     if (self) {
         mlt_animation_clean(self);
+        pthread_mutex_destroy(&self->mutex);
+        free(self->index);
+        free(self->doubles.values);
+        free(self->rects.values);
         free(self);
     }
 }
@@ -965,6 +1427,7 @@ int mlt_animation_key_set_frame(mlt_animation self, int index, int frame)
 
     if (node) {
         node->item.frame = frame;
+        index_invalidate(self);
         mlt_animation_interpolate(self);
         mlt_animation_clear_string(self);
     } else {
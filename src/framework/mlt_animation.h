@@ -57,6 +57,8 @@ MLT_API extern int mlt_animation_get_length(mlt_animation self);
 MLT_API extern void mlt_animation_set_length(mlt_animation self, int length);
 MLT_API extern int mlt_animation_parse_item(mlt_animation self, mlt_animation_item item, const char *data);
 MLT_API extern int mlt_animation_get_item(mlt_animation self, mlt_animation_item item, int position);
+MLT_API extern int mlt_animation_get_double(mlt_animation self, double fps, mlt_locale_t locale, int position, double *value);
+MLT_API extern int mlt_animation_get_rect(mlt_animation self, mlt_locale_t locale, int position, mlt_rect *value);
 MLT_API extern int mlt_animation_insert(mlt_animation self, mlt_animation_item item);
 MLT_API extern int mlt_animation_remove(mlt_animation self, int position);
 MLT_API extern void mlt_animation_interpolate(mlt_animation self);
@@ -21,20 +21,27 @@
  */
 
 #include "mlt_cache.h"
+#include "mlt_factory.h"
 #include "mlt_frame.h"
 #include "mlt_log.h"
 #include "mlt_properties.h"
 #include "mlt_types.h"
 
 #include <pthread.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 
-/** the maximum number of data objects to cache per line */
-#define MAX_CACHE_SIZE (200)
-
 /** the default number of data objects to cache per line */
 #define DEFAULT_CACHE_SIZE (4)
 
+/** the initial number of hash buckets, which must be a power of two */
+#define INITIAL_BUCKETS (16)
+
+/** the number of least recently used items considered when evicting by cost */
+#define EVICTION_SAMPLE (8)
+
 /** \brief Cache item class
  *
  * A cache item is a structure holding information about a data object including
@@ -56,13 +63,36 @@ typedef struct mlt_cache_item_s
     mlt_destructor destructor; /**< a function to release or destroy the cached data */
 } mlt_cache_item_s;
 
+/** \brief Cache node
+ *
+ * A node is an entry of the cache. It is linked both into the list that
+ * orders the entries from least to most recently used and into the chain of
+ * its hash bucket, which orders them from most to least recently used.
+ */
+
+typedef struct cache_node_s
+{
+    void *object; /**< the owner of the cached data, or the cloned frame for a frame cache */
+    void *owner;  /**< the cache that put the frame into the shared frame cache */
+    mlt_position position;      /**< the position of the frame for a frame cache */
+    mlt_image_format format;    /**< the image format of the frame for a frame cache */
+    int width;                  /**< the image width of the frame for a frame cache */
+    int height;                 /**< the image height of the frame for a frame cache */
+    int size;                   /**< the number of bytes charged to the budgets */
+    double cost;                /**< the cost of recreating the data */
+    struct cache_node_s *prev;  /**< the next less recently used node */
+    struct cache_node_s *next;  /**< the next more recently used node */
+    struct cache_node_s *chain; /**< the next node in the same hash bucket */
+} cache_node;
+
 /** \brief Cache class
  *
  * This is a utility class for implementing a Least Recently Used (LRU) cache
  * of data blobs indexed by the address of some other object (e.g., a service).
- * Instead of sorting and manipulating linked lists, it tries to be simple and
- * elegant by copying pointers between two arrays of fixed size to shuffle the
- * order of elements.
+ * Entries are found through a hash table and ordered in a doubly linked list,
+ * so that a lookup, an insert, or an eviction does not depend on the number of
+ * entries. The cache is bounded by a number of entries and optionally by a
+ * number of bytes, per cache and across all caches.
  *
  * This class is useful if you have a service that wants to cache something
  * somewhat large, but will not scale if there are many instances of the service.
@@ -76,25 +106,60 @@ typedef struct mlt_cache_item_s
  * of continually reading, parsing, and decoding. On the other hand, you might
  * want to load hundreds of pictures as individual producers, which would use
  * a lot of memory if every picture is held in memory!
+ *
+ * \envvar \em MLT_CACHE_MAX_BYTES the maximum number of bytes held across all
+ * caches, defaults to no limit. When exceeded, a cache that is putting an item
+ * evicts its own least recently used items.
+ * \envvar \em MLT_FRAME_CACHE_MAX_BYTES the maximum number of bytes held by the
+ * shared frame cache, defaults to 0, which leaves each cache to hold its own
+ * frames. See mlt_cache_shared_frames().
  */
 
 struct mlt_cache_s
 {
-    int count;      /**< the number of items currently in the cache */
-    int size;       /**< the maximum number of items permitted in the cache <= \p MAX_CACHE_SIZE */
-    int is_frames;  /**< indicates if this cache is used to cache frames */
-    void **current; /**< pointer to the current array of pointers */
-    void *A[MAX_CACHE_SIZE];
-    void *B[MAX_CACHE_SIZE];
+    int count;         /**< the number of items currently in the cache */
+    int size;          /**< the maximum number of items permitted in the cache */
+    int is_frames;     /**< indicates if this cache is used to cache frames */
+    int64_t bytes;     /**< the number of bytes held by the items in the cache */
+    int64_t max_bytes; /**< the maximum number of bytes permitted in the cache or 0 for no limit */
+    int64_t hits;      /**< the number of gets that found an item */
+    int64_t misses;    /**< the number of gets that did not find an item */
+    int64_t evictions; /**< the number of items released to make room */
+    cache_node *lru;   /**< the least recently used node, the head of the list */
+    cache_node *mru;   /**< the most recently used node, the tail of the list */
+    cache_node **buckets; /**< the hash table of nodes */
+    int bucket_count;     /**< the number of hash buckets, a power of two */
+    int shared_count;     /**< the number of frames put into the shared frame cache */
     pthread_mutex_t mutex;  /**< a mutex to prevent multi-threaded race conditions */
     mlt_properties active;  /**< a list of cache items some of which may no longer
-	                            be in \p current but to which there are
+	                            be in the cache but to which there are
 	                            outstanding references */
     mlt_properties garbage; /**< a list cache items pending release. A cache item
 	                            is copied to this list when it is updated but there
 	                            are outstanding references to the old data object. */
 };
 
+/** the number of bytes held across all caches */
+static atomic_int_fast64_t global_bytes = 0;
+
+/** the maximum number of bytes held across all caches or 0 for no limit */
+static int64_t global_max_bytes = 0;
+
+/** the initial maximum number of bytes held by the shared frame cache */
+static int64_t shared_max_bytes = 0;
+
+static pthread_once_t global_once = PTHREAD_ONCE_INIT;
+
+static void global_init(void)
+{
+    const char *e = getenv("MLT_CACHE_MAX_BYTES");
+    if (e)
+        global_max_bytes = strtoll(e, NULL, 10);
+    e = getenv("MLT_FRAME_CACHE_MAX_BYTES");
+    if (e)
+        shared_max_bytes = strtoll(e, NULL, 10);
+}
+
 /** Get the data pointer from the cache item.
  *
  * \public \memberof mlt_cache_s
@@ -191,6 +256,254 @@ void mlt_cache_item_close(mlt_cache_item item)
     }
 }
 
+/** Get the hash bucket of a node.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param owner the cache that put the frame for the shared frame cache
+ * \param object the object that owns the cached data
+ * \param position the position of the frame for a frame cache
+ * \return the index of the hash bucket
+ */
+
+static int cache_bucket(mlt_cache cache, void *owner, void *object, mlt_position position)
+{
+    uint64_t key = cache->is_frames ? (uint64_t) (uintptr_t) owner * 31 + (uint64_t) position
+                                    : (uint64_t) (uintptr_t) object;
+    return (int) ((key * 0x9E3779B97F4A7C15ULL) >> 32) & (cache->bucket_count - 1);
+}
+
+/** Look up the node for an object or a frame position.
+ *
+ * The most recently used frame matches first when the frame cache holds the
+ * same position in several image formats or sizes.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param owner the cache that put the frame for the shared frame cache
+ * \param object the object that owns the cached data
+ * \param position the position of the frame for a frame cache
+ * \return the node or NULL if not found
+ */
+
+static cache_node *cache_find(mlt_cache cache, void *owner, void *object, mlt_position position)
+{
+    cache_node *node = NULL;
+    if (cache->buckets) {
+        node = cache->buckets[cache_bucket(cache, owner, object, position)];
+        while (node
+               && (cache->is_frames ? node->position != position || node->owner != owner
+                                    : node->object != object))
+            node = node->chain;
+    }
+    return node;
+}
+
+/** Double the number of hash buckets.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ */
+
+static void cache_grow(mlt_cache cache)
+{
+    int count = cache->bucket_count ? cache->bucket_count * 2 : INITIAL_BUCKETS;
+    cache_node **buckets = calloc(count, sizeof(cache_node *));
+    if (!buckets)
+        return;
+    free(cache->buckets);
+    cache->buckets = buckets;
+    cache->bucket_count = count;
+    for (cache_node *node = cache->lru; node; node = node->next) {
+        int i = cache_bucket(cache, node->owner, node->object, node->position);
+        node->chain = buckets[i];
+        buckets[i] = node;
+    }
+}
+
+/** Add a node at the most recently used end.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param node the node to add
+ */
+
+static void cache_link(mlt_cache cache, cache_node *node)
+{
+    if (++cache->count > cache->bucket_count)
+        cache_grow(cache);
+    if (node->owner)
+        ((mlt_cache) node->owner)->shared_count++;
+    node->prev = cache->mru;
+    node->next = NULL;
+    if (cache->mru)
+        cache->mru->next = node;
+    else
+        cache->lru = node;
+    cache->mru = node;
+    int i = cache_bucket(cache, node->owner, node->object, node->position);
+    node->chain = cache->buckets[i];
+    cache->buckets[i] = node;
+}
+
+/** Remove a node from the list and its hash bucket.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param node the node to remove
+ */
+
+static void cache_unlink(mlt_cache cache, cache_node *node)
+{
+    int i = cache_bucket(cache, node->owner, node->object, node->position);
+    cache_node **p = &cache->buckets[i];
+    while (*p != node)
+        p = &(*p)->chain;
+    *p = node->chain;
+    if (node->prev)
+        node->prev->next = node->next;
+    else
+        cache->lru = node->next;
+    if (node->next)
+        node->next->prev = node->prev;
+    else
+        cache->mru = node->prev;
+    cache->count--;
+    if (node->owner)
+        ((mlt_cache) node->owner)->shared_count--;
+}
+
+/** Move a node to the most recently used end.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param node the node to move
+ */
+
+static void cache_touch(mlt_cache cache, cache_node *node)
+{
+    if (node != cache->mru) {
+        // The most recently used node is always the head of its hash chain
+        int i = cache_bucket(cache, node->owner, node->object, node->position);
+        cache_node **p = &cache->buckets[i];
+        while (*p != node)
+            p = &(*p)->chain;
+        *p = node->chain;
+        node->chain = cache->buckets[i];
+        cache->buckets[i] = node;
+
+        if (node->prev)
+            node->prev->next = node->next;
+        else
+            cache->lru = node->next;
+        node->next->prev = node->prev;
+        node->prev = cache->mru;
+        node->next = NULL;
+        cache->mru->next = node;
+        cache->mru = node;
+    }
+}
+
+/** Charge or credit a number of bytes to the budgets.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param size the number of bytes, negative to credit
+ */
+
+static void cache_charge(mlt_cache cache, int64_t size)
+{
+    cache->bytes += size;
+    atomic_fetch_add(&global_bytes, size);
+}
+
+/** Remove a node and release its data.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \param node the node to release
+ */
+
+static void cache_release(mlt_cache cache, cache_node *node)
+{
+    cache_unlink(cache, node);
+    cache_charge(cache, -node->size);
+    cache_object_close(cache, node->object, NULL);
+    free(node);
+}
+
+/** Choose the item to evict to free bytes.
+ *
+ * Of the least recently used items, this is the one that is cheapest to
+ * recreate per byte it holds.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ * \return the node to evict
+ */
+
+static cache_node *cache_victim(mlt_cache cache)
+{
+    cache_node *victim = cache->lru;
+    cache_node *node = victim->next;
+    int i;
+
+    for (i = 1; i < EVICTION_SAMPLE && node != cache->mru; i++, node = node->next) {
+        if (node->cost * MAX(victim->size, 1) < victim->cost * MAX(node->size, 1))
+            victim = node;
+    }
+    return victim;
+}
+
+/** Release items until the cache is within its limits.
+ *
+ * The most recently used item is always kept.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a cache
+ */
+
+static void cache_evict(mlt_cache cache)
+{
+    while (cache->lru != cache->mru) {
+        cache_node *victim = NULL;
+        if (cache->count > cache->size)
+            victim = cache->lru;
+        else if ((cache->max_bytes && cache->bytes > cache->max_bytes)
+                 || (global_max_bytes && atomic_load(&global_bytes) > global_max_bytes))
+            victim = cache_victim(cache);
+        else
+            break;
+        mlt_log(NULL, MLT_LOG_DEBUG, "%s: evict %p\n", __FUNCTION__, victim->object);
+        cache->evictions++;
+        cache_release(cache, victim);
+    }
+}
+
+/** Release the frames that a cache put into the shared frame cache beyond its size.
+ *
+ * The least recently used frames of \p owner go first. The most recently used
+ * item is always kept.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache the shared frame cache
+ * \param owner the cache that put the frames
+ */
+
+static void cache_evict_owner(mlt_cache cache, mlt_cache owner)
+{
+    cache_node *node = cache->lru;
+    while (owner->shared_count > owner->size && node != cache->mru) {
+        cache_node *next = node->next;
+        if (node->owner == owner) {
+            mlt_log(NULL, MLT_LOG_DEBUG, "%s: evict %p\n", __FUNCTION__, node->object);
+            cache->evictions++;
+            cache_release(cache, node);
+        }
+        node = next;
+    }
+}
+
 /** Create a new cache.
  *
  * The default size is \p DEFAULT_CACHE_SIZE.
@@ -201,9 +514,9 @@ void mlt_cache_item_close(mlt_cache_item item)
 mlt_cache mlt_cache_init()
 {
     mlt_cache result = calloc(1, sizeof(struct mlt_cache_s));
+    pthread_once(&global_once, global_init);
     if (result) {
         result->size = DEFAULT_CACHE_SIZE;
-        result->current = result->A;
         pthread_mutex_init(&result->mutex, NULL);
         result->active = mlt_properties_new();
         result->garbage = mlt_properties_new();
@@ -213,8 +526,8 @@ mlt_cache mlt_cache_init()
 
 /** Set the number of items to cache.
  *
- * This must be called before using the cache. The size can not be more
- * than \p MAX_CACHE_SIZE.
+ * This must be called before using the cache. It also limits the number of
+ * frames that the cache holds in the shared frame cache.
  * \public \memberof mlt_cache_s
  * \param cache the cache to adjust
  * \param size the new size of the cache
@@ -222,7 +535,7 @@ mlt_cache mlt_cache_init()
 
 void mlt_cache_set_size(mlt_cache cache, int size)
 {
-    if (size <= MAX_CACHE_SIZE)
+    if (size > 0)
         cache->size = size;
 }
 
@@ -238,6 +551,62 @@ int mlt_cache_get_size(mlt_cache cache)
     return cache->size;
 }
 
+/** Set the maximum number of bytes to cache.
+ *
+ * This limit applies in addition to the number of items. The size of an
+ * item is the size given to mlt_cache_put() or, for a frame, the size of its
+ * image, alpha, and audio.
+ * \public \memberof mlt_cache_s
+ * \param cache the cache to adjust
+ * \param max_bytes the new maximum number of bytes or 0 for no limit
+ */
+
+void mlt_cache_set_max_bytes(mlt_cache cache, int64_t max_bytes)
+{
+    if (cache && max_bytes >= 0) {
+        pthread_mutex_lock(&cache->mutex);
+        cache->max_bytes = max_bytes;
+        cache_evict(cache);
+        pthread_mutex_unlock(&cache->mutex);
+    }
+}
+
+/** Get the maximum number of bytes to cache.
+ *
+ * \public \memberof mlt_cache_s
+ * \param cache the cache to check
+ * \return the maximum number of bytes or 0 for no limit
+ */
+
+int64_t mlt_cache_get_max_bytes(mlt_cache cache)
+{
+    return cache ? cache->max_bytes : 0;
+}
+
+/** Get the statistics of a cache.
+ *
+ * This sets the properties "count", "size", "bytes", "max_bytes", "hits",
+ * "misses", and "evictions" on \p properties.
+ * \public \memberof mlt_cache_s
+ * \param cache the cache to check
+ * \param properties the properties list to receive the statistics
+ */
+
+void mlt_cache_get_stats(mlt_cache cache, mlt_properties properties)
+{
+    if (!cache || !properties)
+        return;
+    pthread_mutex_lock(&cache->mutex);
+    mlt_properties_set_int(properties, "count", cache->count);
+    mlt_properties_set_int(properties, "size", cache->size);
+    mlt_properties_set_int64(properties, "bytes", cache->bytes);
+    mlt_properties_set_int64(properties, "max_bytes", cache->max_bytes);
+    mlt_properties_set_int64(properties, "hits", cache->hits);
+    mlt_properties_set_int64(properties, "misses", cache->misses);
+    mlt_properties_set_int64(properties, "evictions", cache->evictions);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
 /** Destroy a cache.
  *
  * \public \memberof mlt_cache_s
@@ -247,11 +616,30 @@ int mlt_cache_get_size(mlt_cache cache)
 void mlt_cache_close(mlt_cache cache)
 {
     if (cache) {
-        while (cache->count--) {
-            void *object = cache->current[cache->count];
-            mlt_log(NULL, MLT_LOG_DEBUG, "%s: %d = %p\n", __FUNCTION__, cache->count, object);
-            cache_object_close(cache, object, NULL);
+        // Drop the frames put into the shared frame cache on behalf of this one
+        mlt_properties global = mlt_global_properties();
+        mlt_cache shared = global ? mlt_properties_get_data(global, "_shared_frames", NULL) : NULL;
+        if (shared && shared != cache) {
+            pthread_mutex_lock(&shared->mutex);
+            cache_node *node = shared->lru;
+            while (node) {
+                cache_node *next = node->next;
+                if (node->owner == cache)
+                    cache_release(shared, node);
+                node = next;
+            }
+            pthread_mutex_unlock(&shared->mutex);
         }
+        while (cache->mru) {
+            mlt_log(NULL,
+                    MLT_LOG_DEBUG,
+                    "%s: %d = %p\n",
+                    __FUNCTION__,
+                    cache->count - 1,
+                    cache->mru->object);
+            cache_release(cache, cache->mru);
+        }
+        free(cache->buckets);
         mlt_properties_close(cache->active);
         mlt_properties_close(cache->garbage);
         pthread_mutex_destroy(&cache->mutex);
@@ -271,76 +659,29 @@ void mlt_cache_purge(mlt_cache cache, void *object)
     if (!cache)
         return;
     pthread_mutex_lock(&cache->mutex);
-    if (cache && object) {
-        int i, j;
-        void **alt = cache->current == cache->A ? cache->B : cache->A;
-
-        for (i = 0, j = 0; i < cache->count; i++) {
-            void *o = cache->current[i];
-
-            if (o == object) {
-                cache_object_close(cache, o, NULL);
-            } else {
-                alt[j++] = o;
+    if (object) {
+        if (cache->is_frames) {
+            // Frame caches are keyed by position; compare the frames themselves
+            cache_node *node = cache->lru;
+            while (node) {
+                cache_node *next = node->next;
+                if (node->object == object)
+                    cache_release(cache, node);
+                node = next;
             }
+        } else {
+            cache_node *node = cache_find(cache, NULL, object, 0);
+            if (node)
+                cache_release(cache, node);
         }
-        cache->count = j;
-        cache->current = alt;
     }
     pthread_mutex_unlock(&cache->mutex);
 }
 
-/** Shuffle the cache entries between the two arrays and return the cache entry for an object.
- *
- * \private \memberof mlt_cache_s
- * \param cache a cache object
- * \param object the object that owns the cached data
- * \return a cache entry if there was a hit or NULL for a miss
- */
-
-static void **shuffle_get_hit(mlt_cache cache, void *object)
-{
-    int i = cache->count;
-    int j = cache->count - 1;
-    void **hit = NULL;
-    void **alt = cache->current == cache->A ? cache->B : cache->A;
-
-    if (cache->count > 0 && cache->count < cache->size) {
-        // first determine if we have a hit
-        while (i-- && !hit) {
-            void **o = &cache->current[i];
-            if (*o == object)
-                hit = o;
-        }
-        // if there was no hit, we will not be shuffling out an entry
-        // and are still filling the cache
-        if (!hit)
-            ++j;
-        // reset these
-        i = cache->count;
-        hit = NULL;
-    }
-
-    // shuffle the existing entries to the alternate array
-    while (i--) {
-        void **o = &cache->current[i];
-
-        if (!hit && *o == object) {
-            hit = o;
-        } else if (j > 0) {
-            alt[--j] = *o;
-            // 			mlt_log( NULL, MLT_LOG_DEBUG, "%s: shuffle %d = %p\n", __FUNCTION__, j, alt[j] );
-        }
-    }
-    return hit;
-}
-
 /** Put a chunk of data in the cache.
  *
- * This function and mlt_cache_get() are not scalable with a large volume
- * of unique \p object parameter values. Therefore, it does not make sense
- * to use it for a frame/image cache using the frame position for \p object.
- * Instead, use mlt_cache_put_frame() for that.
+ * This function and mlt_cache_get() key the cache by \p object. To cache
+ * frames by their position use mlt_cache_put_frame() instead.
  *
  * \public \memberof mlt_cache_s
  * \param cache a cache object
@@ -353,26 +694,26 @@ static void **shuffle_get_hit(mlt_cache cache, void *object)
 void mlt_cache_put(mlt_cache cache, void *object, void *data, int size, mlt_destructor destructor)
 {
     pthread_mutex_lock(&cache->mutex);
-    void **hit = shuffle_get_hit(cache, object);
-    void **alt = cache->current == cache->A ? cache->B : cache->A;
+    cache_node *node = cache_find(cache, NULL, object, 0);
 
     // add the object to the cache
-    if (hit) {
+    if (node) {
         // release the old data
-        cache_object_close(cache, *hit, NULL);
+        cache_object_close(cache, object, NULL);
+        cache_charge(cache, size - node->size);
+        node->size = size;
         // the MRU end gets the updated data
-        hit = &alt[cache->count - 1];
-    } else if (cache->count < cache->size) {
-        // more room in cache, add it to MRU end
-        hit = &alt[cache->count++];
+        cache_touch(cache, node);
     } else {
-        // release the entry at the LRU end
-        cache_object_close(cache, cache->current[0], NULL);
-
-        // The MRU end gets the new item
-        hit = &alt[cache->count - 1];
+        node = calloc(1, sizeof(cache_node));
+        if (node) {
+            node->object = object;
+            node->size = size;
+            node->cost = 1.0;
+            cache_charge(cache, size);
+            cache_link(cache, node);
+        }
     }
-    *hit = object;
     mlt_log(NULL,
             MLT_LOG_DEBUG,
             "%s: put %d = %p, %p\n",
@@ -417,8 +758,8 @@ void mlt_cache_put(mlt_cache cache, void *object, void *data, int size, mlt_dest
         item->refcount = 1;
     }
 
-    // swap the current array
-    cache->current = alt;
+    // release the entries at the LRU end
+    cache_evict(cache);
     pthread_mutex_unlock(&cache->mutex);
 }
 
@@ -434,16 +775,14 @@ mlt_cache_item mlt_cache_get(mlt_cache cache, void *object)
 {
     mlt_cache_item result = NULL;
     pthread_mutex_lock(&cache->mutex);
-    void **hit = shuffle_get_hit(cache, object);
-    void **alt = cache->current == cache->A ? cache->B : cache->A;
+    cache_node *node = cache_find(cache, NULL, object, 0);
 
-    if (hit) {
-        // copy the hit to the MRU end
-        alt[cache->count - 1] = *hit;
-        hit = &alt[cache->count - 1];
+    if (node) {
+        // move the hit to the MRU end
+        cache_touch(cache, node);
 
         char key[19];
-        sprintf(key, "%p", *hit);
+        sprintf(key, "%p", object);
         result = mlt_properties_get_data(cache->active, key, NULL);
         if (result && result->data) {
             result->refcount++;
@@ -452,98 +791,138 @@ mlt_cache_item mlt_cache_get(mlt_cache cache, void *object)
                     "%s: get %d = %p, %p\n",
                     __FUNCTION__,
                     cache->count - 1,
-                    *hit,
+                    object,
                     result->data);
         }
-
-        // swap the current array
-        cache->current = alt;
+        cache->hits++;
+    } else {
+        cache->misses++;
     }
     pthread_mutex_unlock(&cache->mutex);
 
     return result;
 }
 
-/** Shuffle the cache entries between the two arrays and return the frame for a position.
+/** Get the number of bytes of data held by a cached frame.
  *
  * \private \memberof mlt_cache_s
- * \param cache a cache object
- * \param position the position of the frame that you want
- * \return a frame if there was a hit or NULL for a miss
+ * \param frame a frame
+ * \return the size of its image, alpha, and audio
  */
 
-static mlt_frame *shuffle_get_frame(mlt_cache cache, mlt_position position)
+static int frame_size(mlt_frame frame)
 {
-    int i = cache->count;
-    int j = cache->count - 1;
-    mlt_frame *hit = NULL;
-    mlt_frame *alt = (mlt_frame *) (cache->current == cache->A ? cache->B : cache->A);
+    mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+    int total = 0;
+    int size = 0;
+
+    if (mlt_properties_get_data(properties, "image", &size))
+        total += size;
+    if (mlt_properties_get_data(properties, "alpha", &size))
+        total += size;
+    if (mlt_properties_get_data(properties, "audio", &size))
+        total += size;
+    return total;
+}
 
-    if (cache->count > 0 && cache->count < cache->size) {
-        // first determine if we have a hit
-        while (i-- && !hit) {
-            mlt_frame *o = (mlt_frame *) &cache->current[i];
-            if (mlt_frame_original_position(*o) == position)
-                hit = o;
-        }
-        // if there was no hit, we will not be shuffling out an entry
-        // and are still filling the cache
-        if (!hit)
-            ++j;
-        // reset these
-        i = cache->count;
-        hit = NULL;
-    }
+/** Get the shared frame cache if it is enabled.
+ *
+ * \private \memberof mlt_cache_s
+ * \return the shared frame cache or NULL if frames are held per cache
+ */
 
-    // shuffle the existing entries to the alternate array
-    while (i--) {
-        mlt_frame *o = (mlt_frame *) &cache->current[i];
+static mlt_cache shared_frames()
+{
+    mlt_properties global = mlt_global_properties();
+    mlt_cache shared = global ? mlt_properties_get_data(global, "_shared_frames", NULL) : NULL;
 
-        if (!hit && mlt_frame_original_position(*o) == position) {
-            hit = o;
-        } else if (j > 0) {
-            alt[--j] = *o;
-            // 			mlt_log( NULL, MLT_LOG_DEBUG, "%s: shuffle %d = %p\n", __FUNCTION__, j, alt[j] );
-        }
+    if (!shared) {
+        pthread_once(&global_once, global_init);
+        if (shared_max_bytes > 0)
+            shared = mlt_cache_shared_frames();
     }
-    return hit;
+    return shared && shared->max_bytes > 0 ? shared : NULL;
 }
 
-static void cache_put_frame(mlt_cache cache, mlt_frame frame, int audio, int image)
+/** Put a frame clone into a frame cache.
+ *
+ * \private \memberof mlt_cache_s
+ * \param cache a frame cache
+ * \param owner the cache on whose behalf the frame is put into the shared frame cache
+ * \param clone a frame to which the cache takes the reference
+ */
+
+static void cache_put_clone(mlt_cache cache, void *owner, mlt_frame clone)
 {
+    mlt_properties properties = MLT_FRAME_PROPERTIES(clone);
+    mlt_position position = mlt_frame_original_position(clone);
+    mlt_image_format format = mlt_properties_get_int(properties, "format");
+    int width = mlt_properties_get_int(properties, "width");
+    int height = mlt_properties_get_int(properties, "height");
+    double cost = mlt_properties_get_double(properties, "cache_cost");
+
     pthread_mutex_lock(&cache->mutex);
-    mlt_frame *hit = shuffle_get_frame(cache, mlt_frame_original_position(frame));
-    mlt_frame *alt = (mlt_frame *) (cache->current == cache->A ? cache->B : cache->A);
+    cache->is_frames = 1;
+    cache_node *node = cache_find(cache, owner, NULL, position);
+    while (node
+           && (node->owner != owner || node->position != position || node->format != format
+               || node->width != width || node->height != height))
+        node = node->chain;
+    int size = frame_size(clone);
 
     // add the frame to the cache
-    if (hit) {
+    if (node) {
         // release the old data
-        mlt_frame_close(*hit);
+        mlt_frame_close(node->object);
+        node->object = clone;
+        cache_charge(cache, size - node->size);
+        node->size = size;
+        node->cost = cost > 0.0 ? cost : 1.0;
         // the MRU end gets the updated data
-        hit = &alt[cache->count - 1];
-    } else if (cache->count < cache->size) {
-        // more room in cache, add it to MRU end
-        hit = &alt[cache->count++];
+        cache_touch(cache, node);
     } else {
-        // release the entry at the LRU end
-        mlt_frame_close(cache->current[0]);
-
-        // The MRU end gets the new item
-        hit = &alt[cache->count - 1];
+        node = calloc(1, sizeof(cache_node));
+        if (node) {
+            node->object = clone;
+            node->owner = owner;
+            node->position = position;
+            node->format = format;
+            node->width = width;
+            node->height = height;
+            node->size = size;
+            node->cost = cost > 0.0 ? cost : 1.0;
+            cache_charge(cache, size);
+            cache_link(cache, node);
+        } else {
+            mlt_frame_close(clone);
+        }
     }
+    mlt_log(NULL, MLT_LOG_DEBUG, "%s: put %d = %p\n", __FUNCTION__, cache->count - 1, clone);
+
+    // release the entries at the LRU end
+    cache_evict(cache);
+    if (owner)
+        cache_evict_owner(cache, owner);
+    pthread_mutex_unlock(&cache->mutex);
+}
+
+static void cache_put_frame(mlt_cache cache, mlt_frame frame, int audio, int image)
+{
+    mlt_frame clone = NULL;
     if (audio && image) {
-        *hit = mlt_frame_clone(frame, 1);
+        clone = mlt_frame_clone(frame, 1);
     } else if (audio) {
-        *hit = mlt_frame_clone_audio(frame, 1);
+        clone = mlt_frame_clone_audio(frame, 1);
     } else if (image) {
-        *hit = mlt_frame_clone_image(frame, 1);
+        clone = mlt_frame_clone_image(frame, 1);
+    }
+    if (clone) {
+        mlt_cache shared = shared_frames();
+        if (shared && shared != cache)
+            cache_put_clone(shared, cache, clone);
+        else
+            cache_put_clone(cache, NULL, clone);
     }
-    mlt_log(NULL, MLT_LOG_DEBUG, "%s: put %d = %p\n", __FUNCTION__, cache->count - 1, frame);
-
-    // swap the current array
-    cache->current = (void **) alt;
-    cache->is_frames = 1;
-    pthread_mutex_unlock(&cache->mutex);
 }
 
 /** Put a frame in the cache with audio and video.
@@ -613,23 +992,105 @@ void mlt_cache_put_frame_image(mlt_cache cache, mlt_frame frame)
 
 mlt_frame mlt_cache_get_frame(mlt_cache cache, mlt_position position)
 {
-    mlt_frame result = NULL;
-    pthread_mutex_lock(&cache->mutex);
-    mlt_frame *hit = shuffle_get_frame(cache, position);
-    mlt_frame *alt = (mlt_frame *) (cache->current == cache->A ? cache->B : cache->A);
+    return mlt_cache_get_frame_image(cache, position, mlt_image_none, 0, 0);
+}
 
-    if (hit) {
-        // copy the hit to the MRU end
-        alt[cache->count - 1] = *hit;
-        hit = &alt[cache->count - 1];
+/** Get a frame with a particular image from the cache.
+ *
+ * You must call mlt_frame_close() on the frame you receive from this.
+ *
+ * \public \memberof mlt_cache_s
+ * \param cache a cache object
+ * \param position the position of the frame that you want
+ * \param format the image format that you want or mlt_image_none for any
+ * \param width the image width that you want or 0 for any
+ * \param height the image height that you want or 0 for any
+ * \return a frame if found or NULL if not found or has been flushed from the cache
+ * \see mlt_cache_get_frame
+ */
 
-        result = mlt_frame_clone(*hit, 1);
-        mlt_log(NULL, MLT_LOG_DEBUG, "%s: get %d = %p\n", __FUNCTION__, cache->count - 1, *hit);
+mlt_frame mlt_cache_get_frame_image(
+    mlt_cache cache, mlt_position position, mlt_image_format format, int width, int height)
+{
+    mlt_frame result = NULL;
+    mlt_cache shared = shared_frames();
+    void *owner = NULL;
 
-        // swap the current array
-        cache->current = (void **) alt;
+    if (shared && shared != cache) {
+        owner = cache;
+        cache = shared;
+    }
+    pthread_mutex_lock(&cache->mutex);
+    cache_node *node = cache->is_frames ? cache_find(cache, owner, NULL, position) : NULL;
+    while (node
+           && (node->owner != owner || node->position != position
+               || (format != mlt_image_none && node->format != format)
+               || (width > 0 && node->width != width) || (height > 0 && node->height != height)))
+        node = node->chain;
+
+    if (node) {
+        // move the hit to the MRU end
+        cache_touch(cache, node);
+
+        result = mlt_frame_clone(node->object, 1);
+        mlt_log(NULL,
+                MLT_LOG_DEBUG,
+                "%s: get %d = %p\n",
+                __FUNCTION__,
+                cache->count - 1,
+                node->object);
+        cache->hits++;
+    } else {
+        cache->misses++;
     }
     pthread_mutex_unlock(&cache->mutex);
 
     return result;
 }
+
+/** Get the frame cache shared by all caches.
+ *
+ * When the shared frame cache has a byte limit, which is initialized from the
+ * environment variable \p MLT_FRAME_CACHE_MAX_BYTES and may be changed with
+ * mlt_cache_set_max_bytes(), all frame caches put their frames into it instead
+ * of holding them. Each cache still only gets the frames that it put, and no
+ * more of them than its mlt_cache_set_size(), but the frames of all caches
+ * share one memory ceiling, evicting the least recently used frames that are
+ * cheapest to recreate. A producer can declare the cost
+ * of recreating a frame by setting the "cache_cost" property on the frame
+ * before it is put; it defaults to 1.
+ *
+ * A consumer can also use it to cache frames for scrubbing, keyed by position,
+ * image format, and size.
+ *
+ * \public \memberof mlt_cache_s
+ * \return the shared frame cache or NULL if there was an error
+ */
+
+mlt_cache mlt_cache_shared_frames()
+{
+    static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+    mlt_properties global = mlt_global_properties();
+    mlt_cache result = NULL;
+
+    if (!global)
+        return NULL;
+    pthread_mutex_lock(&mutex);
+    result = mlt_properties_get_data(global, "_shared_frames", NULL);
+    if (!result) {
+        result = mlt_cache_init();
+        if (result) {
+            result->size = INT_MAX;
+            result->max_bytes = shared_max_bytes;
+            result->is_frames = 1;
+            mlt_properties_set_data(global,
+                                    "_shared_frames",
+                                    result,
+                                    0,
+                                    (mlt_destructor) mlt_cache_close,
+                                    NULL);
+        }
+    }
+    pthread_mutex_unlock(&mutex);
+    return result;
+}
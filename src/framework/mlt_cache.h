@@ -32,6 +32,9 @@ MLT_API extern void mlt_cache_item_close(mlt_cache_item item);
 MLT_API extern mlt_cache mlt_cache_init();
 MLT_API extern void mlt_cache_set_size(mlt_cache cache, int size);
 MLT_API extern int mlt_cache_get_size(mlt_cache cache);
+MLT_API extern void mlt_cache_set_max_bytes(mlt_cache cache, int64_t max_bytes);
+MLT_API extern int64_t mlt_cache_get_max_bytes(mlt_cache cache);
+MLT_API extern void mlt_cache_get_stats(mlt_cache cache, mlt_properties properties);
 MLT_API extern void mlt_cache_close(mlt_cache cache);
 MLT_API extern void mlt_cache_purge(mlt_cache cache, void *object);
 MLT_API extern void mlt_cache_put(
@@ -41,5 +44,8 @@ MLT_API extern void mlt_cache_put_frame(mlt_cache cache, mlt_frame frame);
 MLT_API extern void mlt_cache_put_frame_audio(mlt_cache cache, mlt_frame frame);
 MLT_API extern void mlt_cache_put_frame_image(mlt_cache cache, mlt_frame frame);
 MLT_API extern mlt_frame mlt_cache_get_frame(mlt_cache cache, mlt_position position);
+MLT_API extern mlt_frame mlt_cache_get_frame_image(
+    mlt_cache cache, mlt_position position, mlt_image_format format, int width, int height);
+MLT_API extern mlt_cache mlt_cache_shared_frames();
 
 #endif
@@ -54,6 +54,8 @@ static int producer_probe(mlt_producer parent);
 static void relink_chain(mlt_chain self);
 static void chain_property_changed(mlt_service owner, mlt_chain self, char *name);
 static void source_property_changed(mlt_service owner, mlt_chain self, char *name);
+static void chain_properties_changed(mlt_service owner, mlt_chain self, mlt_event_data event_data);
+static void source_properties_changed(mlt_service owner, mlt_chain self, mlt_event_data event_data);
 
 /** Construct a chain.
  *
@@ -90,10 +92,14 @@ mlt_chain mlt_chain_init(mlt_profile profile)
             base->source_profile = NULL;
 
             // Listen to property changes to pass along to the source
+            mlt_events_listen_batched(MLT_CHAIN_PROPERTIES(self),
+                                      self,
+                                      "property-changed",
+                                      (mlt_listener) chain_property_changed);
             mlt_events_listen(MLT_CHAIN_PROPERTIES(self),
                               self,
-                              "property-changed",
-                              (mlt_listener) chain_property_changed);
+                              "properties-changed",
+                              (mlt_listener) chain_properties_changed);
         } else {
             free(self);
             self = NULL;
@@ -200,10 +206,14 @@ void mlt_chain_set_source(mlt_chain self, mlt_producer source)
         mlt_events_unblock(MLT_CHAIN_PROPERTIES(self), self);
 
         // Monitor property changes from the source to pass to the chain.
+        mlt_events_listen_batched(source_properties,
+                                  self,
+                                  "property-changed",
+                                  (mlt_listener) source_property_changed);
         mlt_events_listen(source_properties,
                           self,
-                          "property-changed",
-                          (mlt_listener) source_property_changed);
+                          "properties-changed",
+                          (mlt_listener) source_properties_changed);
 
         // This chain will control the speed and in/out
         mlt_producer_set_speed(base->source, 0.0);
@@ -594,3 +604,44 @@ static void source_property_changed(mlt_service owner, mlt_chain self, char *nam
         mlt_events_unblock(chain_properties, self);
     }
 }
+
+static void pass_changes(mlt_chain self,
+                         mlt_properties to,
+                         mlt_properties from,
+                         mlt_properties names)
+{
+    mlt_chain_base *base = self->local;
+    int count = mlt_properties_count(names);
+    // Pass the whole batch in one update so that the other side reacts to it once.
+    mlt_events_block(to, self);
+    mlt_properties_begin_update(to);
+    for (int i = 0; i < count; i++) {
+        const char *name = mlt_properties_get_name(names, i);
+        if (mlt_properties_get_int(base->source_parameters, name) || !strncmp(name, "meta.", 5))
+            mlt_properties_pass_property(to, from, name);
+    }
+    mlt_properties_commit_update(to);
+    mlt_events_unblock(to, self);
+}
+
+static void chain_properties_changed(mlt_service owner, mlt_chain self, mlt_event_data event_data)
+{
+    mlt_chain_base *base = self->local;
+    mlt_properties names = mlt_event_data_to_object(event_data);
+    if (base->source && names)
+        pass_changes(self,
+                     MLT_PRODUCER_PROPERTIES(base->source),
+                     MLT_CHAIN_PROPERTIES(self),
+                     names);
+}
+
+static void source_properties_changed(mlt_service owner, mlt_chain self, mlt_event_data event_data)
+{
+    mlt_chain_base *base = self->local;
+    mlt_properties names = mlt_event_data_to_object(event_data);
+    if (base->source && names)
+        pass_changes(self,
+                     MLT_CHAIN_PROPERTIES(self),
+                     MLT_PRODUCER_PROPERTIES(base->source),
+                     names);
+}
@@ -27,6 +27,7 @@
 #include "mlt_producer.h"
 #include "mlt_profile.h"
 
+#include <math.h>
 #include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -50,6 +51,25 @@ MLT_API  pthread_mutex_t mlt_sdl_mutex = PTHREAD_MUTEX_INITIALIZER;
  */
 MLT_API  pthread_mutex_t mlt_frame_processing_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+/** the number of frames over which the rolling statistics are averaged */
+#define TELEMETRY_WINDOW (25.0)
+
+/** the number of frames shown between updates of the telemetry properties of the consumer */
+#define TELEMETRY_INTERVAL (25)
+
+/** the stages of processing a frame for which telemetry is recorded */
+enum {
+    TELEMETRY_GET_FRAME,
+    TELEMETRY_GET_AUDIO,
+    TELEMETRY_GET_IMAGE,
+    TELEMETRY_QUEUE_WAIT,
+    TELEMETRY_SHOW,
+    TELEMETRY_COUNT
+};
+
+static const char *telemetry_names[TELEMETRY_COUNT]
+    = {"get_frame", "get_audio", "get_image", "queue_wait", "show"};
+
 /** \brief private members of mlt_consumer */
 
 typedef struct
@@ -85,6 +105,18 @@ typedef struct
     int process_head;
     atomic_int started;
     pthread_t *threads; /**< used to deallocate all threads */
+    pthread_t feeder_thread; /**< gets frames and audio in order for renders with real_time < -1 */
+    int has_feeder;
+    /* additional fields added for telemetry and the adaptive read-ahead queue */
+    pthread_mutex_t telemetry_mutex;
+    double telemetry_mean[TELEMETRY_COUNT]; /**< rolling mean microseconds per stage */
+    double telemetry_dev[TELEMETRY_COUNT];  /**< rolling mean absolute deviation per stage */
+    int telemetry_queue;                    /**< frames queued when the last frame was taken */
+    int telemetry_buffer;                   /**< the last size of the read-ahead queue */
+    const char *telemetry_skip;             /**< why the last frame was not rendered */
+    int telemetry_shown;                    /**< frames shown since the properties were updated */
+    atomic_int adaptive_buffer; /**< the current read-ahead queue size or 0 if not adapting */
+    int frame_render_event;     /**< the event id of consumer-frame-render, fired for every frame */
 } consumer_private;
 
 static void mlt_consumer_property_changed(mlt_properties owner, mlt_consumer self, mlt_event_data);
@@ -92,6 +124,10 @@ static void apply_profile_properties(mlt_consumer self,
                                      mlt_profile profile,
                                      mlt_properties properties);
 static void on_consumer_frame_show(mlt_properties owner, mlt_consumer self, mlt_event_data);
+static int64_t telemetry_time(mlt_consumer self);
+static void *consumer_feeder_thread(void *arg);
+static void telemetry_record(mlt_consumer self, mlt_frame frame, int stage, int64_t since);
+static void telemetry_publish(mlt_consumer self);
 static void mlt_thread_create(mlt_consumer self, mlt_thread_function_t function);
 static void mlt_thread_join(mlt_consumer self);
 static void consumer_read_ahead_start(mlt_consumer self);
@@ -163,6 +199,8 @@ int mlt_consumer_init(mlt_consumer self, void *child, mlt_profile profile)
         mlt_events_register(properties, "consumer-stopped");
         mlt_events_register(properties, "consumer-thread-create");
         mlt_events_register(properties, "consumer-thread-join");
+        mlt_events_register(properties, "consumer-frame-telemetry");
+        priv->frame_render_event = mlt_events_lookup(properties, "consumer-frame-render");
         mlt_events_listen(properties,
                           self,
                           "consumer-frame-show",
@@ -180,6 +218,7 @@ int mlt_consumer_init(mlt_consumer self, void *child, mlt_profile profile)
         pthread_cond_init(&priv->put_cond, NULL);
 
         pthread_mutex_init(&priv->position_mutex, NULL);
+        pthread_mutex_init(&priv->telemetry_mutex, NULL);
     }
     return error;
 }
@@ -318,7 +357,7 @@ static void mlt_consumer_property_changed(mlt_properties owner,
 
 /** A listener on the consumer-frame-show event
  *
- * Saves the position of the frame shown.
+ * Saves the position of the frame shown and reports its telemetry.
  *
  * \private \memberof mlt_consumer_s
  * \param owner the events object
@@ -336,6 +375,18 @@ static void on_consumer_frame_show(mlt_properties owner,
         pthread_mutex_lock(&priv->position_mutex);
         priv->position = mlt_frame_get_position(frame);
         pthread_mutex_unlock(&priv->position_mutex);
+
+        int64_t start = mlt_properties_get_int64(MLT_FRAME_PROPERTIES(frame), "_telemetry.start");
+        if (start && mlt_properties_get_int(MLT_CONSUMER_PROPERTIES(consumer), "telemetry")) {
+            telemetry_record(consumer, frame, TELEMETRY_SHOW, start);
+            if (++priv->telemetry_shown >= TELEMETRY_INTERVAL) {
+                priv->telemetry_shown = 0;
+                telemetry_publish(consumer);
+            }
+            mlt_events_fire(MLT_CONSUMER_PROPERTIES(consumer),
+                            "consumer-frame-telemetry",
+                            mlt_event_data_from_frame(frame));
+        }
     }
 }
 
@@ -714,6 +765,157 @@ static inline long time_difference(struct timeval *time1)
     return time1->tv_sec * 1000000 + time1->tv_usec - time2.tv_sec * 1000000 - time2.tv_usec;
 }
 
+/** Get the current time if telemetry is enabled.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \return the time in microseconds or 0 if telemetry is not enabled
+ */
+
+static int64_t telemetry_time(mlt_consumer self)
+{
+    struct timeval now;
+    if (!mlt_properties_get_int(MLT_CONSUMER_PROPERTIES(self), "telemetry"))
+        return 0;
+    gettimeofday(&now, NULL);
+    return (int64_t) now.tv_sec * 1000000 + now.tv_usec;
+}
+
+/** Record the time taken by a stage of processing a frame.
+ *
+ * This sets the duration on the frame and updates the rolling statistics of
+ * the consumer, which telemetry_publish() copies to its properties.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param frame a frame
+ * \param stage the stage of processing
+ * \param since the time returned by telemetry_time() when the stage began
+ */
+
+static void telemetry_record(mlt_consumer self, mlt_frame frame, int stage, int64_t since)
+{
+    consumer_private *priv = self->local;
+    int64_t now = telemetry_time(self);
+    char name[64];
+
+    if (!since || !now || !frame)
+        return;
+    int64_t duration = now - since;
+    snprintf(name, sizeof(name), "telemetry.%s", telemetry_names[stage]);
+    mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame), name, duration);
+
+    pthread_mutex_lock(&priv->telemetry_mutex);
+    double delta = duration - priv->telemetry_mean[stage];
+    priv->telemetry_mean[stage] += delta / TELEMETRY_WINDOW;
+    priv->telemetry_dev[stage] += (fabs(delta) - priv->telemetry_dev[stage]) / TELEMETRY_WINDOW;
+    pthread_mutex_unlock(&priv->telemetry_mutex);
+}
+
+/** Copy the rolling statistics to the telemetry properties of the consumer.
+ *
+ * This is done once every TELEMETRY_INTERVAL frames shown and as a single
+ * update so that listeners on property-changed are not called for every
+ * stage of every frame.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ */
+
+static void telemetry_publish(mlt_consumer self)
+{
+    consumer_private *priv = self->local;
+    mlt_properties properties = MLT_CONSUMER_PROPERTIES(self);
+    double mean[TELEMETRY_COUNT];
+    double dev[TELEMETRY_COUNT];
+    char name[64];
+
+    pthread_mutex_lock(&priv->telemetry_mutex);
+    memcpy(mean, priv->telemetry_mean, sizeof(mean));
+    memcpy(dev, priv->telemetry_dev, sizeof(dev));
+    int queue = priv->telemetry_queue;
+    int buffer = priv->telemetry_buffer;
+    const char *skip = priv->telemetry_skip;
+    priv->telemetry_skip = NULL;
+    pthread_mutex_unlock(&priv->telemetry_mutex);
+
+    mlt_properties_begin_update(properties);
+    for (int stage = 0; stage < TELEMETRY_COUNT; stage++) {
+        snprintf(name, sizeof(name), "telemetry.%s", telemetry_names[stage]);
+        mlt_properties_set_double(properties, name, mean[stage]);
+        snprintf(name, sizeof(name), "telemetry.%s.dev", telemetry_names[stage]);
+        mlt_properties_set_double(properties, name, dev[stage]);
+    }
+    mlt_properties_set_int(properties, "telemetry.queue", queue);
+    mlt_properties_set_int(properties, "telemetry.buffer", buffer);
+    if (skip)
+        mlt_properties_set(properties, "telemetry.skip_reason", skip);
+    mlt_properties_commit_update(properties);
+}
+
+/** Record why the image of a frame is not rendered.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param frame a frame
+ * \param reason a short description, which must be a string constant
+ */
+
+static void telemetry_skip(mlt_consumer self, mlt_frame frame, const char *reason)
+{
+    if (mlt_properties_get_int(MLT_CONSUMER_PROPERTIES(self), "telemetry")) {
+        consumer_private *priv = self->local;
+        mlt_properties_set(MLT_FRAME_PROPERTIES(frame), "telemetry.skip_reason", reason);
+        pthread_mutex_lock(&priv->telemetry_mutex);
+        priv->telemetry_skip = reason;
+        pthread_mutex_unlock(&priv->telemetry_mutex);
+    }
+}
+
+/** Record that a frame is taken from the queue.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param frame a frame
+ * \param queued the number of frames remaining in the queue
+ */
+
+static void telemetry_dequeue(mlt_consumer self, mlt_frame frame, int queued)
+{
+    if (frame && mlt_properties_get_int(MLT_CONSUMER_PROPERTIES(self), "telemetry")) {
+        mlt_properties frame_properties = MLT_FRAME_PROPERTIES(frame);
+        int64_t queued_at = mlt_properties_get_int64(frame_properties, "_telemetry.queued");
+        consumer_private *priv = self->local;
+        telemetry_record(self, frame, TELEMETRY_QUEUE_WAIT, queued_at);
+        pthread_mutex_lock(&priv->telemetry_mutex);
+        priv->telemetry_queue = queued;
+        pthread_mutex_unlock(&priv->telemetry_mutex);
+    }
+}
+
+/** Compute the size of the read-ahead queue from the cost of processing frames.
+ *
+ * The queue must hold enough frames to absorb the slowest frames expected,
+ * which is taken to be four deviations above the mean processing time.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param buffer the maximum size of the queue
+ * \param mean the rolling mean microseconds to process a frame
+ * \param dev the rolling mean absolute deviation of the microseconds to process a frame
+ * \param frame_duration the microseconds per frame
+ * \return the size of the queue
+ */
+
+static int adaptive_buffer_size(
+    mlt_consumer self, int buffer, double mean, double dev, int frame_duration)
+{
+    int prefill = mlt_properties_get_int(MLT_CONSUMER_PROPERTIES(self), "prefill");
+    int minimum = prefill > 0 ? MIN(prefill, buffer) : 1;
+    int needed = frame_duration > 0 ? ceil((mean + 4.0 * dev) / frame_duration) + 1 : buffer;
+    return CLAMP(needed, minimum, buffer);
+}
+
 /** The thread procedure for asynchronously pulling frames through the service
  * network connected to a consumer.
  *
@@ -763,6 +965,11 @@ static void *consumer_read_ahead_thread(void *arg)
     mlt_position last_pos = 0;
     int frame_duration = mlt_properties_get_int(properties, "frame_duration");
     int drop_max = mlt_properties_get_int(properties, "drop_max");
+    int64_t telemetry_start = 0;
+
+    // Rolling statistics of the cost of processing a frame for the adaptive buffer
+    double cost_mean = 0.0;
+    double cost_dev = 0.0;
 
     if (preview_off && preview_format != 0)
         priv->image_format = preview_format;
@@ -773,7 +980,11 @@ static void *consumer_read_ahead_thread(void *arg)
     mlt_events_fire(properties, "consumer-thread-started", mlt_event_data_none());
 
     // Get the first frame
+    telemetry_start = telemetry_time(self);
     frame = mlt_consumer_get_frame(self);
+    telemetry_record(self, frame, TELEMETRY_GET_FRAME, telemetry_start);
+    if (frame && telemetry_start)
+        mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame), "_telemetry.start", telemetry_start);
     if (priv->speed != mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "_speed")) {
         priv->speed = mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "_speed");
         // get_frame might want to recalculate the minimum queue size if the speed has changed.
@@ -796,9 +1007,9 @@ static void *consumer_read_ahead_thread(void *arg)
 
         // Get the image of the first frame
         if (!video_off) {
-            mlt_events_fire(MLT_CONSUMER_PROPERTIES(self),
-                            "consumer-frame-render",
-                            mlt_event_data_from_frame(frame));
+            mlt_events_fire_id(MLT_CONSUMER_PROPERTIES(self),
+                               priv->frame_render_event,
+                               mlt_event_data_from_frame(frame));
             mlt_frame_get_image(frame, &image, &priv->image_format, &width, &height, 0);
         }
 
@@ -816,14 +1027,28 @@ static void *consumer_read_ahead_thread(void *arg)
         int buffer = (priv->speed == 0) ? 1
                                         : MAX(mlt_properties_get_int(properties, "buffer"), 0) + 1;
 
+        // Size the queue by the cost of processing frames if requested
+        int limit = buffer;
+        if (mlt_properties_get_int(properties, "adaptive_buffer") && priv->speed == 1)
+            limit = adaptive_buffer_size(self, buffer, cost_mean, cost_dev, frame_duration);
+        priv->adaptive_buffer = limit < buffer ? limit : 0;
+        pthread_mutex_lock(&priv->telemetry_mutex);
+        priv->telemetry_buffer = limit;
+        pthread_mutex_unlock(&priv->telemetry_mutex);
+
         // Put the current frame into the queue
         pthread_mutex_lock(&priv->queue_mutex);
-        while (priv->ahead && mlt_deque_count(priv->queue) >= buffer)
+        while (priv->ahead && mlt_deque_count(priv->queue) >= limit)
             pthread_cond_wait(&priv->queue_cond, &priv->queue_mutex);
         if (priv->is_purge) {
             mlt_frame_close(frame);
             priv->is_purge = 0;
         } else {
+            telemetry_start = telemetry_time(self);
+            if (frame && telemetry_start)
+                mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame),
+                                         "_telemetry.queued",
+                                         telemetry_start);
             mlt_deque_push_back(priv->queue, frame);
         }
         pthread_cond_broadcast(&priv->queue_cond);
@@ -831,12 +1056,18 @@ static void *consumer_read_ahead_thread(void *arg)
 
         mlt_log_timings_begin();
         // Get the next frame
+        telemetry_start = telemetry_time(self);
         frame = mlt_consumer_get_frame(self);
         mlt_log_timings_end(NULL, "mlt_consumer_get_frame");
 
         // If there's no frame, we're probably stopped...
         if (frame == NULL)
             continue;
+        telemetry_record(self, frame, TELEMETRY_GET_FRAME, telemetry_start);
+        if (telemetry_start)
+            mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame),
+                                     "_telemetry.start",
+                                     telemetry_start);
         pos = mlt_frame_get_position(frame);
         priv->speed = mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "_speed");
 
@@ -851,12 +1082,14 @@ static void *consumer_read_ahead_thread(void *arg)
             samples = mlt_audio_calculate_frame_samples(priv->fps,
                                                         priv->frequency,
                                                         priv->aud_counter++);
+            telemetry_start = telemetry_time(self);
             mlt_frame_get_audio(frame,
                                 &audio,
                                 &priv->audio_format,
                                 &priv->frequency,
                                 &priv->channels,
                                 &samples);
+            telemetry_record(self, frame, TELEMETRY_GET_AUDIO, telemetry_start);
         }
 
         // All non-normal playback frames should be shown
@@ -876,11 +1109,13 @@ static void *consumer_read_ahead_thread(void *arg)
                 height = mlt_properties_get_int(properties, "height");
 
                 // Get the image
-                mlt_events_fire(MLT_CONSUMER_PROPERTIES(self),
-                                "consumer-frame-render",
-                                mlt_event_data_from_frame(frame));
+                mlt_events_fire_id(MLT_CONSUMER_PROPERTIES(self),
+                                   priv->frame_render_event,
+                                   mlt_event_data_from_frame(frame));
                 mlt_log_timings_begin();
+                telemetry_start = telemetry_time(self);
                 mlt_frame_get_image(frame, &image, &priv->image_format, &width, &height, 0);
+                telemetry_record(self, frame, TELEMETRY_GET_IMAGE, telemetry_start);
                 mlt_log_timings_end(NULL, "mlt_frame_get_image");
             }
 
@@ -893,6 +1128,7 @@ static void *consumer_read_ahead_thread(void *arg)
         {
             // Increment the number of consecutively-skipped frames
             skipped++;
+            telemetry_skip(self, frame, "average processing time exceeds frame duration");
 
             // If too many (1 sec) consecutively-skipped frames
             if (skipped > drop_max) {
@@ -906,6 +1142,15 @@ static void *consumer_read_ahead_thread(void *arg)
         // Get the time to process this frame
         int64_t time_current = time_difference(&ante);
 
+        // Update the rolling cost of processing a rendered frame
+        if (!skipped && cost_mean == 0.0) {
+            cost_mean = time_current;
+        } else if (!skipped) {
+            double delta = time_current - cost_mean;
+            cost_mean += delta / TELEMETRY_WINDOW;
+            cost_dev += (fabs(delta) - cost_dev) / TELEMETRY_WINDOW;
+        }
+
         // If the current time is not suddenly some large amount
         if (time_current < time_process / count * 20 || !time_process || count < 5) {
             // Accumulate the cost for processing this frame
@@ -1082,10 +1327,12 @@ static void *consumer_worker_thread(void *arg)
             // Fetch width/height again
             width = mlt_properties_get_int(properties, "width");
             height = mlt_properties_get_int(properties, "height");
-            mlt_events_fire(MLT_CONSUMER_PROPERTIES(self),
-                            "consumer-frame-render",
-                            mlt_event_data_from_frame(frame));
+            mlt_events_fire_id(MLT_CONSUMER_PROPERTIES(self),
+                               priv->frame_render_event,
+                               mlt_event_data_from_frame(frame));
+            int64_t telemetry_start = telemetry_time(self);
             mlt_frame_get_image(frame, &image, &format, &width, &height, 0);
+            telemetry_record(self, frame, TELEMETRY_GET_IMAGE, telemetry_start);
         }
         mlt_properties_set_int(MLT_FRAME_PROPERTIES(frame), "rendered", 1);
         mlt_frame_close(frame);
@@ -1204,6 +1451,14 @@ static void consumer_work_start(mlt_consumer self)
             thread++;
         }
     }
+
+    // Without frame dropping, get frames and audio on their own thread. Interactive consumers
+    // purge and seek too often for frames read ahead to be of use, so only do this for renders.
+    if (priv->real_time < -1
+        && mlt_properties_get_int(MLT_CONSUMER_PROPERTIES(self), "terminate_on_pause")) {
+        int error = pthread_create(&priv->feeder_thread, NULL, consumer_feeder_thread, self);
+        priv->has_feeder = !error;
+    }
     priv->started = 1;
 }
 
@@ -1279,6 +1534,9 @@ static void consumer_work_stop(mlt_consumer self)
 
         // Join the threads
         pthread_t *thread;
+        if (priv->has_feeder)
+            pthread_join(priv->feeder_thread, NULL);
+        priv->has_feeder = 0;
         while ((thread = mlt_deque_pop_back(priv->worker_threads)))
             pthread_join(*thread, NULL);
 
@@ -1359,20 +1617,193 @@ void mlt_consumer_purge(mlt_consumer self)
 /** Use multiple worker threads and a work queue.
  */
 
-static mlt_frame worker_get_frame(mlt_consumer self, mlt_properties properties)
+/** Get the next frame and its audio for the work queue.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param properties the consumer's properties
+ * \return a frame or NULL
+ */
+
+static mlt_frame worker_read_frame(mlt_consumer self, mlt_properties properties)
 {
-    // Frame to return
-    mlt_frame frame = NULL;
     consumer_private *priv = self->local;
-    int threads = abs(priv->real_time);
-    int audio_off = mlt_properties_get_int(properties, "audio_off");
     int samples = 0;
     void *audio = NULL;
+
+    int64_t telemetry_start = telemetry_time(self);
+    mlt_frame frame = mlt_consumer_get_frame(self);
+    if (frame) {
+        telemetry_record(self, frame, TELEMETRY_GET_FRAME, telemetry_start);
+        if (telemetry_start)
+            mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame),
+                                     "_telemetry.start",
+                                     telemetry_start);
+
+        // Process the audio
+        if (!mlt_properties_get_int(properties, "audio_off")) {
+            samples = mlt_audio_calculate_frame_samples(priv->fps,
+                                                        priv->frequency,
+                                                        priv->aud_counter++);
+            telemetry_start = telemetry_time(self);
+            mlt_frame_get_audio(frame,
+                                &audio,
+                                &priv->audio_format,
+                                &priv->frequency,
+                                &priv->channels,
+                                &samples);
+            telemetry_record(self, frame, TELEMETRY_GET_AUDIO, telemetry_start);
+        }
+        if (mlt_properties_get_int(properties, "telemetry"))
+            mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame),
+                                     "_telemetry.queued",
+                                     telemetry_time(self));
+        priv->speed = mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "_speed");
+    }
+    return frame;
+}
+
+/** Get the number of frames permitted in the work queue.
+ *
+ * This applies the buffer_bytes property to bound the memory of the images
+ * in flight.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \param buffer the maximum number of frames
+ * \return the number of frames
+ */
+
+static int worker_window(mlt_consumer self, int buffer)
+{
+    consumer_private *priv = self->local;
+    mlt_properties properties = MLT_CONSUMER_PROPERTIES(self);
+    int64_t max_bytes = mlt_properties_get_int64(properties, "buffer_bytes");
+
+    if (priv->speed == 0)
+        return 1;
+    if (max_bytes > 0 && !mlt_properties_get_int(properties, "video_off")) {
+        int64_t frame_bytes = mlt_image_format_size(priv->image_format,
+                                                    mlt_properties_get_int(properties, "width"),
+                                                    mlt_properties_get_int(properties, "height"),
+                                                    NULL);
+        if (frame_bytes > 0)
+            buffer = CLAMP(max_bytes / frame_bytes, 1, buffer);
+    }
+    return buffer;
+}
+
+/** Get the size of the work queue.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \return the number of frames
+ */
+
+static int worker_buffer(mlt_consumer self)
+{
+    consumer_private *priv = self->local;
+    mlt_properties properties = MLT_CONSUMER_PROPERTIES(self);
+    int threads = abs(priv->real_time);
     int buffer = mlt_properties_get_int(properties, "_buffer");
     buffer = buffer > 0 ? buffer : mlt_properties_get_int(properties, "buffer");
     // This is a heuristic to determine a suitable minimum buffer size for the number of threads.
     int headroom = (priv->real_time < 0) ? threads : (2 + threads * threads);
-    buffer = MAX(buffer, headroom);
+    return MAX(buffer, headroom);
+}
+
+/** Locate the first unprocessed frame in the queue while it may be fed concurrently.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \return an index into the queue
+ */
+
+static int worker_unprocessed_frame(mlt_consumer self)
+{
+    consumer_private *priv = self->local;
+    pthread_mutex_lock(&priv->queue_mutex);
+    int index = first_unprocessed_frame(self);
+    pthread_mutex_unlock(&priv->queue_mutex);
+    return index;
+}
+
+/** Determine whether the frame at the head of the queue is rendered.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param self a consumer
+ * \return true if there is a frame and it is rendered
+ */
+
+static int worker_head_rendered(mlt_consumer self)
+{
+    consumer_private *priv = self->local;
+    pthread_mutex_lock(&priv->queue_mutex);
+    mlt_frame frame = mlt_deque_peek_front(priv->queue);
+    int rendered = frame && mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "rendered");
+    pthread_mutex_unlock(&priv->queue_mutex);
+    return rendered;
+}
+
+/** The feeder thread procedure for parallel processing frames without dropping.
+ *
+ * This gets frames and their audio in order and adds them to the work queue
+ * so that the consumer's own thread only waits for the next frame to finish.
+ *
+ * \private \memberof mlt_consumer_s
+ * \param arg a consumer
+ */
+
+static void *consumer_feeder_thread(void *arg)
+{
+    mlt_consumer self = arg;
+    consumer_private *priv = self->local;
+    mlt_properties properties = MLT_CONSUMER_PROPERTIES(self);
+    int buffer = worker_buffer(self);
+
+    while (priv->ahead) {
+        // Wait for room in the work queue before getting the frame so that it is not stale.
+        int limit = worker_window(self, buffer);
+        pthread_mutex_lock(&priv->queue_mutex);
+        while (priv->ahead && mlt_deque_count(priv->queue) >= limit)
+            pthread_cond_wait(&priv->queue_cond, &priv->queue_mutex);
+        priv->is_purge = 0;
+        pthread_mutex_unlock(&priv->queue_mutex);
+
+        mlt_frame frame = worker_read_frame(self, properties);
+
+        // If there's no frame, we're probably stopped...
+        if (frame == NULL)
+            continue;
+
+        // Drop the frame if the queue was purged while getting it
+        pthread_mutex_lock(&priv->queue_mutex);
+        if (priv->is_purge) {
+            priv->is_purge = 0;
+        } else if (priv->ahead) {
+            mlt_deque_push_back(priv->queue, frame);
+            frame = NULL;
+        }
+        pthread_cond_broadcast(&priv->queue_cond);
+        pthread_mutex_unlock(&priv->queue_mutex);
+        mlt_frame_close(frame);
+
+        // Tell the consumer thread there may be a frame at the head of the queue.
+        pthread_mutex_lock(&priv->done_mutex);
+        pthread_cond_broadcast(&priv->done_cond);
+        pthread_mutex_unlock(&priv->done_mutex);
+    }
+
+    return NULL;
+}
+
+static mlt_frame worker_get_frame(mlt_consumer self, mlt_properties properties)
+{
+    // Frame to return
+    mlt_frame frame = NULL;
+    consumer_private *priv = self->local;
+    int threads = abs(priv->real_time);
+    int buffer = worker_buffer(self);
 
     // Start worker threads if not already started.
     if (!priv->ahead) {
@@ -1385,81 +1816,53 @@ static mlt_frame worker_get_frame(mlt_consumer self, mlt_properties properties)
 
         // Fill the work queue.
         int i = buffer;
-        while (priv->ahead && i--) {
-            frame = mlt_consumer_get_frame(self);
+        while (priv->ahead && !priv->has_feeder && i--) {
+            frame = worker_read_frame(self, properties);
             if (frame) {
-                // Process the audio
-                if (!audio_off) {
-                    samples = mlt_audio_calculate_frame_samples(priv->fps,
-                                                                priv->frequency,
-                                                                priv->aud_counter++);
-                    mlt_frame_get_audio(frame,
-                                        &audio,
-                                        &priv->audio_format,
-                                        &priv->frequency,
-                                        &priv->channels,
-                                        &samples);
-                }
                 pthread_mutex_lock(&priv->queue_mutex);
                 mlt_deque_push_back(priv->queue, frame);
                 pthread_cond_signal(&priv->queue_cond);
                 pthread_mutex_unlock(&priv->queue_mutex);
-                priv->speed = mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "_speed");
                 buffer = (priv->speed == 0) ? 1 : buffer;
             }
         }
 
-        // Wait for prefill
-        while (priv->ahead && first_unprocessed_frame(self) < prefill) {
-            pthread_mutex_lock(&priv->done_mutex);
+        // Wait for prefill unless waiting for each frame below
+        pthread_mutex_lock(&priv->done_mutex);
+        while (priv->ahead && !priv->has_feeder && worker_unprocessed_frame(self) < prefill)
             pthread_cond_wait(&priv->done_cond, &priv->done_mutex);
-            pthread_mutex_unlock(&priv->done_mutex);
-        }
+        pthread_mutex_unlock(&priv->done_mutex);
         priv->process_head = threads;
     }
 
     //	mlt_log_verbose( MLT_CONSUMER_SERVICE(self), "size %d done count %d work count %d process_head %d\n",
     //		threads, first_unprocessed_frame( self ), mlt_deque_count( priv->queue ), priv->process_head );
 
-    // Feed the work queupriv->speede
-    while (priv->ahead && mlt_deque_count(priv->queue) < buffer) {
-        frame = mlt_consumer_get_frame(self);
+    // Feed the work queue
+    while (priv->ahead && !priv->has_feeder && mlt_deque_count(priv->queue) < buffer) {
+        frame = worker_read_frame(self, properties);
         if (frame) {
-            // Process the audio
-            if (!audio_off) {
-                samples = mlt_audio_calculate_frame_samples(priv->fps,
-                                                            priv->frequency,
-                                                            priv->aud_counter++);
-                mlt_frame_get_audio(frame,
-                                    &audio,
-                                    &priv->audio_format,
-                                    &priv->frequency,
-                                    &priv->channels,
-                                    &samples);
-            }
             pthread_mutex_lock(&priv->queue_mutex);
             mlt_deque_push_back(priv->queue, frame);
             pthread_cond_signal(&priv->queue_cond);
             pthread_mutex_unlock(&priv->queue_mutex);
-            priv->speed = mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "_speed");
             buffer = (priv->speed == 0) ? 1 : buffer;
         }
     }
 
     // Wait if not realtime.
-    while (priv->ahead && priv->real_time < 0 && !priv->is_purge
-           && !(mlt_properties_get_int(MLT_FRAME_PROPERTIES(
-                                           MLT_FRAME(mlt_deque_peek_front(priv->queue))),
-                                       "rendered"))) {
-        pthread_mutex_lock(&priv->done_mutex);
+    pthread_mutex_lock(&priv->done_mutex);
+    while (priv->ahead && priv->real_time < 0 && !priv->is_purge && !worker_head_rendered(self))
         pthread_cond_wait(&priv->done_cond, &priv->done_mutex);
-        pthread_mutex_unlock(&priv->done_mutex);
-    }
+    pthread_mutex_unlock(&priv->done_mutex);
 
     // Get the frame from the queue.
     pthread_mutex_lock(&priv->queue_mutex);
     frame = mlt_deque_pop_front(priv->queue);
+    int queued = mlt_deque_count(priv->queue);
+    pthread_cond_broadcast(&priv->queue_cond);
     pthread_mutex_unlock(&priv->queue_mutex);
+    telemetry_dequeue(self, frame, queued);
     if (!frame) {
         priv->is_purge = 0;
         return frame;
@@ -1503,6 +1906,7 @@ static mlt_frame worker_get_frame(mlt_consumer self, mlt_properties properties)
             }
         }
         if (!mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "rendered")) {
+            telemetry_skip(self, frame, "workers did not render before playout");
             int dropped = mlt_properties_get_int(properties, "drop_count");
             mlt_properties_set_int(properties, "drop_count", ++dropped);
             mlt_log_verbose(MLT_CONSUMER_SERVICE(self), "dropped video frame %d\n", dropped);
@@ -1556,10 +1960,15 @@ mlt_frame mlt_consumer_rt_frame(mlt_consumer self)
         }
 
         // Get frame from queue
+        int queued = 0;
         pthread_mutex_lock(&priv->queue_mutex);
         mlt_log_timings_begin();
         while (priv->ahead && mlt_deque_count(priv->queue) < size) {
-            pthread_cond_wait(&priv->queue_cond, &priv->queue_mutex);
+            // The adaptive buffer may hold fewer frames than the preroll
+            if (priv->adaptive_buffer > 0 && size > priv->adaptive_buffer)
+                size = priv->adaptive_buffer;
+            else
+                pthread_cond_wait(&priv->queue_cond, &priv->queue_mutex);
             if (priv->speed == 0) {
                 size = 1;
             } else if (priv->preroll) {
@@ -1569,9 +1978,11 @@ mlt_frame mlt_consumer_rt_frame(mlt_consumer self)
             }
         }
         frame = mlt_deque_pop_front(priv->queue);
+        queued = mlt_deque_count(priv->queue);
         mlt_log_timings_end(NULL, "wait_for_frame_queue");
         pthread_cond_broadcast(&priv->queue_cond);
         pthread_mutex_unlock(&priv->queue_mutex);
+        telemetry_dequeue(self, frame, queued);
         if (priv->real_time == 1 && frame
             && !mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "rendered")) {
             int dropped = mlt_properties_get_int(properties, "drop_count");
@@ -1585,11 +1996,17 @@ mlt_frame mlt_consumer_rt_frame(mlt_consumer self)
             mlt_events_fire(properties, "consumer-thread-started", mlt_event_data_none());
         }
         // Get the frame in non real time
+        int64_t telemetry_start = telemetry_time(self);
         frame = mlt_consumer_get_frame(self);
 
         // This isn't true, but from the consumers perspective it is
         if (frame != NULL) {
             mlt_properties_set_int(MLT_FRAME_PROPERTIES(frame), "rendered", 1);
+            telemetry_record(self, frame, TELEMETRY_GET_FRAME, telemetry_start);
+            if (telemetry_start)
+                mlt_properties_set_int64(MLT_FRAME_PROPERTIES(frame),
+                                         "_telemetry.start",
+                                         telemetry_start);
 
             // WebVfx uses this to setup a consumer-stopping event handler.
             mlt_properties_set_data(MLT_FRAME_PROPERTIES(frame), "consumer", self, 0, NULL, NULL);
@@ -1658,6 +2075,12 @@ int mlt_consumer_stop(mlt_consumer self)
     else if (abs(priv->real_time) > 1)
         consumer_work_stop(self);
 
+    // Report the telemetry of the frames shown since the last update
+    if (mlt_properties_get_int(properties, "telemetry")) {
+        priv->telemetry_shown = 0;
+        telemetry_publish(self);
+    }
+
     // Kill the test card
     mlt_properties_set_data(properties, "test_card_producer", NULL, 0, NULL, NULL);
 
@@ -1719,6 +2142,7 @@ void mlt_consumer_close(mlt_consumer self)
             pthread_cond_destroy(&priv->put_cond);
 
             pthread_mutex_destroy(&priv->position_mutex);
+            pthread_mutex_destroy(&priv->telemetry_mutex);
 
             mlt_service_close(&self->parent);
             free(priv);
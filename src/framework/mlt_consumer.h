@@ -41,13 +41,20 @@
  * render thread, defaults to 25
  * \properties \em prefill the number of frames to render before commencing
  * output when real_time <> 0, defaults to the size of buffer
+ * \properties \em buffer_bytes the approximate maximum bytes of images to hold in the work
+ * queue when real_time < -1, which reduces the number of frames in flight below buffer for
+ * large images; default is 0 (unlimited)
  * \properties \em drop_max the maximum number of consecutively dropped frames, defaults to 5
  * \properties \em frequency the audio sample rate to use in Hertz, defaults to 48000
  * \properties \em channels the number of audio channels to use, defaults to 2
  * \properties \em channel_layout the layout of the audio channels, defaults to auto.
  * other options include: mono, stereo, 5.1, 7.1, etc.
  * \properties \em real_time the asynchronous behavior: 1 (default) for asynchronous
- * with frame dropping, -1 for asynchronous without frame dropping, 0 to disable (synchronous)
+ * with frame dropping, -1 for asynchronous without frame dropping, 0 to disable (synchronous).
+ * The magnitude when greater than 1 is the number of threads rendering images in parallel.
+ * Below -1, frames are delivered in order as each completes, and when terminate_on_pause is
+ * set (a render rather than a player), another thread gets the frames and their audio in order
+ * ahead of the image threads.
  * \properties \em test_card the name of a resource to use as the test card, defaults to
  * environment variable MLT_TEST_CARD. If undefined, the hard-coded default test card is
  * white silence. A test card is what appears when nothing is produced.
@@ -89,6 +96,24 @@
  * \properties \em color_range the color range as tv/mpeg (limited) or pc/jpeg (full); default is unset, which implies tv/mpeg
  * \properties \em color_trc the color transfer characteristic (gamma), default is unset, use FFmpeg's string values
  * \properties \em deinterlacer the deinterlace algorithm to pass to deinterlace filters, defaults to "yadif"
+ * \properties \em adaptive_buffer set non-zero to size the read-ahead queue of real_time 1 or -1
+ * from the measured mean and variation of the time to process a frame, between prefill (or 1) and buffer
+ * \properties \em telemetry set non-zero to record the time taken by each stage of each frame
+ * The following are updated every 25 frames shown and when the consumer stops.
+ * \properties \em telemetry.get_frame the rolling mean of the microseconds to get a frame (read only)
+ * \properties \em telemetry.get_audio the rolling mean of the microseconds to get audio (read only)
+ * \properties \em telemetry.get_image the rolling mean of the microseconds to get an image (read only)
+ * \properties \em telemetry.queue_wait the rolling mean of the microseconds a frame was queued (read only)
+ * \properties \em telemetry.show the rolling mean of the microseconds from getting a frame to
+ * showing it (read only)
+ * \properties \em telemetry.<stage>.dev the rolling mean absolute deviation of each of the above (read only)
+ * \properties \em telemetry.queue the number of frames queued when a frame was taken (read only)
+ * \properties \em telemetry.buffer the current size of the read-ahead queue (read only)
+ * \properties \em telemetry.skip_reason why the last frame was not rendered (read only)
+ * \event \em consumer-frame-telemetry The base class fires this after consumer-frame-show when
+ *   telemetry is set. The event data is the frame, which has the microseconds of each stage in the
+ *   properties telemetry.get_frame, telemetry.get_audio, telemetry.get_image, telemetry.queue_wait,
+ *   and telemetry.show, as well as telemetry.skip_reason if the image was not rendered.
  */
 
 struct mlt_consumer_s
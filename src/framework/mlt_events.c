@@ -38,18 +38,53 @@ static int events_created = 0;
 static int events_destroyed = 0;
 #endif
 
+/** \brief An array of pointers that can be read while it is being extended
+ *
+ * Writers hold the events mutex. Readers load the array and a separately kept length without
+ * locking. When the array is full it is replaced by a larger copy, and the old one is kept on
+ * the retired chain until the events object is closed, so a reader still walking it is safe.
+ * Doubling the size keeps the retired memory below that of the current array.
+ */
+
+typedef struct pointer_array_s
+{
+    int size;                         ///< the number of slots
+    struct pointer_array_s *retired;  ///< the array this one replaced
+    _Atomic(void *) items[];
+} pointer_array;
+
+/** \brief The listeners of one registered event */
+
+typedef struct
+{
+    char *id;                         ///< the name of the event
+    unsigned int hash;                ///< the hash of the name
+    int index;                        ///< the integer id of the event
+    _Atomic(pointer_array *) array;   ///< the mlt_event slots, NULL for an empty one
+    atomic_int length;                ///< the number of slots in use, including empty ones
+    atomic_int count;                 ///< the number of slots that hold an event
+} event_list;
+
 /** \brief Events class
  *
  * Events provide messages and notifications between services and the application.
  * A service can register an event and fire/send it upon certain conditions or times.
  * Likewise, a service or an application can listen/receive specific events on specific
  * services.
+ *
+ * Each registered event gets an integer id, its index in the lists array. Ids never change, so
+ * a caller that fires an event often can look the id up once with mlt_events_lookup(). Firing by
+ * name finds the id in a hash table of the names, which is replaced like the arrays when it
+ * fills up.
  */
 
 struct mlt_events_struct
 {
     mlt_properties owner;
-    mlt_properties listeners;
+    pthread_mutex_t mutex;           ///< serialises registering, listening and disconnecting
+    _Atomic(pointer_array *) lists;  ///< the event_list of each registered event
+    _Atomic(pointer_array *) names;  ///< the event_list of each name by hash, NULL if free
+    atomic_int count;                ///< the number of registered events
 };
 
 typedef struct mlt_events_struct *mlt_events;
@@ -65,6 +100,7 @@ struct mlt_event_struct
     atomic_int_fast32_t block_count;
     mlt_listener listener;
     void *listener_data;
+    int batched; ///< the listener also handles a summary of the event, see mlt_events_listen_batched()
 };
 
 /** Increment the reference count on self event.
@@ -133,6 +169,152 @@ void mlt_event_close(mlt_event self)
 static mlt_events mlt_events_fetch(mlt_properties);
 static void mlt_events_close(mlt_events);
 
+/** Make room for one more item at the end of an array.
+ *
+ * \private \memberof mlt_events_struct
+ * \param pointer the array to grow, replaced if it is full
+ * \param length the number of slots in use
+ * \return true if there was an error
+ */
+
+static int array_reserve(_Atomic(pointer_array *) *pointer, int length)
+{
+    pointer_array *array = atomic_load(pointer);
+    if (array == NULL || length >= array->size) {
+        int size = array ? array->size * 2 : 4;
+        pointer_array *grown = calloc(1, sizeof(pointer_array) + size * sizeof(grown->items[0]));
+        if (grown == NULL)
+            return 1;
+        grown->size = size;
+        grown->retired = array;
+        for (int i = 0; i < length; i++)
+            atomic_init(&grown->items[i], atomic_load(&array->items[i]));
+        atomic_store(pointer, grown);
+    }
+    return 0;
+}
+
+/** Free an array and the arrays it replaced.
+ *
+ * \private \memberof mlt_events_struct
+ * \param array an array
+ */
+
+static void array_free(pointer_array *array)
+{
+    while (array != NULL) {
+        pointer_array *retired = array->retired;
+        free(array);
+        array = retired;
+    }
+}
+
+/** Get the listeners of a registered event.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ * \param id the integer id of the event
+ * \return the listeners or NULL if the id is not registered
+ */
+
+static event_list *events_list(mlt_events events, int id)
+{
+    if (id < 0 || id >= atomic_load(&events->count))
+        return NULL;
+    return atomic_load(&atomic_load(&events->lists)->items[id]);
+}
+
+/** Calculate the hash of an event name.
+ *
+ * \private \memberof mlt_events_struct
+ * \param name the name of an event
+ * \return the hash
+ */
+
+static unsigned int generate_hash(const char *name)
+{
+    unsigned int hash = 5381;
+    while (*name)
+        hash = hash * 33 + (unsigned int) (*name++);
+    return hash;
+}
+
+/** Add the listeners of an event to a hash table of names.
+ *
+ * The table must have at least one free slot.
+ *
+ * \private \memberof mlt_events_struct
+ * \param names a hash table
+ * \param list the listeners of an event
+ */
+
+static void names_insert(pointer_array *names, event_list *list)
+{
+    unsigned int mask = names->size - 1;
+    unsigned int slot = list->hash & mask;
+    while (atomic_load(&names->items[slot]) != NULL)
+        slot = (slot + 1) & mask;
+    atomic_store(&names->items[slot], list);
+}
+
+/** Add a newly registered event to the hash table of names.
+ *
+ * The table is kept at most half full. When it would fill beyond that, it is replaced by one
+ * twice the size and the old one is retired.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ * \param list the listeners of the new event, whose id equals the number of events
+ * \return true if there was an error
+ */
+
+static int events_name(mlt_events events, event_list *list)
+{
+    pointer_array *names = atomic_load(&events->names);
+    if (names == NULL || (list->index + 1) * 2 > names->size) {
+        int size = names ? names->size * 2 : 16;
+        pointer_array *grown = calloc(1, sizeof(pointer_array) + size * sizeof(grown->items[0]));
+        if (grown == NULL)
+            return 1;
+        grown->size = size;
+        grown->retired = names;
+        for (int i = 0; i < list->index; i++)
+            names_insert(grown, events_list(events, i));
+        names_insert(grown, list);
+        atomic_store(&events->names, grown);
+    } else {
+        names_insert(names, list);
+    }
+    return 0;
+}
+
+/** Find the integer id of a registered event.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ * \param id the name of the event
+ * \return the integer id or -1 if the event is not registered
+ */
+
+static int events_lookup(mlt_events events, const char *id)
+{
+    pointer_array *names = atomic_load(&events->names);
+    if (names != NULL) {
+        unsigned int hash = generate_hash(id);
+        unsigned int mask = names->size - 1;
+        unsigned int slot = hash & mask;
+        event_list *list;
+
+        // Probe until a free slot, comparing names only when the hashes match
+        while ((list = atomic_load(&names->items[slot])) != NULL) {
+            if (list->hash == hash && !strcmp(list->id, id))
+                return list->index;
+            slot = (slot + 1) & mask;
+        }
+    }
+    return -1;
+}
+
 /** Initialise the events structure.
  *
  * \public \memberof mlt_events_struct
@@ -145,7 +327,7 @@ void mlt_events_init(mlt_properties self)
     if (!events && self) {
         events = calloc(1, sizeof(struct mlt_events_struct));
         if (events) {
-            events->listeners = mlt_properties_new();
+            pthread_mutex_init(&events->mutex, NULL);
             events->owner = self;
             mlt_properties_set_data(self,
                                     "_events",
@@ -170,144 +352,315 @@ int mlt_events_register(mlt_properties self, const char *id)
     int error = 1;
     mlt_events events = mlt_events_fetch(self);
     if (events != NULL) {
-        mlt_properties list = events->listeners;
-        char temp[128];
-        sprintf(temp, "list:%s", id);
-        if (mlt_properties_get_data(list, temp, NULL) == NULL)
-            mlt_properties_set_data(list,
-                                    temp,
-                                    mlt_properties_new(),
-                                    0,
-                                    (mlt_destructor) mlt_properties_close,
-                                    NULL);
+        pthread_mutex_lock(&events->mutex);
+        int count = atomic_load(&events->count);
+        if (events_lookup(events, id) == -1 && !array_reserve(&events->lists, count)) {
+            event_list *list = calloc(1, sizeof(event_list));
+            if (list != NULL) {
+                list->id = strdup(id);
+                list->hash = generate_hash(id);
+                list->index = count;
+                atomic_store(&atomic_load(&events->lists)->items[count], list);
+                if (events_name(events, list)) {
+                    free(list->id);
+                    free(list);
+                } else {
+                    // Publish the list only after it is in place.
+                    atomic_store(&events->count, count + 1);
+                }
+            }
+        }
+        pthread_mutex_unlock(&events->mutex);
     }
     return error;
 }
 
-/** Fire an event.
+/** Get the integer id of a registered event.
+ *
+ * Firing by id with mlt_events_fire_id() skips looking up the name each time.
  *
  * \public \memberof mlt_events_struct
  * \param self a properties list
  * \param id the name of an event
+ * \return the integer id or -1 if the event is not registered
+ */
+
+int mlt_events_lookup(mlt_properties self, const char *id)
+{
+    mlt_events events = mlt_events_fetch(self);
+    return events != NULL ? events_lookup(events, id) : -1;
+}
+
+/** Call the listeners of an event.
+ *
+ * \private \memberof mlt_events_struct
+ * \param events an events object
+ * \param id the integer id of the event
+ * \param unbatched whether to skip the listeners from mlt_events_listen_batched()
  * \param event_data an event data object
- * \return the number of listeners
+ * \return the number of listeners called
  */
 
-int mlt_events_fire(mlt_properties self, const char *id, mlt_event_data event_data)
+static int events_fire(mlt_events events, int id, int unbatched, mlt_event_data event_data)
 {
     int result = 0;
-    mlt_events events = mlt_events_fetch(self);
-    if (events != NULL) {
-        mlt_properties list = events->listeners;
-        mlt_properties listeners = NULL;
-        char temp[128];
-        sprintf(temp, "list:%s", id);
-        listeners = mlt_properties_get_data(list, temp, NULL);
-
-        if (listeners != NULL) {
-            for (int i = 0; i < mlt_properties_count(listeners); i++) {
-                mlt_event event = mlt_properties_get_data_at(listeners, i, NULL);
-                if (event != NULL && event->parent != NULL && event->block_count == 0) {
-                    event->listener(event->parent->owner, event->listener_data, event_data);
-                    ++result;
-                }
+    event_list *list = events_list(events, id);
+    if (list != NULL && atomic_load(&list->count) > 0) {
+        int length = atomic_load(&list->length);
+        pointer_array *array = atomic_load(&list->array);
+        for (int i = 0; i < length; i++) {
+            mlt_event event = atomic_load(&array->items[i]);
+            if (event != NULL && event->parent != NULL && event->block_count == 0
+                && !(unbatched && event->batched)) {
+                event->listener(event->parent->owner, event->listener_data, event_data);
+                ++result;
             }
         }
     }
     return result;
 }
 
-/** Register a listener.
+/** Fire an event by its integer id.
+ *
+ * This does not lock anything. A listener that is connected or disconnected on another thread
+ * while firing may or may not be called.
+ *
+ * \public \memberof mlt_events_struct
+ * \param self a properties list
+ * \param id the integer id of an event as returned by mlt_events_lookup()
+ * \param event_data an event data object
+ * \return the number of listeners
+ */
+
+int mlt_events_fire_id(mlt_properties self, int id, mlt_event_data event_data)
+{
+    mlt_events events = mlt_events_fetch(self);
+    return events != NULL ? events_fire(events, id, 0, event_data) : 0;
+}
+
+/** Fire an event by its integer id to the listeners that do not handle its summary.
+ *
+ * This is for an event that is also summed up by another, such as "property-changed" by
+ * "properties-changed": the listeners connected with mlt_events_listen_batched() get the summary
+ * instead, so they are not called.
  *
  * \public \memberof mlt_events_struct
  * \param self a properties list
+ * \param id the integer id of an event as returned by mlt_events_lookup()
+ * \param event_data an event data object
+ * \return the number of listeners
+ */
+
+int mlt_events_fire_id_unbatched(mlt_properties self, int id, mlt_event_data event_data)
+{
+    mlt_events events = mlt_events_fetch(self);
+    return events != NULL ? events_fire(events, id, 1, event_data) : 0;
+}
+
+/** Fire an event.
+ *
+ * \public \memberof mlt_events_struct
+ * \param self a properties list
+ * \param id the name of the event
+ * \param event_data an event data object
+ * \return the number of listeners
+ */
+
+int mlt_events_fire(mlt_properties self, const char *id, mlt_event_data event_data)
+{
+    mlt_events events = mlt_events_fetch(self);
+    if (events == NULL || atomic_load(&events->count) == 0)
+        return 0;
+    return mlt_events_fire_id(self, events_lookup(events, id), event_data);
+}
+
+/** Determine whether an event has any listeners.
+ *
+ * Use this to skip preparing event data that nobody will receive. It may report a listener
+ * that was closed but has not been replaced or disconnected yet.
+ *
+ * \public \memberof mlt_events_struct
+ * \param self a properties list
+ * \param id the name of the event
+ * \return true if the event is registered and has at least one listener
+ */
+
+int mlt_events_has_listeners(mlt_properties self, const char *id)
+{
+    mlt_events events = mlt_events_fetch(self);
+    event_list *list = events != NULL ? events_list(events, events_lookup(events, id)) : NULL;
+    return list != NULL && atomic_load(&list->count) > 0;
+}
+
+/** Register a listener.
+ *
+ * \private \memberof mlt_events_struct
+ * \param self a properties list
  * \param listener_data an opaque pointer
  * \param id the name of the event to listen for
  * \param listener the callback to receive an event message
+ * \param batched whether the listener also handles a summary of the event
  * \return an event
  */
 
-mlt_event mlt_events_listen(mlt_properties self,
-                            void *listener_data,
-                            const char *id,
-                            mlt_listener listener)
+static mlt_event events_listen(
+    mlt_properties self, void *listener_data, const char *id, mlt_listener listener, int batched)
 {
     mlt_event event = NULL;
     mlt_events events = mlt_events_fetch(self);
     if (events != NULL) {
-        mlt_properties list = events->listeners;
-        mlt_properties listeners = NULL;
-        char temp[128];
-        sprintf(temp, "list:%s", id);
-        listeners = mlt_properties_get_data(list, temp, NULL);
-        if (listeners != NULL) {
+        pthread_mutex_lock(&events->mutex);
+        event_list *list = events_list(events, events_lookup(events, id));
+        if (list != NULL) {
+            int length = atomic_load(&list->length);
+            pointer_array *array = atomic_load(&list->array);
             int first_null = -1;
             int i = 0;
-            for (i = 0; event == NULL && i < mlt_properties_count(listeners); i++) {
-                mlt_event entry = mlt_properties_get_data_at(listeners, i, NULL);
+            for (i = 0; event == NULL && i < length; i++) {
+                mlt_event entry = atomic_load(&array->items[i]);
                 if (entry != NULL && entry->parent != NULL) {
-                    if (entry->listener_data == listener_data && entry->listener == listener)
+                    if (entry->listener_data == listener_data && entry->listener == listener) {
                         event = entry;
-                } else if ((entry == NULL || entry->parent == NULL) && first_null == -1) {
+                        event->batched |= batched;
+                    }
+                } else if (first_null == -1) {
                     first_null = i;
                 }
             }
 
-            if (event == NULL) {
+            if (event == NULL && (first_null != -1 || !array_reserve(&list->array, length))) {
                 event = malloc(sizeof(struct mlt_event_struct));
                 if (event != NULL) {
 #ifdef _MLT_EVENT_CHECKS_
                     events_created++;
 #endif
-                    sprintf(temp,
-                            "%d",
-                            first_null == -1 ? mlt_properties_count(listeners) : first_null);
                     event->parent = events;
                     event->ref_count = 0;
                     event->block_count = 0;
                     event->listener = listener;
                     event->listener_data = listener_data;
-                    mlt_properties_set_data(listeners,
-                                            temp,
-                                            event,
-                                            0,
-                                            (mlt_destructor) mlt_event_close,
-                                            NULL);
+                    event->batched = batched;
                     mlt_event_inc_ref(event);
+                    array = atomic_load(&list->array);
+                    if (first_null == -1) {
+                        atomic_store(&array->items[length], event);
+                        atomic_store(&list->length, length + 1);
+                        list->count++;
+                    } else {
+                        // Reuse the slot of a closed or disconnected listener
+                        mlt_event closed = atomic_exchange(&array->items[first_null], event);
+                        if (closed != NULL)
+                            mlt_event_close(closed);
+                        else
+                            list->count++;
+                    }
                 }
             }
         }
+        pthread_mutex_unlock(&events->mutex);
     }
     return event;
 }
 
-/** Block all events for a given listener_data.
+/** Register a listener.
+ *
+ * \public \memberof mlt_events_struct
+ * \param self a properties list
+ * \param listener_data an opaque pointer
+ * \param id the name of the event to listen for
+ * \param listener the callback to receive an event message
+ * \return an event
+ */
+
+mlt_event mlt_events_listen(mlt_properties self,
+                            void *listener_data,
+                            const char *id,
+                            mlt_listener listener)
+{
+    return events_listen(self, listener_data, id, listener, 0);
+}
+
+/** Register a listener for an event that it also handles in summary.
+ *
+ * The listener is called like one from mlt_events_listen(), except by
+ * mlt_events_fire_id_unbatched(). Use this for a "property-changed" listener whose service also
+ * listens for "properties-changed", so that it gets a committed update only once.
  *
  * \public \memberof mlt_events_struct
  * \param self a properties list
+ * \param listener_data an opaque pointer
+ * \param id the name of the event to listen for
+ * \param listener the callback to receive an event message
+ * \return an event
+ */
+
+mlt_event mlt_events_listen_batched(mlt_properties self,
+                                    void *listener_data,
+                                    const char *id,
+                                    mlt_listener listener)
+{
+    return events_listen(self, listener_data, id, listener, 1);
+}
+
+/** Apply a function to every listener with the given listener_data.
+ *
+ * \private \memberof mlt_events_struct
+ * \param self a properties list
  * \param listener_data the listener's opaque data pointer
+ * \param function the function to call with the list, its array, the slot and the listener
  */
 
-void mlt_events_block(mlt_properties self, void *listener_data)
+static void events_for_each(mlt_properties self,
+                            void *listener_data,
+                            void (*function)(event_list *, pointer_array *, int, mlt_event))
 {
     mlt_events events = mlt_events_fetch(self);
     if (events != NULL) {
-        int i = 0, j = 0;
-        mlt_properties list = events->listeners;
-        for (j = 0; j < mlt_properties_count(list); j++) {
-            char *temp = mlt_properties_get_name(list, j);
-            if (!strncmp(temp, "list:", 5)) {
-                mlt_properties listeners = mlt_properties_get_data(list, temp, NULL);
-                for (i = 0; i < mlt_properties_count(listeners); i++) {
-                    mlt_event entry = mlt_properties_get_data_at(listeners, i, NULL);
-                    if (entry != NULL && entry->listener_data == listener_data)
-                        mlt_event_block(entry);
-                }
+        pthread_mutex_lock(&events->mutex);
+        int count = atomic_load(&events->count);
+        for (int j = 0; j < count; j++) {
+            event_list *list = events_list(events, j);
+            int length = atomic_load(&list->length);
+            pointer_array *array = atomic_load(&list->array);
+            for (int i = 0; i < length; i++) {
+                mlt_event entry = atomic_load(&array->items[i]);
+                if (entry != NULL && entry->listener_data == listener_data)
+                    function(list, array, i, entry);
             }
         }
+        pthread_mutex_unlock(&events->mutex);
     }
 }
 
+static void block_entry(event_list *list, pointer_array *array, int i, mlt_event entry)
+{
+    mlt_event_block(entry);
+}
+
+static void unblock_entry(event_list *list, pointer_array *array, int i, mlt_event entry)
+{
+    mlt_event_unblock(entry);
+}
+
+static void disconnect_entry(event_list *list, pointer_array *array, int i, mlt_event entry)
+{
+    atomic_store(&array->items[i], NULL);
+    list->count--;
+    mlt_event_close(entry);
+}
+
+/** Block all events for a given listener_data.
+ *
+ * \public \memberof mlt_events_struct
+ * \param self a properties list
+ * \param listener_data the listener's opaque data pointer
+ */
+
+void mlt_events_block(mlt_properties self, void *listener_data)
+{
+    events_for_each(self, listener_data, block_entry);
+}
+
 /** Unblock all events for a given listener_data.
  *
  * \public \memberof mlt_events_struct
@@ -317,22 +670,7 @@ void mlt_events_block(mlt_properties self, void *listener_data)
 
 void mlt_events_unblock(mlt_properties self, void *listener_data)
 {
-    mlt_events events = mlt_events_fetch(self);
-    if (events != NULL) {
-        int i = 0, j = 0;
-        mlt_properties list = events->listeners;
-        for (j = 0; j < mlt_properties_count(list); j++) {
-            char *temp = mlt_properties_get_name(list, j);
-            if (!strncmp(temp, "list:", 5)) {
-                mlt_properties listeners = mlt_properties_get_data(list, temp, NULL);
-                for (i = 0; i < mlt_properties_count(listeners); i++) {
-                    mlt_event entry = mlt_properties_get_data_at(listeners, i, NULL);
-                    if (entry != NULL && entry->listener_data == listener_data)
-                        mlt_event_unblock(entry);
-                }
-            }
-        }
-    }
+    events_for_each(self, listener_data, unblock_entry);
 }
 
 /** Disconnect all events for a given listener_data.
@@ -344,23 +682,7 @@ void mlt_events_unblock(mlt_properties self, void *listener_data)
 
 void mlt_events_disconnect(mlt_properties self, void *listener_data)
 {
-    mlt_events events = mlt_events_fetch(self);
-    if (events != NULL) {
-        int i = 0, j = 0;
-        mlt_properties list = events->listeners;
-        for (j = 0; j < mlt_properties_count(list); j++) {
-            char *temp = mlt_properties_get_name(list, j);
-            if (!strncmp(temp, "list:", 5)) {
-                mlt_properties listeners = mlt_properties_get_data(list, temp, NULL);
-                for (i = 0; i < mlt_properties_count(listeners); i++) {
-                    mlt_event entry = mlt_properties_get_data_at(listeners, i, NULL);
-                    char *name = mlt_properties_get_name(listeners, i);
-                    if (entry != NULL && entry->listener_data == listener_data)
-                        mlt_properties_set_data(listeners, name, NULL, 0, NULL, NULL);
-                }
-            }
-        }
-    }
+    events_for_each(self, listener_data, disconnect_entry);
 }
 
 /** \brief private to mlt_events_struct, used by mlt_events_wait_for() */
@@ -460,7 +782,20 @@ static mlt_events mlt_events_fetch(mlt_properties self)
 static void mlt_events_close(mlt_events events)
 {
     if (events != NULL) {
-        mlt_properties_close(events->listeners);
+        int count = atomic_load(&events->count);
+        for (int j = 0; j < count; j++) {
+            event_list *list = events_list(events, j);
+            int length = atomic_load(&list->length);
+            pointer_array *array = atomic_load(&list->array);
+            for (int i = 0; i < length; i++)
+                mlt_event_close(atomic_load(&array->items[i]));
+            array_free(array);
+            free(list->id);
+            free(list);
+        }
+        array_free(atomic_load(&events->lists));
+        array_free(atomic_load(&events->names));
+        pthread_mutex_destroy(&events->mutex);
         free(events);
     }
 }
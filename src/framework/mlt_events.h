@@ -43,6 +43,13 @@ typedef struct
     void *data;                     /**< an opaque data pointer to pass along */
 } mlt_event_data_thread;
 
+/** An event data structure to convey the positions a producer will be asked for */
+typedef struct
+{
+    mlt_position position; /**< the first position that will be requested */
+    int count;             /**< the number of consecutive positions that will be requested */
+} mlt_event_data_prefetch;
+
 /** event handler when receiving an event message
  * \param the properties object on which the event was registered
  * \param an opaque pointer to the listener's data
@@ -53,10 +60,18 @@ typedef void (*mlt_listener)(mlt_properties, void *, mlt_event_data);
 MLT_API extern void mlt_events_init(mlt_properties self);
 MLT_API extern int mlt_events_register(mlt_properties self, const char *id);
 MLT_API extern int mlt_events_fire(mlt_properties self, const char *id, mlt_event_data);
+MLT_API extern int mlt_events_lookup(mlt_properties self, const char *id);
+MLT_API extern int mlt_events_fire_id(mlt_properties self, int id, mlt_event_data);
+MLT_API extern int mlt_events_fire_id_unbatched(mlt_properties self, int id, mlt_event_data);
+MLT_API extern int mlt_events_has_listeners(mlt_properties self, const char *id);
 MLT_API extern mlt_event mlt_events_listen(mlt_properties self,
                                    void *listener_data,
                                    const char *id,
                                    mlt_listener listener);
+MLT_API extern mlt_event mlt_events_listen_batched(mlt_properties self,
+                                           void *listener_data,
+                                           const char *id,
+                                           mlt_listener listener);
 MLT_API extern void mlt_events_block(mlt_properties self, void *listener_data);
 MLT_API extern void mlt_events_unblock(mlt_properties self, void *listener_data);
 MLT_API extern void mlt_events_disconnect(mlt_properties self, void *listener_data);
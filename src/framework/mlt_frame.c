@@ -26,7 +26,9 @@
 #include "mlt_log.h"
 #include "mlt_producer.h"
 #include "mlt_profile.h"
+#include "mlt_slices.h"
 
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -475,6 +477,259 @@ static int generate_test_image(mlt_properties properties,
     return error;
 }
 
+/** A request to render a frame's image or audio on another thread.
+ *
+ * The result is kept on the frame until the next mlt_frame_get_image() or
+ * mlt_frame_get_audio() hands it to the caller.
+ */
+
+typedef struct
+{
+    mlt_slices_task task; ///< the pending job, NULL once it was waited for
+    mlt_frame frame;
+    mlt_deque stack; ///< a copy of the frame's stack to render again with other arguments
+    int image_count;
+    mlt_image_format request_image_format;
+    int request_width;
+    int request_height;
+    mlt_audio_format request_audio_format;
+    int request_frequency;
+    int request_channels;
+    int request_samples;
+    int error;
+    void *buffer;
+    mlt_image_format image_format;
+    int width;
+    int height;
+    int writable;
+    mlt_audio_format audio_format;
+    int frequency;
+    int channels;
+    int samples;
+} frame_prefetch;
+
+static pthread_key_t prefetch_key;
+static pthread_once_t prefetch_once = PTHREAD_ONCE_INIT;
+
+static void prefetch_key_init(void)
+{
+    pthread_key_create(&prefetch_key, NULL);
+}
+
+static void prefetch_close(frame_prefetch *prefetch)
+{
+    if (prefetch->task)
+        mlt_slices_wait(prefetch->task);
+    if (prefetch->stack)
+        mlt_deque_close(prefetch->stack);
+    free(prefetch);
+}
+
+/** Copy a processing stack of a frame.
+ *
+ * The stacks only hold pointers and integers, which fit in a pointer.
+ */
+
+static mlt_deque stack_copy(mlt_deque stack)
+{
+    mlt_deque copy = mlt_deque_init();
+    int i;
+    for (i = 0; copy && i < mlt_deque_count(stack); i++)
+        mlt_deque_push_back(copy, mlt_deque_peek(stack, i));
+    return copy;
+}
+
+/** Put back the copy of a processing stack taken before a prefetch consumed it.
+ */
+
+static void stack_restore(mlt_deque stack, mlt_deque copy)
+{
+    while (mlt_deque_count(copy))
+        mlt_deque_push_back(stack, mlt_deque_pop_front(copy));
+    mlt_deque_close(copy);
+}
+
+/** Wait for a prefetch of the frame to complete.
+ *
+ * A thread running the prefetch job itself - filters call back into
+ * mlt_frame_get_image() on the same frame - must not wait for it.
+ */
+
+static void prefetch_wait(mlt_frame self, const char *name)
+{
+    frame_prefetch *prefetch = mlt_properties_get_data(MLT_FRAME_PROPERTIES(self), name, NULL);
+    if (prefetch && prefetch->task && prefetch != pthread_getspecific(prefetch_key)) {
+        mlt_slices_wait(prefetch->task);
+        prefetch->task = NULL;
+    }
+}
+
+/** Wait for all prefetches of the frame and take the completed result named \p name.
+ *
+ * \return true if \p result was filled in
+ */
+
+static int prefetch_finish(mlt_frame self, const char *name, frame_prefetch *result)
+{
+    mlt_properties properties = MLT_FRAME_PROPERTIES(self);
+    frame_prefetch *prefetch;
+
+    prefetch_wait(self, "_prefetch_image");
+    prefetch_wait(self, "_prefetch_audio");
+    prefetch = mlt_properties_get_data(properties, name, NULL);
+    if (!prefetch || prefetch->task)
+        return 0;
+    *result = *prefetch;
+    prefetch->stack = NULL;
+    mlt_properties_set_data(properties, name, NULL, 0, NULL, NULL);
+    return 1;
+}
+
+static int prefetch_proc(int id, int index, int jobs, void *cookie)
+{
+    frame_prefetch *prefetch = cookie;
+    void *previous = pthread_getspecific(prefetch_key);
+
+    pthread_setspecific(prefetch_key, prefetch);
+    if (prefetch->image_format != mlt_image_invalid)
+        prefetch->error = mlt_frame_get_image(prefetch->frame,
+                                              (uint8_t **) &prefetch->buffer,
+                                              &prefetch->image_format,
+                                              &prefetch->width,
+                                              &prefetch->height,
+                                              prefetch->writable);
+    else
+        prefetch->error = mlt_frame_get_audio(prefetch->frame,
+                                              &prefetch->buffer,
+                                              &prefetch->audio_format,
+                                              &prefetch->frequency,
+                                              &prefetch->channels,
+                                              &prefetch->samples);
+    pthread_setspecific(prefetch_key, previous);
+    return 0;
+}
+
+static int prefetch_start(mlt_frame self, const char *name, frame_prefetch *prefetch)
+{
+    pthread_once(&prefetch_once, prefetch_key_init);
+
+    // Only one job may render the frame at a time
+    prefetch_wait(self, "_prefetch_image");
+    prefetch_wait(self, "_prefetch_audio");
+    if (mlt_properties_get_data(MLT_FRAME_PROPERTIES(self), name, NULL)) {
+        free(prefetch);
+        return 1;
+    }
+    prefetch->frame = self;
+    prefetch->image_count = mlt_properties_get_int(MLT_FRAME_PROPERTIES(self), "image_count");
+    prefetch->stack = stack_copy(prefetch->image_format != mlt_image_invalid ? self->stack_image
+                                                                             : self->stack_audio);
+    if (!prefetch->stack) {
+        free(prefetch);
+        return 1;
+    }
+    prefetch->task = mlt_slices_submit_normal(1, prefetch_proc, prefetch);
+    if (!prefetch->task) {
+        mlt_deque_close(prefetch->stack);
+        free(prefetch);
+        return 1;
+    }
+    return mlt_properties_set_data(MLT_FRAME_PROPERTIES(self),
+                                   name,
+                                   prefetch,
+                                   0,
+                                   (mlt_destructor) prefetch_close,
+                                   NULL);
+}
+
+/** Start rendering the image of a frame on the normal slices pool.
+ *
+ * The next call to mlt_frame_get_image() waits for the result instead of
+ * rendering when it is given the same format, width, and height; with other
+ * arguments it discards the result and renders again. Use this to overlap the
+ * rendering of independent frames, for example the tracks of a tractor; call
+ * it with the same arguments you will later give mlt_frame_get_image().
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param format the image format
+ * \param width the horizontal size in pixels
+ * \param height the vertical size in pixels
+ * \param writable whether or not the image will need to be writable
+ * \return true if the image is not being prefetched
+ */
+
+int mlt_frame_prefetch_image(
+    mlt_frame self, mlt_image_format format, int width, int height, int writable)
+{
+    frame_prefetch *prefetch = self ? calloc(1, sizeof(*prefetch)) : NULL;
+    if (!prefetch)
+        return 1;
+    prefetch->image_format = format == mlt_image_invalid ? mlt_image_none : format;
+    prefetch->width = width;
+    prefetch->height = height;
+    prefetch->request_image_format = prefetch->image_format;
+    prefetch->request_width = width;
+    prefetch->request_height = height;
+    prefetch->writable = writable;
+    return prefetch_start(self, "_prefetch_image", prefetch);
+}
+
+/** Start rendering the audio of a frame on the normal slices pool.
+ *
+ * This is the audio counterpart of mlt_frame_prefetch_image().
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ * \param format the audio format
+ * \param frequency the sample rate
+ * \param channels the number of channels
+ * \param samples the number of samples per frame
+ * \return true if the audio is not being prefetched
+ */
+
+int mlt_frame_prefetch_audio(
+    mlt_frame self, mlt_audio_format format, int frequency, int channels, int samples)
+{
+    frame_prefetch *prefetch = self ? calloc(1, sizeof(*prefetch)) : NULL;
+    if (!prefetch)
+        return 1;
+    prefetch->image_format = mlt_image_invalid;
+    prefetch->audio_format = format;
+    prefetch->frequency = frequency;
+    prefetch->channels = channels;
+    prefetch->samples = samples;
+    prefetch->request_audio_format = format;
+    prefetch->request_frequency = frequency;
+    prefetch->request_channels = channels;
+    prefetch->request_samples = samples;
+    return prefetch_start(self, "_prefetch_audio", prefetch);
+}
+
+/** Discard the prefetches of a frame.
+ *
+ * This waits for any prefetch of the frame to complete and puts back its processing stack, so
+ * that the next mlt_frame_get_image() or mlt_frame_get_audio() renders the frame again. Call it
+ * before changing properties of the frame that the prefetch may read.
+ *
+ * \public \memberof mlt_frame_s
+ * \param self a frame
+ */
+
+void mlt_frame_prefetch_cancel(mlt_frame self)
+{
+    frame_prefetch prefetched;
+
+    if (!self)
+        return;
+    if (prefetch_finish(self, "_prefetch_image", &prefetched)) {
+        stack_restore(self->stack_image, prefetched.stack);
+        mlt_properties_set_int(MLT_FRAME_PROPERTIES(self), "image_count", prefetched.image_count);
+    }
+    if (prefetch_finish(self, "_prefetch_audio", &prefetched))
+        stack_restore(self->stack_audio, prefetched.stack);
+}
+
 /** Get the image associated to the frame.
  *
  * You should express the desired format, width, and height as inputs. As long
@@ -503,10 +758,37 @@ int mlt_frame_get_image(mlt_frame self,
                         int writable)
 {
     mlt_properties properties = MLT_FRAME_PROPERTIES(self);
-    mlt_get_image get_image = mlt_frame_pop_get_image(self);
+    mlt_get_image get_image = NULL;
     mlt_image_format requested_format = *format;
     int error = 0;
+    frame_prefetch prefetched;
+
+    // A prefetched image has already been through the stack
+    int is_prefetched = prefetch_finish(self, "_prefetch_image", &prefetched);
+    if (is_prefetched
+        && (prefetched.request_image_format != requested_format
+            || prefetched.request_width != *width || prefetched.request_height != *height)) {
+        // It was rendered for other arguments; render again
+        stack_restore(self->stack_image, prefetched.stack);
+        mlt_properties_set_int(properties, "image_count", prefetched.image_count);
+        is_prefetched = 0;
+    }
+    if (is_prefetched) {
+        mlt_deque_close(prefetched.stack);
+        if (buffer)
+            *buffer = prefetched.buffer;
+        *format = prefetched.image_format;
+        *width = prefetched.width;
+        *height = prefetched.height;
+        if (!prefetched.error && self->convert_image && buffer && *buffer
+            && requested_format != mlt_image_none) {
+            self->convert_image(self, buffer, format, requested_format);
+            mlt_properties_set_int(properties, "format", *format);
+        }
+        return prefetched.error;
+    }
 
+    get_image = mlt_frame_pop_get_image(self);
     if (get_image) {
         mlt_properties_set_int(properties,
                                "image_count",
@@ -616,10 +898,37 @@ int mlt_frame_get_audio(mlt_frame self,
                         int *channels,
                         int *samples)
 {
-    mlt_get_audio get_audio = mlt_frame_pop_audio(self);
+    mlt_get_audio get_audio = NULL;
     mlt_properties properties = MLT_FRAME_PROPERTIES(self);
-    int hide = mlt_properties_get_int(properties, "test_audio");
+    int hide = 0;
     mlt_audio_format requested_format = *format;
+    frame_prefetch prefetched;
+
+    // Prefetched audio has already been through the stack
+    int is_prefetched = prefetch_finish(self, "_prefetch_audio", &prefetched);
+    if (is_prefetched
+        && (prefetched.request_audio_format != requested_format
+            || prefetched.request_frequency != *frequency
+            || prefetched.request_channels != *channels
+            || prefetched.request_samples != *samples)) {
+        // It was rendered for other arguments; render again
+        stack_restore(self->stack_audio, prefetched.stack);
+        is_prefetched = 0;
+    }
+    if (is_prefetched) {
+        mlt_deque_close(prefetched.stack);
+        *buffer = prefetched.buffer;
+        *format = prefetched.audio_format;
+        *frequency = prefetched.frequency;
+        *channels = prefetched.channels;
+        *samples = prefetched.samples;
+        if (self->convert_audio && *buffer && requested_format != mlt_audio_none)
+            self->convert_audio(self, buffer, format, requested_format);
+        return prefetched.error;
+    }
+
+    get_audio = mlt_frame_pop_audio(self);
+    hide = mlt_properties_get_int(properties, "test_audio");
 
     if (hide == 0 && get_audio != NULL) {
         get_audio(self, buffer, format, frequency, channels, samples);
@@ -817,6 +1126,8 @@ mlt_producer mlt_frame_get_original_producer(mlt_frame self)
 void mlt_frame_close(mlt_frame self)
 {
     if (self != NULL && mlt_properties_dec_ref(MLT_FRAME_PROPERTIES(self)) <= 0) {
+        prefetch_wait(self, "_prefetch_image");
+        prefetch_wait(self, "_prefetch_audio");
         mlt_deque_close(self->stack_image);
         mlt_deque_close(self->stack_audio);
         while (mlt_deque_peek_back(self->stack_service))
@@ -144,6 +144,11 @@ MLT_API extern int mlt_frame_get_image(mlt_frame self,
                                int *width,
                                int *height,
                                int writable);
+MLT_API extern int mlt_frame_prefetch_image(
+    mlt_frame self, mlt_image_format format, int width, int height, int writable);
+MLT_API extern int mlt_frame_prefetch_audio(
+    mlt_frame self, mlt_audio_format format, int frequency, int channels, int samples);
+MLT_API extern void mlt_frame_prefetch_cancel(mlt_frame self);
 MLT_API extern uint8_t *mlt_frame_get_alpha(mlt_frame self);
 MLT_API extern uint8_t *mlt_frame_get_alpha_size(mlt_frame self, int *size);
 MLT_API extern int mlt_frame_get_audio(mlt_frame self,
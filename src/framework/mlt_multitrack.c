@@ -33,6 +33,7 @@
 /* Forward reference. */
 
 static int producer_get_frame(mlt_producer producer, mlt_frame_ptr frame, int index);
+static void on_multitrack_prefetch(mlt_properties owner, mlt_multitrack self, mlt_event_data);
 
 /** Construct and initialize a new multitrack.
  *
@@ -52,13 +53,19 @@ mlt_multitrack mlt_multitrack_init()
         if (mlt_producer_init(producer, self) == 0) {
             mlt_properties properties = MLT_MULTITRACK_PROPERTIES(self);
             producer->get_frame = producer_get_frame;
+            mlt_properties_begin_update(properties);
             mlt_properties_set_data(properties, "multitrack", self, 0, NULL, NULL);
             mlt_properties_set(properties, "log_id", "multitrack");
             mlt_properties_set(properties, "resource", "<multitrack>");
             mlt_properties_set_int(properties, "in", 0);
             mlt_properties_set_int(properties, "out", -1);
             mlt_properties_set_int(properties, "length", 0);
+            mlt_properties_commit_update(properties);
             producer->close = (mlt_destructor) mlt_multitrack_close;
+            mlt_events_listen(properties,
+                              self,
+                              "producer-prefetch",
+                              (mlt_listener) on_multitrack_prefetch);
         } else {
             free(self);
             self = NULL;
@@ -527,6 +534,53 @@ mlt_position mlt_multitrack_clip(mlt_multitrack self, mlt_whence whence, int ind
     return position;
 }
 
+/** Announce the positions that will be requested from each track of a multitrack.
+ *
+ * Hidden tracks are skipped.
+ *
+ * \public \memberof mlt_multitrack_s
+ * \param self a multitrack
+ * \param position the first position that will be requested
+ * \param count the number of consecutive positions that will be requested
+ * \return true if there was an error
+ * \see mlt_producer_prefetch
+ */
+
+int mlt_multitrack_prefetch(mlt_multitrack self, mlt_position position, int count)
+{
+    int i;
+
+    if (!self || count <= 0)
+        return 1;
+
+    for (i = 0; i < self->count; i++) {
+        mlt_producer producer = self->list[i] ? self->list[i]->producer : NULL;
+        if (producer == NULL)
+            continue;
+        mlt_properties properties = MLT_PRODUCER_PROPERTIES(mlt_producer_cut_parent(producer));
+        if (mlt_properties_get_int(properties, "hide") != 3)
+            mlt_producer_prefetch(producer, position, count);
+    }
+    return 0;
+}
+
+/** Listener for the producer-prefetch event of the multitrack.
+ *
+ * \private \memberof mlt_multitrack_s
+ * \param owner the multitrack's properties
+ * \param self a multitrack
+ * \param event_data a pointer to mlt_event_data_prefetch
+ */
+
+static void on_multitrack_prefetch(mlt_properties owner,
+                                   mlt_multitrack self,
+                                   mlt_event_data event_data)
+{
+    mlt_event_data_prefetch *prefetch = mlt_event_data_to_object(event_data);
+    if (prefetch)
+        mlt_multitrack_prefetch(self, prefetch->position, prefetch->count);
+}
+
 /** Get frame method.
  *
  * <pre>
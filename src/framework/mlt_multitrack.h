@@ -70,5 +70,6 @@ MLT_API extern void mlt_multitrack_close(mlt_multitrack self);
 MLT_API extern int mlt_multitrack_count(mlt_multitrack self);
 MLT_API extern void mlt_multitrack_refresh(mlt_multitrack self);
 MLT_API extern mlt_producer mlt_multitrack_track(mlt_multitrack self, int track);
+MLT_API extern int mlt_multitrack_prefetch(mlt_multitrack self, mlt_position position, int count);
 
 #endif
@@ -55,6 +55,7 @@ static int producer_get_frame(mlt_producer producer, mlt_frame_ptr frame, int in
 static int mlt_playlist_unmix(mlt_playlist self, int clip);
 static int mlt_playlist_resize_mix(mlt_playlist self, int clip, int in, int out);
 static mlt_producer blank_producer(mlt_playlist self);
+static void on_playlist_prefetch(mlt_properties owner, mlt_playlist self, mlt_event_data);
 
 mlt_playlist mlt_playlist_alloc()
 {
@@ -77,19 +78,26 @@ mlt_playlist mlt_playlist_alloc()
         mlt_properties_set_data(MLT_PLAYLIST_PROPERTIES(self), "playlist", self, 0, NULL, NULL);
 
         // Specify the eof condition
+        mlt_properties_begin_update(MLT_PLAYLIST_PROPERTIES(self));
         mlt_properties_set(MLT_PLAYLIST_PROPERTIES(self), "eof", "pause");
         mlt_properties_set(MLT_PLAYLIST_PROPERTIES(self), "resource", "<playlist>");
         mlt_properties_set(MLT_PLAYLIST_PROPERTIES(self), "mlt_type", "mlt_producer");
         mlt_properties_set_position(MLT_PLAYLIST_PROPERTIES(self), "in", 0);
         mlt_properties_set_position(MLT_PLAYLIST_PROPERTIES(self), "out", -1);
         mlt_properties_set_position(MLT_PLAYLIST_PROPERTIES(self), "length", 0);
+        mlt_properties_commit_update(MLT_PLAYLIST_PROPERTIES(self));
 
         self->size = 10;
         self->list = calloc(self->size, sizeof(playlist_entry *));
+        self->starts_count = -1;
         if (self->list == NULL)
             goto error2;
 
         mlt_events_register(MLT_PLAYLIST_PROPERTIES(self), "playlist-next");
+        mlt_events_listen(MLT_PLAYLIST_PROPERTIES(self),
+                          self,
+                          "producer-prefetch",
+                          (mlt_listener) on_playlist_prefetch);
     }
 
     return self;
@@ -172,6 +180,8 @@ mlt_properties mlt_playlist_properties(mlt_playlist self)
 
 /** Refresh the playlist after a clip has been changed.
  *
+ * This also rebuilds the index of the time at which each entry starts, which
+ * lets mlt_playlist_locate() find the entry for a position with a binary search.
  * \private \memberof mlt_playlist_s
  * \param self a playlist
  * \return false
@@ -184,6 +194,18 @@ static int mlt_playlist_virtual_refresh(mlt_playlist self)
     int i = 0;
     mlt_position frame_count = 0;
 
+    // Make room to index the start of each entry
+    self->starts_count = -1;
+    if (self->count >= self->starts_size) {
+        int size = MAX(self->count + 1, self->starts_size * 2);
+        mlt_position *starts = realloc(self->starts, size * sizeof(mlt_position));
+        if (starts) {
+            self->starts = starts;
+            self->starts_size = size;
+        }
+    }
+    int indexed = self->count < self->starts_size;
+
     for (i = 0; i < self->count; i++) {
         // Get the producer
         mlt_producer producer = self->list[i]->producer;
@@ -214,8 +236,15 @@ static int mlt_playlist_virtual_refresh(mlt_playlist self)
                                      * self->list[i]->repeat;
 
         // Update the frame_count for self clip
+        if (indexed)
+            self->starts[i] = frame_count;
+        indexed = indexed && self->list[i]->frame_count >= 0;
         frame_count += self->list[i]->frame_count;
     }
+    if (indexed) {
+        self->starts[self->count] = frame_count;
+        self->starts_count = self->count;
+    }
 
     // Refresh all properties
     mlt_events_block(properties, properties);
@@ -366,6 +395,28 @@ static mlt_producer mlt_playlist_locate(mlt_playlist self,
     // Default producer to NULL
     mlt_producer producer = NULL;
 
+    if (self->starts_count == self->count) {
+        // Binary search the index for the first entry that ends after the position.
+        // Negative positions resolve to the first entry as in the loop below.
+        int first = 0, last = self->count;
+        while (*position >= 0 && first < last) {
+            int middle = first + (last - first) / 2;
+            if (*position < self->starts[middle + 1])
+                last = middle;
+            else
+                first = middle + 1;
+        }
+        *clip = first;
+        if (first < self->count) {
+            *total += self->starts[first + 1];
+            producer = self->list[first]->producer;
+        } else {
+            *total += self->starts[first];
+        }
+        *position -= self->starts[first];
+        return producer;
+    }
+
     // Loop for each producer until found
     for (*clip = 0; *clip < self->count; *clip += 1) {
         // Increment the total
@@ -495,20 +546,9 @@ static mlt_producer mlt_playlist_virtual_set_out(mlt_playlist self)
 
     // Map playlist position to real producer in virtual playlist
     mlt_position position = mlt_producer_frame(&self->parent);
+    int i = 0, total = 0;
 
-    // Loop through the virtual playlist
-    int i = 0;
-
-    for (i = 0; i < self->count; i++) {
-        if (position < self->list[i]->frame_count) {
-            // Found it, now break
-            producer = self->list[i]->producer;
-            break;
-        } else {
-            // Decrement position by length of this entry
-            position -= self->list[i]->frame_count;
-        }
-    }
+    producer = mlt_playlist_locate(self, &position, &i, &total);
 
     if (!producer) {
         producer = blank_producer(self);
@@ -538,20 +578,9 @@ int mlt_playlist_current_clip(mlt_playlist self)
 {
     // Map playlist position to real producer in virtual playlist
     mlt_position position = mlt_producer_frame(&self->parent);
+    int i = 0, total = 0;
 
-    // Loop through the virtual playlist
-    int i = 0;
-
-    for (i = 0; i < self->count; i++) {
-        if (position < self->list[i]->frame_count) {
-            // Found it, now break
-            break;
-        } else {
-            // Decrement position by length of this entry
-            position -= self->list[i]->frame_count;
-        }
-    }
-
+    mlt_playlist_locate(self, &position, &i, &total);
     return i;
 }
 
@@ -609,6 +638,8 @@ mlt_position mlt_playlist_clip(mlt_playlist self, mlt_whence whence, int index)
         absolute_clip = self->count;
 
     // Now determine the position
+    if (self->starts_count == self->count)
+        return self->starts[absolute_clip];
     for (i = 0; i < absolute_clip; i++)
         position += self->list[i]->frame_count;
 
@@ -887,6 +918,8 @@ int mlt_playlist_move(mlt_playlist self, int src, int dest)
         else if (current == dest)
             current = src;
 
+        // The index is stale until the refresh below
+        self->starts_count = -1;
         src_entry = self->list[src];
         if (src > dest) {
             for (i = src; i > dest; i--)
@@ -942,6 +975,7 @@ int mlt_playlist_reorder(mlt_playlist self, const int *indices)
     // Delete the old list and save the new list
     free(self->list);
     self->list = new_list;
+    self->starts_count = -1;
     mlt_playlist_virtual_refresh(self);
 
     return 0;
@@ -1553,6 +1587,56 @@ int mlt_playlist_get_clip_index_at(mlt_playlist self, mlt_position position)
     return index;
 }
 
+/** Announce the positions that will be requested from a playlist.
+ *
+ * This forwards the hint to the producer of each entry that the positions
+ * span, so that the next clip can prepare before the playlist reaches it.
+ *
+ * \public \memberof mlt_playlist_s
+ * \param self a playlist
+ * \param position the first position that will be requested
+ * \param count the number of consecutive positions that will be requested
+ * \return true if there was an error
+ */
+
+int mlt_playlist_prefetch(mlt_playlist self, mlt_position position, int count)
+{
+    int i = 0, total = 0;
+
+    if (!self || count <= 0)
+        return 1;
+
+    position = MAX(0, position);
+    mlt_playlist_locate(self, &position, &i, &total);
+    for (; i < self->count && count > 0; i++) {
+        playlist_entry *entry = self->list[i];
+        int length = entry->frame_count / entry->repeat;
+        int n = MIN(count, entry->frame_count - position);
+        if (entry->producer && length > 0) {
+            int offset = position % length;
+            mlt_producer_prefetch(entry->producer, offset, MIN(n, length - offset));
+        }
+        count -= n;
+        position = 0;
+    }
+    return 0;
+}
+
+/** Listener for the producer-prefetch event of the playlist.
+ *
+ * \private \memberof mlt_playlist_s
+ * \param owner the playlist's properties
+ * \param self a playlist
+ * \param event_data a pointer to mlt_event_data_prefetch
+ */
+
+static void on_playlist_prefetch(mlt_properties owner, mlt_playlist self, mlt_event_data event_data)
+{
+    mlt_event_data_prefetch *prefetch = mlt_event_data_to_object(event_data);
+    if (prefetch)
+        mlt_playlist_prefetch(self, prefetch->position, prefetch->count);
+}
+
 /** Determine if the clip is a mix.
  *
  * \public \memberof mlt_playlist_s
@@ -2105,6 +2189,7 @@ void mlt_playlist_close(mlt_playlist self)
         }
         mlt_producer_close(&self->parent);
         free(self->list);
+        free(self->starts);
         free(self);
     }
 }
@@ -76,6 +76,9 @@ struct mlt_playlist_s
     int size;
     int count;
     playlist_entry **list;
+    mlt_position *starts; /// private: the time at which each entry starts
+    int starts_size;
+    int starts_count;
 };
 
 #define MLT_PLAYLIST_PRODUCER(playlist) (&(playlist)->parent)
@@ -132,6 +135,7 @@ MLT_API extern int mlt_playlist_clip_start(mlt_playlist self, int clip);
 MLT_API extern int mlt_playlist_clip_length(mlt_playlist self, int clip);
 MLT_API extern int mlt_playlist_blanks_from(mlt_playlist self, int clip, int bounded);
 MLT_API extern int mlt_playlist_remove_region(mlt_playlist self, mlt_position position, int length);
+MLT_API extern int mlt_playlist_prefetch(mlt_playlist self, mlt_position position, int count);
 MLT_API extern void mlt_playlist_close(mlt_playlist self);
 
 #endif
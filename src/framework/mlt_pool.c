@@ -24,7 +24,10 @@
 #include "mlt_log.h"
 #include "mlt_properties.h"
 
+#include <inttypes.h>
 #include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -74,10 +77,38 @@ void mlt_pool_stat() {}
 
 #else
 
+/** the smallest block size pooled, as a power of 2 */
+
+#define POOL_MIN_INDEX 8
+
+/** one past the largest block size pooled, as a power of 2 */
+
+#define POOL_MAX_INDEX 31
+
+/** the number of size classes */
+
+#define POOL_COUNT (POOL_MAX_INDEX - POOL_MIN_INDEX)
+
+/** the maximum number of blocks a thread may hold per size class */
+
+#define MAGAZINE_SIZE 16
+
+/** the maximum number of bytes a thread may hold per size class */
+
+#define MAGAZINE_CLASS_BYTES (64 * 1024 * 1024)
+
+/** the default maximum number of bytes held across all threads' magazines */
+
+#define MAGAZINE_HIGH_WATER (512 * 1024 * 1024)
+
 /** global singleton for tracking pools */
 
 static mlt_properties pools = NULL;
 
+/** direct access to the pools by size class, avoiding a properties lookup per allocation */
+
+static struct mlt_pool_s *pool_array[POOL_COUNT];
+
 /** \brief Pool (memory) class
  */
 
@@ -87,6 +118,7 @@ typedef struct mlt_pool_s
     mlt_deque stack;      ///< a stack of addresses to memory blocks
     int size;             ///< the size of the memory block as a power of 2
     int count;            ///< the number of blocks in the pool
+    int index;            ///< the size class of the pool
 } * mlt_pool;
 
 /** \brief private to mlt_pool_s, for tracking items to release
@@ -118,14 +150,73 @@ typedef struct mlt_release_s
 } * mlt_release;
 #endif
 
+/** \brief Per-thread stack of free blocks for one size class
+ */
+
+typedef struct
+{
+    void *items[MAGAZINE_SIZE];  ///< free blocks owned by the thread
+    int count;                   ///< the number of blocks in items
+    int capacity;                ///< the maximum number of blocks for this size class
+    atomic_uint_fast64_t hits;   ///< allocations served without touching the shared pool
+    atomic_uint_fast64_t misses; ///< allocations that had to use the shared pool
+} mlt_magazine;
+
+/** \brief Per-thread cache of magazines for all size classes
+ *
+ * A thread only ever touches its own magazines, so the common alloc/release
+ * pair needs no lock. Magazines are refilled from and flushed to the shared
+ * pool in batches.
+ */
+
+typedef struct mlt_thread_cache_s
+{
+    mlt_magazine magazines[POOL_COUNT];
+    int generation;                  ///< the value of pool_generation when last flushed
+    int id;                          ///< a sequence number for reporting
+    struct mlt_thread_cache_s *next; ///< the next cache in the registry
+    struct mlt_thread_cache_s *prev; ///< the previous cache in the registry
+} * mlt_thread_cache;
+
+static pthread_once_t cache_once = PTHREAD_ONCE_INIT;
+static pthread_key_t cache_key;
+static pthread_mutex_t cache_registry_mutex = PTHREAD_MUTEX_INITIALIZER;
+static mlt_thread_cache cache_registry = NULL;
+static int cache_sequence = 0;
+static uint64_t retired_hits = 0;
+static uint64_t retired_misses = 0;
+
+/** the number of bytes currently held in all threads' magazines */
+static atomic_int_fast64_t magazine_bytes = 0;
+
+/** the maximum number of bytes that may be held in all threads' magazines, 0 to disable */
+static int64_t magazine_high_water = MAGAZINE_HIGH_WATER;
+
+/** incremented to ask every thread to flush its magazines to the shared pools */
+static atomic_int pool_generation = 0;
+
+/** Count an event on a magazine.
+ *
+ * Only the owning thread writes the counter, so this needs no atomic read-modify-write, but
+ * mlt_pool_stat() may read it from another thread.
+ */
+
+static inline void magazine_count(atomic_uint_fast64_t *counter)
+{
+    atomic_store_explicit(counter,
+                          atomic_load_explicit(counter, memory_order_relaxed) + 1,
+                          memory_order_relaxed);
+}
+
 /** Create a pool.
  *
  * \private \memberof mlt_pool_s
  * \param size the size of the memory blocks to hold as some power of two
+ * \param index the size class of the pool
  * \return a new pool object
  */
 
-static mlt_pool pool_init(int size)
+static mlt_pool pool_init(int size, int index)
 {
     // Create the pool
     mlt_pool self = calloc(1, sizeof(struct mlt_pool_s));
@@ -140,12 +231,175 @@ static mlt_pool pool_init(int size)
 
         // Assign the size
         self->size = size;
+        self->index = index;
     }
 
     // Return it
     return self;
 }
 
+/** Move blocks from a magazine back to its shared pool.
+ *
+ * \private \memberof mlt_thread_cache_s
+ * \param pool the pool that owns the blocks
+ * \param magazine a magazine
+ * \param keep the number of blocks to leave in the magazine
+ */
+
+static void magazine_flush(mlt_pool pool, mlt_magazine *magazine, int keep)
+{
+    if (magazine->count > keep) {
+        int n = magazine->count - keep;
+
+        pthread_mutex_lock(&pool->lock);
+        while (magazine->count > keep) {
+            void *ptr = magazine->items[--magazine->count];
+            mlt_release release = (void *) ((char *) ptr - sizeof(struct mlt_release_s));
+
+            // A block from before the pools were closed and initialised again is freed
+            if (release->pool == pool)
+                mlt_deque_push_back(pool->stack, ptr);
+            else
+                mlt_free(release);
+        }
+        pthread_mutex_unlock(&pool->lock);
+
+        atomic_fetch_sub(&magazine_bytes, (int64_t) n * pool->size);
+    }
+}
+
+/** Move up to half a magazine of blocks from the shared pool into a magazine.
+ *
+ * \private \memberof mlt_thread_cache_s
+ * \param pool the pool to take blocks from
+ * \param magazine an empty magazine
+ */
+
+static void magazine_refill(mlt_pool pool, mlt_magazine *magazine)
+{
+    int want = magazine->capacity / 2 > 0 ? magazine->capacity / 2 : 1;
+    int64_t reserved = (int64_t) want * pool->size;
+
+    // Respect the global high-water mark
+    if (atomic_fetch_add(&magazine_bytes, reserved) + reserved > magazine_high_water) {
+        atomic_fetch_sub(&magazine_bytes, reserved);
+        return;
+    }
+
+    pthread_mutex_lock(&pool->lock);
+    while (magazine->count < want && mlt_deque_count(pool->stack) > 0)
+        magazine->items[magazine->count++] = mlt_deque_pop_back(pool->stack);
+    pthread_mutex_unlock(&pool->lock);
+
+    // Give back the reservation for blocks the shared pool did not have
+    if (magazine->count < want)
+        atomic_fetch_sub(&magazine_bytes, (int64_t) (want - magazine->count) * pool->size);
+}
+
+/** Flush all magazines of a thread cache to the shared pools.
+ *
+ * Blocks of pools that mlt_pool_close() has already destroyed are freed instead.
+ * \private \memberof mlt_thread_cache_s
+ * \param cache a thread cache
+ */
+
+static void thread_cache_flush(mlt_thread_cache cache)
+{
+    int i;
+    for (i = 0; i < POOL_COUNT; i++) {
+        mlt_magazine *magazine = &cache->magazines[i];
+        if (pool_array[i]) {
+            magazine_flush(pool_array[i], magazine, 0);
+        } else if (magazine->count > 0) {
+            atomic_fetch_sub(&magazine_bytes,
+                             (int64_t) magazine->count << (i + POOL_MIN_INDEX));
+            while (magazine->count > 0)
+                mlt_free((char *) magazine->items[--magazine->count]
+                         - sizeof(struct mlt_release_s));
+        }
+    }
+}
+
+/** Flush and destroy a thread cache when its thread exits.
+ *
+ * \private \memberof mlt_thread_cache_s
+ * \param arg a thread cache
+ */
+
+static void thread_cache_close(void *arg)
+{
+    mlt_thread_cache cache = arg;
+    int i;
+
+    thread_cache_flush(cache);
+
+    pthread_mutex_lock(&cache_registry_mutex);
+    for (i = 0; i < POOL_COUNT; i++) {
+        retired_hits += atomic_load(&cache->magazines[i].hits);
+        retired_misses += atomic_load(&cache->magazines[i].misses);
+    }
+    if (cache->prev)
+        cache->prev->next = cache->next;
+    else
+        cache_registry = cache->next;
+    if (cache->next)
+        cache->next->prev = cache->prev;
+    pthread_mutex_unlock(&cache_registry_mutex);
+
+    free(cache);
+}
+
+static void thread_cache_key_init()
+{
+    pthread_key_create(&cache_key, thread_cache_close);
+}
+
+/** Get the calling thread's cache, creating it on first use.
+ *
+ * \private \memberof mlt_thread_cache_s
+ * \return the thread cache or NULL if magazines are disabled
+ */
+
+static mlt_thread_cache thread_cache_get()
+{
+    mlt_thread_cache cache;
+
+    if (magazine_high_water <= 0)
+        return NULL;
+
+    pthread_once(&cache_once, thread_cache_key_init);
+    cache = pthread_getspecific(cache_key);
+
+    if (cache == NULL) {
+        int i;
+
+        cache = calloc(1, sizeof(struct mlt_thread_cache_s));
+        if (cache == NULL)
+            return NULL;
+        for (i = 0; i < POOL_COUNT; i++) {
+            int capacity = MAGAZINE_CLASS_BYTES >> (i + POOL_MIN_INDEX);
+            cache->magazines[i].capacity = CLAMP(capacity, 1, MAGAZINE_SIZE);
+        }
+        cache->generation = atomic_load(&pool_generation);
+
+        pthread_mutex_lock(&cache_registry_mutex);
+        cache->id = ++cache_sequence;
+        cache->next = cache_registry;
+        if (cache_registry)
+            cache_registry->prev = cache;
+        cache_registry = cache;
+        pthread_mutex_unlock(&cache_registry_mutex);
+
+        pthread_setspecific(cache_key, cache);
+    } else if (cache->generation != atomic_load_explicit(&pool_generation, memory_order_relaxed)) {
+        // Another thread purged the pools
+        thread_cache_flush(cache);
+        cache->generation = atomic_load(&pool_generation);
+    }
+
+    return cache;
+}
+
 /** Get an item from the pool.
  *
  * \private \memberof mlt_pool_s
@@ -222,6 +476,22 @@ static void pool_return(void *ptr)
         mlt_pool self = that->pool;
 
         if (self != NULL) {
+            mlt_thread_cache cache = thread_cache_get();
+
+            // Try to keep it in this thread's magazine
+            if (cache != NULL) {
+                mlt_magazine *magazine = &cache->magazines[self->index];
+
+                if (magazine->count == magazine->capacity)
+                    magazine_flush(self, magazine, magazine->capacity / 2);
+                if (atomic_fetch_add(&magazine_bytes, self->size) + self->size
+                    <= magazine_high_water) {
+                    magazine->items[magazine->count++] = ptr;
+                    return;
+                }
+                atomic_fetch_sub(&magazine_bytes, self->size);
+            }
+
             // Lock the pool
             pthread_mutex_lock(&self->lock);
 
@@ -278,22 +548,28 @@ void mlt_pool_init()
     // Loop variable used to create the pools
     int i = 0;
 
+    // Determine the ceiling for memory held in per-thread magazines
+    const char *e = getenv("MLT_POOL_MAGAZINE_MAX");
+    if (e)
+        magazine_high_water = strtoll(e, NULL, 10);
+
     // Create the pools
     pools = mlt_properties_new();
 
     // Create the pools
-    for (i = 8; i < 31; i++) {
+    for (i = POOL_MIN_INDEX; i < POOL_MAX_INDEX; i++) {
         // Each properties item needs a name
         char name[32];
 
         // Construct a pool
-        mlt_pool pool = pool_init(1 << i);
+        mlt_pool pool = pool_init(1 << i, i - POOL_MIN_INDEX);
 
         // Generate a name
         sprintf(name, "%d", i);
 
         // Register with properties
         mlt_properties_set_data(pools, name, pool, 0, (mlt_destructor) pool_close, NULL);
+        pool_array[i - POOL_MIN_INDEX] = pool;
     }
 }
 
@@ -309,7 +585,10 @@ void *mlt_pool_alloc(int size)
     mlt_pool pool = NULL;
 
     // Determines the index of the pool to use
-    int index = 8;
+    int index = POOL_MIN_INDEX;
+
+    // This thread's magazines
+    mlt_thread_cache cache = NULL;
 
     // Minimum size pooled is 256 bytes
     size += sizeof(struct mlt_release_s);
@@ -317,7 +596,26 @@ void *mlt_pool_alloc(int size)
         index++;
 
     // Now get the pool at the index
-    pool = mlt_properties_get_data_at(pools, index - 8, NULL);
+    pool = pool_array[index - POOL_MIN_INDEX];
+
+    // Try this thread's magazine first
+    if (pool != NULL && (cache = thread_cache_get()) != NULL) {
+        mlt_magazine *magazine = &cache->magazines[pool->index];
+
+        if (magazine->count > 0) {
+            magazine_count(&magazine->hits);
+        } else {
+            // Take a batch from the shared pool for the next allocations
+            magazine_count(&magazine->misses);
+            magazine_refill(pool, magazine);
+        }
+        if (magazine->count > 0) {
+            void *ptr = magazine->items[--magazine->count];
+            atomic_fetch_sub(&magazine_bytes, pool->size);
+            ((mlt_release) ((char *) ptr - sizeof(struct mlt_release_s)))->references = 1;
+            return ptr;
+        }
+    }
 
     // Now get the real item
     return pool_fetch(pool);
@@ -372,6 +670,12 @@ void mlt_pool_purge()
 {
     int i = 0;
 
+    // Return this thread's blocks now and ask other threads to do the same
+    mlt_thread_cache cache = thread_cache_get();
+    if (cache)
+        thread_cache_flush(cache);
+    atomic_fetch_add(&pool_generation, 1);
+
     // For each pool
     for (i = 0; i < mlt_properties_count(pools); i++) {
         // Get the pool
@@ -413,45 +717,112 @@ void mlt_pool_release(void *release)
 
 void mlt_pool_close()
 {
+    mlt_thread_cache cache;
+    int i;
+
 #ifdef _MLT_POOL_CHECKS_
     mlt_pool_stat();
 #endif
 
+    // Return this thread's blocks to the pools so they are freed. Other threads may still be
+    // running and only ever touch their own magazines; they free what they hold the next time
+    // they use the pool or when they exit.
+    pthread_once(&cache_once, thread_cache_key_init);
+    cache = pthread_getspecific(cache_key);
+    if (cache)
+        thread_cache_flush(cache);
+    for (i = 0; i < POOL_COUNT; i++)
+        pool_array[i] = NULL;
+    atomic_fetch_add(&pool_generation, 1);
+
     // Close the properties
     mlt_properties_close(pools);
 }
 
+/** Log statistics about the pools and the per-thread magazines.
+ *
+ * \public \memberof mlt_pool_s
+ */
+
 void mlt_pool_stat()
 {
     // Stats dump
     uint64_t allocated = 0, used = 0, s;
+    uint64_t hits = 0, misses = 0;
     int i = 0, c = mlt_properties_count(pools);
+    mlt_thread_cache cache;
 
     mlt_log(NULL, MLT_LOG_VERBOSE, "%s: count %d\n", __FUNCTION__, c);
 
     for (i = 0; i < c; i++) {
         mlt_pool pool = mlt_properties_get_data_at(pools, i, NULL);
-        if (pool->count)
+        int count, returned;
+
+        pthread_mutex_lock(&pool->lock);
+        count = pool->count;
+        returned = mlt_deque_count(pool->stack);
+        pthread_mutex_unlock(&pool->lock);
+
+        if (count)
             mlt_log_verbose(NULL,
                             "%s: size %d allocated %d returned %d %c\n",
                             __FUNCTION__,
                             pool->size,
-                            pool->count,
-                            mlt_deque_count(pool->stack),
-                            pool->count != mlt_deque_count(pool->stack) ? '*' : ' ');
+                            count,
+                            returned,
+                            count != returned ? '*' : ' ');
         s = pool->size;
-        s *= pool->count;
+        s *= count;
         allocated += s;
-        s = pool->count - mlt_deque_count(pool->stack);
+        s = count - returned;
         s *= pool->size;
         used += s;
     }
 
+    // Blocks held in magazines are not in use
+    used -= atomic_load(&magazine_bytes);
+
     mlt_log_verbose(NULL,
                     "%s: allocated %" PRIu64 " bytes, used %" PRIu64 " bytes \n",
                     __FUNCTION__,
                     allocated,
                     used);
+
+    // Per-thread magazine hit rates
+    pthread_mutex_lock(&cache_registry_mutex);
+    for (cache = cache_registry; cache != NULL; cache = cache->next) {
+        uint64_t thread_hits = 0, thread_misses = 0;
+        for (i = 0; i < POOL_COUNT; i++) {
+            thread_hits += atomic_load_explicit(&cache->magazines[i].hits, memory_order_relaxed);
+            thread_misses += atomic_load_explicit(&cache->magazines[i].misses,
+                                                  memory_order_relaxed);
+        }
+        if (thread_hits + thread_misses)
+            mlt_log_verbose(NULL,
+                            "%s: thread %d hits %" PRIu64 " misses %" PRIu64
+                            " hit rate %.1f%%\n",
+                            __FUNCTION__,
+                            cache->id,
+                            thread_hits,
+                            thread_misses,
+                            100.0 * thread_hits / (thread_hits + thread_misses));
+        hits += thread_hits;
+        misses += thread_misses;
+    }
+    hits += retired_hits;
+    misses += retired_misses;
+    pthread_mutex_unlock(&cache_registry_mutex);
+
+    if (hits + misses)
+        mlt_log_verbose(NULL,
+                        "%s: magazines hits %" PRIu64 " misses %" PRIu64
+                        " hit rate %.1f%% holding %" PRId64 " of %" PRId64 " bytes\n",
+                        __FUNCTION__,
+                        hits,
+                        misses,
+                        100.0 * hits / (hits + misses),
+                        (int64_t) atomic_load(&magazine_bytes),
+                        magazine_high_water);
 }
 
 #endif // NO_MLT_POOL
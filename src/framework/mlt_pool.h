@@ -24,6 +24,12 @@
 #define MLT_POOL_H
 #include "mlt_api.h"
 
+/**
+ * \envvar \em MLT_POOL_MAGAZINE_MAX Set the maximum number of bytes of free
+ * blocks that may be cached in per-thread magazines across all threads, which
+ * defaults to 512 MiB. Set to 0 to disable the per-thread magazines.
+ */
+
 MLT_API extern void mlt_pool_init();
 MLT_API extern void *mlt_pool_alloc(int size);
 MLT_API extern void *mlt_pool_realloc(void *ptr, int size);
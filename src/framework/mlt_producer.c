@@ -41,6 +41,7 @@
 
 static int producer_get_frame(mlt_service self, mlt_frame_ptr frame, int index);
 static void mlt_producer_property_changed(mlt_service owner, mlt_producer self, mlt_event_data);
+static void mlt_producer_properties_changed(mlt_service owner, mlt_producer self, mlt_event_data);
 static void mlt_producer_service_changed(mlt_service owner, mlt_producer self);
 
 /* for debugging */
@@ -110,11 +111,16 @@ int mlt_producer_init(mlt_producer self, void *child)
                               self,
                               "service-changed",
                               (mlt_listener) mlt_producer_service_changed);
+            mlt_events_listen_batched(properties,
+                                      self,
+                                      "property-changed",
+                                      (mlt_listener) mlt_producer_property_changed);
             mlt_events_listen(properties,
                               self,
-                              "property-changed",
-                              (mlt_listener) mlt_producer_property_changed);
+                              "properties-changed",
+                              (mlt_listener) mlt_producer_properties_changed);
             mlt_events_register(properties, "producer-changed");
+            mlt_events_register(properties, "producer-prefetch");
         }
     }
 
@@ -144,6 +150,29 @@ static void mlt_producer_property_changed(mlt_service owner,
                         mlt_event_data_none());
 }
 
+/** Listener for a batch of property changes.
+ *
+ * If any of the in, out, or length properties changed, fire a single "producer-changed" event.
+ *
+ * \private \memberof mlt_producer_s
+ * \param owner a service (ignored)
+ * \param self the producer
+ * \param event_data the names of the properties that changed
+ */
+
+static void mlt_producer_properties_changed(mlt_service owner,
+                                            mlt_producer self,
+                                            mlt_event_data event_data)
+{
+    mlt_properties names = mlt_event_data_to_object(event_data);
+    if (names
+        && (mlt_properties_get(names, "in") || mlt_properties_get(names, "out")
+            || mlt_properties_get(names, "length")))
+        mlt_events_fire(MLT_PRODUCER_PROPERTIES(mlt_producer_cut_parent(self)),
+                        "producer-changed",
+                        mlt_event_data_none());
+}
+
 /** Listener for service changes.
  *
  * Fires the "producer-changed" event.
@@ -1080,6 +1109,43 @@ int mlt_producer_optimise(mlt_producer self)
     return error;
 }
 
+/** Announce the positions that will be requested from a producer.
+ *
+ * This is only a hint: it does not change the position of the producer, and
+ * a producer is free to ignore it. A cut forwards the hint to its parent
+ * producer in the parent's time, and playlists, multitracks, and tractors
+ * forward it to the producers they contain.
+ *
+ * \public \memberof mlt_producer_s
+ * \param self a producer
+ * \param position the first position that will be requested
+ * \param count the number of consecutive positions that will be requested
+ * \return true if there was an error
+ * \see mlt_playlist_prefetch
+ * \see mlt_multitrack_prefetch
+ */
+
+int mlt_producer_prefetch(mlt_producer self, mlt_position position, int count)
+{
+    if (!self || count <= 0)
+        return 1;
+
+    if (mlt_producer_is_cut(self)) {
+        mlt_producer parent = mlt_producer_cut_parent(self);
+        position = MAX(0, position) + mlt_producer_get_in(self);
+        count = MIN(count, mlt_producer_get_out(self) - position + 1);
+        if (parent == self || count <= 0)
+            return 1;
+        self = parent;
+    }
+
+    mlt_event_data_prefetch prefetch = {position, count};
+    mlt_events_fire(MLT_PRODUCER_PROPERTIES(self),
+                    "producer-prefetch",
+                    mlt_event_data_from_object(&prefetch));
+    return 0;
+}
+
 /** Close the producer.
  *
  * Destroys the producer and deallocates its resources managed by its
@@ -36,6 +36,9 @@
  *
  * \extends mlt_service
  * \event \em producer-changed either service-changed was fired or the timing of the producer changed
+ * \event \em producer-prefetch mlt_producer_prefetch() was called to announce positions that will
+ *   be requested soon. The event data is a pointer to mlt_event_data_prefetch, which is only valid
+ *   during the call. A producer may listen to this to read or decode ahead on its own threads.
  * \properties \em mlt_type the name of the service subclass, e.g. mlt_producer
  * \properties \em mlt_service the name of a producer subclass
  * \properties \em _position the current position of the play head, relative to the in point
@@ -145,5 +148,6 @@ MLT_API extern void mlt_producer_close(mlt_producer self);
 MLT_API int64_t mlt_producer_get_creation_time(mlt_producer self);
 MLT_API void mlt_producer_set_creation_time(mlt_producer self, int64_t creation_time);
 MLT_API extern int mlt_producer_probe(mlt_producer self);
+MLT_API extern int mlt_producer_prefetch(mlt_producer self, mlt_position position, int count);
 
 #endif
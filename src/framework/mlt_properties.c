@@ -38,6 +38,7 @@
 #include <locale.h>
 #include <pthread.h>
 #include <stdarg.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -46,11 +47,41 @@
 
 #define MAX_LOAD_LINE_SIZE 4096
 
+/** the initial number of slots in the name index, must be a power of 2 */
+#define INDEX_INITIAL_SIZE 16
+
+/** \brief a slot of the name index */
+
+typedef struct
+{
+    unsigned int hash;           ///< the cached hash of the name
+    const char *name;            ///< the name of the property
+    _Atomic(mlt_property) value; ///< the property, NULL for an empty slot
+} index_slot;
+
+/** \brief open-addressing hash table of property names
+ *
+ * Lookups read the index without taking the properties mutex. A slot is
+ * published by storing its value last, and a table is never rearranged in
+ * place: it is replaced by a new one, and the old one is retired until no
+ * lookup is in progress so that concurrent readers remain safe.
+ */
+
+typedef struct property_index_s
+{
+    int size;                         ///< the number of slots, a power of 2
+    struct property_index_s *retired; ///< the table this one replaced
+    index_slot slots[];
+} property_index;
+
 /** \brief private implementation of the property list */
 
 typedef struct
 {
-    int hash[199];
+    _Atomic(property_index *) index;
+    atomic_int readers;   ///< the number of lookups in progress
+    char **retired_names; ///< renamed names that lookups may still be reading
+    int retired_count;
     char **name;
     mlt_property *value;
     int count;
@@ -62,8 +93,32 @@ typedef struct
     mlt_properties *children_properties;
     char **children_names;
     int children_count;
+    atomic_int updates; ///< the number of threads with an update in progress
 } property_list;
 
+/** the most properties lists a thread can update at once; more are not batched */
+#define MAX_THREAD_UPDATES 8
+
+/** \brief an update in progress on a thread, see mlt_properties_begin_update() */
+
+typedef struct
+{
+    mlt_properties owner; ///< the properties list being updated
+    int depth;            ///< the nesting level of mlt_properties_begin_update()
+    mlt_properties names; ///< the names changed, in order, or NULL until one changes
+} property_update;
+
+/** \brief the updates in progress on a thread */
+
+typedef struct
+{
+    int count;
+    property_update updates[MAX_THREAD_UPDATES];
+} thread_updates;
+
+static pthread_key_t updates_key;
+static pthread_once_t updates_once = PTHREAD_ONCE_INIT;
+
 /* Memory leak checks */
 
 //#define _MLT_PROPERTY_CHECKS_ 2
@@ -210,6 +265,7 @@ static int load_properties(mlt_properties self, const char *filename)
         char last[MAX_LOAD_LINE_SIZE] = "";
 
         // Read each string from the file
+        mlt_properties_begin_update(self);
         while (fgets(temp, MAX_LOAD_LINE_SIZE, file)) {
             // Chomp the new line character from the string
             int x = strlen(temp) - 1;
@@ -232,6 +288,7 @@ static int load_properties(mlt_properties self, const char *filename)
             if (strcmp(temp, "") && temp[0] != '#')
                 mlt_properties_parse(self, temp);
         }
+        mlt_properties_commit_update(self);
 
         // Close the file
         fclose(file);
@@ -321,12 +378,86 @@ int mlt_properties_preset(mlt_properties self, const char *name)
  * \return an integer
  */
 
-static inline int generate_hash(const char *name)
+static inline unsigned int generate_hash(const char *name)
 {
     unsigned int hash = 5381;
     while (*name)
         hash = hash * 33 + (unsigned int) (*name++);
-    return hash % 199;
+    return hash;
+}
+
+/** Add a property to the name index.
+ *
+ * The index must have at least one free slot.
+ * \private \memberof mlt_properties_s
+ * \param index a name index
+ * \param name the name of the property
+ * \param value the property
+ */
+
+static inline void index_insert(property_index *index, const char *name, mlt_property value)
+{
+    unsigned int mask = index->size - 1;
+    unsigned int hash = generate_hash(name);
+    unsigned int slot = hash & mask;
+    while (atomic_load_explicit(&index->slots[slot].value, memory_order_relaxed))
+        slot = (slot + 1) & mask;
+    index->slots[slot].hash = hash;
+    index->slots[slot].name = name;
+    atomic_store_explicit(&index->slots[slot].value, value, memory_order_release);
+}
+
+/** Replace the name index with a new one built from the property list.
+ *
+ * The caller must hold the properties mutex.
+ * \private \memberof mlt_properties_s
+ * \param list a property list
+ * \param size the number of slots, a power of 2
+ */
+
+static int index_rebuild(property_list *list, int size)
+{
+    property_index *index = calloc(1, sizeof(property_index) + size * sizeof(index_slot));
+    int i;
+
+    if (index == NULL)
+        return 1;
+    index->size = size;
+    index->retired = atomic_load_explicit(&list->index, memory_order_relaxed);
+    for (i = 0; i < list->count; i++)
+        if (list->name[i])
+            index_insert(index, list->name[i], list->value[i]);
+    atomic_store(&list->index, index);
+    return 0;
+}
+
+/** Free the retired name index tables and names if no lookup can still be reading them.
+ *
+ * The caller must hold the properties mutex. The index is swapped before the readers are
+ * counted, and a lookup is counted before it loads the index, so a lookup that starts after
+ * the count sees only the current table.
+ * \private \memberof mlt_properties_s
+ * \param list a property list
+ */
+
+static void index_reclaim(property_list *list)
+{
+    property_index *index = atomic_load_explicit(&list->index, memory_order_relaxed);
+    int i;
+
+    if (index == NULL || (index->retired == NULL && list->retired_count == 0)
+        || atomic_load(&list->readers) != 0)
+        return;
+    while (index->retired != NULL) {
+        property_index *retired = index->retired;
+        index->retired = retired->retired;
+        free(retired);
+    }
+    for (i = 0; i < list->retired_count; i++)
+        free(list->retired_names[i]);
+    free(list->retired_names);
+    list->retired_names = NULL;
+    list->retired_count = 0;
 }
 
 /** Copy a serializable property to a properties list that is mirroring this one.
@@ -435,6 +566,8 @@ int mlt_properties_inherit(mlt_properties self, mlt_properties that)
     if (!self || !that)
         return 1;
 
+    mlt_properties_begin_update(self);
+
     // Set "properties" first so preset overrides are reliable.
     char *value = mlt_properties_get(that, "properties");
     if (value)
@@ -462,6 +595,7 @@ int mlt_properties_inherit(mlt_properties self, mlt_properties that)
     }
 
     mlt_properties_unlock(that);
+    mlt_properties_commit_update(self);
 
     return 0;
 }
@@ -482,6 +616,7 @@ int mlt_properties_copy(mlt_properties self, mlt_properties that, const char *pr
     int count = mlt_properties_count(that);
     int length = strlen(prefix);
     int i = 0;
+    mlt_properties_begin_update(self);
     for (i = 0; i < count; i++) {
         char *name = mlt_properties_get_name(that, i);
         if (!strncmp(name, prefix, length)) {
@@ -490,6 +625,7 @@ int mlt_properties_copy(mlt_properties self, mlt_properties that, const char *pr
                 mlt_properties_set_string(self, name, value);
         }
     }
+    mlt_properties_commit_update(self);
     return 0;
 }
 
@@ -512,6 +648,7 @@ int mlt_properties_pass(mlt_properties self, mlt_properties that, const char *pr
     int count = mlt_properties_count(that);
     int length = strlen(prefix);
     int i = 0;
+    mlt_properties_begin_update(self);
     for (i = 0; i < count; i++) {
         char *name = mlt_properties_get_name(that, i);
         if (!strncmp(name, prefix, length)) {
@@ -520,6 +657,7 @@ int mlt_properties_pass(mlt_properties self, mlt_properties that, const char *pr
                 mlt_properties_set_string(self, name + length, value);
         }
     }
+    mlt_properties_commit_update(self);
     return 0;
 }
 
@@ -536,25 +674,29 @@ static inline mlt_property mlt_properties_find(mlt_properties self, const char *
     if (!self || !name)
         return NULL;
     property_list *list = self->local;
-    mlt_property value = NULL;
-    int key = generate_hash(name);
-
-    mlt_properties_lock(self);
-
-    int i = list->hash[key] - 1;
-    if (i >= 0) {
-        // Check if we're hashed
-        if (list->count > 0 && list->name[i] && !strcmp(list->name[i], name))
-            value = list->value[i];
-
-        // Locate the item
-        for (i = list->count - 1; value == NULL && i >= 0; i--)
-            if (list->name[i] && !strcmp(list->name[i], name))
-                value = list->value[i];
+    mlt_property result = NULL;
+
+    // This does not lock the mutex; see property_index and index_reclaim()
+    atomic_fetch_add(&list->readers, 1);
+    property_index *index = atomic_load(&list->index);
+    if (index != NULL) {
+        unsigned int hash = generate_hash(name);
+        unsigned int mask = index->size - 1;
+        unsigned int slot = hash & mask;
+        mlt_property value;
+
+        // Probe until an empty slot, comparing names only when the hashes match
+        while ((value = atomic_load_explicit(&index->slots[slot].value, memory_order_acquire))) {
+            if (index->slots[slot].hash == hash && !strcmp(index->slots[slot].name, name)) {
+                result = value;
+                break;
+            }
+            slot = (slot + 1) & mask;
+        }
     }
-    mlt_properties_unlock(self);
+    atomic_fetch_sub(&list->readers, 1);
 
-    return value;
+    return result;
 }
 
 /** Add a new property.
@@ -568,7 +710,7 @@ static inline mlt_property mlt_properties_find(mlt_properties self, const char *
 static mlt_property mlt_properties_add(mlt_properties self, const char *name)
 {
     property_list *list = self->local;
-    int key = generate_hash(name);
+    property_index *index;
     mlt_property result;
 
     mlt_properties_lock(self);
@@ -584,9 +726,16 @@ static mlt_property mlt_properties_add(mlt_properties self, const char *name)
     list->name[list->count] = strdup(name);
     list->value[list->count] = mlt_property_init();
 
-    // Assign to hash table
-    if (list->hash[key] == 0)
-        list->hash[key] = list->count + 1;
+    // Keep the index at most half full
+    index = atomic_load_explicit(&list->index, memory_order_relaxed);
+    if (index == NULL || (list->count + 1) * 2 > index->size) {
+        index_rebuild(list, index ? index->size * 2 : INDEX_INITIAL_SIZE);
+        index = atomic_load_explicit(&list->index, memory_order_relaxed);
+    }
+    // Without memory to grow, use the old index while it has a free slot
+    if (list->name[list->count] && index && list->count + 1 < index->size)
+        index_insert(index, list->name[list->count], list->value[list->count]);
+    index_reclaim(list);
 
     // Return and increment count accordingly
     result = list->value[list->count++];
@@ -617,9 +766,69 @@ static mlt_property mlt_properties_fetch(mlt_properties self, const char *name)
     return property;
 }
 
+static void thread_updates_close(thread_updates *updates)
+{
+    for (int i = 0; i < updates->count; i++)
+        mlt_properties_close(updates->updates[i].names);
+    free(updates);
+}
+
+static void updates_key_init(void)
+{
+    pthread_key_create(&updates_key, (void (*)(void *)) thread_updates_close);
+}
+
+/** Find the calling thread's update of a properties list.
+ *
+ * \private \memberof mlt_properties_s
+ * \param self a properties list
+ * \param create whether to start a new update if there is none
+ * \return the update or NULL if there is none or no room for one
+ */
+
+static property_update *thread_update(mlt_properties self, int create)
+{
+    pthread_once(&updates_once, updates_key_init);
+    thread_updates *updates = pthread_getspecific(updates_key);
+
+    for (int i = 0; updates && i < updates->count; i++)
+        if (updates->updates[i].owner == self)
+            return &updates->updates[i];
+    if (!create)
+        return NULL;
+    if (!updates) {
+        updates = calloc(1, sizeof(thread_updates));
+        if (!updates || pthread_setspecific(updates_key, updates)) {
+            free(updates);
+            return NULL;
+        }
+    }
+    if (updates->count == MAX_THREAD_UPDATES)
+        return NULL;
+
+    property_update *update = &updates->updates[updates->count++];
+    update->owner = self;
+    update->depth = 0;
+    update->names = NULL;
+    atomic_fetch_add(&((property_list *) self->local)->updates, 1);
+    return update;
+}
+
 static void fire_property_changed(mlt_properties self, const char *name)
 {
-    mlt_events_fire(self, "property-changed", mlt_event_data_from_string(name));
+    property_list *list = self->local;
+    property_update *update = atomic_load(&list->updates) > 0 ? thread_update(self, 0) : NULL;
+
+    // Defer the event until this thread commits its update, once per name, unless nobody listens.
+    if (update
+        && (mlt_events_has_listeners(self, "property-changed")
+            || mlt_events_has_listeners(self, "properties-changed"))) {
+        if (!update->names)
+            update->names = mlt_properties_new();
+        mlt_properties_set_int(update->names, name, 1);
+    } else {
+        mlt_events_fire(self, "property-changed", mlt_event_data_from_string(name));
+    }
 }
 
 /** Copy a property to another properties list.
@@ -662,6 +871,7 @@ int mlt_properties_pass_list(mlt_properties self, mlt_properties that, const cha
     const char *delim = " ,\t\n"; // Any combination of spaces, commas, tabs, and newlines
     int count, done = 0;
 
+    mlt_properties_begin_update(self);
     while (!done) {
         count = strcspn(ptr, delim);
 
@@ -676,6 +886,7 @@ int mlt_properties_pass_list(mlt_properties self, mlt_properties that, const cha
         if (!done)
             ptr += strspn(ptr, delim);
     }
+    mlt_properties_commit_update(self);
 
     free(props);
 
@@ -714,7 +925,9 @@ static int is_valid_expression(mlt_properties self, const char *value)
  * The property name "properties" is reserved to load the preset in \p value.
  * When the value begins with '@' then it is interpreted as a very simple math
  * expression containing only the +, -, *, and / operators.
- * The event "property-changed" is fired after the property has been set.
+ * The event "property-changed" is fired after the property has been set, or when the
+ * update is committed if this is called between mlt_properties_begin_update() and
+ * mlt_properties_commit_update().
  *
  * This makes a copy of the string value you supply.
  * \public \memberof mlt_properties_s
@@ -827,7 +1040,9 @@ int mlt_properties_set_or_default(mlt_properties self,
  *
  * Unlike \mlt_properties_set this function does not attempt to interpret an expression.
  * The property name "properties" is reserved to load the preset in \p value.
- * The event "property-changed" is fired after the property has been set.
+ * The event "property-changed" is fired after the property has been set, or when the
+ * update is committed if this is called between mlt_properties_begin_update() and
+ * mlt_properties_commit_update().
  *
  * This makes a copy of the string value you supply.
  * \public \memberof mlt_properties_s
@@ -1269,12 +1484,13 @@ int mlt_properties_set_data(mlt_properties self,
  * \param self a properties list
  * \param source the property to rename
  * \param dest the new name
- * \return true if the name is already in use
+ * \return true if the name is already in use or there is not enough memory
  */
 
 int mlt_properties_rename(mlt_properties self, const char *source, const char *dest)
 {
     mlt_property value = mlt_properties_find(self, dest);
+    int error = value != NULL;
 
     if (value == NULL) {
         property_list *list = self->local;
@@ -1284,16 +1500,31 @@ int mlt_properties_rename(mlt_properties self, const char *source, const char *d
         mlt_properties_lock(self);
         for (i = 0; i < list->count; i++) {
             if (list->name[i] && !strcmp(list->name[i], source)) {
-                free(list->name[i]);
-                list->name[i] = strdup(dest);
-                list->hash[generate_hash(dest)] = i + 1;
+                // Lookups may still be reading the old name
+                char **retired_names = realloc(list->retired_names,
+                                               (list->retired_count + 1) * sizeof(char *));
+                char *name = strdup(dest);
+                char *old_name = list->name[i];
+
+                if (retired_names)
+                    list->retired_names = retired_names;
+                list->name[i] = name;
+                if (!retired_names || !name
+                    || index_rebuild(list, atomic_load(&list->index)->size)) {
+                    list->name[i] = old_name;
+                    free(name);
+                    error = 1;
+                } else {
+                    list->retired_names[list->retired_count++] = old_name;
+                    index_reclaim(list);
+                }
                 break;
             }
         }
         mlt_properties_unlock(self);
     }
 
-    return value != NULL;
+    return error;
 }
 
 /** Dump the properties to a file handle.
@@ -1522,6 +1753,15 @@ void mlt_properties_close(mlt_properties self)
             pthread_mutex_destroy(&list->mutex);
             free(list->name);
             free(list->value);
+            property_index *table = atomic_load(&list->index);
+            while (table != NULL) {
+                property_index *retired = table->retired;
+                free(table);
+                table = retired;
+            }
+            for (index = 0; index < list->retired_count; index++)
+                free(list->retired_names[index]);
+            free(list->retired_names);
             free(list);
 
             // Free self now if self has no child
@@ -2199,6 +2439,63 @@ void mlt_properties_unlock(mlt_properties self)
         pthread_mutex_unlock(&((property_list *) (self->local))->mutex);
 }
 
+/** Start a batch of property changes.
+ *
+ * Until the matching mlt_properties_commit_update(), "property-changed" is not fired. The names
+ * of the changed properties are collected instead, so that listeners are notified once per
+ * property, or once for the whole batch, after all of the values are in place. Updates nest;
+ * only the outermost commit fires. An update belongs to the calling thread: changes made by other
+ * threads meanwhile fire as usual.
+ *
+ * \public \memberof mlt_properties_s
+ * \param self a properties list
+ */
+
+void mlt_properties_begin_update(mlt_properties self)
+{
+    if (self) {
+        property_update *update = thread_update(self, 1);
+        if (update)
+            update->depth++;
+    }
+}
+
+/** Finish a batch of property changes.
+ *
+ * When this ends the outermost update, "properties-changed" is fired with the list of names as
+ * its event data object, a mlt_properties whose property names are the changed names, in the
+ * order they were first changed. Before that, "property-changed" is fired once for every name,
+ * except to the listeners connected with mlt_events_listen_batched(). So a service that handles
+ * the batch at once should listen for "property-changed" that way: it then gets single changes
+ * as usual and each batch only once.
+ *
+ * \public \memberof mlt_properties_s
+ * \param self a properties list
+ */
+
+void mlt_properties_commit_update(mlt_properties self)
+{
+    property_update *update = self ? thread_update(self, 0) : NULL;
+    if (update && --update->depth == 0) {
+        // Finish the update first so that listeners starting another one get a new entry.
+        thread_updates *updates = pthread_getspecific(updates_key);
+        mlt_properties names = update->names;
+        *update = updates->updates[--updates->count];
+        atomic_fetch_sub(&((property_list *) self->local)->updates, 1);
+
+        int count = mlt_properties_count(names);
+        if (count > 0) {
+            int changed = mlt_events_lookup(self, "property-changed");
+            for (int i = 0; i < count; i++) {
+                const char *name = mlt_properties_get_name(names, i);
+                mlt_events_fire_id_unbatched(self, changed, mlt_event_data_from_string(name));
+            }
+            mlt_events_fire(self, "properties-changed", mlt_event_data_from_object(names));
+        }
+        mlt_properties_close(names);
+    }
+}
+
 /** Remove the value for a property.
  *
  * This initializes the value to zero and removes any string, data, or animation.
@@ -2454,7 +2751,9 @@ char *mlt_properties_anim_get(mlt_properties self, const char *name, int positio
 
 /** Set a property to a string at a frame position.
  *
- * The event "property-changed" is fired after the property has been set.
+ * The event "property-changed" is fired after the property has been set, or when the
+ * update is committed if this is called between mlt_properties_begin_update() and
+ * mlt_properties_commit_update().
  *
  * This makes a copy of the string value you supply.
  * \public \memberof mlt_properties_s
@@ -97,6 +97,8 @@ MLT_API extern mlt_properties mlt_properties_parse_yaml(const char *file);
 MLT_API extern char *mlt_properties_serialise_yaml(mlt_properties self);
 MLT_API extern void mlt_properties_lock(mlt_properties self);
 MLT_API extern void mlt_properties_unlock(mlt_properties self);
+MLT_API extern void mlt_properties_begin_update(mlt_properties self);
+MLT_API extern void mlt_properties_commit_update(mlt_properties self);
 MLT_API extern void mlt_properties_clear(mlt_properties self, const char *name);
 MLT_API extern int mlt_properties_exists(mlt_properties self, const char *name);
 
@@ -1439,10 +1439,14 @@ double mlt_property_anim_get_double(
     double result;
     pthread_mutex_lock(&self->mutex);
     if (mlt_property_is_anim(self)) {
+        refresh_animation(self, fps, locale, length);
+        if (!mlt_animation_get_double(self->animation, fps, locale, position, &result)) {
+            pthread_mutex_unlock(&self->mutex);
+            return result;
+        }
+
         struct mlt_animation_item_s item;
         item.property = mlt_property_init();
-
-        refresh_animation(self, fps, locale, length);
         mlt_animation_get_item(self->animation, &item, position);
         pthread_mutex_unlock(&self->mutex);
         result = mlt_property_get_double(item.property, fps, locale);
@@ -2022,11 +2026,15 @@ mlt_rect mlt_property_anim_get_rect(
     mlt_rect result;
     pthread_mutex_lock(&self->mutex);
     if (mlt_property_is_anim(self)) {
+        refresh_animation(self, fps, locale, length);
+        if (!mlt_animation_get_rect(self->animation, locale, position, &result)) {
+            pthread_mutex_unlock(&self->mutex);
+            return result;
+        }
+
         struct mlt_animation_item_s item;
         item.property = mlt_property_init();
         item.property->types = mlt_prop_rect;
-
-        refresh_animation(self, fps, locale, length);
         mlt_animation_get_item(self->animation, &item, position);
         pthread_mutex_unlock(&self->mutex);
         result = mlt_property_get_rect(item.property, locale);
@@ -97,6 +97,7 @@ int mlt_service_init(mlt_service self, void *child)
         mlt_events_init(&self->parent);
         mlt_events_register(&self->parent, "service-changed");
         mlt_events_register(&self->parent, "property-changed");
+        mlt_events_register(&self->parent, "properties-changed");
         pthread_mutex_init(&((mlt_service_base *) self->local)->mutex, NULL);
     }
 
@@ -115,6 +116,20 @@ void mlt_service_lock(mlt_service self)
         pthread_mutex_lock(&((mlt_service_base *) self->local)->mutex);
 }
 
+/** Try to acquire a mutual exclusion lock on this service without waiting.
+ *
+ * \public \memberof mlt_service_s
+ * \param self the service to lock
+ * \return 0 if the lock was acquired, non-zero if it is held elsewhere or \p self is NULL
+ */
+
+int mlt_service_trylock(mlt_service self)
+{
+    if (self != NULL)
+        return pthread_mutex_trylock(&((mlt_service_base *) self->local)->mutex);
+    return 1;
+}
+
 /** Release a mutual exclusion lock on this service.
  *
  * \public \memberof mlt_service_s
@@ -80,6 +80,7 @@ struct mlt_service_s
 
 MLT_API extern int mlt_service_init(mlt_service self, void *child);
 MLT_API extern void mlt_service_lock(mlt_service self);
+MLT_API extern int mlt_service_trylock(mlt_service self);
 MLT_API extern void mlt_service_unlock(mlt_service self);
 MLT_API extern mlt_service_type mlt_service_identify(mlt_service self);
 MLT_API extern int mlt_service_connect_producer(mlt_service self, mlt_service producer, int index);
@@ -27,6 +27,7 @@
 
 #include <pthread.h>
 #include <sched.h>
+#include <stdatomic.h>
 #include <stdlib.h>
 #ifndef _MSC_VER
 #include <unistd.h>
@@ -47,11 +48,23 @@ typedef enum {
 static pthread_mutex_t g_lock = PTHREAD_MUTEX_INITIALIZER;
 static mlt_slices globals[mlt_policy_nb] = {NULL, NULL, NULL};
 
+/** \brief A set of jobs submitted to a sliced threading context
+ *
+ * Jobs are claimed by atomically incrementing \p curr, so workers and the
+ * submitting thread never take the context mutex per job. The mutex only
+ * protects the queue and the count of attached workers.
+ */
+
 struct mlt_slices_runtime_s
 {
-    int jobs, done, curr;
+    int jobs;
+    atomic_int done;
+    atomic_int curr;
+    int workers; ///< the number of worker threads currently running jobs from this runtime
+    int queued;  ///< whether this runtime is in the context queue
     mlt_slices_proc proc;
     void *cookie;
+    mlt_slices ctx;
     struct mlt_slices_runtime_s *next;
 };
 
@@ -69,9 +82,78 @@ struct mlt_slices_s
     const char *name;
 };
 
+/** Remove a runtime from the queue of a context.
+ *
+ * The caller must hold the context mutex.
+ * \private \memberof mlt_slices_s
+ * \param ctx context pointer
+ * \param r the runtime to remove
+ */
+
+static void runtime_unlink(mlt_slices ctx, struct mlt_slices_runtime_s *r)
+{
+    struct mlt_slices_runtime_s *prev = NULL, *cur;
+
+    if (!r->queued)
+        return;
+    for (cur = ctx->head; cur && cur != r; cur = cur->next)
+        prev = cur;
+    if (cur) {
+        if (prev)
+            prev->next = r->next;
+        else
+            ctx->head = r->next;
+        if (ctx->tail == r)
+            ctx->tail = prev;
+    }
+    r->next = NULL;
+    r->queued = 0;
+}
+
+/** Get the first queued runtime that still has unclaimed jobs.
+ *
+ * Fully claimed runtimes are removed from the queue on the way.
+ * The caller must hold the context mutex.
+ * \private \memberof mlt_slices_s
+ * \param ctx context pointer
+ * \return a runtime or NULL if there is nothing to do
+ */
+
+static struct mlt_slices_runtime_s *runtime_next(mlt_slices ctx)
+{
+    while (ctx->head && atomic_load(&ctx->head->curr) >= ctx->head->jobs)
+        runtime_unlink(ctx, ctx->head);
+    return ctx->head;
+}
+
+/** Claim and run jobs of a runtime until all of them are claimed.
+ *
+ * \private \memberof mlt_slices_s
+ * \param r a runtime
+ * \param id the identifier of the calling thread
+ */
+
+static void runtime_execute(struct mlt_slices_runtime_s *r, int id)
+{
+    int idx;
+
+    while ((idx = atomic_fetch_add(&r->curr, 1)) < r->jobs) {
+        mlt_log_debug(NULL,
+                      "%s:%d: running job: id=%d, idx=%d/%d, pool=[%s]\n",
+                      __FUNCTION__,
+                      __LINE__,
+                      id,
+                      idx,
+                      r->jobs,
+                      r->ctx->name);
+        r->proc(id, idx, r->jobs, r->cookie);
+        atomic_fetch_add(&r->done, 1);
+    }
+}
+
 static void *mlt_slices_worker(void *p)
 {
-    int id, idx;
+    int id;
     struct mlt_slices_runtime_s *r;
     mlt_slices ctx = (mlt_slices) p;
 
@@ -86,48 +168,25 @@ static void *mlt_slices_worker(void *p)
         mlt_log_debug(NULL, "%s:%d: ctx=[%p][%s] waiting\n", __FUNCTION__, __LINE__, ctx, ctx->name);
 
         /* wait for new jobs */
-        while (!ctx->f_exit && !(r = ctx->head))
+        while (!ctx->f_exit && !(r = runtime_next(ctx)))
             pthread_cond_wait(&ctx->cond_var_job, &ctx->cond_mutex);
 
         if (ctx->f_exit)
             break;
 
-        if (!r)
-            continue;
-
-        /* check if no new job */
-        if (r->curr == r->jobs) {
-            ctx->head = ctx->head->next;
-            if (!ctx->head)
-                ctx->tail = NULL;
-            mlt_log_debug(NULL, "%s:%d: new ctx->head=%p\n", __FUNCTION__, __LINE__, ctx->head);
-            continue;
-        };
+        /* attach to the runtime so it outlives our use of it */
+        r->workers++;
+        pthread_mutex_unlock(&ctx->cond_mutex);
 
-        /* new job id */
-        idx = r->curr;
-        r->curr++;
+        runtime_execute(r, id);
 
-        /* run job */
-        pthread_mutex_unlock(&ctx->cond_mutex);
-        mlt_log_debug(NULL,
-                      "%s:%d: running job: id=%d, idx=%d/%d, pool=[%s]\n",
-                      __FUNCTION__,
-                      __LINE__,
-                      id,
-                      idx,
-                      r->jobs,
-                      ctx->name);
-        r->proc(id, idx, r->jobs, r->cookie);
         pthread_mutex_lock(&ctx->cond_mutex);
+        r->workers--;
 
-        /* increase done jobs counter */
-        r->done++;
-
-        /* notify we fininished last job */
-        if (r->done == r->jobs) {
+        /* notify the submitter once all jobs are finished and released */
+        if (!r->workers && atomic_load(&r->done) == r->jobs) {
             mlt_log_debug(NULL,
-                          "%s:%d: pthread_cond_signal( &ctx->cond_var_ready )\n",
+                          "%s:%d: pthread_cond_broadcast( &ctx->cond_var_ready )\n",
                           __FUNCTION__,
                           __LINE__);
             pthread_cond_broadcast(&ctx->cond_var_ready);
@@ -266,23 +325,22 @@ static void mlt_slices_close(mlt_slices ctx)
     free(ctx);
 }
 
-/** Run sliced execution
+/** Queue jobs on a sliced threading context without waiting for them.
  *
  * \private \memberof mlt_slices_s
  * \param ctx context pointer
+ * \param r an uninitialized runtime that must stay valid until runtime_wait()
  * \param jobs number of jobs to process
  * \param proc a pointer to the function that will be called
  * \param cookie an opaque data pointer passed to \p proc
  */
 
-static void mlt_slices_run(mlt_slices ctx, int jobs, mlt_slices_proc proc, void *cookie)
+static void runtime_submit(mlt_slices ctx,
+                           struct mlt_slices_runtime_s *r,
+                           int jobs,
+                           mlt_slices_proc proc,
+                           void *cookie)
 {
-    if (jobs == 1) {
-        proc(0, 0, 1, cookie);
-        return;
-    }
-    struct mlt_slices_runtime_s runtime, *r = &runtime;
-
     /* lock */
     pthread_mutex_lock(&ctx->cond_mutex);
 
@@ -294,10 +352,13 @@ static void mlt_slices_run(mlt_slices ctx, int jobs, mlt_slices_proc proc, void
 
     /* setup runtime args */
     r->jobs = jobs;
-    r->done = 0;
-    r->curr = 0;
+    atomic_init(&r->done, 0);
+    atomic_init(&r->curr, 0);
+    r->workers = 0;
+    r->queued = 1;
     r->proc = proc;
     r->cookie = cookie;
+    r->ctx = ctx;
     r->next = NULL;
 
     /* attach job */
@@ -311,8 +372,29 @@ static void mlt_slices_run(mlt_slices ctx, int jobs, mlt_slices_proc proc, void
     /* notify workers */
     pthread_cond_broadcast(&ctx->cond_var_job);
 
+    pthread_mutex_unlock(&ctx->cond_mutex);
+}
+
+/** Help to run the remaining jobs of a runtime and wait for all of them to finish.
+ *
+ * The calling thread runs jobs itself with an id equal to the number of
+ * slices, so a sliced job started from within another sliced job or from a
+ * thread that would otherwise sit idle always makes progress.
+ * \private \memberof mlt_slices_s
+ * \param r a runtime queued with runtime_submit()
+ */
+
+static void runtime_wait(struct mlt_slices_runtime_s *r)
+{
+    mlt_slices ctx = r->ctx;
+
+    runtime_execute(r, ctx->count);
+
+    pthread_mutex_lock(&ctx->cond_mutex);
+    runtime_unlink(ctx, r);
+
     /* wait for end of task */
-    while (!ctx->f_exit && (r->done < r->jobs)) {
+    while (!ctx->f_exit && (atomic_load(&r->done) < r->jobs || r->workers)) {
         pthread_cond_wait(&ctx->cond_var_ready, &ctx->cond_mutex);
         mlt_log_debug(NULL,
                       "%s:%d: ctx=[%p][%s] signalled\n",
@@ -325,6 +407,48 @@ static void mlt_slices_run(mlt_slices ctx, int jobs, mlt_slices_proc proc, void
     pthread_mutex_unlock(&ctx->cond_mutex);
 }
 
+/** Run sliced execution
+ *
+ * \private \memberof mlt_slices_s
+ * \param ctx context pointer
+ * \param jobs number of jobs to process
+ * \param proc a pointer to the function that will be called
+ * \param cookie an opaque data pointer passed to \p proc
+ */
+
+static void mlt_slices_run(mlt_slices ctx, int jobs, mlt_slices_proc proc, void *cookie)
+{
+    if (jobs == 1) {
+        proc(0, 0, 1, cookie);
+        return;
+    }
+    struct mlt_slices_runtime_s runtime;
+
+    runtime_submit(ctx, &runtime, jobs, proc, cookie);
+    runtime_wait(&runtime);
+}
+
+/** Queue sliced execution without blocking.
+ *
+ * \private \memberof mlt_slices_s
+ * \param ctx context pointer
+ * \param jobs number of jobs to process
+ * \param proc a pointer to the function that will be called
+ * \param cookie an opaque data pointer passed to \p proc
+ * \return a task to pass to mlt_slices_wait()
+ */
+
+static mlt_slices_task mlt_slices_submit(mlt_slices ctx,
+                                         int jobs,
+                                         mlt_slices_proc proc,
+                                         void *cookie)
+{
+    mlt_slices_task task = calloc(1, sizeof(struct mlt_slices_runtime_s));
+    if (task)
+        runtime_submit(ctx, task, jobs, proc, cookie);
+    return task;
+}
+
 /** Get a global shared sliced threading context.
  *
  * There are separate contexts for each scheduling policy.
@@ -417,6 +541,62 @@ void mlt_slices_run_fifo(int jobs, mlt_slices_proc proc, void *cookie)
     return mlt_slices_run(mlt_slices_get_global(mlt_policy_fifo), jobs, proc, cookie);
 }
 
+/** Start sliced execution on the normal scheduling policy pool without waiting.
+ *
+ * The jobs start running on the worker threads immediately. The caller can
+ * do other work and must call mlt_slices_wait() to finish the task.
+ *
+ * \public \memberof mlt_slices_s
+ * \param jobs number of jobs to process, 0 for the number of slices
+ * \param proc a pointer to the function that will be called
+ * \param cookie an opaque data pointer passed to \p proc
+ * \return a task handle or NULL on error
+ */
+
+mlt_slices_task mlt_slices_submit_normal(int jobs, mlt_slices_proc proc, void *cookie)
+{
+    return mlt_slices_submit(mlt_slices_get_global(mlt_policy_normal), jobs, proc, cookie);
+}
+
+/** Start sliced execution on the round robin scheduling policy pool without waiting.
+ *
+ * \public \memberof mlt_slices_s
+ * \see mlt_slices_submit_normal
+ */
+
+mlt_slices_task mlt_slices_submit_rr(int jobs, mlt_slices_proc proc, void *cookie)
+{
+    return mlt_slices_submit(mlt_slices_get_global(mlt_policy_rr), jobs, proc, cookie);
+}
+
+/** Start sliced execution on the fifo scheduling policy pool without waiting.
+ *
+ * \public \memberof mlt_slices_s
+ * \see mlt_slices_submit_normal
+ */
+
+mlt_slices_task mlt_slices_submit_fifo(int jobs, mlt_slices_proc proc, void *cookie)
+{
+    return mlt_slices_submit(mlt_slices_get_global(mlt_policy_fifo), jobs, proc, cookie);
+}
+
+/** Finish a task started with one of the mlt_slices_submit functions.
+ *
+ * The calling thread runs any jobs not yet claimed by a worker, waits for the
+ * rest to finish, and then releases the task.
+ *
+ * \public \memberof mlt_slices_s
+ * \param task a task handle, which is invalid after this returns
+ */
+
+void mlt_slices_wait(mlt_slices_task task)
+{
+    if (task) {
+        runtime_wait(task);
+        free(task);
+    }
+}
+
 /** Compute size of a slice.
  *
  * This a helper function for use in a mlt_slices_proc() to get the number of
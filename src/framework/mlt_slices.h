@@ -32,8 +32,17 @@
 
 struct mlt_slices_s;
 
+/** A sliced job function.
+ *
+ * \p id identifies the thread running the job: a worker thread uses 0 up to
+ * one less than the number of slices, and the thread that called
+ * mlt_slices_run_normal() or mlt_slices_wait(), which helps to run the jobs,
+ * uses the number of slices. \p idx is the index of the job out of \p jobs.
+ */
 typedef int (*mlt_slices_proc)(int id, int idx, int jobs, void *cookie);
 
+typedef struct mlt_slices_runtime_s *mlt_slices_task; /**< handle of jobs started without waiting */
+
 MLT_API extern int mlt_slices_count_normal();
 
 MLT_API extern int mlt_slices_count_rr();
@@ -46,6 +55,16 @@ MLT_API extern void mlt_slices_run_rr(int jobs, mlt_slices_proc proc, void *cook
 
 MLT_API extern void mlt_slices_run_fifo(int jobs, mlt_slices_proc proc, void *cookie);
 
+MLT_API extern mlt_slices_task mlt_slices_submit_normal(int jobs,
+                                                        mlt_slices_proc proc,
+                                                        void *cookie);
+
+MLT_API extern mlt_slices_task mlt_slices_submit_rr(int jobs, mlt_slices_proc proc, void *cookie);
+
+MLT_API extern mlt_slices_task mlt_slices_submit_fifo(int jobs, mlt_slices_proc proc, void *cookie);
+
+MLT_API extern void mlt_slices_wait(mlt_slices_task task);
+
 MLT_API extern int mlt_slices_size_slice(int jobs, int index, int input_size, int *start);
 
 #endif
@@ -37,6 +37,7 @@
 
 static int producer_get_frame(mlt_producer parent, mlt_frame_ptr frame, int track);
 static void mlt_tractor_listener(mlt_multitrack tracks, mlt_tractor self);
+static void on_tractor_prefetch(mlt_properties owner, mlt_tractor self, mlt_event_data);
 
 /** Construct a tractor without a field or multitrack.
  *
@@ -55,12 +56,18 @@ mlt_tractor mlt_tractor_init()
         if (mlt_producer_init(producer, self) == 0) {
             mlt_properties properties = MLT_PRODUCER_PROPERTIES(producer);
 
+            mlt_properties_begin_update(properties);
             mlt_properties_set(properties, "resource", "<tractor>");
             mlt_properties_set(properties, "mlt_type", "mlt_producer");
             mlt_properties_set(properties, "mlt_service", "tractor");
             mlt_properties_set_int(properties, "in", 0);
             mlt_properties_set_int(properties, "out", -1);
             mlt_properties_set_int(properties, "length", 0);
+            mlt_properties_commit_update(properties);
+            mlt_events_listen(properties,
+                              self,
+                              "producer-prefetch",
+                              (mlt_listener) on_tractor_prefetch);
 
             producer->get_frame = producer_get_frame;
             producer->close = (mlt_destructor) mlt_tractor_close;
@@ -92,6 +99,7 @@ mlt_tractor mlt_tractor_new()
             mlt_field field = mlt_field_new(multitrack, self);
             mlt_properties props = MLT_PRODUCER_PROPERTIES(producer);
 
+            mlt_properties_begin_update(props);
             mlt_properties_set(props, "resource", "<tractor>");
             mlt_properties_set(props, "mlt_type", "mlt_producer");
             mlt_properties_set(props, "mlt_service", "tractor");
@@ -105,11 +113,13 @@ mlt_tractor mlt_tractor_new()
                                     (mlt_destructor) mlt_multitrack_close,
                                     NULL);
             mlt_properties_set_data(props, "field", field, 0, (mlt_destructor) mlt_field_close, NULL);
+            mlt_properties_commit_update(props);
 
             mlt_events_listen(MLT_MULTITRACK_PROPERTIES(multitrack),
                               self,
                               "producer-changed",
                               (mlt_listener) mlt_tractor_listener);
+            mlt_events_listen(props, self, "producer-prefetch", (mlt_listener) on_tractor_prefetch);
 
             producer->get_frame = producer_get_frame;
             producer->close = (mlt_destructor) mlt_tractor_close;
@@ -185,6 +195,21 @@ mlt_multitrack mlt_tractor_multitrack(mlt_tractor self)
     return mlt_properties_get_data(MLT_TRACTOR_PROPERTIES(self), "multitrack", NULL);
 }
 
+/** Listener for the producer-prefetch event of the tractor.
+ *
+ * \private \memberof mlt_tractor_s
+ * \param owner the tractor's properties
+ * \param self a tractor
+ * \param event_data a pointer to mlt_event_data_prefetch
+ */
+
+static void on_tractor_prefetch(mlt_properties owner, mlt_tractor self, mlt_event_data event_data)
+{
+    mlt_event_data_prefetch *prefetch = mlt_event_data_to_object(event_data);
+    if (prefetch)
+        mlt_multitrack_prefetch(mlt_tractor_multitrack(self), prefetch->position, prefetch->count);
+}
+
 /** Ensure the tractors in/out points match the multitrack.
  *
  * \public \memberof mlt_tractor_s
@@ -515,6 +540,14 @@ static int producer_get_frame(mlt_producer parent, mlt_frame_ptr frame, int trac
             // Get the properties of the frame
             frame_properties = MLT_FRAME_PROPERTIES(*frame);
 
+            // Whether transitions may prefetch the tracks they overlay
+            int parallel_tracks = mlt_properties_get_int(properties, "parallel_tracks");
+
+            // Announce the positions that will follow during normal playback
+            int prefetch = mlt_properties_get_int(properties, "prefetch");
+            if (prefetch > 0 && mlt_producer_get_speed(parent) == 1.0)
+                mlt_multitrack_prefetch(multitrack, mlt_producer_frame(parent) + 1, prefetch);
+
             // Loop through each of the tracks we're harvesting
             for (i = 0; !done; i++) {
                 // Get a frame from the producer
@@ -546,6 +579,9 @@ static int producer_get_frame(mlt_producer parent, mlt_frame_ptr frame, int trac
                 // Check for last track
                 done = mlt_properties_get_int(temp_properties, "last_track");
 
+                if (parallel_tracks)
+                    mlt_properties_set_int(temp_properties, "parallel_tracks", 1);
+
                 // Handle fx only tracks
                 if (mlt_properties_get_int(temp_properties, "fx_cut")) {
                     int hide = (video == NULL ? 1 : 0) | (audio == NULL ? 2 : 0);
@@ -34,6 +34,11 @@
  * \properties \em multitrack holds a reference to the mulitrack object that a tractor manages
  * \properties \em field holds a reference to the field object that a tractor manages
  * \properties \em producer holds a reference to an encapsulated producer
+ * \properties \em parallel_tracks set to let transitions render the track they
+ * overlay on other threads while the tracks below it are rendered
+ * \properties \em prefetch the number of positions after the current one to announce to the
+ * producers of the tracks during normal playback, default 0 (none)
+ * \see mlt_producer_prefetch
  */
 
 struct mlt_tractor_s
@@ -0,0 +1,297 @@
+/*
+ * chunks.c -- melt rendering in parallel chunks
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include "chunks.h"
+
+/* System header files */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef HAVE_LIBAVFORMAT
+#include <libavformat/avformat.h>
+#endif
+
+/** Get the first frame of a chunk when splitting [in, out] into count chunks.
+ *
+ * The chunks are encoded independently, so they are simply as even as possible. When there are
+ * more chunks than frames some chunks are empty, in which case the first frame of a chunk equals
+ * that of the next one.
+ */
+
+int chunk_start(int in, int out, int count, int index)
+{
+    int length = out - in + 1;
+
+    if (index <= 0 || length <= 0)
+        return in;
+    if (index >= count)
+        return out + 1;
+    return in + (int) ((int64_t) length * index / count);
+}
+
+/** Get the file name of a chunk: "name.ext" becomes "name.chunk000.ext".
+ *
+ * The extension is kept so that the muxer is chosen the same way as for the joined file.
+ */
+
+char *chunk_target(const char *target, int index)
+{
+    const char *name = strrchr(target, '/') ? strrchr(target, '/') + 1 : target;
+    const char *dot = strrchr(name, '.');
+    int prefix = (dot && dot != name) ? dot - target : strlen(target);
+    char *result = malloc(strlen(target) + 20);
+
+    if (result)
+        sprintf(result, "%.*s.chunk%03d%s", prefix, target, index, target + prefix);
+    return result;
+}
+
+#ifdef HAVE_LIBAVFORMAT
+
+/** A file being copied into the joined file. */
+typedef struct
+{
+    AVFormatContext *context;
+    int *map;           // the output stream of each input stream, or -1 to skip it
+    unsigned nb_map;    // the number of input streams in map
+    int64_t shift;      // the time of the first frame in the joined file in microseconds
+    AVPacket *pkt;      // the next packet to write
+    int is_pkt;         // whether pkt holds a packet
+} join_input;
+
+static void join_close(join_input *input)
+{
+    avformat_close_input(&input->context);
+    av_freep(&input->map);
+    input->nb_map = 0;
+    input->is_pkt = 0;
+}
+
+/** Open a chunk and map its streams to the output streams.
+ *
+ * The streams of the type (audio or not) are mapped in order to the output streams starting at
+ * \p first, which are created when \p create is set.
+ */
+
+static int join_open(join_input *input,
+                     const char *filename,
+                     AVFormatContext *output,
+                     int audio,
+                     int first,
+                     int create)
+{
+    int index = first;
+
+    if (avformat_open_input(&input->context, filename, NULL, NULL) < 0
+        || avformat_find_stream_info(input->context, NULL) < 0) {
+        fprintf(stderr, "Error: failed to read %s\n", filename);
+        return 1;
+    }
+    input->map = av_malloc_array(input->context->nb_streams, sizeof(*input->map));
+    if (!input->map)
+        return 1;
+    input->nb_map = input->context->nb_streams;
+    for (unsigned i = 0; i < input->context->nb_streams; i++) {
+        AVStream *stream = input->context->streams[i];
+
+        input->map[i] = -1;
+        if ((stream->codecpar->codec_type == AVMEDIA_TYPE_AUDIO) != audio)
+            continue;
+        if (create) {
+            AVStream *out = avformat_new_stream(output, NULL);
+            if (!out || avcodec_parameters_copy(out->codecpar, stream->codecpar) < 0)
+                return 1;
+            out->codecpar->codec_tag = 0;
+            out->time_base = stream->time_base;
+        } else if (index >= (int) output->nb_streams
+                   || output->streams[index]->codecpar->codec_id != stream->codecpar->codec_id) {
+            fprintf(stderr, "Error: the streams of %s do not match the first chunk\n", filename);
+            return 1;
+        }
+        input->map[i] = index++;
+    }
+    return 0;
+}
+
+/** Read the next packet of a file that goes into the joined file.
+ *
+ * \return true if there is one
+ */
+
+static int join_read(join_input *input)
+{
+    input->is_pkt = 0;
+    while (input->context && av_read_frame(input->context, input->pkt) >= 0) {
+        // Streams found while reading, as in MPEG-TS, were not in the first chunk
+        if ((unsigned) input->pkt->stream_index < input->nb_map
+            && input->map[input->pkt->stream_index] >= 0) {
+            input->is_pkt = 1;
+            break;
+        }
+        av_packet_unref(input->pkt);
+    }
+    return input->is_pkt;
+}
+
+/** Get the decoding time of the next packet in the joined file in microseconds. */
+
+static int64_t join_time(join_input *input)
+{
+    AVStream *stream = input->context->streams[input->pkt->stream_index];
+    int64_t ts = input->pkt->dts != AV_NOPTS_VALUE ? input->pkt->dts : input->pkt->pts;
+
+    if (ts == AV_NOPTS_VALUE)
+        return INT64_MIN;
+    return av_rescale_q(ts, stream->time_base, AV_TIME_BASE_Q) + input->shift;
+}
+
+/** Write the next packet of a file, moving it by the time of its first frame, and read another. */
+
+static int join_write(join_input *input, AVFormatContext *output)
+{
+    AVPacket *pkt = input->pkt;
+    AVStream *in = input->context->streams[pkt->stream_index];
+    AVStream *out = output->streams[input->map[pkt->stream_index]];
+    int64_t shift = av_rescale_q(input->shift, AV_TIME_BASE_Q, out->time_base);
+
+    pkt->stream_index = out->index;
+    av_packet_rescale_ts(pkt, in->time_base, out->time_base);
+    if (pkt->pts != AV_NOPTS_VALUE)
+        pkt->pts += shift;
+    if (pkt->dts != AV_NOPTS_VALUE)
+        pkt->dts += shift;
+    pkt->pos = -1;
+    if (av_interleaved_write_frame(output, pkt) < 0)
+        return 1;
+    join_read(input);
+    return 0;
+}
+
+/** Join the rendered chunks into the target without re-encoding.
+ *
+ * The video chunks are copied one after the other, each moved to the time of its first frame.
+ * The audio was rendered in one piece, so encoders with fixed frame sizes such as AAC add no
+ * priming or padding at the chunk boundaries, and it is interleaved with the video as it is.
+ *
+ * \param starts the first frame of each chunk relative to the first frame of the render, or -1
+ * if the chunk is empty
+ * \param has_audio whether there is an audio file, which is named after chunk \p count
+ * \return non-zero on error
+ */
+
+int join_chunks(const char *target,
+                const char *format,
+                const int *starts,
+                int count,
+                int has_audio,
+                int frame_rate_num,
+                int frame_rate_den)
+{
+    AVFormatContext *output = NULL;
+    join_input video = {0};
+    join_input audio = {0};
+    int video_streams = 0;
+    int next = 0;
+    int error = 0;
+    int is_header = 0;
+    char *filename = NULL;
+
+    video.pkt = av_packet_alloc();
+    audio.pkt = av_packet_alloc();
+    error = !video.pkt || !audio.pkt
+            || avformat_alloc_output_context2(&output, NULL, format, target) < 0;
+
+    // Create the output streams from the first chunk and the audio
+    while (!error && next < count && starts[next] < 0)
+        next++;
+    if (!error && next < count) {
+        filename = chunk_target(target, next);
+        error = !filename || join_open(&video, filename, output, 0, 0, 1);
+        video.shift = av_rescale(starts[next],
+                                 (int64_t) frame_rate_den * AV_TIME_BASE,
+                                 frame_rate_num);
+        video_streams = output->nb_streams;
+        next++;
+        free(filename);
+    }
+    if (!error && has_audio) {
+        filename = chunk_target(target, count);
+        error = !filename || join_open(&audio, filename, output, 1, video_streams, 1);
+        free(filename);
+    }
+    if (!error && !(output->oformat->flags & AVFMT_NOFILE))
+        error = avio_open(&output->pb, target, AVIO_FLAG_WRITE) < 0;
+    if (!error)
+        error = avformat_write_header(output, NULL) < 0;
+    is_header = !error;
+
+    // Write the packets in the order of their decoding times
+    join_read(&video);
+    join_read(&audio);
+    while (!error && (video.is_pkt || audio.is_pkt || next < count)) {
+        if (!video.is_pkt && next < count) {
+            // Move on to the next chunk
+            join_close(&video);
+            if (starts[next] >= 0) {
+                filename = chunk_target(target, next);
+                error = !filename || join_open(&video, filename, output, 0, 0, 0);
+                video.shift = av_rescale(starts[next],
+                                         (int64_t) frame_rate_den * AV_TIME_BASE,
+                                         frame_rate_num);
+                free(filename);
+                if (!error)
+                    join_read(&video);
+            }
+            next++;
+        } else if (video.is_pkt && (!audio.is_pkt || join_time(&video) <= join_time(&audio))) {
+            error = join_write(&video, output);
+        } else if (audio.is_pkt) {
+            error = join_write(&audio, output);
+        }
+    }
+    if (is_header && av_write_trailer(output) < 0)
+        error = 1;
+
+    join_close(&video);
+    join_close(&audio);
+    av_packet_free(&video.pkt);
+    av_packet_free(&audio.pkt);
+    if (output && !(output->oformat->flags & AVFMT_NOFILE))
+        avio_closep(&output->pb);
+    avformat_free_context(output);
+    return error;
+}
+
+#else
+
+int join_chunks(const char *target,
+                const char *format,
+                const int *starts,
+                int count,
+                int has_audio,
+                int frame_rate_num,
+                int frame_rate_den)
+{
+    fprintf(stderr, "Error: joining chunks requires melt to be built with libavformat\n");
+    return 1;
+}
+
+#endif
@@ -0,0 +1,41 @@
+/*
+ * chunks.h -- melt rendering in parallel chunks
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#ifndef _MELT_CHUNKS_H_
+#define _MELT_CHUNKS_H_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern int chunk_start(int in, int out, int count, int index);
+extern char *chunk_target(const char *target, int index);
+extern int join_chunks(const char *target,
+                       const char *format,
+                       const int *starts,
+                       int count,
+                       int has_audio,
+                       int frame_rate_num,
+                       int frame_rate_den);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -69,6 +69,12 @@
 #ifndef _MSC_VER
 #include <unistd.h>
 #endif
+#ifndef _WIN32
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+#endif
 
 #ifdef _MSC_VER
 #include <io.h>  // _isatty 在这里
@@ -84,6 +90,7 @@
 #include <SDL.h>
 #endif
 
+#include "chunks.h"
 #include "io.h"
 
 static mlt_producer melt = NULL;
@@ -533,6 +540,159 @@ static void transport(mlt_producer producer, mlt_consumer consumer)
     }
 }
 
+/** Restrict a worker process to its part of the render.
+ *
+ * The worker rebuilds the same network from the same command line, so it only needs its index to
+ * work out its range and output file. Workers below \p count render the video of one chunk each,
+ * and the worker at \p count renders all of the audio in one piece.
+ */
+
+static void setup_chunk(mlt_producer producer, mlt_consumer consumer, int count, int index)
+{
+    mlt_properties properties = MLT_CONSUMER_PROPERTIES(consumer);
+    char *target = mlt_properties_get(properties, "target");
+
+    if (target) {
+        target = chunk_target(target, index);
+        mlt_properties_set(properties, "target", target);
+        free(target);
+    }
+    if (index < count) {
+        int in = mlt_producer_get_in(producer);
+        int out = mlt_producer_get_out(producer);
+
+        mlt_properties_set_int(properties, "an", 1);
+        mlt_properties_set_int(properties, "audio_off", 1);
+        mlt_producer_set_in_and_out(producer,
+                                    chunk_start(in, out, count, index),
+                                    chunk_start(in, out, count, index + 1) - 1);
+        mlt_producer_seek(producer, 0);
+    } else {
+        mlt_properties_set_int(properties, "vn", 1);
+        mlt_properties_set_int(properties, "video_off", 1);
+    }
+}
+
+#if !defined(_WIN32) && defined(HAVE_LIBAVFORMAT)
+
+static pid_t spawn_process(char **args)
+{
+    pid_t pid = -1;
+    if (posix_spawnp(&pid, args[0], NULL, NULL, args, environ)) {
+        fprintf(stderr, "Error: failed to run %s\n", args[0]);
+        pid = -1;
+    }
+    return pid;
+}
+
+static int wait_process(pid_t pid)
+{
+    int status = 0;
+    if (pid <= 0 || waitpid(pid, &status, 0) != pid)
+        return EXIT_FAILURE;
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
+
+/** Render the producer in parallel worker processes, one per chunk, and join the results.
+ *
+ * Each worker is this program run again with the same arguments plus the index of its part.
+ * The chunks are encoded independently, so only the video is split; the audio is rendered in one
+ * piece by another worker so that its encoder adds no priming or padding at the chunk boundaries.
+ */
+
+static int render_chunks(
+    mlt_producer producer, mlt_consumer consumer, int count, int argc, char **argv)
+{
+    mlt_properties properties = MLT_CONSUMER_PROPERTIES(consumer);
+    const char *service = mlt_properties_get(properties, "mlt_service");
+    const char *target = mlt_properties_get(properties, "target");
+    const char *vcodec = mlt_properties_get(properties, "vcodec");
+
+    if (!service || strcmp(service, "avformat") || !target || !strcmp(target, "-")) {
+        fprintf(stderr, "Error: -chunks requires the avformat consumer with a target file\n");
+        return EXIT_FAILURE;
+    }
+    if (mlt_properties_get_int(properties, "vn") || (vcodec && !strcmp(vcodec, "none"))) {
+        fprintf(stderr, "Error: -chunks requires video\n");
+        return EXIT_FAILURE;
+    }
+#if defined(_WIN32) || !defined(HAVE_LIBAVFORMAT)
+    fprintf(stderr, "Error: -chunks is not supported on this platform\n");
+    return EXIT_FAILURE;
+#else
+    mlt_profile profile = mlt_service_profile(MLT_CONSUMER_SERVICE(consumer));
+    const char *acodec = mlt_properties_get(properties, "acodec");
+    int error = EXIT_SUCCESS;
+    int in = mlt_producer_get_in(producer);
+    int out = mlt_producer_get_out(producer);
+    int has_audio = !mlt_properties_get_int(properties, "an")
+                    && !(acodec && !strcmp(acodec, "none"));
+    int *starts = calloc(count, sizeof(*starts));
+    pid_t *pids = calloc(count + 1, sizeof(*pids));
+    char **args = calloc(argc + 4, sizeof(*args));
+    char index[16];
+    int i;
+
+    // Workers get: program -silent -chunk index <original arguments>
+    args[0] = argv[0];
+    args[1] = "-silent";
+    args[2] = "-chunk";
+    args[3] = index;
+    memcpy(&args[4], &argv[1], (argc - 1) * sizeof(*args));
+
+    for (i = 0; i <= count && !error; i++) {
+        if (i < count) {
+            int start = chunk_start(in, out, count, i);
+            starts[i] = start < chunk_start(in, out, count, i + 1) ? start - in : -1;
+            if (starts[i] < 0)
+                continue;
+        } else if (!has_audio) {
+            break;
+        }
+        snprintf(index, sizeof(index), "%d", i);
+        pids[i] = spawn_process(args);
+        if (pids[i] <= 0)
+            error = EXIT_FAILURE;
+    }
+
+    // Wait for every worker that started, even after a failure.
+    for (i = 0; i <= count; i++) {
+        if (pids[i] > 0 && wait_process(pids[i])) {
+            fprintf(stderr, "Error: chunk %d failed\n", i);
+            error = EXIT_FAILURE;
+        }
+    }
+
+    if (!error) {
+        error = join_chunks(target,
+                            mlt_properties_get(properties, "f"),
+                            starts,
+                            count,
+                            has_audio,
+                            profile->frame_rate_num,
+                            profile->frame_rate_den);
+        if (error)
+            fprintf(stderr, "Error: failed to join the chunks of %s\n", target);
+    }
+    if (!error) {
+        for (i = 0; i <= count; i++) {
+            if (pids[i] > 0) {
+                char *chunk = chunk_target(target, i);
+                remove(chunk);
+                free(chunk);
+            }
+        }
+    }
+
+    free(args);
+    free(pids);
+    free(starts);
+    return error ? EXIT_FAILURE : EXIT_SUCCESS;
+#endif
+}
+
 static void show_usage(char *program_name)
 {
     fprintf(
@@ -546,6 +706,7 @@ static void show_usage(char *program_name)
         "  -audio-track | -hide-video               Add an audio-only track\n"
         "  -blank frames                            Add blank silence to a track\n"
         "  -chain id[:arg] [name=value]*            Add a producer as a chain\n"
+        "  -chunks count                            Render a file in chunks in parallel\n"
         "  -consumer id[:arg] [name=value]*         Set the consumer (sink)\n"
         "  -debug                                   Set the logging level to debug\n"
         "  -filter filter[:arg] [name=value]*       Add a filter to the current track\n"
@@ -807,6 +968,8 @@ int main(int argc, char **argv)
     const char *repo_path = NULL;
     int is_consumer_explicit = 0;
     int is_setlocale = 0;
+    int chunk_count = 0;
+    int chunk_index = -1;
 
     // Handle abnormal exit situations.
     signal(SIGSEGV, abnormal_exit_handler);
@@ -974,6 +1137,10 @@ int main(int argc, char **argv)
                 repo_path = argv[++i];
         } else if (!strcmp(argv[i], "-consumer")) {
             is_consumer_explicit = 1;
+        } else if (!strcmp(argv[i], "-chunks") && argv[i + 1]) {
+            chunk_count = atoi(argv[++i]);
+        } else if (!strcmp(argv[i], "-chunk") && argv[i + 1]) {
+            chunk_index = atoi(argv[++i]);
         }
     }
     if (!is_silent && !isatty(STDIN_FILENO) && !is_progress)
@@ -1122,28 +1289,36 @@ int main(int argc, char **argv)
                 mlt_producer_set_in_and_out(melt, in, out);
                 mlt_producer_seek(melt, 0);
             }
-            // Connect consumer to melt
-            mlt_consumer_connect(consumer, MLT_PRODUCER_SERVICE(melt));
-
-            // Start the consumer
-            mlt_events_listen(properties,
-                              consumer,
-                              "consumer-fatal-error",
-                              (mlt_listener) on_fatal_error);
-            if (mlt_consumer_start(consumer) == 0) {
-                // Try to exit gracefully upon these signals
-                signal(SIGINT, stop_handler);
-                signal(SIGTERM, stop_handler);
+            if (chunk_count > 1 && chunk_index >= 0)
+                setup_chunk(melt, consumer, chunk_count, chunk_index);
+
+            if (chunk_count > 1 && chunk_index < 0) {
+                // Leave the rendering to the worker processes
+                error = render_chunks(melt, consumer, chunk_count, argc, argv);
+            } else {
+                // Connect consumer to melt
+                mlt_consumer_connect(consumer, MLT_PRODUCER_SERVICE(melt));
+
+                // Start the consumer
+                mlt_events_listen(properties,
+                                  consumer,
+                                  "consumer-fatal-error",
+                                  (mlt_listener) on_fatal_error);
+                if (mlt_consumer_start(consumer) == 0) {
+                    // Try to exit gracefully upon these signals
+                    signal(SIGINT, stop_handler);
+                    signal(SIGTERM, stop_handler);
 #ifndef _WIN32
-                signal(SIGHUP, stop_handler);
-                signal(SIGPIPE, stop_handler);
+                    signal(SIGHUP, stop_handler);
+                    signal(SIGPIPE, stop_handler);
 #endif
 
-                // Transport functionality
-                transport(melt, consumer);
+                    // Transport functionality
+                    transport(melt, consumer);
 
-                // Stop the consumer
-                mlt_consumer_stop(consumer);
+                    // Stop the consumer
+                    mlt_consumer_stop(consumer);
+                }
             }
         } else if (store != NULL && store != stdout && name != NULL) {
             fprintf(stderr, "Project saved as %s.\n", name);
@@ -20,9 +20,53 @@
 #include "common.h"
 
 #include <libavutil/channel_layout.h>
+#include <libavutil/opt.h>
 #include <libavutil/pixdesc.h>
 #include <libavutil/samplefmt.h>
 
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The most swscale contexts kept per owner
+#define SWS_CACHE_SIZE 64
+// The number of lookups after which an unused context is freed
+#define SWS_CACHE_IDLE 1000
+// The number of reused contexts between updates of the _sws_cache.hits property
+#define SWS_CACHE_PUBLISH 100
+
+typedef struct
+{
+    mlt_sws_key key;
+    struct SwsContext *context;
+    int transfer_error; ///< the result of mlt_set_luma_transfer()
+    int in_use;
+    int64_t last_used;
+} sws_cache_entry;
+
+/** A set of initialized swscale contexts, keyed by their parameters.
+ *
+ * Building a context computes its filter coefficients, which costs a noticeable part of a frame
+ * at high resolutions, so contexts are kept and handed out again for identical parameters. A
+ * context is checked out while it is in use, so that threads never share one; a thread that
+ * finds all matching contexts busy gets a new one.
+ */
+
+typedef struct
+{
+    pthread_mutex_t mutex;
+    sws_cache_entry entries[SWS_CACHE_SIZE];
+    int count;
+    int64_t clock;
+    int64_t hits;
+    int64_t rebuilds;
+} sws_cache;
+
+static pthread_mutex_t sws_cache_mutex = PTHREAD_MUTEX_INITIALIZER;
+static _Atomic(sws_cache *) sws_shared_cache = NULL;
+
 int mlt_get_sws_flags(
     int srcwidth, int srcheight, int srcformat, int dstwidth, int dstheight, int dstformat)
 {
@@ -448,3 +492,210 @@ void avframe_to_mlt_image(AVFrame *avframe, mlt_image image)
         }
     }
 }
+
+static void sws_cache_close(sws_cache *cache)
+{
+    mlt_log_debug(NULL,
+                  "[avformat] swscale context cache: %" PRId64 " hits, %" PRId64 " rebuilds\n",
+                  cache->hits,
+                  cache->rebuilds);
+    for (int i = 0; i < cache->count; i++)
+        sws_freeContext(cache->entries[i].context);
+    pthread_mutex_destroy(&cache->mutex);
+    free(cache);
+}
+
+static sws_cache *sws_cache_fetch(mlt_properties owner, int create)
+{
+    sws_cache *cache = owner ? mlt_properties_get_data(owner, "_sws_cache", NULL)
+                             : atomic_load(&sws_shared_cache);
+    if (!cache && create) {
+        pthread_mutex_lock(&sws_cache_mutex);
+        cache = owner ? mlt_properties_get_data(owner, "_sws_cache", NULL)
+                      : atomic_load(&sws_shared_cache);
+        if (!cache) {
+            cache = calloc(1, sizeof(*cache));
+            if (cache) {
+                pthread_mutex_init(&cache->mutex, NULL);
+                if (owner) {
+                    mlt_properties_set_data(owner,
+                                            "_sws_cache",
+                                            cache,
+                                            0,
+                                            (mlt_destructor) sws_cache_close,
+                                            NULL);
+                } else {
+                    atomic_store(&sws_shared_cache, cache);
+                    mlt_factory_register_for_clean_up(cache, (mlt_destructor) sws_cache_close);
+                }
+            }
+        }
+        pthread_mutex_unlock(&sws_cache_mutex);
+    }
+    return cache;
+}
+
+static struct SwsContext *sws_create_context(const mlt_sws_key *key, int *transfer_error)
+{
+    struct SwsContext *context = sws_alloc_context();
+    if (!context)
+        return NULL;
+
+    av_opt_set_int(context, "srcw", key->src_width, 0);
+    av_opt_set_int(context, "srch", key->src_height, 0);
+    av_opt_set_int(context, "src_format", key->src_format, 0);
+    av_opt_set_int(context, "dstw", key->dst_width, 0);
+    av_opt_set_int(context, "dsth", key->dst_height, 0);
+    av_opt_set_int(context, "dst_format", key->dst_format, 0);
+    av_opt_set_int(context, "sws_flags", key->flags, 0);
+    av_opt_set_int(context, "src_v_chr_pos", key->src_v_chr_pos, 0);
+    av_opt_set_int(context, "dst_v_chr_pos", key->dst_v_chr_pos, 0);
+#if LIBSWSCALE_VERSION_MAJOR >= 6
+    if (key->threads > 0)
+        av_opt_set_int(context, "threads", key->threads, 0);
+#endif
+
+    int error = sws_init_context(context, NULL, NULL);
+    if (error < 0) {
+        mlt_log_error(NULL,
+                      "[avformat] Initializing swscale failed with %d (%s)\n",
+                      error,
+                      av_err2str(error));
+        sws_freeContext(context);
+        return NULL;
+    }
+    *transfer_error = 0;
+    if (key->src_colorspace >= 0)
+        *transfer_error = mlt_set_luma_transfer(context,
+                                                key->src_colorspace,
+                                                key->dst_colorspace,
+                                                key->src_full_range,
+                                                key->dst_full_range);
+    return context;
+}
+
+/** Get an initialized swscale context for the given parameters.
+ *
+ * The context comes from the cache of \p owner, or a cache shared by the module if \p owner is
+ * NULL, and is built only if no idle context with the same parameters is there. The caller has it
+ * to itself until it gives it back with mlt_sws_release_context().
+ * The owner gets the properties _sws_cache.hits and _sws_cache.rebuilds, the numbers of
+ * contexts reused and built so far, which are hidden from serialization like other private
+ * properties. The hits are published every SWS_CACHE_PUBLISH reuses.
+ *
+ * \param owner the service that owns the cache, or NULL for the shared cache
+ * \param key the parameters of the context
+ * \param transfer_error if not NULL, receives the result of mlt_set_luma_transfer()
+ * \return a swscale context or NULL on error
+ */
+
+struct SwsContext *mlt_sws_get_context(mlt_properties owner,
+                                       const mlt_sws_key *key,
+                                       int *transfer_error)
+{
+    sws_cache *cache = sws_cache_fetch(owner, 1);
+    struct SwsContext *context = NULL;
+    struct SwsContext *expired[SWS_CACHE_SIZE];
+    int expired_count = 0;
+    int error = 0;
+    int64_t hits = -1;
+    int64_t rebuilds = -1;
+
+    if (!cache) {
+        if (transfer_error)
+            *transfer_error = -1;
+        return NULL;
+    }
+    pthread_mutex_lock(&cache->mutex);
+    cache->clock++;
+    for (int i = 0; i < cache->count; i++) {
+        sws_cache_entry *entry = &cache->entries[i];
+        if (!entry->in_use && !context && !memcmp(&entry->key, key, sizeof(*key))) {
+            entry->in_use = 1;
+            entry->last_used = cache->clock;
+            context = entry->context;
+            error = entry->transfer_error;
+            if (++cache->hits % SWS_CACHE_PUBLISH == 0)
+                hits = cache->hits;
+        } else if (!entry->in_use && cache->clock - entry->last_used > SWS_CACHE_IDLE) {
+            // Drop contexts for parameters that are no longer used
+            expired[expired_count++] = entry->context;
+            *entry = cache->entries[--cache->count];
+            i--;
+        }
+    }
+    pthread_mutex_unlock(&cache->mutex);
+
+    for (int i = 0; i < expired_count; i++)
+        sws_freeContext(expired[i]);
+
+    if (!context) {
+        context = sws_create_context(key, &error);
+        if (context) {
+            struct SwsContext *evicted = NULL;
+            pthread_mutex_lock(&cache->mutex);
+            rebuilds = ++cache->rebuilds;
+            hits = cache->hits;
+            int slot = cache->count < SWS_CACHE_SIZE ? cache->count++ : -1;
+            if (slot < 0) {
+                // Replace the least recently used idle context
+                for (int i = 0; i < cache->count; i++) {
+                    if (!cache->entries[i].in_use
+                        && (slot < 0
+                            || cache->entries[i].last_used < cache->entries[slot].last_used))
+                        slot = i;
+                }
+                if (slot >= 0)
+                    evicted = cache->entries[slot].context;
+            }
+            if (slot >= 0) {
+                sws_cache_entry *entry = &cache->entries[slot];
+                entry->key = *key;
+                entry->context = context;
+                entry->transfer_error = error;
+                entry->in_use = 1;
+                entry->last_used = cache->clock;
+            }
+            pthread_mutex_unlock(&cache->mutex);
+            sws_freeContext(evicted);
+        }
+    }
+    if (owner) {
+        // Publish the statistics outside the cache mutex, since listeners may run.
+        if (hits >= 0)
+            mlt_properties_set_int64(owner, "_sws_cache.hits", hits);
+        if (rebuilds >= 0)
+            mlt_properties_set_int64(owner, "_sws_cache.rebuilds", rebuilds);
+    }
+    if (transfer_error)
+        *transfer_error = context ? error : -1;
+    return context;
+}
+
+/** Give back a context from mlt_sws_get_context().
+ *
+ * \param owner the owner that was given to mlt_sws_get_context()
+ * \param context the context
+ */
+
+void mlt_sws_release_context(mlt_properties owner, struct SwsContext *context)
+{
+    sws_cache *cache = sws_cache_fetch(owner, 0);
+    int found = 0;
+
+    if (!context)
+        return;
+    if (cache) {
+        pthread_mutex_lock(&cache->mutex);
+        for (int i = 0; i < cache->count && !found; i++) {
+            if (cache->entries[i].context == context) {
+                cache->entries[i].in_use = 0;
+                found = 1;
+            }
+        }
+        pthread_mutex_unlock(&cache->mutex);
+    }
+    // The cache was full of busy contexts when this one was made.
+    if (!found)
+        sws_freeContext(context);
+}
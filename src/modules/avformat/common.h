@@ -27,6 +27,25 @@
 #define MLT_AVFILTER_SWS_FLAGS "bicubic+accurate_rnd+full_chroma_int+full_chroma_inp"
 #define HAVE_FFMPEG_CH_LAYOUT (LIBAVUTIL_VERSION_MAJOR >= 59)
 
+/** The parameters that identify a reusable swscale context */
+typedef struct
+{
+    int src_width;
+    int src_height;
+    int src_format;
+    int dst_width;
+    int dst_height;
+    int dst_format;
+    int flags;
+    int threads;       ///< 0 for the swscale default
+    int src_v_chr_pos; ///< -513 for the swscale default
+    int dst_v_chr_pos; ///< -513 for the swscale default
+    int src_colorspace; ///< -1 to keep the swscale default color details
+    int dst_colorspace;
+    int src_full_range;
+    int dst_full_range;
+} mlt_sws_key;
+
 int mlt_to_av_sample_format(mlt_audio_format format);
 int64_t mlt_to_av_channel_layout(mlt_channel_layout layout);
 #if HAVE_FFMPEG_CH_LAYOUT
@@ -42,6 +61,10 @@ int mlt_set_luma_transfer(struct SwsContext *context,
                           int dst_full_range);
 int mlt_get_sws_flags(
     int srcwidth, int srcheight, int srcformat, int dstwidth, int dstheight, int dstformat);
+struct SwsContext *mlt_sws_get_context(mlt_properties owner,
+                                       const mlt_sws_key *key,
+                                       int *transfer_error);
+void mlt_sws_release_context(mlt_properties owner, struct SwsContext *context);
 int mlt_to_av_image_format(mlt_image_format format);
 mlt_image_format mlt_get_supported_image_format(mlt_image_format format);
 void mlt_image_to_avframe(mlt_image image, mlt_frame mltframe, AVFrame *avframe);
@@ -18,6 +18,7 @@
  */
 
 #include "common.h"
+#include "encode_queue.h"
 
 // mlt Header files
 #include <framework/mlt_consumer.h>
@@ -28,6 +29,7 @@
 
 // System header files
 #include <pthread.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -66,65 +68,6 @@
 #define VIDEO_BUFFER_SIZE (8192 * 8192)
 #define IMAGE_ALIGN (4)
 
-//
-// This structure should be extended and made globally available in mlt
-//
-
-typedef struct
-{
-    uint8_t *buffer;
-    int size;
-    int used;
-    double time;
-    int frequency;
-    int channels;
-} * sample_fifo, sample_fifo_s;
-
-sample_fifo sample_fifo_init(int frequency, int channels)
-{
-    sample_fifo fifo = calloc(1, sizeof(sample_fifo_s));
-    fifo->frequency = frequency;
-    fifo->channels = channels;
-    return fifo;
-}
-
-// count is the number of samples multiplied by the number of bytes per sample
-void sample_fifo_append(sample_fifo fifo, uint8_t *samples, int count)
-{
-    if ((fifo->size - fifo->used) < count) {
-        fifo->size += count * 5;
-        fifo->buffer = realloc(fifo->buffer, fifo->size);
-    }
-
-    memcpy(&fifo->buffer[fifo->used], samples, count);
-    fifo->used += count;
-}
-
-int sample_fifo_used(sample_fifo fifo)
-{
-    return fifo->used;
-}
-
-int sample_fifo_fetch(sample_fifo fifo, uint8_t *samples, int count)
-{
-    if (count > fifo->used)
-        count = fifo->used;
-
-    memcpy(samples, fifo->buffer, count);
-    fifo->used -= count;
-    memmove(fifo->buffer, &fifo->buffer[count], fifo->used);
-
-    fifo->time += (double) count / fifo->channels / fifo->frequency;
-
-    return count;
-}
-
-void sample_fifo_close(sample_fifo fifo)
-{
-    free(fifo->buffer);
-    free(fifo);
-}
-
 #if defined(AVFILTER)
 static AVFilterGraph *vfilter_graph;
 
@@ -735,14 +678,15 @@ static int pick_sample_fmt(mlt_properties properties, const AVCodec *codec)
 static uint8_t *interleaved_to_planar(int samples,
                                       int channels,
                                       uint8_t *audio,
-                                      int bytes_per_sample)
+                                      int bytes_per_sample,
+                                      int plane_size)
 {
     uint8_t *buffer = mlt_pool_alloc(AUDIO_ENCODE_BUFFER_SIZE);
-    uint8_t *p = buffer;
     int c;
 
     memset(buffer, 0, AUDIO_ENCODE_BUFFER_SIZE);
     for (c = 0; c < channels; c++) {
+        uint8_t *p = buffer + c * plane_size;
         uint8_t *q = audio + c * bytes_per_sample;
         int i = samples + 1;
         while (--i) {
@@ -754,6 +698,14 @@ static uint8_t *interleaved_to_planar(int samples,
     return buffer;
 }
 
+// Get the size of each plane that avcodec_fill_audio_frame() with the default alignment expects.
+static int audio_plane_size(int samples, enum AVSampleFormat format)
+{
+    int linesize = 0;
+    av_samples_get_buffer_size(&linesize, 1, samples, format, 0);
+    return linesize;
+}
+
 /** Add an audio output stream
 */
 
@@ -1271,6 +1223,46 @@ static int mlt_write(void *h, uint8_t *buf, int size)
     return 0;
 }
 
+enum { STAGE_CONVERT, STAGE_VIDEO, STAGE_AUDIO, STAGE_MUX, STAGE_COUNT };
+
+static const char *stage_names[STAGE_COUNT] = {"convert", "video", "audio", "mux"};
+
+// The number of frames between updates of the pipeline statistics properties
+#define PIPELINE_STATS_INTERVAL (25)
+
+typedef struct
+{
+    atomic_int count;   ///< the number of items processed
+    atomic_llong busy;  ///< the microseconds spent processing them
+} stage_stats;
+
+typedef struct
+{
+    mlt_frame frame;
+    AVFrame *avframe;
+} video_job;
+
+// The state of the encoding pipeline, which runs the image conversion, the video encoder, the
+// audio encoder and the muxer on their own threads
+typedef struct
+{
+    stage_queue convert_queue; ///< frames waiting for image conversion
+    stage_queue video_queue;   ///< video_job waiting for the video encoder
+    stage_queue spare_queue;   ///< converted AVFrames that can be reused
+    stage_queue mux_queue;     ///< AVPackets waiting for the muxer
+    AVFrame **avframes;
+    int avframe_count;
+    pthread_t threads[STAGE_COUNT];
+    int started[STAGE_COUNT];
+    audio_handoff audio; ///< the samples for the audio encoder
+    atomic_int error;
+    int flush;
+    stage_stats stats[STAGE_COUNT];
+    mlt_image_format img_fmt;
+    uint8_t *video_outbuf;
+    int video_outbuf_size;
+} pipeline_t;
+
 typedef struct encode_ctx_desc
 {
     mlt_consumer consumer;
@@ -1297,7 +1289,10 @@ typedef struct encode_ctx_desc
     int video_codec_id;
     int audio_codec_id;
 
-    int error_count;
+    // Consecutive encoder errors, counted per stage because audio and video may encode
+    // on separate threads
+    int audio_error_count;
+    int video_error_count;
     int frame_count;
 
     double audio_pts;
@@ -1314,25 +1309,54 @@ typedef struct encode_ctx_desc
     AVStream *subtitle_st[MAX_SUBTITLE_STREAMS];
     AVCodecContext *sdec_ctx[MAX_AUDIO_STREAMS];
     AVCodecContext *senc_ctx[MAX_AUDIO_STREAMS];
+
+    pipeline_t *pipeline;
 } encode_ctx_t;
 
+// Write a packet to the output, or hand it to the muxer thread when pipelined.
+// Like av_interleaved_write_frame(), this takes over the packet's contents.
+static int write_packet(encode_ctx_t *ctx, AVPacket *pkt)
+{
+    if (ctx->pipeline) {
+        AVPacket *copy = av_packet_alloc();
+        int error = copy ? av_packet_ref(copy, pkt) : AVERROR(ENOMEM);
+        av_packet_unref(pkt);
+        if (!error && stage_queue_push(&ctx->pipeline->mux_queue, copy))
+            error = AVERROR_EXIT;
+        if (error)
+            av_packet_free(&copy);
+        return error;
+    }
+    return av_interleaved_write_frame(ctx->oc, pkt);
+}
+
 static int encode_audio(encode_ctx_t *ctx)
 {
     char key[27];
     int i, j = 0, samples = ctx->audio_input_frame_size;
 
     int frame_length = ctx->audio_input_frame_size * ctx->channels * ctx->sample_bytes;
+    int simple = !ctx->audio_st[1] && !mlt_properties_count(ctx->frame_meta_properties);
+    int planar = simple && av_sample_fmt_is_planar(ctx->acodec_ctx[0]->sample_fmt)
+                 && av_get_bytes_per_sample(ctx->acodec_ctx[0]->sample_fmt) == ctx->sample_bytes;
 
     // Get samples count to fetch from fifo
     if (sample_fifo_used(ctx->fifo) < frame_length) {
         samples = sample_fifo_used(ctx->fifo) / (ctx->channels * ctx->sample_bytes);
     } else if (ctx->audio_input_frame_size == 1) {
-        // PCM consumes as much as possible.
-        samples = FFMIN(sample_fifo_used(ctx->fifo), AUDIO_ENCODE_BUFFER_SIZE) / frame_length;
+        // PCM consumes as much as possible, leaving room to align planes to 32 samples.
+        samples = FFMIN(sample_fifo_used(ctx->fifo), AUDIO_ENCODE_BUFFER_SIZE - 32 * frame_length)
+                  / frame_length;
     }
+    int plane_size = audio_plane_size(FFMAX(samples, ctx->audio_input_frame_size),
+                                      ctx->acodec_ctx[0]->sample_fmt);
 
     // Get the audio samples
-    if (samples > 0) {
+    if (samples > 0 && planar) {
+        // Deinterleave straight out of the fifo into the planes the encoder expects
+        memset(ctx->audio_buf_1, 0, plane_size * ctx->channels);
+        sample_fifo_fetch_planar(ctx->fifo, ctx->audio_buf_1, samples, plane_size);
+    } else if (samples > 0) {
         sample_fifo_fetch(ctx->fifo, ctx->audio_buf_1, samples * ctx->sample_bytes * ctx->channels);
     } else if (ctx->audio_codec_id == AV_CODEC_ID_VORBIS && ctx->terminated) {
         // This prevents an infinite loop when some versions of vorbis do not
@@ -1354,16 +1378,34 @@ static int encode_audio(encode_ctx_t *ctx)
         pkt.size = ctx->audio_outbuf_size;
 
         // Optimized for single track and no channel remap
-        if (!ctx->audio_st[1] && !mlt_properties_count(ctx->frame_meta_properties)) {
+        if (simple) {
             void *p = ctx->audio_buf_1;
-            if (codec->sample_fmt == AV_SAMPLE_FMT_FLTP)
-                p = interleaved_to_planar(samples, ctx->channels, p, sizeof(float));
+            if (planar) {
+                // The fifo already deinterleaved the samples.
+            } else if (codec->sample_fmt == AV_SAMPLE_FMT_FLTP)
+                p = interleaved_to_planar(samples,
+                                          ctx->channels,
+                                          p,
+                                          sizeof(float),
+                                          plane_size);
             else if (codec->sample_fmt == AV_SAMPLE_FMT_S16P)
-                p = interleaved_to_planar(samples, ctx->channels, p, sizeof(int16_t));
+                p = interleaved_to_planar(samples,
+                                          ctx->channels,
+                                          p,
+                                          sizeof(int16_t),
+                                          plane_size);
             else if (codec->sample_fmt == AV_SAMPLE_FMT_S32P)
-                p = interleaved_to_planar(samples, ctx->channels, p, sizeof(int32_t));
+                p = interleaved_to_planar(samples,
+                                          ctx->channels,
+                                          p,
+                                          sizeof(int32_t),
+                                          plane_size);
             else if (codec->sample_fmt == AV_SAMPLE_FMT_U8P)
-                p = interleaved_to_planar(samples, ctx->channels, p, sizeof(uint8_t));
+                p = interleaved_to_planar(samples,
+                                          ctx->channels,
+                                          p,
+                                          sizeof(uint8_t),
+                                          plane_size);
             ctx->audio_avframe->nb_samples = FFMAX(samples, ctx->audio_input_frame_size);
             ctx->audio_avframe->pts = ctx->sample_count[i];
             ctx->sample_count[i] += ctx->audio_avframe->nb_samples;
@@ -1475,12 +1517,12 @@ static int encode_audio(encode_ctx_t *ctx)
             // Write the compressed frame in the media file
             av_packet_rescale_ts(&pkt, codec->time_base, stream->time_base);
             pkt.stream_index = stream->index;
-            if (av_interleaved_write_frame(ctx->oc, &pkt)) {
+            if (write_packet(ctx, &pkt)) {
                 mlt_log_fatal(MLT_CONSUMER_SERVICE(ctx->consumer), "error writing audio frame\n");
                 mlt_events_fire(ctx->properties, "consumer-fatal-error", mlt_event_data_none());
                 return -1;
             }
-            ctx->error_count = 0;
+            ctx->audio_error_count = 0;
             mlt_log_debug(MLT_CONSUMER_SERVICE(ctx->consumer),
                           "audio stream %d pkt pts %" PRId64 " frame_size %d\n",
                           stream->index,
@@ -1493,13 +1535,13 @@ static int encode_audio(encode_ctx_t *ctx)
                             "error with audio encode: %d (frame %d)\n",
                             pkt.size,
                             ctx->frame_count);
-            if (++ctx->error_count > 2)
+            if (++ctx->audio_error_count > 2)
                 return -1;
         } else if (!samples) // flushing
         {
             pkt.stream_index = stream->index;
             av_packet_rescale_ts(&pkt, codec->time_base, stream->time_base);
-            av_interleaved_write_frame(ctx->oc, &pkt);
+            write_packet(ctx, &pkt);
         }
 
         if (i == 0) {
@@ -1710,7 +1752,7 @@ static void encode_subtitles(encode_ctx_t *ctx, mlt_frame frame)
                        / profile->frame_rate_num;
         pkt.stream_index = ctx->subtitle_st[i]->index;
         // Send the packet to the output
-        if (av_interleaved_write_frame(ctx->oc, &pkt)) {
+        if (write_packet(ctx, &pkt)) {
             mlt_log_error(MLT_CONSUMER_SERVICE(ctx->consumer), "error writing subtitle frame\n");
             av_packet_unref(&pkt);
             break;
@@ -1718,21 +1760,18 @@ static void encode_subtitles(encode_ctx_t *ctx, mlt_frame frame)
     }
 }
 
-static int encode_video(encode_ctx_t *enc_ctx,
-                        AVFrame *converted_avframe,
-                        uint8_t *video_outbuf,
-                        int video_outbuf_size,
-                        mlt_frame frame,
-                        mlt_image_format img_fmt)
+// Render the image of a frame and convert it into the encoder's pixel format
+static void convert_video(encode_ctx_t *enc_ctx,
+                          AVFrame *converted_avframe,
+                          mlt_frame frame,
+                          mlt_image_format img_fmt)
 {
-    int ret = 0;
     mlt_properties properties = enc_ctx->properties;
     int dst_colorspace = mlt_properties_get_int(properties, "colorspace");
     const char *color_range = mlt_properties_get(properties, "color_range");
     int dst_full_range = mlt_image_full_range(color_range);
 
     AVCodecContext *c = enc_ctx->vcodec_ctx;
-    AVFrame *avframe = NULL;
 
     mlt_properties frame_properties = MLT_FRAME_PROPERTIES(frame);
     mlt_service service = MLT_CONSUMER_SERVICE(enc_ctx->consumer);
@@ -1772,33 +1811,33 @@ static int encode_video(encode_ctx_t *enc_ctx,
 
         // Do the colour space conversion
         int srcfmt = pick_pix_fmt(img_fmt);
-        int flags
-            = mlt_get_sws_flags(width, height, srcfmt, width, height, converted_avframe->format);
-        struct SwsContext *context = sws_getContext(width,
-                                                    height,
-                                                    srcfmt,
-                                                    width,
-                                                    height,
-                                                    converted_avframe->format,
-                                                    flags,
-                                                    NULL,
-                                                    NULL,
-                                                    NULL);
-        int src_colorspace = mlt_properties_get_int(frame_properties, "colorspace");
-        int src_full_range = mlt_properties_get_int(frame_properties, "full_range");
-        mlt_set_luma_transfer(context,
-                              src_colorspace,
-                              dst_colorspace,
-                              src_full_range,
-                              dst_full_range);
-        sws_scale(context,
-                  (const uint8_t *const *) video_avframe.data,
-                  video_avframe.linesize,
-                  0,
-                  height,
-                  converted_avframe->data,
-                  converted_avframe->linesize);
-        sws_freeContext(context);
+        mlt_sws_key key = {
+            .src_width = width,
+            .src_height = height,
+            .src_format = srcfmt,
+            .dst_width = width,
+            .dst_height = height,
+            .dst_format = converted_avframe->format,
+            .flags = mlt_get_sws_flags(
+                width, height, srcfmt, width, height, converted_avframe->format),
+            .src_v_chr_pos = -513,
+            .dst_v_chr_pos = -513,
+            .src_colorspace = mlt_properties_get_int(frame_properties, "colorspace"),
+            .dst_colorspace = dst_colorspace,
+            .src_full_range = mlt_properties_get_int(frame_properties, "full_range"),
+            .dst_full_range = dst_full_range,
+        };
+        struct SwsContext *context = mlt_sws_get_context(properties, &key, NULL);
+        if (context) {
+            sws_scale(context,
+                      (const uint8_t *const *) video_avframe.data,
+                      video_avframe.linesize,
+                      0,
+                      height,
+                      converted_avframe->data,
+                      converted_avframe->linesize);
+            mlt_sws_release_context(properties, context);
+        }
 
         if (is_interlaced_chroma_correction) // restoring everything back
         {
@@ -1866,6 +1905,26 @@ static int encode_video(encode_ctx_t *enc_ctx,
                     }
                 }
             }
+    }
+}
+
+// Encode a converted image and write its packets
+static int encode_video_frame(encode_ctx_t *enc_ctx,
+                              AVFrame *converted_avframe,
+                              uint8_t *video_outbuf,
+                              int video_outbuf_size,
+                              mlt_frame frame)
+{
+    int ret = 0;
+    mlt_properties properties = enc_ctx->properties;
+
+    AVCodecContext *c = enc_ctx->vcodec_ctx;
+    AVFrame *avframe = NULL;
+
+    mlt_properties frame_properties = MLT_FRAME_PROPERTIES(frame);
+    mlt_service service = MLT_CONSUMER_SERVICE(enc_ctx->consumer);
+
+    if (mlt_properties_get_int(frame_properties, "rendered")) {
 #if defined(AVFILTER)
         if (AV_PIX_FMT_VAAPI == c->pix_fmt) {
             AVFilterContext *vfilter_in = mlt_properties_get_data(properties, "vfilter_in", NULL);
@@ -1880,7 +1939,7 @@ static int encode_video(encode_ctx_t *enc_ctx,
                                     "error with hwupload: %d (frame %d)\n",
                                     ret,
                                     enc_ctx->frame_count);
-                    if (++enc_ctx->error_count > 2)
+                    if (++enc_ctx->video_error_count > 2)
                         return -1;
                     ret = 0;
                 }
@@ -1962,14 +2021,14 @@ static int encode_video(encode_ctx_t *enc_ctx,
             pkt.stream_index = enc_ctx->video_st->index;
 
             // write the compressed frame in the media file
-            ret = av_interleaved_write_frame(enc_ctx->oc, &pkt);
+            ret = write_packet(enc_ctx, &pkt);
             mlt_log_debug(service, " frame_size %d\n", c->frame_size);
 
             // Dual pass logging
             if (mlt_properties_get_data(properties, "_logfile", NULL) && c->stats_out)
                 fprintf(mlt_properties_get_data(properties, "_logfile", NULL), "%s", c->stats_out);
 
-            enc_ctx->error_count = 0;
+            enc_ctx->video_error_count = 0;
 
             if (!ret)
                 goto receive_video_packet;
@@ -1978,7 +2037,7 @@ static int encode_video(encode_ctx_t *enc_ctx,
                             "error with video encode: %d (frame %d)\n",
                             pkt.size,
                             enc_ctx->frame_count);
-            if (++enc_ctx->error_count > 2)
+            if (++enc_ctx->video_error_count > 2)
                 return -1;
             ret = 0;
         }
@@ -1997,6 +2056,376 @@ static int encode_video(encode_ctx_t *enc_ctx,
     return 0;
 }
 
+static int encode_video(encode_ctx_t *enc_ctx,
+                        AVFrame *converted_avframe,
+                        uint8_t *video_outbuf,
+                        int video_outbuf_size,
+                        mlt_frame frame,
+                        mlt_image_format img_fmt)
+{
+    convert_video(enc_ctx, converted_avframe, frame, img_fmt);
+    return encode_video_frame(enc_ctx, converted_avframe, video_outbuf, video_outbuf_size, frame);
+}
+
+static void flush_audio(encode_ctx_t *enc_ctx)
+{
+    for (;;) {
+        int sz = sample_fifo_used(enc_ctx->fifo);
+        int ret = encode_audio(enc_ctx);
+
+        mlt_log_debug(MLT_CONSUMER_SERVICE(enc_ctx->consumer),
+                      "flushing audio: sz=%d, ret=%d\n",
+                      sz,
+                      ret);
+
+        if (!sz || ret < 0)
+            break;
+    }
+}
+
+static int flush_video(encode_ctx_t *enc_ctx, uint8_t *video_outbuf, int video_outbuf_size)
+{
+    mlt_properties properties = enc_ctx->properties;
+    mlt_service service = MLT_CONSUMER_SERVICE(enc_ctx->consumer);
+
+#ifdef AVFMT_RAWPICTURE
+    if (enc_ctx->oc->oformat->flags & AVFMT_RAWPICTURE)
+        return 0;
+#endif
+    for (;;) {
+        AVCodecContext *c = enc_ctx->vcodec_ctx;
+        AVPacket pkt;
+        av_init_packet(&pkt);
+        if (c->codec->id == AV_CODEC_ID_RAWVIDEO) {
+            pkt.data = NULL;
+            pkt.size = 0;
+        } else {
+            pkt.data = video_outbuf;
+            pkt.size = video_outbuf_size;
+        }
+
+        // Encode the image
+        int ret;
+        while ((ret = avcodec_receive_packet(c, &pkt)) == AVERROR(EAGAIN)) {
+            ret = avcodec_send_frame(c, NULL);
+            if (ret < 0) {
+                mlt_log_warning(service, "error with video encode: %d\n", ret);
+                break;
+            }
+        }
+        mlt_log_debug(service, "flushing video size %d\n", pkt.size);
+        if (pkt.size < 0)
+            break;
+        // Dual pass logging
+        if (mlt_properties_get_data(properties, "_logfile", NULL) && c->stats_out)
+            fprintf(mlt_properties_get_data(properties, "_logfile", NULL), "%s", c->stats_out);
+        if (!pkt.size)
+            break;
+
+        av_packet_rescale_ts(&pkt, c->time_base, enc_ctx->video_st->time_base);
+        pkt.stream_index = enc_ctx->video_st->index;
+
+        // write the compressed frame in the media file
+        if (write_packet(enc_ctx, &pkt) != 0) {
+            mlt_log_fatal(service, "error writing flushed video frame\n");
+            mlt_events_fire(properties, "consumer-fatal-error", mlt_event_data_none());
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// Stop every stage of the pipeline after one of them failed
+static void pipeline_abort(pipeline_t *pipeline)
+{
+    atomic_store(&pipeline->error, 1);
+    stage_queue_close(&pipeline->convert_queue, 1);
+    stage_queue_close(&pipeline->video_queue, 1);
+    stage_queue_close(&pipeline->spare_queue, 1);
+    stage_queue_close(&pipeline->mux_queue, 1);
+    audio_handoff_abort(&pipeline->audio);
+}
+
+static void stage_stats_add(stage_stats *stats, struct timeval *start)
+{
+    atomic_fetch_add(&stats->count, 1);
+    atomic_fetch_add(&stats->busy, time_difference(start));
+}
+
+static void *convert_thread(void *arg)
+{
+    encode_ctx_t *enc_ctx = arg;
+    pipeline_t *pipeline = enc_ctx->pipeline;
+    mlt_frame frame;
+
+    while ((frame = stage_queue_pop(&pipeline->convert_queue))) {
+        AVFrame *avframe = stage_queue_pop(&pipeline->spare_queue);
+        video_job *job = avframe ? malloc(sizeof(video_job)) : NULL;
+        struct timeval start;
+
+        if (!job) {
+            mlt_frame_close(frame);
+            break;
+        }
+        gettimeofday(&start, NULL);
+        convert_video(enc_ctx, avframe, frame, pipeline->img_fmt);
+        stage_stats_add(&pipeline->stats[STAGE_CONVERT], &start);
+        job->frame = frame;
+        job->avframe = avframe;
+        if (stage_queue_push(&pipeline->video_queue, job)) {
+            mlt_frame_close(frame);
+            free(job);
+            break;
+        }
+    }
+    stage_queue_close(&pipeline->video_queue, 0);
+    return NULL;
+}
+
+static void *video_thread(void *arg)
+{
+    encode_ctx_t *enc_ctx = arg;
+    pipeline_t *pipeline = enc_ctx->pipeline;
+    video_job *job;
+
+    while ((job = stage_queue_pop(&pipeline->video_queue))) {
+        struct timeval start;
+        gettimeofday(&start, NULL);
+        int error = encode_video_frame(enc_ctx,
+                                       job->avframe,
+                                       pipeline->video_outbuf,
+                                       pipeline->video_outbuf_size,
+                                       job->frame);
+        stage_stats_add(&pipeline->stats[STAGE_VIDEO], &start);
+        mlt_frame_close(job->frame);
+        stage_queue_push(&pipeline->spare_queue, job->avframe);
+        free(job);
+        if (error < 0) {
+            pipeline_abort(pipeline);
+            return NULL;
+        }
+
+        // Let the audio encoder catch up
+        audio_handoff_video(&pipeline->audio, enc_ctx->video_pts, 0);
+    }
+    if (!atomic_load(&pipeline->error) && pipeline->flush
+        && flush_video(enc_ctx, pipeline->video_outbuf, pipeline->video_outbuf_size))
+        pipeline_abort(pipeline);
+    audio_handoff_video(&pipeline->audio, enc_ctx->video_pts, 1);
+    return NULL;
+}
+
+static void *audio_thread(void *arg)
+{
+    encode_ctx_t *enc_ctx = arg;
+    pipeline_t *pipeline = enc_ctx->pipeline;
+    int frame_length = enc_ctx->audio_input_frame_size * enc_ctx->channels * enc_ctx->sample_bytes;
+
+    for (;;) {
+        struct timeval start;
+        int eof;
+
+        // Wait for a whole audio frame or the end of the audio. As when not pipelined, do not
+        // encode audio ahead of the video unless the consumer thread is waiting for room.
+        eof = audio_handoff_wait(&pipeline->audio,
+                                 frame_length,
+                                 enc_ctx->audio_pts,
+                                 enc_ctx->frame_meta_properties);
+        if (eof < 0 || atomic_load(&pipeline->error))
+            break;
+        if (sample_fifo_used(enc_ctx->fifo) < frame_length) {
+            // eof is set and only a partial frame is left
+            if (pipeline->flush)
+                flush_audio(enc_ctx);
+            break;
+        }
+        gettimeofday(&start, NULL);
+        int error = encode_audio(enc_ctx);
+        stage_stats_add(&pipeline->stats[STAGE_AUDIO], &start);
+
+        // Let the consumer thread know there is room in the fifo
+        audio_handoff_fetched(&pipeline->audio);
+
+        if (error < 0) {
+            pipeline_abort(pipeline);
+            break;
+        } else if (error > 0 && eof) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static void *mux_thread(void *arg)
+{
+    encode_ctx_t *enc_ctx = arg;
+    pipeline_t *pipeline = enc_ctx->pipeline;
+    AVPacket *pkt;
+
+    while ((pkt = stage_queue_pop(&pipeline->mux_queue))) {
+        struct timeval start;
+        gettimeofday(&start, NULL);
+        int error = av_interleaved_write_frame(enc_ctx->oc, pkt);
+        stage_stats_add(&pipeline->stats[STAGE_MUX], &start);
+        av_packet_free(&pkt);
+        if (error) {
+            mlt_log_fatal(MLT_CONSUMER_SERVICE(enc_ctx->consumer), "error writing packet\n");
+            mlt_events_fire(enc_ctx->properties, "consumer-fatal-error", mlt_event_data_none());
+            pipeline_abort(pipeline);
+            break;
+        }
+    }
+    return NULL;
+}
+
+// Publish the throughput of each stage as consumer properties
+static void pipeline_update_stats(encode_ctx_t *enc_ctx)
+{
+    pipeline_t *pipeline = enc_ctx->pipeline;
+    char key[32];
+
+    for (int i = 0; i < STAGE_COUNT; i++) {
+        int count = atomic_load(&pipeline->stats[i].count);
+        double busy = atomic_load(&pipeline->stats[i].busy) / 1000000.0;
+        snprintf(key, sizeof(key), "pipeline.%s.count", stage_names[i]);
+        mlt_properties_set_int(enc_ctx->properties, key, count);
+        snprintf(key, sizeof(key), "pipeline.%s.busy", stage_names[i]);
+        mlt_properties_set_double(enc_ctx->properties, key, busy);
+        snprintf(key, sizeof(key), "pipeline.%s.rate", stage_names[i]);
+        mlt_properties_set_double(enc_ctx->properties, key, busy > 0.0 ? count / busy : 0.0);
+    }
+}
+
+static void free_video_job(video_job *job)
+{
+    mlt_frame_close(job->frame);
+    free(job);
+}
+
+static void free_packet(AVPacket *pkt)
+{
+    av_packet_free(&pkt);
+}
+
+/** Start the pipeline threads.
+ *
+ * \param depth the capacity of the queues between the stages
+ * \return non-zero on error
+ */
+
+static int pipeline_open(encode_ctx_t *enc_ctx,
+                         int depth,
+                         int flush,
+                         enum AVPixelFormat pix_fmt,
+                         int width,
+                         int height,
+                         mlt_image_format img_fmt,
+                         uint8_t *video_outbuf,
+                         int video_outbuf_size)
+{
+    pipeline_t *pipeline = calloc(1, sizeof(pipeline_t));
+    if (!pipeline)
+        return 1;
+
+    stage_queue_init(&pipeline->convert_queue, depth);
+    stage_queue_init(&pipeline->video_queue, depth);
+    stage_queue_init(&pipeline->mux_queue, depth * (MAX_AUDIO_STREAMS + 1));
+    audio_handoff_init(&pipeline->audio, enc_ctx->video_st != NULL);
+    pipeline->flush = flush;
+    pipeline->img_fmt = img_fmt;
+    pipeline->video_outbuf = video_outbuf;
+    pipeline->video_outbuf_size = video_outbuf_size;
+    enc_ctx->pipeline = pipeline;
+
+    // One converted image for each queued frame and one at either end of the queue
+    stage_queue_init(&pipeline->spare_queue, depth + 2);
+    if (enc_ctx->video_st) {
+        pipeline->avframes = calloc(depth + 2, sizeof(AVFrame *));
+        if (!pipeline->avframes)
+            return 1;
+        for (int i = 0; i < depth + 2; i++) {
+            AVFrame *avframe = alloc_picture(pix_fmt, width, height);
+            if (!avframe)
+                return 1;
+            pipeline->avframes[pipeline->avframe_count++] = avframe;
+            stage_queue_push(&pipeline->spare_queue, avframe);
+        }
+        pipeline->started[STAGE_CONVERT]
+            = !pthread_create(&pipeline->threads[STAGE_CONVERT], NULL, convert_thread, enc_ctx);
+        pipeline->started[STAGE_VIDEO]
+            = !pthread_create(&pipeline->threads[STAGE_VIDEO], NULL, video_thread, enc_ctx);
+    }
+    pipeline->started[STAGE_MUX]
+        = !pthread_create(&pipeline->threads[STAGE_MUX], NULL, mux_thread, enc_ctx);
+    return !pipeline->started[STAGE_MUX]
+           || (enc_ctx->video_st
+               && (!pipeline->started[STAGE_CONVERT] || !pipeline->started[STAGE_VIDEO]));
+}
+
+// Start the audio encoder thread once the sample fifo exists
+static void pipeline_start_audio(encode_ctx_t *enc_ctx)
+{
+    pipeline_t *pipeline = enc_ctx->pipeline;
+    pipeline->audio.fifo = enc_ctx->fifo;
+    pipeline->started[STAGE_AUDIO]
+        = !pthread_create(&pipeline->threads[STAGE_AUDIO], NULL, audio_thread, enc_ctx);
+    if (!pipeline->started[STAGE_AUDIO])
+        pipeline_abort(pipeline);
+}
+
+// Hand the samples of a frame to the audio encoder thread
+static void pipeline_append_audio(encode_ctx_t *enc_ctx, mlt_frame frame, uint8_t *data, int size)
+{
+    audio_handoff_append(&enc_ctx->pipeline->audio, MLT_FRAME_PROPERTIES(frame), data, size);
+}
+
+// Wait for the stages to process everything queued and the encoders to flush
+// returns non-zero if a stage failed
+static int pipeline_finish(encode_ctx_t *enc_ctx)
+{
+    pipeline_t *pipeline = enc_ctx->pipeline;
+
+    stage_queue_close(&pipeline->convert_queue, 0);
+    audio_handoff_finish(&pipeline->audio);
+    for (int i = STAGE_CONVERT; i < STAGE_MUX; i++) {
+        if (pipeline->started[i])
+            pthread_join(pipeline->threads[i], NULL);
+        pipeline->started[i] = 0;
+    }
+    stage_queue_close(&pipeline->mux_queue, 0);
+    if (pipeline->started[STAGE_MUX])
+        pthread_join(pipeline->threads[STAGE_MUX], NULL);
+    pipeline->started[STAGE_MUX] = 0;
+    pipeline_update_stats(enc_ctx);
+
+    return atomic_load(&pipeline->error);
+}
+
+// Stop any stages still running and release the pipeline
+static void pipeline_close(encode_ctx_t *enc_ctx)
+{
+    pipeline_t *pipeline = enc_ctx->pipeline;
+
+    if (!pipeline)
+        return;
+    pipeline_abort(pipeline);
+    for (int i = 0; i < STAGE_COUNT; i++)
+        if (pipeline->started[i])
+            pthread_join(pipeline->threads[i], NULL);
+    stage_queue_free(&pipeline->convert_queue, (mlt_destructor) mlt_frame_close);
+    stage_queue_free(&pipeline->video_queue, (mlt_destructor) free_video_job);
+    stage_queue_free(&pipeline->spare_queue, NULL);
+    stage_queue_free(&pipeline->mux_queue, (mlt_destructor) free_packet);
+    for (int i = 0; i < pipeline->avframe_count; i++) {
+        av_free(pipeline->avframes[i]->data[0]);
+        av_free(pipeline->avframes[i]);
+    }
+    free(pipeline->avframes);
+    audio_handoff_close(&pipeline->audio);
+    free(pipeline);
+    enc_ctx->pipeline = NULL;
+}
+
 /** The main thread - the argument is simply the consumer.
 */
 
@@ -2388,6 +2817,23 @@ static void *consumer_thread(void *arg)
         }
     }
 
+    // Run the conversion, encoders and muxer on their own threads if requested
+    int pipeline_depth = mlt_properties_get_int(properties, "pipeline");
+    if (pipeline_depth > 0
+        && pipeline_open(enc_ctx,
+                         pipeline_depth,
+                         real_time_output <= 0,
+                         pix_fmt,
+                         width,
+                         height,
+                         img_fmt,
+                         video_outbuf,
+                         video_outbuf_size)) {
+        mlt_log_error(MLT_CONSUMER_SERVICE(consumer), "failed to start the encoding pipeline\n");
+        mlt_events_fire(properties, "consumer-fatal-error", mlt_event_data_none());
+        goto on_fatal_error;
+    }
+
     // Get the starting time (can ignore the times above)
     gettimeofday(&ante, NULL);
 
@@ -2397,6 +2843,10 @@ static void *consumer_thread(void *arg)
         if (!frame)
             frame = mlt_consumer_rt_frame(consumer);
 
+        // Stop if a pipeline stage failed
+        if (enc_ctx->pipeline && atomic_load(&enc_ctx->pipeline->error))
+            goto on_fatal_error;
+
         // Check that we have a frame to work with
         if (frame != NULL) {
             // Default audio args
@@ -2441,23 +2891,30 @@ static void *consumer_thread(void *arg)
 
             // Get audio and append to the fifo
             if (!enc_ctx->terminated && enc_ctx->audio_st[0]) {
+                // The audio encoder thread reads the channel count once it started
+                int channels = enc_ctx->total_channels;
                 samples = mlt_audio_calculate_frame_samples(fps, enc_ctx->frequency, count++);
-                enc_ctx->channels = enc_ctx->total_channels;
                 mlt_frame_get_audio(frame,
                                     &pcm,
                                     &aud_fmt,
                                     &enc_ctx->frequency,
-                                    &enc_ctx->channels,
+                                    &channels,
                                     &samples);
+                if (!enc_ctx->pipeline || !enc_ctx->fifo)
+                    enc_ctx->channels = channels;
 
                 // Save the audio channel remap properties for later
-                mlt_properties_pass(enc_ctx->frame_meta_properties,
-                                    frame_properties,
-                                    "meta.map.audio.");
+                if (!enc_ctx->pipeline)
+                    mlt_properties_pass(enc_ctx->frame_meta_properties,
+                                        frame_properties,
+                                        "meta.map.audio.");
 
                 // Create the fifo if we don't have one
                 if (enc_ctx->fifo == NULL) {
-                    enc_ctx->fifo = sample_fifo_init(enc_ctx->frequency, enc_ctx->channels);
+                    enc_ctx->fifo = sample_fifo_init(enc_ctx->frequency,
+                                                     enc_ctx->channels,
+                                                     enc_ctx->sample_bytes,
+                                                     2 * AUDIO_ENCODE_BUFFER_SIZE);
                     mlt_properties_set_data(properties,
                                             "sample_fifo",
                                             enc_ctx->fifo,
@@ -2465,15 +2922,33 @@ static void *consumer_thread(void *arg)
                                             (mlt_destructor) sample_fifo_close,
                                             NULL);
                 }
+                if (enc_ctx->pipeline && !enc_ctx->pipeline->started[STAGE_AUDIO])
+                    pipeline_start_audio(enc_ctx);
                 if (pcm) {
                     // Silence if not normal forward speed
                     if (mlt_properties_get_double(frame_properties, "_speed") != 1.0)
-                        memset(pcm, 0, samples * enc_ctx->channels * enc_ctx->sample_bytes);
-
-                    // Append the samples
-                    sample_fifo_append(enc_ctx->fifo,
-                                       pcm,
-                                       samples * enc_ctx->channels * enc_ctx->sample_bytes);
+                        memset(pcm, 0, samples * channels * enc_ctx->sample_bytes);
+
+                    // Append the samples, encoding some to make room if the fifo is full
+                    uint8_t *data = pcm;
+                    int remaining = samples * channels * enc_ctx->sample_bytes;
+                    if (enc_ctx->pipeline) {
+                        pipeline_append_audio(enc_ctx, frame, data, remaining);
+                        remaining = 0;
+                    }
+                    while (remaining > 0) {
+                        int appended = sample_fifo_append(enc_ctx->fifo, data, remaining);
+                        data += appended;
+                        remaining -= appended;
+                        if (remaining > 0) {
+                            int r = encode_audio(enc_ctx);
+
+                            if (r > 0)
+                                break;
+                            else if (r < 0)
+                                goto on_fatal_error;
+                        }
+                    }
                     total_time += (samples * 1000000) / enc_ctx->frequency;
                 }
                 if (!enc_ctx->video_st) {
@@ -2484,15 +2959,22 @@ static void *consumer_thread(void *arg)
             }
 
             // Encode the image
-            if (!enc_ctx->terminated && enc_ctx->video_st)
+            if (!enc_ctx->terminated && enc_ctx->video_st && enc_ctx->pipeline) {
+                if (stage_queue_push(&enc_ctx->pipeline->convert_queue, frame))
+                    mlt_frame_close(frame);
+            } else if (!enc_ctx->terminated && enc_ctx->video_st) {
                 mlt_deque_push_back(queue, frame);
-            else
+            } else {
                 mlt_frame_close(frame);
+            }
             frame = NULL;
+
+            if (enc_ctx->pipeline && frames % PIPELINE_STATS_INTERVAL == 0)
+                pipeline_update_stats(enc_ctx);
         }
 
         // While we have stuff to process, process...
-        while (1) {
+        while (!enc_ctx->pipeline) {
             // Write interleaved audio and video frames
             if (!enc_ctx->video_st
                 || (enc_ctx->video_st && enc_ctx->audio_st[0]
@@ -2554,80 +3036,25 @@ static void *consumer_thread(void *arg)
     }
 
     // Flush the encoder buffers
-    if (real_time_output <= 0) {
+    if (enc_ctx->pipeline) {
+        // The pipeline threads flush the encoders before they end
+        if (pipeline_finish(enc_ctx))
+            goto on_fatal_error;
+    } else if (real_time_output <= 0) {
         // Flush audio fifo
         // TODO: flush all audio streams
         if (enc_ctx->fifo && enc_ctx->audio_st[0])
-            for (;;) {
-                int sz = sample_fifo_used(enc_ctx->fifo);
-                int ret = encode_audio(enc_ctx);
-
-                mlt_log_debug(MLT_CONSUMER_SERVICE(consumer),
-                              "flushing audio: sz=%d, ret=%d\n",
-                              sz,
-                              ret);
+            flush_audio(enc_ctx);
 
-                if (!sz || ret < 0)
-                    break;
-            }
-
-            // Flush video
-#ifdef AVFMT_RAWPICTURE
-        if (enc_ctx->video_st && !(enc_ctx->oc->oformat->flags & AVFMT_RAWPICTURE))
-            for (;;)
-#else
-        if (enc_ctx->video_st)
-            for (;;)
-#endif
-            {
-                AVCodecContext *c = enc_ctx->vcodec_ctx;
-                AVPacket pkt;
-                av_init_packet(&pkt);
-                if (c->codec->id == AV_CODEC_ID_RAWVIDEO) {
-                    pkt.data = NULL;
-                    pkt.size = 0;
-                } else {
-                    pkt.data = video_outbuf;
-                    pkt.size = video_outbuf_size;
-                }
-
-                // Encode the image
-                int ret;
-                while ((ret = avcodec_receive_packet(c, &pkt)) == AVERROR(EAGAIN)) {
-                    ret = avcodec_send_frame(c, NULL);
-                    if (ret < 0) {
-                        mlt_log_warning(MLT_CONSUMER_SERVICE(consumer),
-                                        "error with video encode: %d\n",
-                                        ret);
-                        break;
-                    }
-                }
-                mlt_log_debug(MLT_CONSUMER_SERVICE(consumer), "flushing video size %d\n", pkt.size);
-                if (pkt.size < 0)
-                    break;
-                // Dual pass logging
-                if (mlt_properties_get_data(properties, "_logfile", NULL) && c->stats_out)
-                    fprintf(mlt_properties_get_data(properties, "_logfile", NULL),
-                            "%s",
-                            c->stats_out);
-                if (!pkt.size)
-                    break;
-
-                av_packet_rescale_ts(&pkt, c->time_base, enc_ctx->video_st->time_base);
-                pkt.stream_index = enc_ctx->video_st->index;
-
-                // write the compressed frame in the media file
-                if (av_interleaved_write_frame(enc_ctx->oc, &pkt) != 0) {
-                    mlt_log_fatal(MLT_CONSUMER_SERVICE(consumer),
-                                  "error writing flushed video frame\n");
-                    mlt_events_fire(properties, "consumer-fatal-error", mlt_event_data_none());
-                    goto on_fatal_error;
-                }
-            }
+        // Flush video
+        if (enc_ctx->video_st && flush_video(enc_ctx, video_outbuf, video_outbuf_size))
+            goto on_fatal_error;
     }
 
 on_fatal_error:
 
+    pipeline_close(enc_ctx);
+
     if (frame)
         mlt_frame_close(frame);
 
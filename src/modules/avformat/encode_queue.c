@@ -0,0 +1,309 @@
+/*
+ * encode_queue.c -- queues between the threads of the avformat consumer
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "encode_queue.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+// The number of seconds of audio the sample fifo holds
+#define SAMPLE_FIFO_SECONDS (4)
+
+//
+// The positions of the sample fifo only ever increase; the thread that owns each one stores it
+// with release semantics after copying, so the other thread never sees bytes that are not yet
+// written. The capacity is a whole number of sample frames so that a frame never wraps.
+//
+
+struct sample_fifo_s
+{
+    uint8_t *buffer;
+    size_t size;
+    atomic_size_t read;
+    atomic_size_t write;
+    double time;
+    int frequency;
+    int channels;
+    int sample_bytes;
+};
+
+// min_size is the least number of bytes the fifo holds whatever the frequency
+sample_fifo sample_fifo_init(int frequency, int channels, int sample_bytes, int min_size)
+{
+    sample_fifo fifo = calloc(1, sizeof(struct sample_fifo_s));
+    size_t frame_bytes = (size_t) channels * sample_bytes;
+    size_t frames = (size_t) frequency * SAMPLE_FIFO_SECONDS;
+
+    if (frames * frame_bytes < (size_t) min_size)
+        frames = (min_size + frame_bytes - 1) / frame_bytes;
+    fifo->size = frames * frame_bytes;
+    fifo->buffer = malloc(fifo->size);
+    atomic_init(&fifo->read, 0);
+    atomic_init(&fifo->write, 0);
+    fifo->frequency = frequency;
+    fifo->channels = channels;
+    fifo->sample_bytes = sample_bytes;
+    return fifo;
+}
+
+// count is the number of samples multiplied by the number of bytes per sample
+// returns the number of bytes appended, which is less than count when the fifo is full
+int sample_fifo_append(sample_fifo fifo, uint8_t *samples, int count)
+{
+    size_t write = atomic_load_explicit(&fifo->write, memory_order_relaxed);
+    size_t read = atomic_load_explicit(&fifo->read, memory_order_acquire);
+    size_t space = fifo->size - (write - read);
+    size_t offset = write % fifo->size;
+    size_t first;
+
+    if ((size_t) count > space)
+        count = space;
+    first = MIN((size_t) count, fifo->size - offset);
+    memcpy(&fifo->buffer[offset], samples, first);
+    memcpy(fifo->buffer, &samples[first], count - first);
+    atomic_store_explicit(&fifo->write, write + count, memory_order_release);
+
+    return count;
+}
+
+int sample_fifo_used(sample_fifo fifo)
+{
+    size_t read = atomic_load_explicit(&fifo->read, memory_order_acquire);
+    size_t write = atomic_load_explicit(&fifo->write, memory_order_acquire);
+    return write - read;
+}
+
+int sample_fifo_fetch(sample_fifo fifo, uint8_t *samples, int count)
+{
+    size_t read = atomic_load_explicit(&fifo->read, memory_order_relaxed);
+    size_t used = atomic_load_explicit(&fifo->write, memory_order_acquire) - read;
+    size_t offset = read % fifo->size;
+    size_t first;
+
+    if ((size_t) count > used)
+        count = used;
+    first = MIN((size_t) count, fifo->size - offset);
+    memcpy(samples, &fifo->buffer[offset], first);
+    memcpy(&samples[first], fifo->buffer, count - first);
+    atomic_store_explicit(&fifo->read, read + count, memory_order_release);
+
+    fifo->time += (double) count / fifo->channels / fifo->frequency;
+
+    return count;
+}
+
+// Fetch up to count samples per channel into consecutive planes of plane_size bytes each.
+// returns the number of samples per channel fetched
+int sample_fifo_fetch_planar(sample_fifo fifo, uint8_t *planes, int count, int plane_size)
+{
+    size_t frame_bytes = (size_t) fifo->channels * fifo->sample_bytes;
+    size_t read = atomic_load_explicit(&fifo->read, memory_order_relaxed);
+    size_t used = atomic_load_explicit(&fifo->write, memory_order_acquire) - read;
+    size_t offset = read % fifo->size;
+    int i, c;
+
+    if ((size_t) count > used / frame_bytes)
+        count = used / frame_bytes;
+    if (count * fifo->sample_bytes > plane_size)
+        count = plane_size / fifo->sample_bytes;
+    for (i = 0; i < count; i++) {
+        const uint8_t *frame = &fifo->buffer[offset];
+        for (c = 0; c < fifo->channels; c++)
+            memcpy(&planes[c * plane_size + i * fifo->sample_bytes],
+                   &frame[c * fifo->sample_bytes],
+                   fifo->sample_bytes);
+        offset += frame_bytes;
+        if (offset == fifo->size)
+            offset = 0;
+    }
+    atomic_store_explicit(&fifo->read, read + count * frame_bytes, memory_order_release);
+
+    fifo->time += (double) count * fifo->sample_bytes / fifo->frequency;
+
+    return count;
+}
+
+void sample_fifo_close(sample_fifo fifo)
+{
+    free(fifo->buffer);
+    free(fifo);
+}
+
+void stage_queue_init(stage_queue *queue, int capacity)
+{
+    queue->deque = mlt_deque_init();
+    pthread_mutex_init(&queue->mutex, NULL);
+    pthread_cond_init(&queue->cond, NULL);
+    queue->capacity = capacity;
+    queue->closed = 0;
+}
+
+// returns non-zero if the queue is closed and the item was not added
+int stage_queue_push(stage_queue *queue, void *item)
+{
+    int error = 0;
+    pthread_mutex_lock(&queue->mutex);
+    while (!queue->closed && mlt_deque_count(queue->deque) >= queue->capacity)
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    if (queue->closed)
+        error = 1;
+    else
+        mlt_deque_push_back(queue->deque, item);
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return error;
+}
+
+// returns NULL once the queue is closed and drained
+void *stage_queue_pop(stage_queue *queue)
+{
+    void *item = NULL;
+    pthread_mutex_lock(&queue->mutex);
+    while (!queue->closed && !mlt_deque_count(queue->deque))
+        pthread_cond_wait(&queue->cond, &queue->mutex);
+    if (queue->closed < 2)
+        item = mlt_deque_pop_front(queue->deque);
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+    return item;
+}
+
+void stage_queue_close(stage_queue *queue, int abort)
+{
+    pthread_mutex_lock(&queue->mutex);
+    queue->closed = MAX(queue->closed, abort ? 2 : 1);
+    pthread_cond_broadcast(&queue->cond);
+    pthread_mutex_unlock(&queue->mutex);
+}
+
+// Free a queue after its threads ended, passing each item left in it to the destructor
+void stage_queue_free(stage_queue *queue, mlt_destructor destructor)
+{
+    void *item;
+    while ((item = mlt_deque_pop_front(queue->deque)))
+        if (destructor)
+            destructor(item);
+    mlt_deque_close(queue->deque);
+    pthread_mutex_destroy(&queue->mutex);
+    pthread_cond_destroy(&queue->cond);
+}
+
+void audio_handoff_init(audio_handoff *handoff, int has_video)
+{
+    pthread_mutex_init(&handoff->mutex, NULL);
+    pthread_cond_init(&handoff->cond, NULL);
+    handoff->fifo = NULL;
+    handoff->meta = mlt_properties_new();
+    handoff->eof = 0;
+    handoff->full = 0;
+    handoff->aborted = 0;
+    handoff->video_eof = !has_video;
+    handoff->video_pts = 0.0;
+}
+
+void audio_handoff_close(audio_handoff *handoff)
+{
+    pthread_mutex_destroy(&handoff->mutex);
+    pthread_cond_destroy(&handoff->cond);
+    mlt_properties_close(handoff->meta);
+}
+
+// Append the samples of a frame, waiting for the audio encoder to make room as needed.
+// meta holds the channel map of the frame, as meta.map.audio.* properties.
+// returns non-zero if the hand-off was aborted before all of the samples were appended
+int audio_handoff_append(audio_handoff *handoff, mlt_properties meta, uint8_t *data, int size)
+{
+    pthread_mutex_lock(&handoff->mutex);
+    if (meta)
+        mlt_properties_pass(handoff->meta, meta, "meta.map.audio.");
+    while (size > 0 && !handoff->aborted) {
+        int appended = sample_fifo_append(handoff->fifo, data, size);
+        data += appended;
+        size -= appended;
+        pthread_cond_broadcast(&handoff->cond);
+        if (size > 0) {
+            handoff->full = 1;
+            pthread_cond_wait(&handoff->cond, &handoff->mutex);
+            handoff->full = 0;
+        }
+    }
+    pthread_mutex_unlock(&handoff->mutex);
+    return size > 0;
+}
+
+// Wait until there is a whole audio frame to encode and the audio encoder may encode it, or the
+// end of the audio. The audio encoder may go ahead of audio_pts only while the video encoder is
+// not past it, unless the consumer thread is waiting for room.
+// meta receives the channel map for the audio encoder.
+// returns -1 if the hand-off was aborted, otherwise whether no more samples will be appended
+int audio_handoff_wait(audio_handoff *handoff,
+                       int frame_length,
+                       double audio_pts,
+                       mlt_properties meta)
+{
+    int eof;
+
+    pthread_mutex_lock(&handoff->mutex);
+    while (!handoff->aborted && !handoff->eof
+           && (sample_fifo_used(handoff->fifo) < frame_length
+               || (!handoff->video_eof && !handoff->full && audio_pts >= handoff->video_pts)))
+        pthread_cond_wait(&handoff->cond, &handoff->mutex);
+    eof = handoff->aborted ? -1 : handoff->eof;
+    if (meta)
+        mlt_properties_pass(meta, handoff->meta, "");
+    pthread_mutex_unlock(&handoff->mutex);
+    return eof;
+}
+
+// Let the consumer thread know that the audio encoder fetched samples
+void audio_handoff_fetched(audio_handoff *handoff)
+{
+    pthread_mutex_lock(&handoff->mutex);
+    pthread_cond_broadcast(&handoff->cond);
+    pthread_mutex_unlock(&handoff->mutex);
+}
+
+// Let the audio encoder catch up with the video encoder
+void audio_handoff_video(audio_handoff *handoff, double video_pts, int eof)
+{
+    pthread_mutex_lock(&handoff->mutex);
+    handoff->video_pts = video_pts;
+    handoff->video_eof = handoff->video_eof || eof;
+    pthread_cond_broadcast(&handoff->cond);
+    pthread_mutex_unlock(&handoff->mutex);
+}
+
+// Tell the audio encoder that no more samples will be appended
+void audio_handoff_finish(audio_handoff *handoff)
+{
+    pthread_mutex_lock(&handoff->mutex);
+    handoff->eof = 1;
+    pthread_cond_broadcast(&handoff->cond);
+    pthread_mutex_unlock(&handoff->mutex);
+}
+
+// Stop both sides from waiting
+void audio_handoff_abort(audio_handoff *handoff)
+{
+    pthread_mutex_lock(&handoff->mutex);
+    handoff->aborted = 1;
+    pthread_cond_broadcast(&handoff->cond);
+    pthread_mutex_unlock(&handoff->mutex);
+}
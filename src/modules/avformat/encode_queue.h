@@ -0,0 +1,92 @@
+/*
+ * encode_queue.h -- queues between the threads of the avformat consumer
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef ENCODE_QUEUE_H
+#define ENCODE_QUEUE_H
+
+#include <framework/mlt.h>
+
+#include <pthread.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A fixed-capacity ring of interleaved samples with one thread appending and one fetching. */
+typedef struct sample_fifo_s *sample_fifo;
+
+sample_fifo sample_fifo_init(int frequency, int channels, int sample_bytes, int min_size);
+int sample_fifo_append(sample_fifo fifo, uint8_t *samples, int count);
+int sample_fifo_used(sample_fifo fifo);
+int sample_fifo_fetch(sample_fifo fifo, uint8_t *samples, int count);
+int sample_fifo_fetch_planar(sample_fifo fifo, uint8_t *planes, int count, int plane_size);
+void sample_fifo_close(sample_fifo fifo);
+
+/** A bounded queue between two pipeline stages. */
+typedef struct
+{
+    mlt_deque deque;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int capacity;
+    int closed; // 1 when no more items will come, 2 when the remaining items are dropped
+} stage_queue;
+
+void stage_queue_init(stage_queue *queue, int capacity);
+int stage_queue_push(stage_queue *queue, void *item);
+void *stage_queue_pop(stage_queue *queue);
+void stage_queue_close(stage_queue *queue, int abort);
+void stage_queue_free(stage_queue *queue, mlt_destructor destructor);
+
+/** The samples handed from the consumer thread to the audio encoder thread.
+ *
+ * The audio encoder does not run ahead of the video encoder unless the consumer thread waits for
+ * room in the fifo, so that the muxer interleaves them as when they are not pipelined.
+ */
+typedef struct
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    sample_fifo fifo;    // set before the audio encoder thread starts
+    mlt_properties meta; // the channel map for the audio encoder
+    int eof;             // no more samples will be appended
+    int full;            // the consumer thread waits for room in the fifo
+    int aborted;
+    int video_eof;    // the video encoder finished or there is none
+    double video_pts; // the time the video encoder reached
+} audio_handoff;
+
+void audio_handoff_init(audio_handoff *handoff, int has_video);
+void audio_handoff_close(audio_handoff *handoff);
+int audio_handoff_append(audio_handoff *handoff, mlt_properties meta, uint8_t *data, int size);
+int audio_handoff_wait(audio_handoff *handoff,
+                       int frame_length,
+                       double audio_pts,
+                       mlt_properties meta);
+void audio_handoff_fetched(audio_handoff *handoff);
+void audio_handoff_video(audio_handoff *handoff, double video_pts, int eof);
+void audio_handoff_finish(audio_handoff *handoff);
+void audio_handoff_abort(audio_handoff *handoff);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ENCODE_QUEUE_H
@@ -99,7 +99,6 @@ static int av_convert_image(uint8_t *out,
     int in_stride[4];
     uint8_t *out_data[4];
     int out_stride[4];
-    int flags = mlt_get_sws_flags(in_width, in_height, in_fmt, out_width, out_height, out_fmt);
     int error = -1;
 
     if (in_fmt == AV_PIX_FMT_YUV422P16LE)
@@ -110,17 +109,27 @@ static int av_convert_image(uint8_t *out,
         mlt_image_format_planes(out_fmt, out_width, out_height, out, out_data, out_stride);
     else
         av_image_fill_arrays(out_data, out_stride, out, out_fmt, out_width, out_height, IMAGE_ALIGN);
-    struct SwsContext *context = sws_getContext(
-        in_width, in_height, in_fmt, out_width, out_height, out_fmt, flags, NULL, NULL, NULL);
+    // libswscale wants the RGB colorspace to be SWS_CS_DEFAULT, which is = SWS_CS_ITU601.
+    if (out_fmt == AV_PIX_FMT_RGB24 || out_fmt == AV_PIX_FMT_RGBA)
+        dst_colorspace = 601;
+    // The conversion has no reference to the filter, so use the cache shared by the module.
+    mlt_sws_key key = {
+        .src_width = in_width,
+        .src_height = in_height,
+        .src_format = in_fmt,
+        .dst_width = out_width,
+        .dst_height = out_height,
+        .dst_format = out_fmt,
+        .flags = mlt_get_sws_flags(in_width, in_height, in_fmt, out_width, out_height, out_fmt),
+        .src_v_chr_pos = -513,
+        .dst_v_chr_pos = -513,
+        .src_colorspace = src_colorspace,
+        .dst_colorspace = dst_colorspace,
+        .src_full_range = src_full_range,
+        .dst_full_range = dst_full_range,
+    };
+    struct SwsContext *context = mlt_sws_get_context(NULL, &key, &error);
     if (context) {
-        // libswscale wants the RGB colorspace to be SWS_CS_DEFAULT, which is = SWS_CS_ITU601.
-        if (out_fmt == AV_PIX_FMT_RGB24 || out_fmt == AV_PIX_FMT_RGBA)
-            dst_colorspace = 601;
-        error = mlt_set_luma_transfer(context,
-                                      src_colorspace,
-                                      dst_colorspace,
-                                      src_full_range,
-                                      dst_full_range);
         sws_scale(context,
                   (const uint8_t *const *) in_data,
                   in_stride,
@@ -128,7 +137,7 @@ static int av_convert_image(uint8_t *out,
                   in_height,
                   out_data,
                   out_stride);
-        sws_freeContext(context);
+        mlt_sws_release_context(NULL, context);
     }
     return error;
 }
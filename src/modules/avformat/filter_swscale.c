@@ -117,45 +117,36 @@ static int filter_scale(mlt_frame frame,
     int out_size = mlt_image_format_size(*format, owidth, oheight, NULL);
     uint8_t *outbuf = mlt_pool_alloc(out_size);
 
-    // Create the context
-    struct SwsContext *context = sws_alloc_context();
-    if (outbuf && context) {
+    mlt_profile profile = mlt_service_profile(
+        MLT_PRODUCER_SERVICE(mlt_frame_get_original_producer(frame)));
+    const char *dst_color_range = mlt_properties_get(properties, "consumer.color_range");
+    int dst_full_range = mlt_image_full_range(dst_color_range);
+
+    // Get the context, reusing one from an earlier frame of the same size and format
+    mlt_sws_key key = {
+        .src_width = iwidth,
+        .src_height = iheight,
+        .src_format = avformat,
+        .dst_width = owidth,
+        .dst_height = oheight,
+        .dst_format = avformat,
+        .flags = interp,
+        .threads = MIN(mlt_slices_count_normal(), MAX_THREADS),
+        .src_v_chr_pos = -513,
+        .dst_v_chr_pos = -513,
+        .src_colorspace = mlt_properties_get_int(properties, "colorspace"),
+        .dst_colorspace = profile ? profile->colorspace : 601,
+        .src_full_range = mlt_properties_get_int(properties, "full_range"),
+        .dst_full_range = dst_full_range,
+    };
+    struct SwsContext *context = outbuf ? mlt_sws_get_context(NULL, &key, &result) : NULL;
+    if (outbuf && !context) {
+        mlt_pool_release(outbuf);
+        result = 1;
+    } else if (outbuf) {
         AVFrame *avinframe = av_frame_alloc();
         AVFrame *avoutframe = av_frame_alloc();
 
-        av_opt_set_int(context, "srcw", iwidth, 0);
-        av_opt_set_int(context, "srch", iheight, 0);
-        av_opt_set_int(context, "src_format", avformat, 0);
-        av_opt_set_int(context, "dstw", owidth, 0);
-        av_opt_set_int(context, "dsth", oheight, 0);
-        av_opt_set_int(context, "dst_format", avformat, 0);
-        av_opt_set_int(context, "sws_flags", interp, 0);
-#if LIBSWSCALE_VERSION_MAJOR >= 6
-        av_opt_set_int(context, "threads", MIN(mlt_slices_count_normal(), MAX_THREADS), 0);
-#endif
-        result = sws_init_context(context, NULL, NULL);
-        if (result < 0) {
-            mlt_log_error(NULL,
-                          "[filter swscale] Initializing swscale failed with %d (%s)\n",
-                          result,
-                          av_err2str(result));
-            result = 1;
-            goto exit;
-        }
-
-        mlt_profile profile = mlt_service_profile(
-            MLT_PRODUCER_SERVICE(mlt_frame_get_original_producer(frame)));
-        int dst_colorspace = profile ? profile->colorspace : 601;
-        int src_colorspace = mlt_properties_get_int(properties, "colorspace");
-        int src_full_range = mlt_properties_get_int(properties, "full_range");
-        const char *dst_color_range = mlt_properties_get(properties, "consumer.color_range");
-        int dst_full_range = mlt_image_full_range(dst_color_range);
-
-        result = mlt_set_luma_transfer(context,
-                                       src_colorspace,
-                                       dst_colorspace,
-                                       src_full_range,
-                                       dst_full_range);
         if (result < 0) {
             mlt_log_error(NULL,
                           "[filter swscale] Setting swscale color options failed with %d (%s)\n",
@@ -213,7 +204,7 @@ static int filter_scale(mlt_frame frame,
             result = 1;
             goto exit;
         }
-        sws_freeContext(context);
+        mlt_sws_release_context(NULL, context);
         context = NULL;
 
         // Sanity check the output frame
@@ -268,35 +259,22 @@ static int filter_scale(mlt_frame frame,
         uint8_t *alpha = mlt_frame_get_alpha_size(frame, &alpha_size);
         if (alpha && alpha_size > 0 && alpha_size != (owidth * oheight)) {
             // Create the context and output image
+            avformat = AV_PIX_FMT_GRAY8;
+            key.src_format = key.dst_format = avformat;
+            key.src_colorspace = key.dst_colorspace = -1;
+            key.src_full_range = key.dst_full_range = 0;
             outbuf = mlt_pool_alloc(owidth * oheight);
-            context = sws_alloc_context();
-
-            if (outbuf && context) {
+            context = outbuf ? mlt_sws_get_context(NULL, &key, NULL) : NULL;
+
+            if (outbuf && !context) {
+                mlt_log_error(NULL, "[filter swscale] Initializing swscale alpha failed\n");
+                mlt_pool_release(outbuf);
+                result = 1;
+                goto exit;
+            } else if (outbuf) {
                 av_frame_unref(avinframe);
                 av_frame_unref(avoutframe);
 
-                avformat = AV_PIX_FMT_GRAY8;
-                av_opt_set_int(context, "srcw", iwidth, 0);
-                av_opt_set_int(context, "srch", iheight, 0);
-                av_opt_set_int(context, "src_format", avformat, 0);
-                av_opt_set_int(context, "dstw", owidth, 0);
-                av_opt_set_int(context, "dsth", oheight, 0);
-                av_opt_set_int(context, "dst_format", avformat, 0);
-                av_opt_set_int(context, "sws_flags", interp, 0);
-#if LIBSWSCALE_VERSION_MAJOR >= 6
-                av_opt_set_int(context, "threads", MIN(mlt_slices_count_normal(), MAX_THREADS), 0);
-#endif
-                result = sws_init_context(context, NULL, NULL);
-                if (result < 0) {
-                    mlt_log_error(
-                        NULL,
-                        "[filter swscale] Initializing swscale alpha failed with %d (%s)\n",
-                        result,
-                        av_err2str(result));
-                    result = 1;
-                    goto exit;
-                }
-
                 // Setup the input image
                 avinframe->width = iwidth;
                 avinframe->height = iheight;
@@ -339,7 +317,7 @@ static int filter_scale(mlt_frame frame,
                     result = 1;
                     goto exit;
                 }
-                sws_freeContext(context);
+                mlt_sws_release_context(NULL, context);
                 context = NULL;
 
                 // Sanity check the output frame
@@ -366,7 +344,7 @@ static int filter_scale(mlt_frame frame,
     exit:
         av_frame_free(&avinframe);
         av_frame_free(&avoutframe);
-        sws_freeContext(context);
+        mlt_sws_release_context(NULL, context);
     }
     return result;
 }
@@ -27,6 +27,7 @@
 #endif
 
 #include "common.h"
+#include "seek_index.h"
 
 // MLT Header files
 #include <framework/mlt_cache.h>
@@ -64,6 +65,7 @@
 #include <stdatomic.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <wchar.h>
 
 #define POSITION_INITIAL (-2)
@@ -72,8 +74,11 @@
 #define MAX_AUDIO_STREAMS (32)
 #define MAX_AUDIO_FRAME_SIZE (192000) // 1 second of 48khz 32bit audio
 #define IMAGE_ALIGN (1)
+#define GOP_CACHE_SIZE (30) // default frames kept for reverse playback
+#define GOP_CACHE_BYTES (256 * 1024 * 1024) // default bytes kept for reverse playback
 #define VFR_THRESHOLD \
     (3) // The minimum number of video frames with differing durations to be considered VFR.
+#define SEEK_INDEX_MAX_BUILDS (2) // the number of seek indexes built at the same time
 
 struct producer_avformat_s
 {
@@ -139,6 +144,22 @@ struct producer_avformat_s
     int is_audio_synchronizing;
     int video_send_result;
     int reset_image_cache;
+    mlt_cache gop_cache; // decoded frames for reverse playback and lookahead
+    pthread_t lookahead_thread;
+    pthread_mutex_t lookahead_mutex;
+    pthread_cond_t lookahead_cond;
+    atomic_int is_lookahead_init; // set once lookahead_mutex and lookahead_thread exist
+    int lookahead_stop;           // non-zero when lookahead_thread is to stop
+    mlt_position lookahead_next;  // next position for lookahead_thread to decode
+    mlt_position lookahead_end;   // last position for lookahead_thread to decode
+    mlt_image_format lookahead_format;
+    int lookahead_full_range;
+    int lookahead_size; // the most frames the GOP cache can hold ahead
+    atomic_int image_waiting; // get_image calls waiting for video_mutex
+    seek_index_t *seek_index;
+    pthread_t seek_index_thread;
+    int is_seek_index_init;
+    atomic_int seek_index_stop; // non-zero when seek_index_thread is to stop
     struct
     {
         int pix_fmt;
@@ -164,7 +185,13 @@ static int video_codec_init(producer_avformat self, int index, mlt_properties pr
 static void get_audio_streams_info(producer_avformat self);
 static mlt_audio_format pick_audio_format(int sample_fmt);
 static int pick_av_pixel_format(int *pix_fmt, int full_range);
+static void init_mutexes(producer_avformat self);
 static void property_changed(mlt_service owner, producer_avformat self, char *name);
+static void properties_changed(mlt_service owner,
+                               producer_avformat self,
+                               mlt_event_data event_data);
+static void *lookahead_worker(void *param);
+static void on_prefetch(mlt_properties owner, producer_avformat self, mlt_event_data event_data);
 
 static int absolute_stream_index(AVFormatContext *context, enum AVMediaType media_type, int relative)
 {
@@ -215,6 +242,7 @@ mlt_producer producer_avformat_init(mlt_profile profile, const char *service, ch
         // Initialise it
         if (mlt_producer_init(producer, self) == 0) {
             self->parent = producer;
+            init_mutexes(self);
 
             // Get the properties
             mlt_properties properties = MLT_PRODUCER_PROPERTIES(producer);
@@ -261,10 +289,18 @@ mlt_producer producer_avformat_init(mlt_profile profile, const char *service, ch
                                       0,
                                       (mlt_destructor) producer_avformat_close);
                 mlt_properties_set_int(properties, "mute_on_pause", 0);
+                mlt_events_listen_batched(properties,
+                                          self,
+                                          "property-changed",
+                                          (mlt_listener) property_changed);
                 mlt_events_listen(properties,
                                   self,
-                                  "property-changed",
-                                  (mlt_listener) property_changed);
+                                  "properties-changed",
+                                  (mlt_listener) properties_changed);
+                mlt_events_listen(properties,
+                                  self,
+                                  "producer-prefetch",
+                                  (mlt_listener) on_prefetch);
             }
         }
     }
@@ -1118,16 +1154,267 @@ static void set_up_discard(producer_avformat self, int audio_index, int video_in
     }
 }
 
-/** Open the file.
+/** The job of the thread that builds a seek index. */
+typedef struct
+{
+    producer_avformat self;
+    char *filename;
+    char *path; // where to save the index
+    const AVInputFormat *format;
+    int stream;
+    int64_t size;
+    int64_t mtime;
+} seek_index_job;
+
+static int seek_index_enabled(mlt_properties properties)
+{
+    if (mlt_properties_get(properties, "seek_index"))
+        return mlt_properties_get_int(properties, "seek_index");
+    return getenv("MLT_AVFORMAT_SEEK_INDEX_DIR") != NULL;
+}
+
+/** Get the file name of the seek index for a media file.
+ *
+ * The index goes next to the media unless a cache directory is given, in which case
+ * it is named after a hash of the media file name.
+ */
+
+static char *seek_index_path(mlt_properties properties, const char *filename)
+{
+    const char *dir = mlt_properties_get(properties, "seek_index_dir");
+    char *path = NULL;
+
+    if (!dir)
+        dir = getenv("MLT_AVFORMAT_SEEK_INDEX_DIR");
+    if (dir && *dir) {
+        // 64-bit FNV-1a
+        uint64_t hash = 14695981039346656037ULL;
+        for (const char *c = filename; *c; c++)
+            hash = (hash ^ (unsigned char) *c) * 1099511628211ULL;
+        path = malloc(strlen(dir) + 25);
+        if (path)
+            sprintf(path, "%s/%016" PRIx64 ".mltidx", dir, hash);
+    } else {
+        path = malloc(strlen(filename) + 8);
+        if (path)
+            sprintf(path, "%s.mltidx", filename);
+    }
+    return path;
+}
+
+// The number of seek index workers running in the process
+static atomic_int seek_index_builds;
+
+/** Read the whole file on a separate context to find the keyframes of the video stream.
 */
 
-static int producer_open(
-    producer_avformat self, mlt_profile profile, const char *URL, int take_lock, int test_open)
+static void *seek_index_worker(void *param)
+{
+    seek_index_job *job = param;
+    producer_avformat self = job->self;
+    AVFormatContext *context = NULL;
+    AVPacket *pkt = av_packet_alloc();
+    seek_index_t *index = calloc(1, sizeof(*index));
+    int64_t max_pts = AV_NOPTS_VALUE;
+    int pkt_countdown = 500; // as in find_first_pts()
+    int vfr_countdown = 20;
+    int vfr_counter = 0;
+    int64_t prev_pkt_duration = AV_NOPTS_VALUE;
+    int error = !pkt || !index
+                || avformat_open_input(&context, job->filename, job->format, NULL) < 0
+                || avformat_find_stream_info(context, NULL) < 0
+                || job->stream >= (int) context->nb_streams;
+
+    if (!error) {
+        for (int i = 0; i < context->nb_streams; i++)
+            context->streams[i]->discard = i == job->stream ? AVDISCARD_DEFAULT : AVDISCARD_ALL;
+        index->size = job->size;
+        index->mtime = job->mtime;
+        index->stream = job->stream;
+        index->time_base_num = context->streams[job->stream]->time_base.num;
+        index->time_base_den = context->streams[job->stream]->time_base.den;
+        index->first_pts = AV_NOPTS_VALUE;
+        index->end_pts = INT64_MAX;
+
+        while (!error && !self->seek_index_stop && index->end_pts == INT64_MAX
+               && av_read_frame(context, pkt) >= 0) {
+            int64_t pts = pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+            if (pkt->stream_index != job->stream) {
+                av_packet_unref(pkt);
+                continue;
+            }
+
+            // Find the first PTS and whether the frame rate varies as find_first_pts() does,
+            // so that later opens can skip it
+            if (vfr_countdown > 0 && vfr_counter < VFR_THRESHOLD) {
+                if (pkt->duration != AV_NOPTS_VALUE && pkt->duration != prev_pkt_duration
+                    && prev_pkt_duration != AV_NOPTS_VALUE)
+                    ++vfr_counter;
+                prev_pkt_duration = pkt->duration;
+                vfr_countdown--;
+            }
+            if (pkt_countdown > 0 && (pkt->flags & AV_PKT_FLAG_KEY)
+                && index->first_pts == AV_NOPTS_VALUE) {
+                // See find_first_pts() about negative DTS
+                if (pkt->dts != AV_NOPTS_VALUE && pkt->dts < 0)
+                    index->first_pts = 0;
+                else
+                    index->first_pts = pts;
+            }
+            pkt_countdown--;
+
+            if ((pkt->flags & AV_PKT_FLAG_KEY) && pts != AV_NOPTS_VALUE) {
+                int result = seek_index_append(index, pts, pkt->pos);
+                error = result < 0;
+                // Stop at a timestamp discontinuity, where the later keyframes would have
+                // the same timestamps as earlier ones. Seeks past it use the demuxer.
+                if (result > 0) {
+                    index->end_pts = max_pts;
+                    mlt_log_verbose(MLT_PRODUCER_SERVICE(self->parent),
+                                    "seek index stops at byte %" PRId64 "\n",
+                                    pkt->pos);
+                }
+            }
+            if (pts != AV_NOPTS_VALUE && index->end_pts == INT64_MAX)
+                max_pts = FFMAX(max_pts, pts);
+            av_packet_unref(pkt);
+        }
+        error = error || self->seek_index_stop || index->count == 0;
+
+        index->vfr = vfr_counter >= VFR_THRESHOLD;
+        if (!index->vfr) {
+            AVStream *stream = context->streams[job->stream];
+            int d = stream->avg_frame_rate.den;
+            index->vfr = d != 0 && d != 1 && d != 2 && d != 125 && d != 1001
+                         && av_cmp_q(stream->avg_frame_rate, stream->r_frame_rate);
+        }
+    }
+    avformat_close_input(&context);
+    av_packet_free(&pkt);
+
+    if (!error) {
+        pthread_mutex_lock(&self->packets_mutex);
+        self->seek_index = index;
+        pthread_mutex_unlock(&self->packets_mutex);
+
+        mlt_log_verbose(MLT_PRODUCER_SERVICE(self->parent),
+                        "seek index has %" PRId64 " keyframes\n",
+                        index->count);
+        seek_index_save(index, job->path);
+    } else {
+        seek_index_close(index);
+    }
+    free(job->filename);
+    free(job->path);
+    free(job);
+    atomic_fetch_sub(&seek_index_builds, 1);
+    return NULL;
+}
+
+/** Load the seek index of the video stream or start building it in the background.
+*/
+
+static void seek_index_open(producer_avformat self,
+                            const char *filename,
+                            const AVInputFormat *format)
 {
-    // Return an error code (0 == no error)
-    int error = 0;
     mlt_properties properties = MLT_PRODUCER_PROPERTIES(self->parent);
+    struct stat stat_buff;
+
+    if (!self->is_seek_index_init && !self->seek_index && self->seekable
+        && self->video_index >= 0 && seek_index_enabled(properties)
+        && !mlt_stat(filename, &stat_buff) && S_ISREG(stat_buff.st_mode)) {
+        AVStream *stream = self->video_format->streams[self->video_index];
+        char *path = seek_index_path(properties, filename);
+        seek_index_t *index = seek_index_load(path,
+                                              &stat_buff,
+                                              self->video_index,
+                                              stream->time_base.num,
+                                              stream->time_base.den);
+
+        if (index) {
+            pthread_mutex_lock(&self->packets_mutex);
+            self->seek_index = index;
+            pthread_mutex_unlock(&self->packets_mutex);
+            free(path);
+        } else if (atomic_fetch_add(&seek_index_builds, 1) >= SEEK_INDEX_MAX_BUILDS) {
+            // Enough files are being read in full already; try again on the next open
+            atomic_fetch_sub(&seek_index_builds, 1);
+            free(path);
+        } else {
+            seek_index_job *job = calloc(1, sizeof(*job));
+            if (job && path) {
+                job->self = self;
+                job->filename = strdup(filename);
+                job->path = path;
+                job->format = format;
+                job->stream = self->video_index;
+                job->size = stat_buff.st_size;
+                job->mtime = stat_buff.st_mtime;
+                self->is_seek_index_init
+                    = !pthread_create(&self->seek_index_thread, NULL, seek_index_worker, job);
+            }
+            if (!self->is_seek_index_init) {
+                if (job)
+                    free(job->filename);
+                free(job);
+                free(path);
+                atomic_fetch_sub(&seek_index_builds, 1);
+            }
+        }
+    }
+
+    // The index remembers the first PTS so find_first_pts() need not run again
+    pthread_mutex_lock(&self->packets_mutex);
+    if (self->seek_index && self->seek_index->first_pts != AV_NOPTS_VALUE) {
+        self->first_pts = self->seek_index->first_pts;
+        if (self->seek_index->vfr)
+            mlt_properties_set_int(properties, "meta.media.variable_frame_rate", 1);
+    }
+    pthread_mutex_unlock(&self->packets_mutex);
+}
+
+/** Seek to the keyframe at or before a timestamp of the video stream using the seek index.
+ *
+ * \return true if the index was used
+ */
+
+static int seek_index_seek(producer_avformat self, AVFormatContext *context, int64_t timestamp)
+{
+    // seek_index_worker() publishes the index from its own thread. Once set, it stays until close.
+    pthread_mutex_lock(&self->packets_mutex);
+    seek_index_t *index = self->seek_index;
+    pthread_mutex_unlock(&self->packets_mutex);
+
+    if (!index || index->stream != self->video_index)
+        return 0;
+    seek_index_entry *entry = seek_index_find(index, timestamp);
+    if (!entry)
+        return 0;
+
+    AVStream *stream = context->streams[self->video_index];
+#if LIBAVFORMAT_VERSION_INT >= ((58 << 16) + (78 << 8) + 100)
+    int has_index = avformat_index_get_entries_count(stream) > 0;
+#else
+    int has_index = stream->nb_index_entries > 0;
+#endif
+    // Demuxers with their own index seek fine by time, others get the exact byte offset.
+    if (entry->pos >= 0 && !(context->iformat->flags & AVFMT_NO_BYTE_SEEK)
+        && ((context->iformat->flags & AVFMT_TS_DISCONT) || !has_index)) {
+        mlt_log_debug(MLT_PRODUCER_SERVICE(self->parent),
+                      "seek index pts %" PRId64 " pos %" PRId64 "\n",
+                      entry->pts,
+                      entry->pos);
+        return av_seek_frame(context, self->video_index, entry->pos, AVSEEK_FLAG_BYTE) >= 0;
+    }
+    return av_seek_frame(context, self->video_index, entry->pts, AVSEEK_FLAG_BACKWARD) >= 0;
+}
 
+/** Initialize the mutexes once.
+*/
+
+static void init_mutexes(producer_avformat self)
+{
     if (!self->is_mutex_init) {
         pthread_mutexattr_t attr;
         pthread_mutexattr_init(&attr);
@@ -1139,6 +1426,19 @@ static int producer_open(
         pthread_mutex_init(&self->close_mutex, &attr);
         self->is_mutex_init = 1;
     }
+}
+
+/** Open the file.
+*/
+
+static int producer_open(
+    producer_avformat self, mlt_profile profile, const char *URL, int take_lock, int test_open)
+{
+    // Return an error code (0 == no error)
+    int error = 0;
+    mlt_properties properties = MLT_PRODUCER_PROPERTIES(self->parent);
+
+    init_mutexes(self);
 
     // Lock the service
     if (take_lock) {
@@ -1180,6 +1480,8 @@ static int producer_open(
             // Initialize position info
             self->first_pts = AV_NOPTS_VALUE;
             self->last_position = POSITION_INITIAL;
+            if (!test_open)
+                seek_index_open(self, filename, format);
 
             AVDictionaryEntry *hwaccel = av_dict_get(params, "hwaccel", NULL, 0);
             AVDictionaryEntry *hwaccel_device = av_dict_get(params, "hwaccel_device", NULL, 0);
@@ -1296,6 +1598,8 @@ static void prepare_reopen(producer_avformat self)
 {
     mlt_service_lock(MLT_PRODUCER_SERVICE(self->parent));
     pthread_mutex_lock(&self->audio_mutex);
+    // Hold off the lookahead thread while the video decoder is freed
+    pthread_mutex_lock(&self->video_mutex);
     pthread_mutex_lock(&self->open_mutex);
 
     int i;
@@ -1339,6 +1643,7 @@ static void prepare_reopen(producer_avformat self)
         mlt_deque_close(self->vpackets);
         self->vpackets = NULL;
     }
+    pthread_mutex_unlock(&self->video_mutex);
     pthread_mutex_unlock(&self->audio_mutex);
     mlt_service_unlock(MLT_PRODUCER_SERVICE(self->parent));
 }
@@ -1497,7 +1802,8 @@ static int seek_video(producer_avformat self,
 
             // Seek to the timestamp
             self->video_codec->skip_loop_filter = AVDISCARD_NONREF;
-            av_seek_frame(context, self->video_index, timestamp, AVSEEK_FLAG_BACKWARD);
+            if (!seek_index_seek(self, context, timestamp))
+                av_seek_frame(context, self->video_index, timestamp, AVSEEK_FLAG_BACKWARD);
 
             // flush any pictures still in decode buffer
             avcodec_flush_buffers(self->video_codec);
@@ -1657,7 +1963,9 @@ static void property_changed(mlt_service owner, producer_avformat self, char *na
 {
     if (self && name && self->parent) {
         mlt_properties properties = MLT_PRODUCER_PROPERTIES(self->parent);
+        // The lookahead thread decodes holding video_mutex, so take it to change the decoder.
         if (!strcmp("color_range", name)) {
+            pthread_mutex_lock(&self->video_mutex);
             if (self->video_codec
                 && !av_opt_set(self->video_codec,
                                name,
@@ -1668,22 +1976,29 @@ static void property_changed(mlt_service owner, producer_avformat self, char *na
                     self->reset_image_cache = 1;
                 }
             }
+            pthread_mutex_unlock(&self->video_mutex);
         } else if (!strcmp("force_full_range", name) || !strcmp("set.force_full_luma", name)) {
+            pthread_mutex_lock(&self->video_mutex);
             if (self->full_range != mlt_properties_get_int(properties, name)) {
                 self->full_range = mlt_properties_get_int(properties, name);
                 self->reset_image_cache = 1;
             }
+            pthread_mutex_unlock(&self->video_mutex);
         } else if (!strcmp("force_progressive", name) || !strcmp("force_tff", name)) {
+            pthread_mutex_lock(&self->video_mutex);
             self->reset_image_cache = 1;
+            pthread_mutex_unlock(&self->video_mutex);
         } else if (!strcmp("autorotate", name)) {
             self->autorotate = mlt_properties_get_int(properties, name);
             if (self->video_index != -1) {
                 mlt_service_lock(MLT_PRODUCER_SERVICE(self->parent));
+                pthread_mutex_lock(&self->video_mutex);
                 avfilter_graph_free(&self->vfilter_graph);
                 self->vfilter_out = NULL;
                 self->rotation = 0.0;
                 setup_filters(self);
                 self->reset_image_cache = 1;
+                pthread_mutex_unlock(&self->video_mutex);
                 mlt_service_unlock(MLT_PRODUCER_SERVICE(self->parent));
             }
         } else if (!strcmp("video_index", name) || !strcmp("vstream", name)) {
@@ -1694,6 +2009,25 @@ static void property_changed(mlt_service owner, producer_avformat self, char *na
     }
 }
 
+static void properties_changed(mlt_service owner, producer_avformat self, mlt_event_data event_data)
+{
+    mlt_properties names = mlt_event_data_to_object(event_data);
+    if (self && names && self->parent) {
+        int count = mlt_properties_count(names);
+        // Hold off the lookahead thread once for the whole batch. The filters are rebuilt last
+        // because that takes the service lock, which must not be taken after video_mutex.
+        pthread_mutex_lock(&self->video_mutex);
+        for (int i = 0; i < count; i++) {
+            char *name = mlt_properties_get_name(names, i);
+            if (strcmp("autorotate", name))
+                property_changed(owner, self, name);
+        }
+        pthread_mutex_unlock(&self->video_mutex);
+        if (mlt_properties_get(names, "autorotate"))
+            property_changed(owner, self, "autorotate");
+    }
+}
+
 struct sliced_pix_fmt_conv_t
 {
     int width, height, slice_w;
@@ -1703,6 +2037,7 @@ struct sliced_pix_fmt_conv_t
     enum AVPixelFormat src_format, dst_format;
     const AVPixFmtDescriptor *src_desc, *dst_desc;
     int flags, src_colorspace, dst_colorspace, src_full_range, dst_full_range;
+    mlt_properties owner;
 };
 
 static int sliced_h_pix_fmt_conv_proc(int id, int idx, int jobs, void *cookie)
@@ -1710,7 +2045,7 @@ static int sliced_h_pix_fmt_conv_proc(int id, int idx, int jobs, void *cookie)
     uint8_t *out[4];
     const uint8_t *in[4];
     int in_stride[4], out_stride[4];
-    int src_v_chr_pos = -513, dst_v_chr_pos = -513, ret, i, slice_x, slice_w, h, mul, field, slices,
+    int src_v_chr_pos = -513, dst_v_chr_pos = -513, i, slice_x, slice_w, h, mul, field, slices,
         interlaced = 0;
 
     struct SwsContext *sws;
@@ -1756,32 +2091,25 @@ static int sliced_h_pix_fmt_conv_proc(int id, int idx, int jobs, void *cookie)
     if (slice_w <= 0)
         return 0;
 
-    sws = sws_alloc_context();
-
-    av_opt_set_int(sws, "srcw", slice_w, 0);
-    av_opt_set_int(sws, "srch", h, 0);
-    av_opt_set_int(sws, "src_format", ctx->src_format, 0);
-    av_opt_set_int(sws, "dstw", slice_w, 0);
-    av_opt_set_int(sws, "dsth", h, 0);
-    av_opt_set_int(sws, "dst_format", ctx->dst_format, 0);
-    av_opt_set_int(sws, "sws_flags", ctx->flags, 0);
-
-    av_opt_set_int(sws, "src_h_chr_pos", -513, 0);
-    av_opt_set_int(sws, "src_v_chr_pos", src_v_chr_pos, 0);
-    av_opt_set_int(sws, "dst_h_chr_pos", -513, 0);
-    av_opt_set_int(sws, "dst_v_chr_pos", dst_v_chr_pos, 0);
-
-    if ((ret = sws_init_context(sws, NULL, NULL)) < 0) {
-        mlt_log_error(NULL, "%s:%d: sws_init_context failed, ret=%d\n", __FUNCTION__, __LINE__, ret);
-        sws_freeContext(sws);
+    // Every slice but the last has the same width, so the slices share cached contexts.
+    mlt_sws_key key = {
+        .src_width = slice_w,
+        .src_height = h,
+        .src_format = ctx->src_format,
+        .dst_width = slice_w,
+        .dst_height = h,
+        .dst_format = ctx->dst_format,
+        .flags = ctx->flags,
+        .src_v_chr_pos = src_v_chr_pos,
+        .dst_v_chr_pos = dst_v_chr_pos,
+        .src_colorspace = ctx->src_colorspace,
+        .dst_colorspace = ctx->dst_colorspace,
+        .src_full_range = ctx->src_full_range,
+        .dst_full_range = ctx->dst_full_range,
+    };
+    sws = mlt_sws_get_context(ctx->owner, &key, NULL);
+    if (!sws)
         return 0;
-    }
-
-    mlt_set_luma_transfer(sws,
-                          ctx->src_colorspace,
-                          ctx->dst_colorspace,
-                          ctx->src_full_range,
-                          ctx->dst_full_range);
 
 #define PIX_DESC_BPP(DESC) (DESC.step)
 
@@ -1808,7 +2136,7 @@ static int sliced_h_pix_fmt_conv_proc(int id, int idx, int jobs, void *cookie)
 
     sws_scale(sws, in, in_stride, 0, h, out, out_stride);
 
-    sws_freeContext(sws);
+    mlt_sws_release_context(ctx->owner, sws);
 
     return 0;
 }
@@ -1825,18 +2153,31 @@ static int convert_image_yuvp(producer_avformat self,
                               int dst_full_range)
 {
     int result = self->yuv_colorspace;
-    int flags = mlt_get_sws_flags(width, height, src_pix_fmt, width, height, dst_pix_fmt);
-    struct SwsContext *context = sws_getContext(
-        width, height, src_pix_fmt, width, height, dst_pix_fmt, flags, NULL, NULL, NULL);
+    mlt_properties owner = MLT_PRODUCER_PROPERTIES(self->parent);
+    mlt_sws_key key = {
+        .src_width = width,
+        .src_height = height,
+        .src_format = src_pix_fmt,
+        .dst_width = width,
+        .dst_height = height,
+        .dst_format = dst_pix_fmt,
+        .flags = mlt_get_sws_flags(width, height, src_pix_fmt, width, height, dst_pix_fmt),
+        .src_v_chr_pos = -513,
+        .dst_v_chr_pos = -513,
+        .src_colorspace = self->yuv_colorspace,
+        .dst_colorspace = profile->colorspace,
+        .src_full_range = self->full_range,
+        .dst_full_range = dst_full_range,
+    };
+    int transfer_error = 0;
+    struct SwsContext *context = mlt_sws_get_context(owner, &key, &transfer_error);
     uint8_t *out_data[4];
     int out_stride[4];
 
+    if (!context)
+        return result;
     mlt_image_format_planes(format, width, height, buffer, out_data, out_stride);
-    if (!mlt_set_luma_transfer(context,
-                               self->yuv_colorspace,
-                               profile->colorspace,
-                               self->full_range,
-                               dst_full_range))
+    if (!transfer_error)
         result = profile->colorspace;
     sws_scale(context,
               (const uint8_t *const *) frame->data,
@@ -1845,7 +2186,7 @@ static int convert_image_yuvp(producer_avformat self,
               height,
               out_data,
               out_stride);
-    sws_freeContext(context);
+    mlt_sws_release_context(owner, context);
 
     return result;
 }
@@ -1861,27 +2202,35 @@ static void convert_image_rgb(producer_avformat self,
                               int dst_pix_fmt,
                               int dst_full_range)
 {
-    int flags = mlt_get_sws_flags(width, height, src_pix_fmt, width, height, dst_pix_fmt);
+    mlt_properties owner = MLT_PRODUCER_PROPERTIES(self->parent);
     uint8_t *out_data[4];
     int out_stride[4];
+    // libswscale wants the RGB colorspace to be SWS_CS_DEFAULT, which is = SWS_CS_ITU601.
+    mlt_sws_key key = {
+        .src_width = width,
+        .src_height = height,
+        .src_format = src_pix_fmt,
+        .dst_width = width,
+        .dst_height = height,
+        .dst_format = dst_pix_fmt,
+        .flags = mlt_get_sws_flags(width, height, src_pix_fmt, width, height, dst_pix_fmt),
+        .src_v_chr_pos = -513,
+        .dst_v_chr_pos = -513,
+        .src_colorspace = self->yuv_colorspace,
+        .dst_colorspace = 601,
+        .src_full_range = self->full_range,
+        .dst_full_range = 1,
+    };
 
     if (src_pix_fmt == AV_PIX_FMT_YUV420P && frame->interlaced_frame) {
         // Perform field-aware conversion for 4:2:0
         int field_height = height / 2;
         const uint8_t *in_data[4];
         int in_stride[4];
-        struct SwsContext *context = sws_getContext(width,
-                                                    field_height,
-                                                    src_pix_fmt,
-                                                    width,
-                                                    field_height,
-                                                    dst_pix_fmt,
-                                                    flags,
-                                                    NULL,
-                                                    NULL,
-                                                    NULL);
-        // libswscale wants the RGB colorspace to be SWS_CS_DEFAULT, which is = SWS_CS_ITU601.
-        mlt_set_luma_transfer(context, self->yuv_colorspace, 601, self->full_range, 1);
+        key.src_height = key.dst_height = field_height;
+        struct SwsContext *context = mlt_sws_get_context(owner, &key, NULL);
+        if (!context)
+            return;
         av_image_fill_arrays(out_data, out_stride, buffer, dst_pix_fmt, width, height, IMAGE_ALIGN);
         // Copy the input frame arrays
         for (int i = 0; i < 4; i++) {
@@ -1902,13 +2251,12 @@ static void convert_image_rgb(producer_avformat self,
         }
         // Convert the second field
         sws_scale(context, in_data, in_stride, 0, field_height, out_data, out_stride);
-        sws_freeContext(context);
+        mlt_sws_release_context(owner, context);
     } else {
-        struct SwsContext *context = sws_getContext(
-            width, height, src_pix_fmt, width, height, dst_pix_fmt, flags, NULL, NULL, NULL);
+        struct SwsContext *context = mlt_sws_get_context(owner, &key, NULL);
+        if (!context)
+            return;
         av_image_fill_arrays(out_data, out_stride, buffer, dst_pix_fmt, width, height, IMAGE_ALIGN);
-        // libswscale wants the RGB colorspace to be SWS_CS_DEFAULT, which is = SWS_CS_ITU601.
-        mlt_set_luma_transfer(context, self->yuv_colorspace, 601, self->full_range, 1);
         sws_scale(context,
                   (const uint8_t *const *) frame->data,
                   frame->linesize,
@@ -1916,7 +2264,7 @@ static void convert_image_rgb(producer_avformat self,
                   height,
                   out_data,
                   out_stride);
-        sws_freeContext(context);
+        mlt_sws_release_context(owner, context);
     }
 }
 
@@ -2025,6 +2373,7 @@ static int convert_image(producer_avformat self,
             .dst_colorspace = profile->colorspace,
             .src_full_range = self->full_range,
             .dst_full_range = dst_full_range,
+            .owner = MLT_PRODUCER_PROPERTIES(self->parent),
         };
         ctx.src_format = (self->full_range && src_pix_fmt == AV_PIX_FMT_YUV422P)
                              ? AV_PIX_FMT_YUVJ422P
@@ -2199,6 +2548,130 @@ static void init_cache(mlt_properties properties, mlt_cache *cache)
         mlt_cache_set_size(*cache, cache_size);
 }
 
+static void init_gop_cache(producer_avformat self, mlt_properties properties)
+{
+    // Reverse playback keeps a GOP worth of frames, lookahead keeps the frames ahead
+    int size = mlt_properties_exists(properties, "gop_cache")
+                   ? mlt_properties_get_int(properties, "gop_cache")
+                   : GOP_CACHE_SIZE;
+    size = MAX(size, mlt_properties_get_int(properties, "lookahead"));
+    if (size > 0 && !mlt_properties_get_int(properties, "noimagecache")) {
+        self->gop_cache = mlt_cache_init();
+        // Leave room for the frames being handed out while the cache refills
+        if (self->gop_cache) {
+            mlt_cache_set_size(self->gop_cache, size + 2);
+            // Large images fill the cache long before it reaches its size
+            mlt_cache_set_max_bytes(self->gop_cache,
+                                    mlt_properties_exists(properties, "gop_cache_bytes")
+                                        ? mlt_properties_get_int64(properties, "gop_cache_bytes")
+                                        : GOP_CACHE_BYTES);
+        }
+    }
+}
+
+/** Set a cached image on the frame if the cache has it in the requested format.
+ *
+ * \return true if the image was found in the cache
+ */
+
+static int get_cached_image(producer_avformat self,
+                            mlt_cache cache,
+                            mlt_frame frame,
+                            mlt_position position,
+                            uint8_t **buffer,
+                            mlt_image_format *format,
+                            int *width,
+                            int *height,
+                            int dst_full_range)
+{
+    mlt_frame original = cache ? mlt_cache_get_frame(cache, position) : NULL;
+    if (!original)
+        return 0;
+
+    mlt_properties orig_props = MLT_FRAME_PROPERTIES(original);
+    if ((*format != mlt_image_none && *format != mlt_properties_get_int(orig_props, "format"))
+        || mlt_properties_get_int(orig_props, "full_range") != dst_full_range) {
+        mlt_frame_close(original);
+        return 0;
+    }
+
+    mlt_properties frame_properties = MLT_FRAME_PROPERTIES(frame);
+    int size = 0;
+
+    *buffer = mlt_frame_get_alpha_size(original, &size);
+    if (*buffer)
+        mlt_frame_set_alpha(frame, *buffer, size, NULL);
+    *buffer = mlt_properties_get_data(orig_props, "image", &size);
+    mlt_frame_set_image(frame, *buffer, size, NULL);
+    mlt_properties_set_data(frame_properties,
+                            "avformat.image_cache",
+                            original,
+                            0,
+                            (mlt_destructor) mlt_frame_close,
+                            NULL);
+    *format = mlt_properties_get_int(orig_props, "format");
+    set_image_size(self, width, height);
+    mlt_properties_pass_property(frame_properties, orig_props, "colorspace");
+    mlt_properties_set_int(frame_properties, "full_range", dst_full_range);
+    return 1;
+}
+
+/** Convert the current decoded picture into the GOP cache without delivering it.
+*/
+
+static void cache_gop_frame(producer_avformat self,
+                            AVCodecParameters *codec_params,
+                            mlt_position position,
+                            mlt_image_format format,
+                            int width,
+                            int height,
+                            int dst_full_range)
+{
+    mlt_frame frame = mlt_frame_init(MLT_PRODUCER_SERVICE(self->parent));
+    uint8_t *buffer = NULL;
+    uint8_t *alpha = NULL;
+
+    if (!frame)
+        return;
+    if (allocate_buffer(frame, codec_params, &buffer, format, width, height)) {
+        mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+        int yuv_colorspace = convert_image(self,
+                                           self->video_frame,
+                                           buffer,
+                                           self->video_frame->format,
+                                           &format,
+                                           width,
+                                           height,
+                                           &alpha,
+                                           dst_full_range);
+        if (alpha)
+            mlt_frame_set_alpha(frame, alpha, width * height, mlt_pool_release);
+        mlt_properties_set_int(properties, "format", format);
+        mlt_properties_set_int(properties, "width", width);
+        mlt_properties_set_int(properties, "height", height);
+        mlt_properties_set_int(properties, "colorspace", yuv_colorspace);
+        mlt_properties_set_int(properties, "full_range", dst_full_range);
+        mlt_properties_set_position(properties, "original_position", position);
+        mlt_cache_put_frame_image(self->gop_cache, frame);
+    }
+    mlt_frame_close(frame);
+}
+
+/** Ask the lookahead thread to decode a range of positions.
+*/
+
+static void lookahead_request(producer_avformat self, mlt_position position, int count)
+{
+    pthread_mutex_lock(&self->lookahead_mutex);
+    count = MIN(count, self->lookahead_size);
+    // Keep going from where the thread is if it is already inside the new range
+    if (self->lookahead_next < position || self->lookahead_next > self->lookahead_end + 1)
+        self->lookahead_next = position;
+    self->lookahead_end = position + count - 1;
+    pthread_cond_signal(&self->lookahead_cond);
+    pthread_mutex_unlock(&self->lookahead_mutex);
+}
+
 /** Get an image from a frame.
 */
 
@@ -2228,6 +2701,10 @@ static int producer_get_image(mlt_frame frame,
     int image_size = 0;
     const char *dst_color_range = mlt_properties_get(frame_properties, "consumer.color_range");
     int dst_full_range = mlt_image_full_range(dst_color_range);
+    // The lookahead thread already holds video_mutex but not the service lock
+    int is_lookahead = mlt_properties_get_int(frame_properties, "_avformat_lookahead");
+    int lookahead = mlt_properties_get_int(properties, "lookahead");
+    double speed = mlt_producer_get_speed(producer);
 
     // if 10-bit libswscale only changes range when scaling, not simple pix_fmt conversion
     const struct AVPixFmtDescriptor *pix_desc = av_pix_fmt_desc_get(self->video_codec->pix_fmt);
@@ -2240,9 +2717,18 @@ static int producer_get_image(mlt_frame frame,
             // Otherwise, convert via RGB
             *format = mlt_image_rgb;
     }
-
-    mlt_service_lock(MLT_PRODUCER_SERVICE(producer));
+    mlt_image_format requested_format = *format;
+    int gop_size = 0;
+
+    // The lookahead thread backs off while image_waiting is set, so that it delays this by
+    // at most the frame it is decoding.
+    if (!is_lookahead) {
+        atomic_fetch_add(&self->image_waiting, 1);
+        mlt_service_lock(MLT_PRODUCER_SERVICE(producer));
+    }
     pthread_mutex_lock(&self->video_mutex);
+    if (!is_lookahead)
+        atomic_fetch_sub(&self->image_waiting, 1);
     mlt_log_timings_begin();
 
 #ifdef AVFILTER
@@ -2258,6 +2744,8 @@ static int producer_get_image(mlt_frame frame,
         self->reset_image_cache = 0;
         mlt_cache_close(self->image_cache);
         self->image_cache = NULL;
+        mlt_cache_close(self->gop_cache);
+        self->gop_cache = NULL;
         av_frame_free(&self->video_frame);
     }
 
@@ -2279,34 +2767,29 @@ static int producer_get_image(mlt_frame frame,
     if (!self->image_cache) {
         init_cache(properties, &self->image_cache);
     }
-    if (self->image_cache) {
-        mlt_frame original = mlt_cache_get_frame(self->image_cache, position);
-        if (original
-            && (*format == mlt_image_none
-                || *format == mlt_properties_get_int(MLT_FRAME_PROPERTIES(original), "format"))) {
-            mlt_properties orig_props = MLT_FRAME_PROPERTIES(original);
-            int size = 0;
-
-            *buffer = mlt_frame_get_alpha_size(original, &size);
-            if (*buffer)
-                mlt_frame_set_alpha(frame, *buffer, size, NULL);
-            *buffer = mlt_properties_get_data(orig_props, "image", &size);
-            mlt_frame_set_image(frame, *buffer, size, NULL);
-            mlt_properties_set_data(frame_properties,
-                                    "avformat.image_cache",
-                                    original,
-                                    0,
-                                    (mlt_destructor) mlt_frame_close,
-                                    NULL);
-            *format = mlt_properties_get_int(orig_props, "format");
-            set_image_size(self, width, height);
-            mlt_properties_pass_property(frame_properties, orig_props, "colorspace");
-            mlt_properties_set_int(frame_properties, "full_range", dst_full_range);
-            got_picture = 1;
-            goto exit_get_image;
-        } else {
-            mlt_frame_close(original);
-        }
+    if (!self->gop_cache && (speed < 0.0 || lookahead > 0) && !is_album_art(self)) {
+        init_gop_cache(self, properties);
+    }
+    if (get_cached_image(self,
+                         self->image_cache,
+                         frame,
+                         position,
+                         buffer,
+                         format,
+                         width,
+                         height,
+                         dst_full_range)
+        || get_cached_image(self,
+                            self->gop_cache,
+                            frame,
+                            position,
+                            buffer,
+                            format,
+                            width,
+                            height,
+                            dst_full_range)) {
+        got_picture = 1;
+        goto exit_get_image;
     }
     // Cache miss
 
@@ -2323,8 +2806,22 @@ static int producer_get_image(mlt_frame frame,
 
     double delay = mlt_properties_get_double(properties, "video_delay");
 
+    // When playing backwards keep the frames decoded on the way to the requested one.
+    int gop_window = 0;
+    if (speed < 0.0 && self->gop_cache && !is_lookahead
+        && fabs(source_fps - mlt_producer_get_fps(producer)) < 0.0001) {
+        int64_t max_bytes = mlt_cache_get_max_bytes(self->gop_cache);
+        int frame_bytes = mlt_image_format_size(*format,
+                                                self->video_codec->width,
+                                                self->video_codec->height,
+                                                NULL);
+        gop_window = mlt_cache_get_size(self->gop_cache) - 2;
+        // Do not convert more frames than the cache can hold
+        if (max_bytes > 0 && frame_bytes > 0)
+            gop_window = MIN(gop_window, max_bytes / frame_bytes);
+    }
+
     // Seek if necessary
-    double speed = mlt_producer_get_speed(producer);
     int preseek = must_decode && self->video_codec->has_b_frames && speed >= 0.0 && speed <= 1.0;
     int paused = seek_video(self, position, req_position, preseek);
 
@@ -2366,6 +2863,7 @@ static int producer_get_image(mlt_frame frame,
     } else {
         int64_t int_position = 0;
         int decode_errors = 0;
+        int cache_only = 0;
 
         // Construct an AVFrame for YUV422 conversion
         if (!self->video_frame)
@@ -2545,9 +3043,10 @@ static int producer_get_image(mlt_frame frame,
                                                   + 0.5);
                     }
 
-                    if (int_position < req_position)
+                    if (int_position < req_position) {
                         got_picture = 0;
-                    else if (int_position >= req_position)
+                        cache_only = req_position - int_position <= gop_window;
+                    } else if (int_position >= req_position)
                         self->video_codec->skip_loop_filter = AVDISCARD_NONE;
                 } else if (!self->pkt.data) // draining decoder with null packets
                 {
@@ -2562,7 +3061,7 @@ static int producer_get_image(mlt_frame frame,
             }
 
             // Now handle the picture if we have one
-            if (got_picture) {
+            if (got_picture || cache_only) {
                 // Detect and correct scan type
                 if (mlt_properties_get(properties, "force_progressive")) {
                     self->progressive = !!mlt_properties_get_int(properties, "force_progressive");
@@ -2587,7 +3086,10 @@ static int producer_get_image(mlt_frame frame,
                 if ((self->autorotate || mlt_properties_get(properties, "filtergraph"))
                     && !setup_filters(self) && self->vfilter_graph) {
                     int ret = av_buffersrc_add_frame(self->vfilter_in, self->video_frame);
-                    if (ret < 0) {
+                    if (ret < 0 && cache_only) {
+                        cache_only = 0;
+                        continue;
+                    } else if (ret < 0) {
                         got_picture = 0;
                         break;
                     }
@@ -2601,8 +3103,21 @@ static int producer_get_image(mlt_frame frame,
                 }
 #endif
                 set_image_size(self, width, height);
-                if ((image_size
-                     = allocate_buffer(frame, codec_params, buffer, *format, *width, *height))) {
+                if (cache_only) {
+                    cache_gop_frame(self,
+                                    codec_params,
+                                    position - (req_position - int_position),
+                                    *format,
+                                    *width,
+                                    *height,
+                                    dst_full_range);
+                    cache_only = 0;
+                } else if ((image_size = allocate_buffer(frame,
+                                                         codec_params,
+                                                         buffer,
+                                                         *format,
+                                                         *width,
+                                                         *height))) {
                     int yuv_colorspace;
                     yuv_colorspace = convert_image(self,
                                                    self->video_frame,
@@ -2635,7 +3150,10 @@ static int producer_get_image(mlt_frame frame,
     if (image_size > 0) {
         mlt_properties_set_int(frame_properties, "format", *format);
         // Cache the image for rapid repeated access.
-        if (self->image_cache) {
+        if (is_lookahead) {
+            if (self->gop_cache)
+                mlt_cache_put_frame_image(self->gop_cache, frame);
+        } else if (self->image_cache) {
             if (is_album_art(self)) {
                 mlt_position original_pos = mlt_frame_original_position(frame);
                 mlt_properties_set_position(frame_properties, "original_position", 0);
@@ -2678,8 +3196,27 @@ static int producer_get_image(mlt_frame frame,
     self->video_expected = position + 1;
 
 exit_get_image:
+    // The lookahead thread may replace the GOP cache once video_mutex is released
+    gop_size = self->gop_cache ? mlt_cache_get_size(self->gop_cache) : 0;
     pthread_mutex_unlock(&self->video_mutex);
 
+    if (is_lookahead) {
+        mlt_log_timings_end(NULL, __FUNCTION__);
+        return !got_picture;
+    }
+
+    // Decode the next frames in the background while playing forward.
+    int decode_ahead = lookahead > 0 && got_picture && speed == 1.0 && gop_size > 2
+                       && self->video_seekable;
+    if (decode_ahead && !self->is_lookahead_init) {
+        pthread_mutex_init(&self->lookahead_mutex, NULL);
+        pthread_cond_init(&self->lookahead_cond, NULL);
+        self->lookahead_next = position + 1;
+        self->lookahead_end = position;
+        self->is_lookahead_init
+            = !pthread_create(&self->lookahead_thread, NULL, lookahead_worker, self);
+    }
+
     mlt_properties_set_int(frame_properties, "progressive", self->progressive);
     mlt_properties_set_int(frame_properties, "top_field_first", self->top_field_first);
 
@@ -2689,11 +3226,86 @@ exit_get_image:
     mlt_properties_set_int(properties, "_probe_complete", 1);
     mlt_service_unlock(MLT_PRODUCER_SERVICE(producer));
 
+    // Wake the lookahead thread only now that it can take video_mutex.
+    if (self->is_lookahead_init) {
+        if (decode_ahead) {
+            pthread_mutex_lock(&self->lookahead_mutex);
+            self->lookahead_format = requested_format;
+            self->lookahead_full_range = dst_full_range;
+            self->lookahead_size = gop_size - 2;
+            pthread_mutex_unlock(&self->lookahead_mutex);
+            lookahead_request(self, position + 1, lookahead);
+        } else {
+            // It may have been waiting for either lock. Stop it decoding ahead unless
+            // playing forward at normal speed.
+            pthread_mutex_lock(&self->lookahead_mutex);
+            if (speed != 1.0)
+                self->lookahead_end = self->lookahead_next - 1;
+            pthread_cond_signal(&self->lookahead_cond);
+            pthread_mutex_unlock(&self->lookahead_mutex);
+        }
+    }
+
     mlt_log_timings_end(NULL, __FUNCTION__);
 
     return !got_picture;
 }
 
+/** Decode frames ahead of the consumer into the GOP cache.
+ *
+ * This decodes under video_mutex like any other get_image call, but does not hold the service
+ * lock, so the consumer can get frames meanwhile. It only takes video_mutex with trylock, so
+ * closing the producer can always stop it, and not while get_image waits for it.
+ */
+
+static void *lookahead_worker(void *param)
+{
+    producer_avformat self = param;
+
+    pthread_mutex_lock(&self->lookahead_mutex);
+    while (!self->lookahead_stop) {
+        if (self->lookahead_next > self->lookahead_end || atomic_load(&self->image_waiting)
+            || pthread_mutex_trylock(&self->video_mutex)) {
+            pthread_cond_wait(&self->lookahead_cond, &self->lookahead_mutex);
+            continue;
+        }
+        mlt_position position = self->lookahead_next++;
+        mlt_image_format format = self->lookahead_format;
+        int full_range = self->lookahead_full_range;
+        pthread_mutex_unlock(&self->lookahead_mutex);
+
+        mlt_frame frame = mlt_frame_init(MLT_PRODUCER_SERVICE(self->parent));
+        if (frame) {
+            mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+            uint8_t *image = NULL;
+            int width = 0;
+            int height = 0;
+
+            mlt_properties_set_position(properties, "original_position", position);
+            mlt_properties_set(properties, "consumer.color_range", full_range ? "full" : "mpeg");
+            mlt_properties_set_int(properties, "_avformat_lookahead", 1);
+            mlt_frame_push_service(frame, self);
+            producer_get_image(frame, &image, &format, &width, &height, 0);
+            mlt_frame_close(frame);
+        }
+        pthread_mutex_unlock(&self->video_mutex);
+        pthread_mutex_lock(&self->lookahead_mutex);
+    }
+    pthread_mutex_unlock(&self->lookahead_mutex);
+    return NULL;
+}
+
+/** Listener for the producer-prefetch event to direct the lookahead thread.
+*/
+
+static void on_prefetch(mlt_properties owner, producer_avformat self, mlt_event_data event_data)
+{
+    (void) owner; // unused
+    mlt_event_data_prefetch *prefetch = mlt_event_data_to_object(event_data);
+    if (prefetch && self->is_lookahead_init)
+        lookahead_request(self, prefetch->position, prefetch->count);
+}
+
 /** Process properties as AVOptions and apply to AV context obj
 */
 
@@ -2988,12 +3600,16 @@ static void producer_set_up_video(producer_avformat self, mlt_frame frame)
                     ? mlt_properties_get_int(properties, "vstream")
                     : mlt_properties_get_int(properties, "video_index");
 
-    int unlock_needed = 0;
+    // The lookahead thread may be decoding, so hold it off while the decoder changes.
+    int unlock_needed = self->is_lookahead_init;
+    if (unlock_needed)
+        pthread_mutex_lock(&self->video_mutex);
 
     // Reopen the file if necessary
     if (!context && index > -1) {
+        if (!unlock_needed)
+            pthread_mutex_lock(&self->video_mutex);
         unlock_needed = 1;
-        pthread_mutex_lock(&self->video_mutex);
         producer_open(self,
                       mlt_service_profile(MLT_PRODUCER_SERVICE(producer)),
                       mlt_properties_get(properties, "resource"),
@@ -3835,6 +4451,10 @@ static void producer_set_up_audio(producer_avformat self, mlt_frame frame)
     // Update the audio properties if the index changed
     if (context && self->audio_index > -1 && index != self->audio_index) {
         self->audio_index = index;
+        // The lookahead thread may be reading the video streams that set_up_discard() changes
+        int unlock_needed = self->is_lookahead_init;
+        if (unlock_needed)
+            pthread_mutex_lock(&self->video_mutex);
         pthread_mutex_lock(&self->open_mutex);
         unsigned i = 0;
         int index_max = FFMIN(MAX_AUDIO_STREAMS, context->nb_streams);
@@ -3845,6 +4465,8 @@ static void producer_set_up_audio(producer_avformat self, mlt_frame frame)
         mlt_cache_close(self->audio_cache);
         self->audio_cache = NULL;
         pthread_mutex_unlock(&self->open_mutex);
+        if (unlock_needed)
+            pthread_mutex_unlock(&self->video_mutex);
     }
 
     // Get the codec(s)
@@ -3892,6 +4514,7 @@ static int producer_get_frame(mlt_producer producer, mlt_frame_ptr frame, int in
     if (!self) {
         self = calloc(1, sizeof(struct producer_avformat_s));
         self->parent = producer;
+        init_mutexes(self);
         mlt_service_cache_put(service,
                               "producer_avformat",
                               self,
@@ -4011,6 +4634,21 @@ static void producer_avformat_close(producer_avformat self)
         mlt_events_disconnect(MLT_PRODUCER_PROPERTIES(self->parent), self);
     pthread_mutex_unlock(&self->close_mutex);
 
+    // Stop the lookahead thread before it can touch anything below
+    if (self->is_lookahead_init) {
+        pthread_mutex_lock(&self->lookahead_mutex);
+        self->lookahead_stop = 1;
+        pthread_cond_signal(&self->lookahead_cond);
+        pthread_mutex_unlock(&self->lookahead_mutex);
+        pthread_join(self->lookahead_thread, NULL);
+        pthread_cond_destroy(&self->lookahead_cond);
+        pthread_mutex_destroy(&self->lookahead_mutex);
+    }
+    if (self->is_seek_index_init) {
+        self->seek_index_stop = 1;
+        pthread_join(self->seek_index_thread, NULL);
+    }
+
     // Cleanup av contexts
     av_packet_unref(&self->pkt);
     av_frame_free(&self->video_frame);
@@ -4049,7 +4687,9 @@ static void producer_avformat_close(producer_avformat self)
 
     // Cleanup caches.
     mlt_cache_close(self->image_cache);
+    mlt_cache_close(self->gop_cache);
     mlt_cache_close(self->audio_cache);
+    seek_index_close(self->seek_index);
     if (self->last_good_frame)
         mlt_frame_close(self->last_good_frame);
 
@@ -0,0 +1,233 @@
+/*
+ * seek_index.c -- keyframe seek index files
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "seek_index.h"
+
+#include <framework/mlt_log.h>
+#include <framework/mlt_types.h>
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#define SEEK_INDEX_MAGIC "MLTSEEK2"
+#define SEEK_INDEX_HEADER (9) // the number of little-endian 64-bit values after the magic
+
+void seek_index_close(seek_index_t *index)
+{
+    if (index) {
+        free(index->entries);
+        free(index);
+    }
+}
+
+/** Read 64-bit values stored in little-endian byte order.
+ *
+ * \return true if all \p count values were read
+ */
+
+static int seek_index_read(FILE *file, int64_t *values, int count)
+{
+    uint8_t bytes[8];
+
+    for (int i = 0; i < count; i++) {
+        uint64_t value = 0;
+        if (fread(bytes, sizeof(bytes), 1, file) != 1)
+            return 0;
+        for (int j = 7; j >= 0; j--)
+            value = (value << 8) | bytes[j];
+        values[i] = (int64_t) value;
+    }
+    return 1;
+}
+
+/** Write 64-bit values in little-endian byte order.
+ *
+ * \return true if all \p count values were written
+ */
+
+static int seek_index_write(FILE *file, const int64_t *values, int count)
+{
+    uint8_t bytes[8];
+
+    for (int i = 0; i < count; i++) {
+        uint64_t value = (uint64_t) values[i];
+        for (int j = 0; j < 8; j++)
+            bytes[j] = value >> (8 * j);
+        if (fwrite(bytes, sizeof(bytes), 1, file) != 1)
+            return 0;
+    }
+    return 1;
+}
+
+/** Load a seek index if it still matches the media file and video stream.
+*/
+
+seek_index_t *seek_index_load(const char *path,
+                              const struct stat *stat_buff,
+                              int stream,
+                              int time_base_num,
+                              int time_base_den)
+{
+    FILE *file = path ? mlt_fopen(path, "rb") : NULL;
+    seek_index_t *index = NULL;
+    char magic[sizeof(SEEK_INDEX_MAGIC) - 1];
+    int64_t header[SEEK_INDEX_HEADER];
+
+    if (!file)
+        return NULL;
+    if (fread(magic, sizeof(magic), 1, file) == 1
+        && !memcmp(magic, SEEK_INDEX_MAGIC, sizeof(magic))
+        && seek_index_read(file, header, SEEK_INDEX_HEADER) && header[0] == stat_buff->st_size
+        && header[1] == stat_buff->st_mtime && header[2] == stream && header[3] == time_base_num
+        && header[4] == time_base_den && header[8] > 0 && header[8] <= stat_buff->st_size
+        && (index = calloc(1, sizeof(*index)))) {
+        index->size = header[0];
+        index->mtime = header[1];
+        index->stream = header[2];
+        index->time_base_num = time_base_num;
+        index->time_base_den = time_base_den;
+        index->first_pts = header[5];
+        index->vfr = header[6];
+        index->end_pts = header[7];
+        index->count = header[8];
+        index->capacity = index->count;
+        index->entries = malloc(index->count * sizeof(seek_index_entry));
+        int64_t i = 0;
+        int64_t entry[2];
+        while (index->entries && i < index->count && seek_index_read(file, entry, 2)) {
+            index->entries[i].pts = entry[0];
+            index->entries[i++].pos = entry[1];
+        }
+        if (i < index->count) {
+            seek_index_close(index);
+            index = NULL;
+        }
+    }
+    fclose(file);
+    return index;
+}
+
+/** Save a seek index, replacing the file at once.
+ *
+ * \return true if there was an error
+ */
+
+int seek_index_save(seek_index_t *index, const char *path)
+{
+    int64_t header[SEEK_INDEX_HEADER] = {index->size,
+                                         index->mtime,
+                                         index->stream,
+                                         index->time_base_num,
+                                         index->time_base_den,
+                                         index->first_pts,
+                                         index->vfr,
+                                         index->end_pts,
+                                         index->count};
+    static atomic_uint saves = 0;
+    size_t length = strlen(path) + 32;
+    char *temp = malloc(length);
+    FILE *file = NULL;
+    int error = 1;
+
+    if (temp) {
+        // Write to a temporary file so that a reader never sees a partial index. Other processes
+        // and threads may index the same media at once, so each writer needs its own file.
+        snprintf(temp, length, "%s.%d.%u.tmp", path, (int) getpid(), atomic_fetch_add(&saves, 1));
+        file = mlt_fopen(temp, "wb");
+    }
+    if (file) {
+        error = fwrite(SEEK_INDEX_MAGIC, sizeof(SEEK_INDEX_MAGIC) - 1, 1, file) != 1
+                || !seek_index_write(file, header, SEEK_INDEX_HEADER);
+        for (int64_t i = 0; !error && i < index->count; i++) {
+            int64_t entry[2] = {index->entries[i].pts, index->entries[i].pos};
+            error = !seek_index_write(file, entry, 2);
+        }
+        error = fclose(file) || error;
+#ifdef _WIN32
+        if (!error)
+            remove(path);
+#endif
+        if (error || rename(temp, path)) {
+            remove(temp);
+            error = 1;
+        }
+    }
+    if (error)
+        mlt_log_verbose(NULL, "[producer avformat] failed to save seek index %s\n", path);
+    free(temp);
+    return error;
+}
+
+/** Add a keyframe read after the others.
+ *
+ * \return 0 if it was added or repeats the last one, 1 if its pts goes backwards so that the
+ * index must stop, or -1 if there is no memory
+ */
+
+int seek_index_append(seek_index_t *index, int64_t pts, int64_t pos)
+{
+    if (index->count > 0) {
+        int64_t last = index->entries[index->count - 1].pts;
+        if (pts < last)
+            return 1;
+        if (pts == last)
+            return 0;
+    }
+    if (index->count == index->capacity) {
+        int64_t capacity = index->capacity ? index->capacity * 2 : 256;
+        seek_index_entry *entries = realloc(index->entries, capacity * sizeof(seek_index_entry));
+        if (!entries)
+            return -1;
+        index->entries = entries;
+        index->capacity = capacity;
+    }
+    index->entries[index->count].pts = pts;
+    index->entries[index->count++].pos = pos;
+    return 0;
+}
+
+/** Find the keyframe at or before a timestamp.
+ *
+ * \return the entry or NULL if the timestamp is before the first keyframe or past end_pts
+ */
+
+seek_index_entry *seek_index_find(seek_index_t *index, int64_t timestamp)
+{
+    int64_t lo = 0;
+    int64_t hi = index->count;
+
+    if (timestamp > index->end_pts)
+        return NULL;
+    while (lo < hi) {
+        int64_t mid = lo + (hi - lo) / 2;
+        if (index->entries[mid].pts <= timestamp)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo > 0 ? &index->entries[lo - 1] : NULL;
+}
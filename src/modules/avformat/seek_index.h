@@ -0,0 +1,72 @@
+/*
+ * seek_index.h -- keyframe seek index files
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef SEEK_INDEX_H
+#define SEEK_INDEX_H
+
+#include <stdint.h>
+#include <sys/stat.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** A video keyframe in a seek index. */
+typedef struct
+{
+    int64_t pts; // presentation timestamp in the stream time base
+    int64_t pos; // byte offset of the packet or -1 if unknown
+} seek_index_entry;
+
+/** The keyframes of the video stream in file order and what they were made from.
+ *
+ * The index stops at the first keyframe whose pts goes backwards, as happens at the
+ * timestamp discontinuities of MPEG-TS, so that its entries are sorted by pts and do not
+ * mix segments. It covers timestamps up to end_pts only.
+ */
+typedef struct
+{
+    int64_t size;  // size of the media file
+    int64_t mtime; // modification time of the media file
+    int64_t stream;
+    int time_base_num; // the time base of the stream
+    int time_base_den;
+    int64_t first_pts; // AV_NOPTS_VALUE if it was not known yet
+    int64_t vfr;
+    int64_t end_pts; // the last pts the index covers, INT64_MAX for the whole stream
+    int64_t count;
+    int64_t capacity; // the number of entries allocated
+    seek_index_entry *entries;
+} seek_index_t;
+
+void seek_index_close(seek_index_t *index);
+seek_index_t *seek_index_load(const char *path,
+                              const struct stat *stat_buff,
+                              int stream,
+                              int time_base_num,
+                              int time_base_den);
+int seek_index_save(seek_index_t *index, const char *path);
+int seek_index_append(seek_index_t *index, int64_t pts, int64_t pos);
+seek_index_entry *seek_index_find(seek_index_t *index, int64_t timestamp);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SEEK_INDEX_H
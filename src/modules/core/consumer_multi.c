@@ -38,6 +38,20 @@ static void purge(mlt_consumer consumer);
 
 static mlt_properties normalizers = NULL;
 
+/** A bounded queue of frames feeding one nested consumer from its own thread.
+*/
+
+typedef struct
+{
+    mlt_consumer nested;
+    mlt_deque queue;
+    int size;
+    int running;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+} output_queue;
+
 /** Initialise the consumer.
 */
 
@@ -55,6 +69,7 @@ mlt_consumer consumer_multi_init(mlt_profile profile,
         mlt_properties_set(properties, "resource", arg);
         mlt_properties_set_int(properties, "real_time", -1);
         mlt_properties_set_int(properties, "terminate_on_pause", 1);
+        mlt_properties_set_int(properties, "output_buffer", 8);
 
         // Init state
         mlt_properties_set_int(properties, "joined", 1);
@@ -300,6 +315,136 @@ static void foreach_consumer_init(mlt_consumer consumer)
     }
 }
 
+static void *output_thread(void *arg)
+{
+    output_queue *output = arg;
+
+    pthread_mutex_lock(&output->mutex);
+    while (output->running || mlt_deque_count(output->queue) > 0) {
+        if (mlt_deque_count(output->queue) == 0) {
+            pthread_cond_wait(&output->cond, &output->mutex);
+            continue;
+        }
+        mlt_frame frame = mlt_deque_pop_front(output->queue);
+        pthread_cond_broadcast(&output->cond);
+        pthread_mutex_unlock(&output->mutex);
+
+        // This blocks until the nested consumer takes the frame.
+        mlt_consumer_put_frame(output->nested, frame);
+
+        pthread_mutex_lock(&output->mutex);
+    }
+    pthread_mutex_unlock(&output->mutex);
+
+    return NULL;
+}
+
+static output_queue *output_open(mlt_consumer nested, int size)
+{
+    output_queue *output = calloc(1, sizeof(output_queue));
+
+    if (output) {
+        output->nested = nested;
+        output->queue = mlt_deque_init();
+        output->size = size;
+        output->running = 1;
+        pthread_mutex_init(&output->mutex, NULL);
+        pthread_cond_init(&output->cond, NULL);
+        if (pthread_create(&output->thread, NULL, output_thread, output) != 0) {
+            mlt_deque_close(output->queue);
+            pthread_mutex_destroy(&output->mutex);
+            pthread_cond_destroy(&output->cond);
+            free(output);
+            output = NULL;
+        }
+    }
+    return output;
+}
+
+// Deliver the frames already queued, then stop the thread.
+static void output_close(output_queue *output)
+{
+    pthread_mutex_lock(&output->mutex);
+    output->running = 0;
+    pthread_cond_broadcast(&output->cond);
+    pthread_mutex_unlock(&output->mutex);
+    pthread_join(output->thread, NULL);
+    mlt_deque_close(output->queue);
+    pthread_mutex_destroy(&output->mutex);
+    pthread_cond_destroy(&output->cond);
+    free(output);
+}
+
+static void output_purge(output_queue *output)
+{
+    pthread_mutex_lock(&output->mutex);
+    while (mlt_deque_count(output->queue) > 0)
+        mlt_frame_close(mlt_deque_pop_front(output->queue));
+    pthread_cond_broadcast(&output->cond);
+    pthread_mutex_unlock(&output->mutex);
+}
+
+static void output_put_frame(mlt_consumer nested, mlt_frame frame)
+{
+    output_queue *output = mlt_properties_get_data(MLT_CONSUMER_PROPERTIES(nested),
+                                                   "_multi_output",
+                                                   NULL);
+
+    if (output) {
+        // Only wait when this output is a full queue behind the others.
+        pthread_mutex_lock(&output->mutex);
+        while (output->running && mlt_deque_count(output->queue) >= output->size)
+            pthread_cond_wait(&output->cond, &output->mutex);
+        mlt_deque_push_back(output->queue, frame);
+        pthread_cond_broadcast(&output->cond);
+        pthread_mutex_unlock(&output->mutex);
+    } else {
+        mlt_consumer_put_frame(nested, frame);
+    }
+}
+
+/** Get the image shared by the clones given to the nested consumers.
+ *
+ * The image belongs to the frame rendered by this consumer, so it is copied
+ * only when a nested consumer asks to write to it.
+ */
+
+static int get_shared_image(mlt_frame frame,
+                            uint8_t **image,
+                            mlt_image_format *format,
+                            int *width,
+                            int *height,
+                            int writable)
+{
+    mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+    int size = 0;
+    uint8_t *data = mlt_properties_get_data(properties, "image", &size);
+
+    if (!data)
+        return 1;
+
+    *format = mlt_properties_get_int(properties, "format");
+    *width = mlt_properties_get_int(properties, "width");
+    *height = mlt_properties_get_int(properties, "height");
+    if (writable && *format != mlt_image_movit) {
+        uint8_t *alpha = mlt_frame_get_alpha_size(frame, &size);
+
+        if (alpha) {
+            uint8_t *copy = mlt_pool_alloc(*width * *height);
+            memcpy(copy, alpha, *width * *height);
+            mlt_frame_set_alpha(frame, copy, *width * *height, mlt_pool_release);
+        }
+        size = mlt_image_format_size(*format, *width, *height, NULL);
+        uint8_t *copy = mlt_pool_alloc(size);
+        memcpy(copy, data, size);
+        mlt_frame_set_image(frame, copy, size, mlt_pool_release);
+        data = copy;
+    }
+    *image = data;
+
+    return 0;
+}
+
 static void foreach_consumer_start(mlt_consumer consumer)
 {
     mlt_properties properties = MLT_CONSUMER_PROPERTIES(consumer);
@@ -318,10 +463,44 @@ static void foreach_consumer_start(mlt_consumer consumer)
             mlt_properties_set_data(nested_props, "_multi_audio", NULL, 0, NULL, NULL);
             mlt_properties_set_int(nested_props, "_multi_samples", 0);
             mlt_consumer_start(nested);
+
+            // Feed each nested consumer from its own thread so that a slow one
+            // only holds back the others once its queue is full.
+            int size = mlt_properties_get_int(properties, "output_buffer");
+            if (size > 0) {
+                output_queue *output = output_open(nested, size);
+                mlt_properties_set_data(nested_props,
+                                        "_multi_output",
+                                        output,
+                                        0,
+                                        (mlt_destructor) output_close,
+                                        NULL);
+            }
         }
     } while (nested);
 }
 
+// Deliver the queued frames and stop the threads feeding the nested consumers.
+static void foreach_consumer_flush(mlt_consumer consumer)
+{
+    mlt_properties properties = MLT_CONSUMER_PROPERTIES(consumer);
+    mlt_consumer nested = NULL;
+    char key[30];
+    int index = 0;
+
+    do {
+        snprintf(key, sizeof(key), "%d.consumer", index++);
+        nested = mlt_properties_get_data(properties, key, NULL);
+        if (nested)
+            mlt_properties_set_data(MLT_CONSUMER_PROPERTIES(nested),
+                                    "_multi_output",
+                                    NULL,
+                                    0,
+                                    NULL,
+                                    NULL);
+    } while (nested);
+}
+
 static void foreach_consumer_refresh(mlt_consumer consumer)
 {
     mlt_properties properties = MLT_CONSUMER_PROPERTIES(consumer);
@@ -363,32 +542,30 @@ static void foreach_consumer_put(mlt_consumer consumer, mlt_frame frame)
     mlt_consumer nested = NULL;
     char key[30];
     int index = 0;
+    double self_fps = mlt_properties_get_double(properties, "fps");
+    mlt_position self_pos = mlt_frame_get_position(frame);
+    double self_time = self_pos / self_fps;
+
+    // get the audio for the current frame
+    uint8_t *audio = NULL;
+    mlt_audio_format format = mlt_audio_s16;
+    int channels = mlt_properties_get_int(properties, "channels");
+    int frequency = mlt_properties_get_int(properties, "frequency");
+    int audio_samples = mlt_audio_calculate_frame_samples(self_fps, frequency, self_pos);
+    mlt_frame_get_audio(frame, (void **) &audio, &format, &frequency, &channels, &audio_samples);
+    int audio_size = mlt_audio_format_size(format, audio_samples, channels);
 
     do {
         snprintf(key, sizeof(key), "%d.consumer", index++);
         nested = mlt_properties_get_data(properties, key, NULL);
         if (nested) {
             mlt_properties nested_props = MLT_CONSUMER_PROPERTIES(nested);
-            double self_fps = mlt_properties_get_double(properties, "fps");
             double nested_fps = mlt_properties_get_double(nested_props, "fps");
             mlt_position nested_pos = mlt_properties_get_position(nested_props, "_multi_position");
-            mlt_position self_pos = mlt_frame_get_position(frame);
-            double self_time = self_pos / self_fps;
             double nested_time = nested_pos / nested_fps;
-
-            // get the audio for the current frame
-            uint8_t *buffer = NULL;
-            mlt_audio_format format = mlt_audio_s16;
-            int channels = mlt_properties_get_int(properties, "channels");
-            int frequency = mlt_properties_get_int(properties, "frequency");
-            int current_samples = mlt_audio_calculate_frame_samples(self_fps, frequency, self_pos);
-            mlt_frame_get_audio(frame,
-                                (void **) &buffer,
-                                &format,
-                                &frequency,
-                                &channels,
-                                &current_samples);
-            int current_size = mlt_audio_format_size(format, current_samples, channels);
+            uint8_t *buffer = audio;
+            int current_samples = audio_samples;
+            int current_size = audio_size;
 
             // get any leftover audio
             int prev_size = 0;
@@ -411,10 +588,12 @@ static void foreach_consumer_put(mlt_consumer consumer, mlt_frame frame)
                           nested_time,
                           self_time);
             while (nested_time <= self_time) {
-                // put ideal number of samples into cloned frame
-                int deeply = index > 1 ? 1 : 0;
-                mlt_frame clone_frame = mlt_frame_clone(frame, deeply);
+                // the clones share the image, which is copied only for a nested writer
+                mlt_frame clone_frame = mlt_frame_clone(frame, 0);
                 mlt_properties clone_props = MLT_FRAME_PROPERTIES(clone_frame);
+                mlt_frame_push_get_image(clone_frame, get_shared_image);
+
+                // put ideal number of samples into cloned frame
                 int nested_samples = mlt_audio_calculate_frame_samples(nested_fps,
                                                                        frequency,
                                                                        nested_pos);
@@ -449,7 +628,7 @@ static void foreach_consumer_put(mlt_consumer consumer, mlt_frame frame)
                                                               "height"));
 
                 // send frame to nested consumer
-                mlt_consumer_put_frame(nested, clone_frame);
+                output_put_frame(nested, clone_frame);
                 mlt_properties_set_position(nested_props, "_multi_position", ++nested_pos);
                 nested_time = nested_pos / nested_fps;
             }
@@ -547,6 +726,7 @@ static int stop(mlt_consumer consumer)
             pthread_join(*thread, NULL);
         }
         mlt_properties_set_int(properties, "joined", 1);
+        foreach_consumer_flush(consumer);
 
         // Stop nested consumers
         foreach_consumer_stop(consumer);
@@ -577,6 +757,13 @@ static void purge(mlt_consumer consumer)
         do {
             snprintf(key, sizeof(key), "%d.consumer", index++);
             nested = mlt_properties_get_data(properties, key, NULL);
+            if (nested) {
+                output_queue *output = mlt_properties_get_data(MLT_CONSUMER_PROPERTIES(nested),
+                                                               "_multi_output",
+                                                               NULL);
+                if (output)
+                    output_purge(output);
+            }
             mlt_consumer_purge(nested);
         } while (nested);
     }
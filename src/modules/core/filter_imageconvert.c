@@ -22,6 +22,7 @@
 #include <framework/mlt_image.h>
 #include <framework/mlt_log.h>
 #include <framework/mlt_pool.h>
+#include <framework/mlt_slices.h>
 
 #include <stdlib.h>
 
@@ -55,73 +56,95 @@
 #define YUV2RGB_601 YUV2RGB_601_UNSCALED
 #endif
 
-static void convert_yuv422_to_rgba(mlt_image src, mlt_image dst)
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+extern int imageconvert_yuv422_to_rgba_sse2(const uint8_t *src,
+                                            const uint8_t *alpha,
+                                            uint8_t *dst,
+                                            int width);
+extern int imageconvert_yuv422_to_rgb_sse2(const uint8_t *src, uint8_t *dst, int width);
+extern int imageconvert_rgba_to_yuv422_sse2(const uint8_t *src,
+                                            uint8_t *dst,
+                                            uint8_t *alpha,
+                                            int width);
+extern int imageconvert_rgb_to_yuv422_sse2(const uint8_t *src, uint8_t *dst, int width);
+extern int imageconvert_yuv420p_to_yuv422_sse2(
+    const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, uint8_t *dst, int width);
+extern int imageconvert_yuv420p_to_rgb_sse2(
+    const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, uint8_t *dst, int width);
+extern int imageconvert_yuv420p_to_rgba_sse2(const uint8_t *src_y,
+                                             const uint8_t *src_u,
+                                             const uint8_t *src_v,
+                                             const uint8_t *alpha,
+                                             uint8_t *dst,
+                                             int width);
+extern int imageconvert_yuv422_to_y_sse2(const uint8_t *src, uint8_t *dst, int width);
+extern int imageconvert_yuv422_to_uv_sse2(const uint8_t *src,
+                                          uint8_t *dst_u,
+                                          uint8_t *dst_v,
+                                          int count);
+extern int imageconvert_rgb_to_rgba_sse2(const uint8_t *src,
+                                         const uint8_t *alpha,
+                                         uint8_t *dst,
+                                         int width);
+extern int imageconvert_rgba_to_rgb_sse2(const uint8_t *src,
+                                         uint8_t *dst,
+                                         uint8_t *alpha,
+                                         int width);
+#endif
+
+typedef void (*conversion_line_function)(mlt_image src, mlt_image dst, int line);
+
+typedef struct
 {
-    int yy, uu, vv;
-    int r, g, b;
+    conversion_line_function convert_line;
+    mlt_image src;
+    mlt_image dst;
+} slice_desc;
 
-    mlt_image_set_values(dst, NULL, mlt_image_rgba, src->width, src->height);
-    mlt_image_alloc_data(dst);
+static int convert_slice_proc(int id, int index, int jobs, void *data)
+{
+    (void) id; // unused
+    slice_desc *desc = (slice_desc *) data;
+    int slice_line_start, slice_height = mlt_slices_size_slice(jobs,
+                                                               index,
+                                                               desc->src->height,
+                                                               &slice_line_start);
+
+    for (int line = slice_line_start; line < slice_line_start + slice_height; line++)
+        desc->convert_line(desc->src, desc->dst, line);
+    return 0;
+}
 
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
-        uint8_t *pAlpha = src->planes[3] + src->strides[3] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        int total = src->width / 2 + 1;
-
-        if (pAlpha)
-            while (--total) {
-                yy = pSrc[0];
-                uu = pSrc[1];
-                vv = pSrc[3];
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[0] = r;
-                pDst[1] = g;
-                pDst[2] = b;
-                pDst[3] = *pAlpha++;
-                yy = pSrc[2];
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[4] = r;
-                pDst[5] = g;
-                pDst[6] = b;
-                pDst[7] = *pAlpha++;
-                pSrc += 4;
-                pDst += 8;
-            }
-        else
-            while (--total) {
-                yy = pSrc[0];
-                uu = pSrc[1];
-                vv = pSrc[3];
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[0] = r;
-                pDst[1] = g;
-                pDst[2] = b;
-                pDst[3] = 0xff;
-                yy = pSrc[2];
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[4] = r;
-                pDst[5] = g;
-                pDst[6] = b;
-                pDst[7] = 0xff;
-                pSrc += 4;
-                pDst += 8;
-            }
-    }
+/** Convert all of the lines of an image in parallel.
+ *
+ * The destination image must already be allocated.
+ */
+
+static void convert_lines(conversion_line_function convert_line, mlt_image src, mlt_image dst)
+{
+    slice_desc desc = {convert_line, src, dst};
+    mlt_slices_run_normal(0, convert_slice_proc, &desc);
 }
 
-static void convert_yuv422_to_rgb(mlt_image src, mlt_image dst)
+static void convert_yuv422_to_rgba_line(mlt_image src, mlt_image dst, int line)
 {
     int yy, uu, vv;
     int r, g, b;
+    uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
+    uint8_t *pAlpha = src->planes[3] + src->strides[3] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int total = src->width / 2 + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_yuv422_to_rgba_sse2(pSrc, pAlpha, pDst, src->width);
+    pSrc += done * 2;
+    pDst += done * 4;
+    if (pAlpha)
+        pAlpha += done;
+    total -= done / 2;
+#endif
 
-    mlt_image_set_values(dst, NULL, mlt_image_rgb, src->width, src->height);
-    mlt_image_alloc_data(dst);
-
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        int total = src->width / 2 + 1;
+    if (pAlpha)
         while (--total) {
             yy = pSrc[0];
             uu = pSrc[1];
@@ -130,93 +153,204 @@ static void convert_yuv422_to_rgb(mlt_image src, mlt_image dst)
             pDst[0] = r;
             pDst[1] = g;
             pDst[2] = b;
+            pDst[3] = *pAlpha++;
             yy = pSrc[2];
             YUV2RGB_601(yy, uu, vv, r, g, b);
-            pDst[3] = r;
-            pDst[4] = g;
-            pDst[5] = b;
+            pDst[4] = r;
+            pDst[5] = g;
+            pDst[6] = b;
+            pDst[7] = *pAlpha++;
             pSrc += 4;
-            pDst += 6;
+            pDst += 8;
         }
+    else
+        while (--total) {
+            yy = pSrc[0];
+            uu = pSrc[1];
+            vv = pSrc[3];
+            YUV2RGB_601(yy, uu, vv, r, g, b);
+            pDst[0] = r;
+            pDst[1] = g;
+            pDst[2] = b;
+            pDst[3] = 0xff;
+            yy = pSrc[2];
+            YUV2RGB_601(yy, uu, vv, r, g, b);
+            pDst[4] = r;
+            pDst[5] = g;
+            pDst[6] = b;
+            pDst[7] = 0xff;
+            pSrc += 4;
+            pDst += 8;
+        }
+}
+
+static void convert_yuv422_to_rgba(mlt_image src, mlt_image dst)
+{
+    mlt_image_set_values(dst, NULL, mlt_image_rgba, src->width, src->height);
+    mlt_image_alloc_data(dst);
+    convert_lines(convert_yuv422_to_rgba_line, src, dst);
+}
+
+static void convert_yuv422_to_rgb_line(mlt_image src, mlt_image dst, int line)
+{
+    int yy, uu, vv;
+    int r, g, b;
+    uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int total = src->width / 2 + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_yuv422_to_rgb_sse2(pSrc, pDst, src->width);
+    pSrc += done * 2;
+    pDst += done * 3;
+    total -= done / 2;
+#endif
+
+    while (--total) {
+        yy = pSrc[0];
+        uu = pSrc[1];
+        vv = pSrc[3];
+        YUV2RGB_601(yy, uu, vv, r, g, b);
+        pDst[0] = r;
+        pDst[1] = g;
+        pDst[2] = b;
+        yy = pSrc[2];
+        YUV2RGB_601(yy, uu, vv, r, g, b);
+        pDst[3] = r;
+        pDst[4] = g;
+        pDst[5] = b;
+        pSrc += 4;
+        pDst += 6;
     }
 }
 
-static void convert_rgba_to_yuv422(mlt_image src, mlt_image dst)
+static void convert_yuv422_to_rgb(mlt_image src, mlt_image dst)
+{
+    mlt_image_set_values(dst, NULL, mlt_image_rgb, src->width, src->height);
+    mlt_image_alloc_data(dst);
+    convert_lines(convert_yuv422_to_rgb_line, src, dst);
+}
+
+static void convert_rgba_to_yuv422_line(mlt_image src, mlt_image dst, int line)
 {
     int y0, y1, u0, u1, v0, v1;
     int r, g, b;
+    uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    uint8_t *pAlpha = dst->planes[3] + dst->strides[3] * line;
+    int j = src->width / 2 + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_rgba_to_yuv422_sse2(pSrc, pDst, pAlpha, src->width);
+    pSrc += done * 4;
+    pDst += done * 2;
+    pAlpha += done;
+    j -= done / 2;
+#endif
+
+    while (--j) {
+        r = *pSrc++;
+        g = *pSrc++;
+        b = *pSrc++;
+        *pAlpha++ = *pSrc++;
+        RGB2YUV_601(r, g, b, y0, u0, v0);
+        r = *pSrc++;
+        g = *pSrc++;
+        b = *pSrc++;
+        *pAlpha++ = *pSrc++;
+        RGB2YUV_601(r, g, b, y1, u1, v1);
+        *pDst++ = y0;
+        *pDst++ = (u0 + u1) >> 1;
+        *pDst++ = y1;
+        *pDst++ = (v0 + v1) >> 1;
+    }
+    if (src->width % 2) {
+        r = *pSrc++;
+        g = *pSrc++;
+        b = *pSrc++;
+        *pAlpha++ = *pSrc++;
+        RGB2YUV_601(r, g, b, y0, u0, v0);
+        *pDst++ = y0;
+        *pDst++ = u0;
+    }
+}
 
+static void convert_rgba_to_yuv422(mlt_image src, mlt_image dst)
+{
     mlt_image_set_values(dst, NULL, mlt_image_yuv422, src->width, src->height);
     mlt_image_alloc_data(dst);
     mlt_image_alloc_alpha(dst);
-
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        uint8_t *pAlpha = dst->planes[3] + dst->strides[3] * line;
-        int j = src->width / 2 + 1;
-        while (--j) {
-            r = *pSrc++;
-            g = *pSrc++;
-            b = *pSrc++;
-            *pAlpha++ = *pSrc++;
-            RGB2YUV_601(r, g, b, y0, u0, v0);
-            r = *pSrc++;
-            g = *pSrc++;
-            b = *pSrc++;
-            *pAlpha++ = *pSrc++;
-            RGB2YUV_601(r, g, b, y1, u1, v1);
-            *pDst++ = y0;
-            *pDst++ = (u0 + u1) >> 1;
-            *pDst++ = y1;
-            *pDst++ = (v0 + v1) >> 1;
-        }
-        if (src->width % 2) {
-            r = *pSrc++;
-            g = *pSrc++;
-            b = *pSrc++;
-            *pAlpha++ = *pSrc++;
-            RGB2YUV_601(r, g, b, y0, u0, v0);
-            *pDst++ = y0;
-            *pDst++ = u0;
-        }
-    }
+    convert_lines(convert_rgba_to_yuv422_line, src, dst);
 }
 
-static void convert_rgb_to_yuv422(mlt_image src, mlt_image dst)
+static void convert_rgb_to_yuv422_line(mlt_image src, mlt_image dst, int line)
 {
     int y0, y1, u0, u1, v0, v1;
     int r, g, b;
+    uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int j = src->width / 2 + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_rgb_to_yuv422_sse2(pSrc, pDst, src->width);
+    pSrc += done * 3;
+    pDst += done * 2;
+    j -= done / 2;
+#endif
 
+    while (--j) {
+        r = *pSrc++;
+        g = *pSrc++;
+        b = *pSrc++;
+        RGB2YUV_601(r, g, b, y0, u0, v0);
+        r = *pSrc++;
+        g = *pSrc++;
+        b = *pSrc++;
+        RGB2YUV_601(r, g, b, y1, u1, v1);
+        *pDst++ = y0;
+        *pDst++ = (u0 + u1) >> 1;
+        *pDst++ = y1;
+        *pDst++ = (v0 + v1) >> 1;
+    }
+    if (src->width % 2) {
+        r = *pSrc++;
+        g = *pSrc++;
+        b = *pSrc++;
+        RGB2YUV_601(r, g, b, y0, u0, v0);
+        *pDst++ = y0;
+        *pDst++ = u0;
+    }
+}
+
+static void convert_rgb_to_yuv422(mlt_image src, mlt_image dst)
+{
     mlt_image_set_values(dst, NULL, mlt_image_yuv422, src->width, src->height);
     mlt_image_alloc_data(dst);
+    convert_lines(convert_rgb_to_yuv422_line, src, dst);
+}
 
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        int j = src->width / 2 + 1;
-        while (--j) {
-            r = *pSrc++;
-            g = *pSrc++;
-            b = *pSrc++;
-            RGB2YUV_601(r, g, b, y0, u0, v0);
-            r = *pSrc++;
-            g = *pSrc++;
-            b = *pSrc++;
-            RGB2YUV_601(r, g, b, y1, u1, v1);
-            *pDst++ = y0;
-            *pDst++ = (u0 + u1) >> 1;
-            *pDst++ = y1;
-            *pDst++ = (v0 + v1) >> 1;
-        }
-        if (src->width % 2) {
-            r = *pSrc++;
-            g = *pSrc++;
-            b = *pSrc++;
-            RGB2YUV_601(r, g, b, y0, u0, v0);
-            *pDst++ = y0;
-            *pDst++ = u0;
-        }
+static void convert_yuv420p_to_yuv422_line(mlt_image src, mlt_image dst, int line)
+{
+    uint8_t *pSrcY = src->planes[0] + src->strides[0] * line;
+    uint8_t *pSrcU = src->planes[1] + src->strides[1] * (line / 2);
+    uint8_t *pSrcV = src->planes[2] + src->strides[2] * (line / 2);
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int j = src->width / 2 + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_yuv420p_to_yuv422_sse2(pSrcY, pSrcU, pSrcV, pDst, src->width);
+    pSrcY += done;
+    pSrcU += done / 2;
+    pSrcV += done / 2;
+    pDst += done * 2;
+    j -= done / 2;
+#endif
+
+    while (--j) {
+        *pDst++ = *pSrcY++;
+        *pDst++ = *pSrcU++;
+        *pDst++ = *pSrcY++;
+        *pDst++ = *pSrcV++;
     }
 }
 
@@ -224,36 +358,76 @@ static void convert_yuv420p_to_yuv422(mlt_image src, mlt_image dst)
 {
     mlt_image_set_values(dst, NULL, mlt_image_yuv422, src->width, src->height);
     mlt_image_alloc_data(dst);
-
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrcY = src->planes[0] + src->strides[0] * line;
-        uint8_t *pSrcU = src->planes[1] + src->strides[1] * line / 2;
-        uint8_t *pSrcV = src->planes[2] + src->strides[2] * line / 2;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        int j = src->width / 2 + 1;
-        while (--j) {
-            *pDst++ = *pSrcY++;
-            *pDst++ = *pSrcU++;
-            *pDst++ = *pSrcY++;
-            *pDst++ = *pSrcV++;
-        }
-    }
+    convert_lines(convert_yuv420p_to_yuv422_line, src, dst);
 }
 
-static void convert_yuv420p_to_rgb(mlt_image src, mlt_image dst)
+static void convert_yuv420p_to_rgb_line(mlt_image src, mlt_image dst, int line)
 {
     int yy, uu, vv;
     int r, g, b;
+    uint8_t *pSrcY = src->planes[0] + src->strides[0] * line;
+    uint8_t *pSrcU = src->planes[1] + src->strides[1] * (line / 2);
+    uint8_t *pSrcV = src->planes[2] + src->strides[2] * (line / 2);
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int total = src->width / 2 + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_yuv420p_to_rgb_sse2(pSrcY, pSrcU, pSrcV, pDst, src->width);
+    pSrcY += done;
+    pSrcU += done / 2;
+    pSrcV += done / 2;
+    pDst += done * 3;
+    total -= done / 2;
+#endif
 
+    while (--total) {
+        yy = *pSrcY++;
+        uu = *pSrcU++;
+        vv = *pSrcV++;
+        YUV2RGB_601(yy, uu, vv, r, g, b);
+        pDst[0] = r;
+        pDst[1] = g;
+        pDst[2] = b;
+        yy = *pSrcY++;
+        YUV2RGB_601(yy, uu, vv, r, g, b);
+        pDst[3] = r;
+        pDst[4] = g;
+        pDst[5] = b;
+        pDst += 6;
+    }
+}
+
+static void convert_yuv420p_to_rgb(mlt_image src, mlt_image dst)
+{
     mlt_image_set_values(dst, NULL, mlt_image_rgb, src->width, src->height);
     mlt_image_alloc_data(dst);
+    convert_lines(convert_yuv420p_to_rgb_line, src, dst);
+}
+
+static void convert_yuv420p_to_rgba_line(mlt_image src, mlt_image dst, int line)
+{
+    int yy, uu, vv;
+    int r, g, b;
+    uint8_t *pSrcY = src->planes[0] + src->strides[0] * line;
+    uint8_t *pSrcU = src->planes[1] + src->strides[1] * (line / 2);
+    uint8_t *pSrcV = src->planes[2] + src->strides[2] * (line / 2);
+    uint8_t *pSrcA = src->planes[3] + src->strides[3] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int total = src->width / 2 + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done
+        = imageconvert_yuv420p_to_rgba_sse2(pSrcY, pSrcU, pSrcV, pSrcA, pDst, src->width);
+    pSrcY += done;
+    pSrcU += done / 2;
+    pSrcV += done / 2;
+    if (pSrcA)
+        pSrcA += done;
+    pDst += done * 4;
+    total -= done / 2;
+#endif
 
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrcY = src->planes[0] + src->strides[0] * line;
-        uint8_t *pSrcU = src->planes[1] + src->strides[1] * line / 2;
-        uint8_t *pSrcV = src->planes[2] + src->strides[2] * line / 2;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        int total = src->width / 2 + 1;
+    if (pSrcA)
         while (--total) {
             yy = *pSrcY++;
             uu = *pSrcU++;
@@ -262,138 +436,149 @@ static void convert_yuv420p_to_rgb(mlt_image src, mlt_image dst)
             pDst[0] = r;
             pDst[1] = g;
             pDst[2] = b;
+            pDst[3] = *pSrcA++;
             yy = *pSrcY++;
             YUV2RGB_601(yy, uu, vv, r, g, b);
-            pDst[3] = r;
-            pDst[4] = g;
-            pDst[5] = b;
-            pDst += 6;
+            pDst[4] = r;
+            pDst[5] = g;
+            pDst[6] = b;
+            pDst[7] = *pSrcA++;
+            pDst += 8;
+        }
+    else
+        while (--total) {
+            yy = *pSrcY++;
+            uu = *pSrcU++;
+            vv = *pSrcV++;
+            YUV2RGB_601(yy, uu, vv, r, g, b);
+            pDst[0] = r;
+            pDst[1] = g;
+            pDst[2] = b;
+            pDst[3] = 0xff;
+            yy = *pSrcY++;
+            YUV2RGB_601(yy, uu, vv, r, g, b);
+            pDst[4] = r;
+            pDst[5] = g;
+            pDst[6] = b;
+            pDst[7] = 0xff;
+            pDst += 8;
         }
-    }
 }
 
 static void convert_yuv420p_to_rgba(mlt_image src, mlt_image dst)
 {
-    int yy, uu, vv;
-    int r, g, b;
-
     mlt_image_set_values(dst, NULL, mlt_image_rgba, src->width, src->height);
     mlt_image_alloc_data(dst);
+    convert_lines(convert_yuv420p_to_rgba_line, src, dst);
+}
 
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrcY = src->planes[0] + src->strides[0] * line;
-        uint8_t *pSrcU = src->planes[1] + src->strides[1] * line / 2;
-        uint8_t *pSrcV = src->planes[2] + src->strides[2] * line / 2;
-        uint8_t *pSrcA = src->planes[3] + src->strides[3] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        int total = src->width / 2 + 1;
-        if (pSrcA)
-            while (--total) {
-                yy = *pSrcY++;
-                uu = *pSrcU++;
-                vv = *pSrcV++;
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[0] = r;
-                pDst[1] = g;
-                pDst[2] = b;
-                pDst[3] = *pSrcA++;
-                yy = *pSrcY++;
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[4] = r;
-                pDst[5] = g;
-                pDst[6] = b;
-                pDst[7] = *pSrcA++;
-                pDst += 8;
-            }
-        else
-            while (--total) {
-                yy = *pSrcY++;
-                uu = *pSrcU++;
-                vv = *pSrcV++;
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[0] = r;
-                pDst[1] = g;
-                pDst[2] = b;
-                pDst[3] = 0xff;
-                yy = *pSrcY++;
-                YUV2RGB_601(yy, uu, vv, r, g, b);
-                pDst[4] = r;
-                pDst[5] = g;
-                pDst[6] = b;
-                pDst[7] = 0xff;
-                pDst += 8;
-            }
+static void convert_yuv422_to_yuv420p_line(mlt_image src, mlt_image dst, int line)
+{
+    uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int pixel = 0;
+
+    // Y
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    pixel = imageconvert_yuv422_to_y_sse2(pSrc, pDst, src->width);
+    pSrc += pixel * 2;
+    pDst += pixel;
+#endif
+    for (; pixel < src->width; pixel++) {
+        *pDst++ = *pSrc;
+        pSrc += 2;
+    }
+
+    // U and V are taken from the even lines.
+    if (line % 2 || line / 2 >= src->height / 2)
+        return;
+    int pixels = src->width / 2;
+    pSrc = src->planes[0] + src->strides[0] * line + 1;
+    uint8_t *pDstU = dst->planes[1] + dst->strides[1] * (line / 2);
+    uint8_t *pDstV = dst->planes[2] + dst->strides[2] * (line / 2);
+    pixel = 0;
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    pixel = imageconvert_yuv422_to_uv_sse2(pSrc - 1, pDstU, pDstV, pixels);
+    pSrc += pixel * 4;
+    pDstU += pixel;
+    pDstV += pixel;
+#endif
+    for (; pixel < pixels; pixel++) {
+        *pDstU++ = pSrc[0];
+        *pDstV++ = pSrc[2];
+        pSrc += 4;
     }
 }
 
 static void convert_yuv422_to_yuv420p(mlt_image src, mlt_image dst)
 {
-    int lines = src->height;
-    int pixels = src->width;
-
     mlt_image_set_values(dst, NULL, mlt_image_yuv420p, src->width, src->height);
     mlt_image_alloc_data(dst);
+    convert_lines(convert_yuv422_to_yuv420p_line, src, dst);
+}
 
-    // Y
-    for (int line = 0; line < lines; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        for (int pixel = 0; pixel < pixels; pixel++) {
-            *pDst++ = *pSrc;
-            pSrc += 2;
-        }
-    }
-
-    lines = src->height / 2;
-    pixels = src->width / 2;
+static void convert_rgb_to_rgba_line(mlt_image src, mlt_image dst, int line)
+{
+    uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
+    uint8_t *pAlpha = src->planes[3] + src->strides[3] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    int total = src->width + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_rgb_to_rgba_sse2(pSrc, pAlpha, pDst, src->width);
+    pSrc += done * 3;
+    pDst += done * 4;
+    if (pAlpha)
+        pAlpha += done;
+    total -= done;
+#endif
 
-    // U
-    for (int line = 0; line < lines; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line * 2 + 1;
-        uint8_t *pDst = dst->planes[1] + dst->strides[1] * line;
-        for (int pixel = 0; pixel < pixels; pixel++) {
-            *pDst++ = *pSrc;
-            pSrc += 4;
+    if (pAlpha)
+        while (--total) {
+            *pDst++ = pSrc[0];
+            *pDst++ = pSrc[1];
+            *pDst++ = pSrc[2];
+            *pDst++ = *pAlpha++;
+            pSrc += 3;
         }
-    }
-
-    // V
-    for (int line = 0; line < lines; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line * 2 + 3;
-        uint8_t *pDst = dst->planes[2] + dst->strides[2] * line;
-        for (int pixel = 0; pixel < pixels; pixel++) {
-            *pDst++ = *pSrc;
-            pSrc += 4;
+    else
+        while (--total) {
+            *pDst++ = pSrc[0];
+            *pDst++ = pSrc[1];
+            *pDst++ = pSrc[2];
+            *pDst++ = 0xff;
+            pSrc += 3;
         }
-    }
 }
 
 static void convert_rgb_to_rgba(mlt_image src, mlt_image dst)
 {
     mlt_image_set_values(dst, NULL, mlt_image_rgba, src->width, src->height);
     mlt_image_alloc_data(dst);
+    convert_lines(convert_rgb_to_rgba_line, src, dst);
+}
 
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
-        uint8_t *pAlpha = src->planes[3] + src->strides[3] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        int total = src->width + 1;
-        if (pAlpha)
-            while (--total) {
-                *pDst++ = pSrc[0];
-                *pDst++ = pSrc[1];
-                *pDst++ = pSrc[2];
-                *pDst++ = *pAlpha++;
-                pSrc += 3;
-            }
-        else
-            while (--total) {
-                *pDst++ = pSrc[0];
-                *pDst++ = pSrc[1];
-                *pDst++ = pSrc[2];
-                *pDst++ = 0xff;
-                pSrc += 3;
-            }
+static void convert_rgba_to_rgb_line(mlt_image src, mlt_image dst, int line)
+{
+    uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
+    uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
+    uint8_t *pAlpha = dst->planes[3] + dst->strides[3] * line;
+    int total = src->width + 1;
+
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+    int done = imageconvert_rgba_to_rgb_sse2(pSrc, pDst, pAlpha, src->width);
+    pSrc += done * 4;
+    pDst += done * 3;
+    pAlpha += done;
+    total -= done;
+#endif
+
+    while (--total) {
+        *pDst++ = pSrc[0];
+        *pDst++ = pSrc[1];
+        *pDst++ = pSrc[2];
+        *pAlpha++ = pSrc[3];
+        pSrc += 4;
     }
 }
 
@@ -402,20 +587,7 @@ static void convert_rgba_to_rgb(mlt_image src, mlt_image dst)
     mlt_image_set_values(dst, NULL, mlt_image_rgb, src->width, src->height);
     mlt_image_alloc_data(dst);
     mlt_image_alloc_alpha(dst);
-
-    for (int line = 0; line < src->height; line++) {
-        uint8_t *pSrc = src->planes[0] + src->strides[0] * line;
-        uint8_t *pDst = dst->planes[0] + dst->strides[0] * line;
-        uint8_t *pAlpha = dst->planes[3] + dst->strides[3] * line;
-        int total = src->width + 1;
-        while (--total) {
-            *pDst++ = pSrc[0];
-            *pDst++ = pSrc[1];
-            *pDst++ = pSrc[2];
-            *pAlpha++ = pSrc[3];
-            pSrc += 4;
-        }
-    }
+    convert_lines(convert_rgba_to_rgb_line, src, dst);
 }
 
 typedef void (*conversion_function)(mlt_image src, mlt_image dst);
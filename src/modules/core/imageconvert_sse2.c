@@ -0,0 +1,368 @@
+/*
+ * imageconvert_sse2.c -- SSE2 line converters for filter_imageconvert
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+// Each function converts as many leading pixels of a line as it can and returns that count.
+// The caller finishes the line with its scalar loop, so the results must match the
+// YUV2RGB_601_SCALED and RGB2YUV_601_SCALED macros exactly. All products are therefore
+// computed in 32 bits with pmaddwd and shifted the same way as the macros.
+
+#include <emmintrin.h>
+#include <inttypes.h>
+#include <string.h>
+
+/** Build a vector of 16-bit coefficient pairs for _mm_madd_epi16. */
+#define PAIR(a, b) _mm_set1_epi32((int) (((uint32_t) (uint16_t) (b) << 16) | (uint16_t) (a)))
+
+static inline uint32_t read32(const uint8_t *p)
+{
+    uint32_t x;
+    memcpy(&x, p, sizeof(x));
+    return x;
+}
+
+static inline void write32(uint8_t *p, uint32_t x)
+{
+    memcpy(p, &x, sizeof(x));
+}
+
+/** Convert 8 pixels of 16-bit Y, U and V to 16-bit R, G and B (clamped when packed to bytes). */
+
+static inline void yuv_to_rgb(__m128i y, __m128i u, __m128i v, __m128i *r, __m128i *g, __m128i *b)
+{
+    __m128i zero = _mm_setzero_si128();
+    y = _mm_sub_epi16(y, _mm_set1_epi16(16));
+    u = _mm_sub_epi16(u, _mm_set1_epi16(128));
+    v = _mm_sub_epi16(v, _mm_set1_epi16(128));
+
+    __m128i yv_lo = _mm_unpacklo_epi16(y, v);
+    __m128i yv_hi = _mm_unpackhi_epi16(y, v);
+    __m128i yu_lo = _mm_unpacklo_epi16(y, u);
+    __m128i yu_hi = _mm_unpackhi_epi16(y, u);
+    __m128i u_lo = _mm_unpacklo_epi16(u, zero);
+    __m128i u_hi = _mm_unpackhi_epi16(u, zero);
+
+    __m128i lo = _mm_srai_epi32(_mm_madd_epi16(yv_lo, PAIR(1192, 1634)), 10);
+    __m128i hi = _mm_srai_epi32(_mm_madd_epi16(yv_hi, PAIR(1192, 1634)), 10);
+    *r = _mm_packs_epi32(lo, hi);
+
+    lo = _mm_add_epi32(_mm_madd_epi16(yv_lo, PAIR(1192, -832)),
+                       _mm_madd_epi16(u_lo, PAIR(-401, 0)));
+    hi = _mm_add_epi32(_mm_madd_epi16(yv_hi, PAIR(1192, -832)),
+                       _mm_madd_epi16(u_hi, PAIR(-401, 0)));
+    *g = _mm_packs_epi32(_mm_srai_epi32(lo, 10), _mm_srai_epi32(hi, 10));
+
+    lo = _mm_srai_epi32(_mm_madd_epi16(yu_lo, PAIR(1192, 2066)), 10);
+    hi = _mm_srai_epi32(_mm_madd_epi16(yu_hi, PAIR(1192, 2066)), 10);
+    *b = _mm_packs_epi32(lo, hi);
+}
+
+/** Convert 8 pixels of 16-bit R, G and B to 16 bytes of yuv422. */
+
+static inline __m128i rgb_to_yuv422(__m128i r, __m128i g, __m128i b)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i rg_lo = _mm_unpacklo_epi16(r, g);
+    __m128i rg_hi = _mm_unpackhi_epi16(r, g);
+    __m128i b_lo = _mm_unpacklo_epi16(b, zero);
+    __m128i b_hi = _mm_unpackhi_epi16(b, zero);
+    __m128i lo, hi;
+
+    lo = _mm_add_epi32(_mm_madd_epi16(rg_lo, PAIR(263, 516)), _mm_madd_epi16(b_lo, PAIR(100, 0)));
+    hi = _mm_add_epi32(_mm_madd_epi16(rg_hi, PAIR(263, 516)), _mm_madd_epi16(b_hi, PAIR(100, 0)));
+    __m128i y = _mm_packs_epi32(_mm_srai_epi32(lo, 10), _mm_srai_epi32(hi, 10));
+    y = _mm_add_epi16(y, _mm_set1_epi16(16));
+
+    lo = _mm_add_epi32(_mm_madd_epi16(rg_lo, PAIR(-152, -300)), _mm_madd_epi16(b_lo, PAIR(450, 0)));
+    hi = _mm_add_epi32(_mm_madd_epi16(rg_hi, PAIR(-152, -300)), _mm_madd_epi16(b_hi, PAIR(450, 0)));
+    __m128i u = _mm_packs_epi32(_mm_srai_epi32(lo, 10), _mm_srai_epi32(hi, 10));
+    u = _mm_add_epi16(u, _mm_set1_epi16(128));
+
+    lo = _mm_add_epi32(_mm_madd_epi16(rg_lo, PAIR(450, -377)), _mm_madd_epi16(b_lo, PAIR(-73, 0)));
+    hi = _mm_add_epi32(_mm_madd_epi16(rg_hi, PAIR(450, -377)), _mm_madd_epi16(b_hi, PAIR(-73, 0)));
+    __m128i v = _mm_packs_epi32(_mm_srai_epi32(lo, 10), _mm_srai_epi32(hi, 10));
+    v = _mm_add_epi16(v, _mm_set1_epi16(128));
+
+    // Average each pair of chroma samples: (u0 + u1) >> 1
+    __m128i low16 = _mm_set1_epi32(0xffff);
+    u = _mm_srli_epi32(_mm_add_epi32(_mm_and_si128(u, low16), _mm_srli_epi32(u, 16)), 1);
+    v = _mm_srli_epi32(_mm_add_epi32(_mm_and_si128(v, low16), _mm_srli_epi32(v, 16)), 1);
+    __m128i uv = _mm_or_si128(u, _mm_slli_epi32(v, 16));
+
+    return _mm_or_si128(y, _mm_slli_epi16(uv, 8));
+}
+
+/** Interleave 8 pixels of 16-bit R, G, B and 8-bit A into two vectors of rgba. */
+
+static inline void pack_rgba(__m128i r, __m128i g, __m128i b, __m128i a, __m128i *p0, __m128i *p1)
+{
+    r = _mm_packus_epi16(r, r);
+    g = _mm_packus_epi16(g, g);
+    b = _mm_packus_epi16(b, b);
+    __m128i rg = _mm_unpacklo_epi8(r, g);
+    __m128i ba = _mm_unpacklo_epi8(b, a);
+    *p0 = _mm_unpacklo_epi16(rg, ba);
+    *p1 = _mm_unpackhi_epi16(rg, ba);
+}
+
+/** Split 8 pixels of rgba into 16-bit R, G and B. */
+
+static inline void unpack_rgba(__m128i p0, __m128i p1, __m128i *r, __m128i *g, __m128i *b)
+{
+    __m128i mask = _mm_set1_epi32(0xff);
+    *r = _mm_packs_epi32(_mm_and_si128(p0, mask), _mm_and_si128(p1, mask));
+    *g = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 8), mask),
+                         _mm_and_si128(_mm_srli_epi32(p1, 8), mask));
+    *b = _mm_packs_epi32(_mm_and_si128(_mm_srli_epi32(p0, 16), mask),
+                         _mm_and_si128(_mm_srli_epi32(p1, 16), mask));
+}
+
+/** Load 4 pixels of rgb into the low 24 bits of each 32-bit lane.
+ *
+ * This reads 16 bytes, 4 more than the pixels occupy.
+ */
+
+static inline __m128i load_rgb(const uint8_t *src)
+{
+    __m128i x = _mm_loadu_si128((const __m128i *) src);
+    __m128i a = _mm_unpacklo_epi32(x, _mm_srli_si128(x, 3));
+    __m128i b = _mm_unpacklo_epi32(_mm_srli_si128(x, 6), _mm_srli_si128(x, 9));
+    return _mm_and_si128(_mm_unpacklo_epi64(a, b), _mm_set1_epi32(0xffffff));
+}
+
+/** Store the low 24 bits of each 32-bit lane as 4 pixels (12 bytes) of rgb. */
+
+static inline void store_rgb(uint8_t *dst, __m128i x)
+{
+    x = _mm_and_si128(x, _mm_set1_epi32(0xffffff));
+    __m128i even = _mm_and_si128(x, _mm_set_epi32(0, -1, 0, -1));
+    __m128i odd = _mm_srli_epi64(x, 32);
+    x = _mm_or_si128(even, _mm_slli_epi64(odd, 24));
+    x = _mm_or_si128(_mm_move_epi64(x), _mm_slli_si128(_mm_srli_si128(x, 8), 6));
+    _mm_storel_epi64((__m128i *) dst, x);
+    write32(dst + 8, (uint32_t) _mm_cvtsi128_si32(_mm_srli_si128(x, 8)));
+}
+
+/** Split 8 pixels of yuv422 into 16-bit Y and horizontally repeated U and V. */
+
+static inline void unpack_yuv422(__m128i x, __m128i *y, __m128i *u, __m128i *v)
+{
+    __m128i uv = _mm_srli_epi16(x, 8);
+    *y = _mm_and_si128(x, _mm_set1_epi16(0xff));
+    *u = _mm_and_si128(uv, _mm_set1_epi32(0xffff));
+    *u = _mm_or_si128(*u, _mm_slli_epi32(*u, 16));
+    *v = _mm_srli_epi32(uv, 16);
+    *v = _mm_or_si128(*v, _mm_slli_epi32(*v, 16));
+}
+
+/** Load 8 pixels of yuv420p as 16-bit Y and horizontally repeated U and V. */
+
+static inline void load_yuv420p(const uint8_t *src_y,
+                                const uint8_t *src_u,
+                                const uint8_t *src_v,
+                                __m128i *y,
+                                __m128i *u,
+                                __m128i *v)
+{
+    __m128i zero = _mm_setzero_si128();
+    *y = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i *) src_y), zero);
+    *u = _mm_cvtsi32_si128((int) read32(src_u));
+    *u = _mm_unpacklo_epi8(_mm_unpacklo_epi8(*u, *u), zero);
+    *v = _mm_cvtsi32_si128((int) read32(src_v));
+    *v = _mm_unpacklo_epi8(_mm_unpacklo_epi8(*v, *v), zero);
+}
+
+int imageconvert_yuv422_to_rgba_sse2(const uint8_t *src,
+                                     const uint8_t *alpha,
+                                     uint8_t *dst,
+                                     int width)
+{
+    __m128i y, u, v, r, g, b, a, p0, p1;
+    int i;
+
+    for (i = 0; i + 8 <= width; i += 8) {
+        unpack_yuv422(_mm_loadu_si128((const __m128i *) (src + 2 * i)), &y, &u, &v);
+        yuv_to_rgb(y, u, v, &r, &g, &b);
+        a = alpha ? _mm_loadl_epi64((const __m128i *) (alpha + i)) : _mm_set1_epi8(-1);
+        pack_rgba(r, g, b, a, &p0, &p1);
+        _mm_storeu_si128((__m128i *) (dst + 4 * i), p0);
+        _mm_storeu_si128((__m128i *) (dst + 4 * i + 16), p1);
+    }
+    return i;
+}
+
+int imageconvert_yuv422_to_rgb_sse2(const uint8_t *src, uint8_t *dst, int width)
+{
+    __m128i y, u, v, r, g, b, p0, p1;
+    int i;
+
+    for (i = 0; i + 8 <= width; i += 8) {
+        unpack_yuv422(_mm_loadu_si128((const __m128i *) (src + 2 * i)), &y, &u, &v);
+        yuv_to_rgb(y, u, v, &r, &g, &b);
+        pack_rgba(r, g, b, r, &p0, &p1);
+        store_rgb(dst + 3 * i, p0);
+        store_rgb(dst + 3 * i + 12, p1);
+    }
+    return i;
+}
+
+int imageconvert_rgba_to_yuv422_sse2(const uint8_t *src, uint8_t *dst, uint8_t *alpha, int width)
+{
+    __m128i r, g, b, p0, p1, a;
+    int i;
+
+    for (i = 0; i + 8 <= width; i += 8) {
+        p0 = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+        p1 = _mm_loadu_si128((const __m128i *) (src + 4 * i + 16));
+        unpack_rgba(p0, p1, &r, &g, &b);
+        _mm_storeu_si128((__m128i *) (dst + 2 * i), rgb_to_yuv422(r, g, b));
+        a = _mm_packs_epi32(_mm_srli_epi32(p0, 24), _mm_srli_epi32(p1, 24));
+        _mm_storel_epi64((__m128i *) (alpha + i), _mm_packus_epi16(a, a));
+    }
+    return i;
+}
+
+int imageconvert_rgb_to_yuv422_sse2(const uint8_t *src, uint8_t *dst, int width)
+{
+    __m128i r, g, b;
+    int i;
+
+    // Stop early enough that load_rgb() does not read past the end of the line.
+    for (i = 0; i + 10 <= width; i += 8) {
+        unpack_rgba(load_rgb(src + 3 * i), load_rgb(src + 3 * i + 12), &r, &g, &b);
+        _mm_storeu_si128((__m128i *) (dst + 2 * i), rgb_to_yuv422(r, g, b));
+    }
+    return i;
+}
+
+int imageconvert_yuv420p_to_yuv422_sse2(
+    const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, uint8_t *dst, int width)
+{
+    int i;
+
+    for (i = 0; i + 16 <= width; i += 16) {
+        __m128i y = _mm_loadu_si128((const __m128i *) (src_y + i));
+        __m128i u = _mm_loadl_epi64((const __m128i *) (src_u + i / 2));
+        __m128i v = _mm_loadl_epi64((const __m128i *) (src_v + i / 2));
+        __m128i uv = _mm_unpacklo_epi8(u, v);
+        _mm_storeu_si128((__m128i *) (dst + 2 * i), _mm_unpacklo_epi8(y, uv));
+        _mm_storeu_si128((__m128i *) (dst + 2 * i + 16), _mm_unpackhi_epi8(y, uv));
+    }
+    return i;
+}
+
+int imageconvert_yuv420p_to_rgb_sse2(
+    const uint8_t *src_y, const uint8_t *src_u, const uint8_t *src_v, uint8_t *dst, int width)
+{
+    __m128i y, u, v, r, g, b, p0, p1;
+    int i;
+
+    for (i = 0; i + 8 <= width; i += 8) {
+        load_yuv420p(src_y + i, src_u + i / 2, src_v + i / 2, &y, &u, &v);
+        yuv_to_rgb(y, u, v, &r, &g, &b);
+        pack_rgba(r, g, b, r, &p0, &p1);
+        store_rgb(dst + 3 * i, p0);
+        store_rgb(dst + 3 * i + 12, p1);
+    }
+    return i;
+}
+
+int imageconvert_yuv420p_to_rgba_sse2(const uint8_t *src_y,
+                                      const uint8_t *src_u,
+                                      const uint8_t *src_v,
+                                      const uint8_t *alpha,
+                                      uint8_t *dst,
+                                      int width)
+{
+    __m128i y, u, v, r, g, b, a, p0, p1;
+    int i;
+
+    for (i = 0; i + 8 <= width; i += 8) {
+        load_yuv420p(src_y + i, src_u + i / 2, src_v + i / 2, &y, &u, &v);
+        yuv_to_rgb(y, u, v, &r, &g, &b);
+        a = alpha ? _mm_loadl_epi64((const __m128i *) (alpha + i)) : _mm_set1_epi8(-1);
+        pack_rgba(r, g, b, a, &p0, &p1);
+        _mm_storeu_si128((__m128i *) (dst + 4 * i), p0);
+        _mm_storeu_si128((__m128i *) (dst + 4 * i + 16), p1);
+    }
+    return i;
+}
+
+int imageconvert_yuv422_to_y_sse2(const uint8_t *src, uint8_t *dst, int width)
+{
+    __m128i mask = _mm_set1_epi16(0xff);
+    int i;
+
+    for (i = 0; i + 16 <= width; i += 16) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *) (src + 2 * i));
+        __m128i x1 = _mm_loadu_si128((const __m128i *) (src + 2 * i + 16));
+        _mm_storeu_si128((__m128i *) (dst + i),
+                         _mm_packus_epi16(_mm_and_si128(x0, mask), _mm_and_si128(x1, mask)));
+    }
+    return i;
+}
+
+int imageconvert_yuv422_to_uv_sse2(const uint8_t *src, uint8_t *dst_u, uint8_t *dst_v, int count)
+{
+    __m128i mask = _mm_set1_epi16(0xff);
+    int i;
+
+    for (i = 0; i + 8 <= count; i += 8) {
+        __m128i x0 = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+        __m128i x1 = _mm_loadu_si128((const __m128i *) (src + 4 * i + 16));
+        __m128i uv = _mm_packus_epi16(_mm_srli_epi16(x0, 8), _mm_srli_epi16(x1, 8));
+        __m128i u = _mm_and_si128(uv, mask);
+        __m128i v = _mm_srli_epi16(uv, 8);
+        _mm_storel_epi64((__m128i *) (dst_u + i), _mm_packus_epi16(u, u));
+        _mm_storel_epi64((__m128i *) (dst_v + i), _mm_packus_epi16(v, v));
+    }
+    return i;
+}
+
+int imageconvert_rgb_to_rgba_sse2(const uint8_t *src, const uint8_t *alpha, uint8_t *dst, int width)
+{
+    __m128i zero = _mm_setzero_si128();
+    int i;
+
+    // Stop early enough that load_rgb() does not read past the end of the line.
+    for (i = 0; i + 6 <= width; i += 4) {
+        __m128i a;
+        if (alpha) {
+            a = _mm_unpacklo_epi8(zero, _mm_cvtsi32_si128((int) read32(alpha + i)));
+            a = _mm_unpacklo_epi16(zero, a);
+        } else {
+            a = _mm_set1_epi32((int) 0xff000000);
+        }
+        _mm_storeu_si128((__m128i *) (dst + 4 * i), _mm_or_si128(load_rgb(src + 3 * i), a));
+    }
+    return i;
+}
+
+int imageconvert_rgba_to_rgb_sse2(const uint8_t *src, uint8_t *dst, uint8_t *alpha, int width)
+{
+    int i;
+
+    for (i = 0; i + 4 <= width; i += 4) {
+        __m128i x = _mm_loadu_si128((const __m128i *) (src + 4 * i));
+        __m128i a = _mm_srli_epi32(x, 24);
+        store_rgb(dst + 3 * i, x);
+        a = _mm_packs_epi32(a, a);
+        write32(alpha + i, (uint32_t) _mm_cvtsi128_si32(_mm_packus_epi16(a, a)));
+    }
+    return i;
+}
@@ -30,20 +30,18 @@
 // Private Types
 typedef struct
 {
-    mlt_position prev_integration_position;
-    double prev_integration_time;
+    double *source_times; // cumulative source time indexed by position relative to in
+    int source_times_count;
+    int source_times_size;
+    mlt_position source_times_length;
+    double source_times_fps;
     mlt_frame prev_frame;
     mlt_filter resample_filter;
     mlt_filter pitch_filter;
 } private_data;
 
-static void property_changed(mlt_service owner, mlt_link self, mlt_event_data event_data)
+static void apply_property(mlt_link self, const char *name)
 {
-    const char *name = mlt_event_data_to_string(event_data);
-
-    if (!name)
-        return;
-
     if (strcmp("map", name) == 0) {
         // Copy the deprecated "map" parameter to the new "time_map" parameter.
         const char *value = mlt_properties_get(MLT_LINK_PROPERTIES(self), "map");
@@ -51,11 +49,27 @@ static void property_changed(mlt_service owner, mlt_link self, mlt_event_data ev
     } else if (strcmp("speed_map", name) == 0) {
         // speed_map changed. Need to re-integrate from the beginning.
         private_data *pdata = (private_data *) self->child;
-        pdata->prev_integration_position = 0;
-        pdata->prev_integration_time = 0.0;
+        pdata->source_times_count = 0;
     }
 }
 
+static void property_changed(mlt_service owner, mlt_link self, mlt_event_data event_data)
+{
+    const char *name = mlt_event_data_to_string(event_data);
+
+    if (name)
+        apply_property(self, name);
+}
+
+static void properties_changed(mlt_service owner, mlt_link self, mlt_event_data event_data)
+{
+    mlt_properties names = mlt_event_data_to_object(event_data);
+    int count = mlt_properties_count(names);
+
+    for (int i = 0; i < count; i++)
+        apply_property(self, mlt_properties_get_name(names, i));
+}
+
 static double integrate_source_time(mlt_link self, mlt_position position)
 {
     private_data *pdata = (private_data *) self->child;
@@ -63,34 +77,60 @@ static double integrate_source_time(mlt_link self, mlt_position position)
     mlt_position length = mlt_producer_get_length(MLT_LINK_PRODUCER(self));
     mlt_position in = mlt_producer_get_in(MLT_LINK_PRODUCER(self));
     double link_fps = mlt_producer_get_fps(MLT_LINK_PRODUCER(self));
-    mlt_position integration_distance = abs(pdata->prev_integration_position - position);
+    mlt_position offset = position - in;
+    double source_time = 0.0;
 
-    if (pdata->prev_integration_position < in || integration_distance > (position - in)) {
-        // Restart integration from the beginning
-        pdata->prev_integration_position = in;
-        pdata->prev_integration_time = 0.0;
+    if (pdata->source_times_length != length || pdata->source_times_fps != link_fps) {
+        // The speed map is interpreted relative to the length and frame rate.
+        pdata->source_times_count = 0;
+        pdata->source_times_length = length;
+        pdata->source_times_fps = link_fps;
     }
 
-    double source_time = pdata->prev_integration_time;
-
-    if (pdata->prev_integration_position < position) {
-        for (mlt_position p = pdata->prev_integration_position; p < position; p++) {
-            double speed = mlt_properties_anim_get_double(properties, "speed_map", p - in, length);
-            double time_delta = speed / link_fps;
-            source_time += time_delta;
+    if (offset < 0) {
+        // Integrate backwards from the in point.
+        for (mlt_position p = offset; p < 0; p++) {
+            double speed = mlt_properties_anim_get_double(properties, "speed_map", p, length);
+            source_time -= speed / link_fps;
         }
-    } else if (pdata->prev_integration_position > position) {
-        for (mlt_position p = position; p < pdata->prev_integration_position; p++) {
-            double speed = mlt_properties_anim_get_double(properties, "speed_map", p - in, length);
-            double time_delta = speed / link_fps;
-            source_time -= time_delta;
+        return source_time;
+    }
+
+    if (offset >= pdata->source_times_size) {
+        int size = pdata->source_times_size ? pdata->source_times_size : 1024;
+        while (size <= offset)
+            size *= 2;
+        double *source_times = realloc(pdata->source_times, size * sizeof(*source_times));
+        if (source_times) {
+            pdata->source_times = source_times;
+            pdata->source_times_size = size;
         }
     }
 
-    // Remember the integration results so that the next frame can start
-    // integration from this position instead of from the beginning.
-    pdata->prev_integration_position = position;
-    pdata->prev_integration_time = source_time;
+    if (pdata->source_times_count == 0 && pdata->source_times_size > 0) {
+        pdata->source_times[0] = 0.0;
+        pdata->source_times_count = 1;
+    }
+
+    // Extend the table of cumulative source times as far as this position so
+    // that any position already visited resolves with a single lookup.
+    int count = MIN(offset + 1, pdata->source_times_size);
+    for (int p = pdata->source_times_count; p < count; p++) {
+        double speed = mlt_properties_anim_get_double(properties, "speed_map", p - 1, length);
+        pdata->source_times[p] = pdata->source_times[p - 1] + speed / link_fps;
+    }
+    pdata->source_times_count = MAX(pdata->source_times_count, count);
+
+    if (offset < pdata->source_times_count)
+        return pdata->source_times[offset];
+
+    // The table could not grow: continue integrating from its end.
+    if (pdata->source_times_count > 0)
+        source_time = pdata->source_times[pdata->source_times_count - 1];
+    for (mlt_position p = MAX(pdata->source_times_count - 1, 0); p < offset; p++) {
+        double speed = mlt_properties_anim_get_double(properties, "speed_map", p, length);
+        source_time += speed / link_fps;
+    }
     return source_time;
 }
 
@@ -672,6 +712,7 @@ static void link_close(mlt_link self)
             mlt_frame_close(pdata->prev_frame);
             mlt_filter_close(pdata->resample_filter);
             mlt_filter_close(pdata->pitch_filter);
+            free(pdata->source_times);
             free(pdata);
         }
         self->close = NULL;
@@ -696,10 +737,14 @@ mlt_link link_timeremap_init(mlt_profile profile, mlt_service_type type, const c
         // Signal that this link performs frame rate conversion
         mlt_properties_set_int(MLT_LINK_PROPERTIES(self), "_frc", 1);
 
+        mlt_events_listen_batched(MLT_LINK_PROPERTIES(self),
+                                  self,
+                                  "property-changed",
+                                  (mlt_listener) property_changed);
         mlt_events_listen(MLT_LINK_PROPERTIES(self),
                           self,
-                          "property-changed",
-                          (mlt_listener) property_changed);
+                          "properties-changed",
+                          (mlt_listener) properties_changed);
     } else {
         free(pdata);
         mlt_link_close(self);
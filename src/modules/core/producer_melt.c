@@ -447,6 +447,10 @@ mlt_producer producer_melt_init(mlt_profile profile,
                 } else {
                     fprintf(stderr, "Failed to load \"%s\"\n", argv[i]);
                 }
+            } else if (!strcmp(argv[i], "-chunks") || !strcmp(argv[i], "-chunk")) {
+                // Skip the option and its value only; the properties after it are not its own.
+                if (argv[i + 1] != NULL)
+                    i++;
             } else {
                 int backtrack = 0;
                 if (!strcmp(argv[i], "-serialise") || !strcmp(argv[i], "-consumer")
@@ -139,6 +139,14 @@ static inline int dissolve_yuv(mlt_frame frame,
 
     if (mlt_properties_get(&frame->parent, "distort"))
         mlt_properties_set(&that->parent, "distort", mlt_properties_get(&frame->parent, "distort"));
+    // When the tractor allows it, render the b frame while the a frame renders
+    if (mlt_properties_get_int(&that->parent, "parallel_tracks"))
+        mlt_frame_prefetch_image(that,
+                                 (fix_background_alpha && that->convert_image) ? mlt_image_rgba
+                                                                               : mlt_image_yuv422,
+                                 width_src,
+                                 height_src,
+                                 0);
     mlt_frame_get_image(frame, &p_dest, &format, &width, &height, 1);
     if (fix_background_alpha && frame->convert_image)
         frame->convert_image(frame, &p_dest, &format, mlt_image_yuv422);
@@ -245,6 +253,10 @@ static void luma_composite(mlt_frame a_frame,
         mlt_properties_set(&b_frame->parent,
                            "distort",
                            mlt_properties_get(&a_frame->parent, "distort"));
+    // When the tractor allows it, render the b frame while the a frame renders. With invert the
+    // frames are swapped, and the a frame is not rendered ahead.
+    if (!invert && mlt_properties_get_int(&b_frame->parent, "parallel_tracks"))
+        mlt_frame_prefetch_image(b_frame, format_src, width_src, height_src, 0);
     mlt_frame_get_image(a_frame, &p_dest, &format_dest, &width_dest, &height_dest, 1);
     if (fix_background_alpha && a_frame->convert_image)
         a_frame->convert_image(a_frame, &p_dest, &format_dest, mlt_image_yuv422);
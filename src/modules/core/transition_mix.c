@@ -124,6 +124,65 @@ static void combine_audio(double weight,
     }
 }
 
+/** Mix the audio of frame B into the audio of frame A according to the transition properties.
+*/
+
+static void mix_frames(mlt_transition transition,
+                       mlt_frame frame_a,
+                       mlt_frame frame_b,
+                       float *buffer_a,
+                       float *buffer_b,
+                       int channels_a,
+                       int channels_b,
+                       int channels,
+                       int samples)
+{
+    mlt_properties b_props = MLT_FRAME_PROPERTIES(frame_b);
+
+    if (mlt_properties_get_int(MLT_TRANSITION_PROPERTIES(transition), "sum")) {
+        double mix_start = 1.0, mix_end = 1.0;
+        if (mlt_properties_get(b_props, "audio.previous_mix"))
+            mix_start = mlt_properties_get_double(b_props, "audio.previous_mix");
+        if (mlt_properties_get(b_props, "audio.mix"))
+            mix_end = mlt_properties_get_double(b_props, "audio.mix");
+        if (mlt_properties_get_int(b_props, "audio.reverse")) {
+            mix_start = 1.0 - mix_start;
+            mix_end = 1.0 - mix_end;
+        }
+        sum_audio(mix_start,
+                  mix_end,
+                  buffer_a,
+                  buffer_b,
+                  channels_a,
+                  channels_b,
+                  channels,
+                  samples);
+    } else if (mlt_properties_get_int(MLT_TRANSITION_PROPERTIES(transition), "combine")) {
+        double weight = 1.0;
+        if (mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame_a), "meta.mixdown"))
+            weight = 1.0 - mlt_properties_get_double(MLT_FRAME_PROPERTIES(frame_a), "meta.volume");
+        combine_audio(weight, buffer_a, buffer_b, channels_a, channels_b, channels, samples);
+    } else {
+        double mix_start = 0.5, mix_end = 0.5;
+        if (mlt_properties_get(b_props, "audio.previous_mix"))
+            mix_start = mlt_properties_get_double(b_props, "audio.previous_mix");
+        if (mlt_properties_get(b_props, "audio.mix"))
+            mix_end = mlt_properties_get_double(b_props, "audio.mix");
+        if (mlt_properties_get_int(b_props, "audio.reverse")) {
+            mix_start = 1.0 - mix_start;
+            mix_end = 1.0 - mix_end;
+        }
+        mix_audio(mix_start,
+                  mix_end,
+                  buffer_a,
+                  buffer_b,
+                  channels_a,
+                  channels_b,
+                  channels,
+                  samples);
+    }
+}
+
 /** Get the audio.
 */
 
@@ -153,9 +212,29 @@ static int transition_get_audio(mlt_frame frame_a,
 
     // We can only mix interleaved 32-bit float.
     *format = mlt_audio_f32le;
-    // Get the audio from our producers
-    mlt_frame_get_audio(frame_b, (void **) &buffer_b, format, &frequency_b, &channels_b, &samples_b);
+    // Get the audio from our producers, rendering the b frame on another thread
+    // while the a frame is rendered if allowed
+    int prefetch_b = mlt_properties_get_int(b_props, "parallel_tracks")
+                     && !mlt_frame_prefetch_audio(frame_b,
+                                                  *format,
+                                                  frequency_b,
+                                                  channels_b,
+                                                  samples_b);
+    if (!prefetch_b)
+        mlt_frame_get_audio(frame_b,
+                            (void **) &buffer_b,
+                            format,
+                            &frequency_b,
+                            &channels_b,
+                            &samples_b);
     mlt_frame_get_audio(frame_a, (void **) &buffer_a, format, &frequency_a, &channels_a, &samples_a);
+    if (prefetch_b)
+        mlt_frame_get_audio(frame_b,
+                            (void **) &buffer_b,
+                            format,
+                            &frequency_b,
+                            &channels_b,
+                            &samples_b);
 
     // Prevent dividing by zero.
     if (!channels_a || !channels_b || !buffer_a || !buffer_b)
@@ -202,11 +281,35 @@ static int transition_get_audio(mlt_frame frame_a,
     // by saving the unused samples in a buffer and then using them first on the
     // next iteration.
 
-    // determine number of samples to process
-    *samples = MIN(self->src_buffer_count + samples_b, self->dest_buffer_count + samples_a);
     *channels = MIN(MIN(channels_b, channels_a), MAX_CHANNELS);
     *frequency = frequency_a;
 
+    // Usually nothing is left over from the previous frame and both frames have the same
+    // layout. Then mix straight into the audio of frame A instead of copying both frames
+    // through the carry-over buffers and the result into a new buffer.
+    if (!self->src_buffer_count && !self->dest_buffer_count && samples_a == samples_b
+        && channels_a == channels_b && channels_a == *channels) {
+        self->previous_frame_a = mlt_frame_get_position(frame_a);
+        self->previous_frame_b = mlt_frame_get_position(frame_b);
+        *samples = samples_a;
+        mix_frames(transition,
+                   frame_a,
+                   frame_b,
+                   buffer_a,
+                   buffer_b,
+                   channels_a,
+                   channels_b,
+                   *channels,
+                   *samples);
+        *buffer = buffer_a;
+        return error;
+    }
+    float *frame_buffer_a = buffer_a;
+    int frame_samples_a = samples_a;
+
+    // determine number of samples to process
+    *samples = MIN(self->src_buffer_count + samples_b, self->dest_buffer_count + samples_a);
+
     // Prevent src buffer overflow by discarding oldest samples.
     samples_b = MIN(samples_b, MAX_SAMPLES * MAX_CHANNELS / channels_b);
     size_t bytes = SAMPLE_BYTES(samples_b, channels_b);
@@ -254,40 +357,27 @@ static int transition_get_audio(mlt_frame frame_a,
     buffer_a = self->dest_buffer;
 
     // Do the mixing.
-    if (mlt_properties_get_int(MLT_TRANSITION_PROPERTIES(transition), "sum")) {
-        double mix_start = 1.0, mix_end = 1.0;
-        if (mlt_properties_get(b_props, "audio.previous_mix"))
-            mix_start = mlt_properties_get_double(b_props, "audio.previous_mix");
-        if (mlt_properties_get(b_props, "audio.mix"))
-            mix_end = mlt_properties_get_double(b_props, "audio.mix");
-        if (mlt_properties_get_int(b_props, "audio.reverse")) {
-            mix_start = 1.0 - mix_start;
-            mix_end = 1.0 - mix_end;
-        }
-        sum_audio(mix_start, mix_end, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples);
-    } else if (mlt_properties_get_int(MLT_TRANSITION_PROPERTIES(transition), "combine")) {
-        double weight = 1.0;
-        if (mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame_a), "meta.mixdown"))
-            weight = 1.0 - mlt_properties_get_double(MLT_FRAME_PROPERTIES(frame_a), "meta.volume");
-        combine_audio(weight, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples);
-    } else {
-        double mix_start = 0.5, mix_end = 0.5;
-        if (mlt_properties_get(b_props, "audio.previous_mix"))
-            mix_start = mlt_properties_get_double(b_props, "audio.previous_mix");
-        if (mlt_properties_get(b_props, "audio.mix"))
-            mix_end = mlt_properties_get_double(b_props, "audio.mix");
-        if (mlt_properties_get_int(b_props, "audio.reverse")) {
-            mix_start = 1.0 - mix_start;
-            mix_end = 1.0 - mix_end;
-        }
-        mix_audio(mix_start, mix_end, buffer_a, buffer_b, channels_a, channels_b, *channels, *samples);
-    }
+    mix_frames(transition,
+               frame_a,
+               frame_b,
+               buffer_a,
+               buffer_b,
+               channels_a,
+               channels_b,
+               *channels,
+               *samples);
 
     // Copy the audio from the dest buffer into the frame.
     bytes = SAMPLE_BYTES(*samples, *channels);
-    *buffer = mlt_pool_alloc(bytes);
-    memcpy(*buffer, buffer_a, bytes);
-    mlt_frame_set_audio(frame_a, *buffer, *format, bytes, mlt_pool_release);
+    if (*samples <= frame_samples_a && *channels == channels_a) {
+        // The result fits in the audio of frame A.
+        *buffer = frame_buffer_a;
+        memcpy(*buffer, buffer_a, bytes);
+    } else {
+        *buffer = mlt_pool_alloc(bytes);
+        memcpy(*buffer, buffer_a, bytes);
+        mlt_frame_set_audio(frame_a, *buffer, *format, bytes, mlt_pool_release);
+    }
 
     if (mlt_properties_get_int(b_props, "_speed") == 0) {
         // Flush the buffer when paused and scrubbing.
@@ -116,6 +116,75 @@ int interpBL_b32(
     return 0;
 }
 
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+#include <emmintrin.h>
+#include <string.h>
+
+static inline __m128 load_b32(const unsigned char *p)
+{
+    int v;
+    memcpy(&v, p, sizeof(v));
+    __m128i x = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v), _mm_setzero_si128());
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(x, _mm_setzero_si128()));
+}
+
+//  bilinear, all four channels at once
+//  This performs the same single precision operations as interpBL_b32, so the results match.
+
+int interpBL_b32_sse2(
+    unsigned char *s, int w, int h, float x, float y, float o, unsigned char *d, int is_atop)
+{
+    int m, n, k, l;
+    int c[4];
+    float v[4];
+
+#ifdef TEST_XY_LIMITS
+    if ((x < 0) || (x >= w) || (y < 0) || (y >= h))
+        return -1;
+#endif
+
+    m = (int) floorf(x);
+    if (m + 2 > w)
+        m = w - 2;
+    n = (int) floorf(y);
+    if (n + 2 > h)
+        n = h - 2;
+
+    k = 4 * (n * w + m);
+    l = 4 * ((n + 1) * w + m);
+
+    __m128 fx = _mm_set1_ps(x - (float) m);
+    __m128 fy = _mm_set1_ps(y - (float) n);
+    __m128 p00 = load_b32(s + k);
+    __m128 p01 = load_b32(s + k + 4);
+    __m128 p10 = load_b32(s + l);
+    __m128 p11 = load_b32(s + l + 4);
+    __m128 a = _mm_add_ps(p00, _mm_mul_ps(_mm_sub_ps(p01, p00), fx));
+    __m128 b = _mm_add_ps(p10, _mm_mul_ps(_mm_sub_ps(p11, p10), fx));
+    __m128 p = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fy));
+    _mm_storeu_ps(v, p);
+
+    float alpha_s = v[3];
+    float alpha_d = (float) d[3] / 255.0f;
+    if (is_atop)
+        d[3] = alpha_s;
+    alpha_s = alpha_s / 255.0f * o;
+    float alpha = alpha_s + alpha_d - alpha_s * alpha_d;
+    if (!is_atop)
+        d[3] = 255 * alpha;
+    alpha = alpha_s / alpha;
+
+    __m128 va = _mm_set1_ps(alpha);
+    __m128 vd = _mm_mul_ps(load_b32(d), _mm_sub_ps(_mm_set1_ps(1.0f), va));
+    _mm_storeu_si128((__m128i *) c, _mm_cvttps_epi32(_mm_add_ps(vd, _mm_mul_ps(p, va))));
+    d[0] = c[0];
+    d[1] = c[1];
+    d[2] = c[2];
+
+    return 0;
+}
+#endif
+
 // bicubic
 
 int interpBC_b32(
@@ -338,37 +338,253 @@ struct sliced_desc
     double minima, xmax, ymax;
 };
 
+// Limit the columns [*j0, *j1) to those where start + j * step may fall within [lower, upper].
+// The span is widened by a column on each side to absorb rounding; callers still test each pixel.
+static void clip_span(double start, double step, double lower, double upper, int *j0, int *j1)
+{
+    if (step == 0.0) {
+        if (start < lower || start > upper)
+            *j1 = *j0;
+        return;
+    }
+    double a = (lower - start) / step;
+    double b = (upper - start) / step;
+    if (a > b) {
+        double t = a;
+        a = b;
+        b = t;
+    }
+    a -= 1.0;
+    b += 2.0;
+    // Clamp to the incoming span before converting, since a double beyond int is undefined.
+    if (a > *j1)
+        a = *j1;
+    if (b < *j0)
+        b = *j0;
+    if (a > *j0)
+        *j0 = a;
+    if (b < *j1)
+        *j1 = b;
+}
+
+// Transform the columns [j0, j1) of a row starting at the mapped coordinates (dx, dy).
+// This is inlined with a constant interp so that the pixel loop makes a direct call.
+static inline void transform_row(const struct sliced_desc *ctx,
+                                 uint8_t *a_row,
+                                 double dx,
+                                 double dy,
+                                 double step_x,
+                                 double step_y,
+                                 int j0,
+                                 int j1,
+                                 interpp interp)
+{
+    uint8_t *d = a_row + j0 * 4;
+    for (int j = j0; j < j1; j++, d += 4) {
+        double x = dx + j * step_x;
+        double y = dy + j * step_y;
+        if (x >= ctx->minima && x <= ctx->xmax && y >= ctx->minima && y <= ctx->ymax)
+            interp(ctx->b_image, ctx->b_width, ctx->b_height, x, y, ctx->mix, d, ctx->b_alpha);
+    }
+}
+
 static int sliced_proc(int id, int index, int jobs, void *cookie)
 {
     (void) id; // unused
-    struct sliced_desc ctx = *((struct sliced_desc *) cookie);
-    int starty, height_slice = mlt_slices_size_slice(jobs, index, ctx.a_height, &starty);
-    double x, y;
-    double dx, dy;
-    int i, j;
-
-    ctx.a_image += starty * (ctx.a_width * 4);
-    for (i = 0, y = ctx.lower_y; i < ctx.a_height; i++, y++) {
-        if (i >= starty && i < (starty + height_slice)) {
-            for (j = 0, x = ctx.lower_x; j < ctx.a_width; j++, x++) {
-                dx = MapX(ctx.affine.matrix, x, y) / ctx.dz + ctx.x_offset;
-                dy = MapY(ctx.affine.matrix, x, y) / ctx.dz + ctx.y_offset;
-                if (dx >= ctx.minima && dx <= ctx.xmax && dy >= ctx.minima && dy <= ctx.ymax)
-                    ctx.interp(ctx.b_image,
-                               ctx.b_width,
-                               ctx.b_height,
-                               dx,
-                               dy,
-                               ctx.mix,
-                               ctx.a_image,
-                               ctx.b_alpha);
-                ctx.a_image += 4;
-            }
+    struct sliced_desc *ctx = (struct sliced_desc *) cookie;
+    int starty, height_slice = mlt_slices_size_slice(jobs, index, ctx->a_height, &starty);
+    // The mapping is linear, so step along each row instead of mapping every pixel.
+    double step_x = ctx->affine.matrix[0][0] / ctx->dz;
+    double step_y = ctx->affine.matrix[1][0] / ctx->dz;
+
+    for (int i = starty; i < starty + height_slice; i++) {
+        double y = ctx->lower_y + i;
+        double dx = MapX(ctx->affine.matrix, ctx->lower_x, y) / ctx->dz + ctx->x_offset;
+        double dy = MapY(ctx->affine.matrix, ctx->lower_x, y) / ctx->dz + ctx->y_offset;
+        uint8_t *a_row = ctx->a_image + i * ctx->a_width * 4;
+        int j0 = 0, j1 = ctx->a_width;
+
+        // Skip the columns that map outside of the B frame. Without rotation or shear
+        // step_y is 0, so rows above or below the B frame are skipped entirely.
+        clip_span(dx, step_x, ctx->minima, ctx->xmax, &j0, &j1);
+        clip_span(dy, step_y, ctx->minima, ctx->ymax, &j0, &j1);
+        if (j0 >= j1)
+            continue;
+
+        if (ctx->interp == interpNN_b32)
+            transform_row(ctx, a_row, dx, dy, step_x, step_y, j0, j1, interpNN_b32);
+        else if (ctx->interp == interpBC_b32)
+            transform_row(ctx, a_row, dx, dy, step_x, step_y, j0, j1, interpBC_b32);
+        else
+#if defined(USE_SSE) && defined(ARCH_X86_64)
+            transform_row(ctx, a_row, dx, dy, step_x, step_y, j0, j1, interpBL_b32_sse2);
+#else
+            transform_row(ctx, a_row, dx, dy, step_x, step_y, j0, j1, interpBL_b32);
+#endif
+    }
+    return 0;
+}
+
+/** Get the unscaled region of the b frame.
+*/
+
+static mlt_rect get_rect(mlt_properties properties,
+                         mlt_position position,
+                         int length,
+                         int normalized_width,
+                         int normalized_height)
+{
+    mlt_rect result = {0, 0, normalized_width, normalized_height, 1.0};
+
+    if (mlt_properties_get(properties, "rect")) {
+        // Determine length and obtain cycle
+        double cycle = mlt_properties_get_double(properties, "cycle");
+
+        // Allow a repeat cycle
+        if (cycle >= 1)
+            length = cycle;
+        else if (cycle > 0)
+            length *= cycle;
+
+        mlt_position anim_pos = repeat_position(properties, "rect", position, length);
+        result = mlt_properties_anim_get_rect(properties, "rect", anim_pos, length);
+        if (mlt_properties_get(properties, "rect")
+            && strchr(mlt_properties_get(properties, "rect"), '%')) {
+            result.x *= normalized_width;
+            result.y *= normalized_height;
+            result.w *= normalized_width;
+            result.h *= normalized_height;
+        }
+        result.o = (result.o == DBL_MIN) ? 1.0 : MIN(result.o, 1.0);
+    }
+    return result;
+}
+
+/** Fit the region to the aspect ratio of the b frame.
+*/
+
+static void fit_rect(mlt_rect *result, double consumer_ar, double b_ar, int b_width, int b_height)
+{
+    double b_dar = b_ar * b_width / b_height;
+    double geometry_dar = result->w * consumer_ar / result->h;
+
+    if (b_dar > geometry_dar) {
+        result->w = MIN(result->w, b_width * b_ar / consumer_ar);
+        result->h = result->w * consumer_ar / b_dar;
+    } else {
+        result->h = MIN(result->h, b_height);
+        result->w = result->h * b_dar / consumer_ar;
+    }
+}
+
+/** Choose the size at which to request the b frame image.
+ *
+ * \p b_width and \p b_height are the size of the media on input.
+ * \return true if the b frame image is to be requested at the resolution of its media
+ */
+
+static int b_image_size(mlt_frame b_frame,
+                        mlt_properties properties,
+                        mlt_rect result,
+                        double scale_width,
+                        double scale_height,
+                        int width,
+                        int height,
+                        int *b_width,
+                        int *b_height)
+{
+    mlt_properties b_props = MLT_FRAME_PROPERTIES(b_frame);
+    double b_ar = mlt_frame_get_aspect_ratio(b_frame);
+    double b_dar = b_ar * *b_width / *b_height;
+    int fill = mlt_properties_get_int(properties, "fill");
+    int distort = mlt_properties_get_int(properties, "distort");
+
+    if (scale_width != 1.0 || scale_height != 1.0) {
+        // Scale request of b frame image to consumer scale maintaining its aspect ratio.
+        *b_height = CLAMP(height, 1, MLT_AFFINE_MAX_DIMENSION);
+        *b_width = MAX(*b_height * b_dar / b_ar, 1);
+        if (*b_width > MLT_AFFINE_MAX_DIMENSION) {
+            *b_width = CLAMP(width, 1, MLT_AFFINE_MAX_DIMENSION);
+            *b_height = MAX(*b_width * b_ar / b_dar, 1);
+        }
+    } else if (mlt_properties_get_int(b_props, "always_scale")
+               || (!mlt_properties_get_int(b_props, "interpolation_not_required")
+                   && (fill || distort || *b_width > result.w || *b_height > result.h
+                       || mlt_properties_get_int(properties, "b_scaled")))) {
+        // Request b frame image scaled to what is needed.
+        *b_height = CLAMP(result.h, 1, MLT_AFFINE_MAX_DIMENSION);
+        *b_width = MAX(*b_height * b_dar / b_ar, 1);
+        if (*b_width > MLT_AFFINE_MAX_DIMENSION) {
+            *b_width = CLAMP(result.w, 1, MLT_AFFINE_MAX_DIMENSION);
+            *b_height = MAX(*b_width * b_ar / b_dar, 1);
         }
+    } else {
+        // Request at resolution of b frame image. This only happens when not using fill or distort mode
+        // and the image is smaller than the rect with the intention to prevent scaling of the
+        // image and merely position and possibly transform.
+        return 1;
     }
     return 0;
 }
 
+/** The b frame properties that request_b_image() sets */
+
+static const char *b_request_names[]
+    = {"consumer.rescale", "distort", "rescale_width", "rescale_height", NULL};
+
+/** Copy the b frame properties that request_b_image() sets from \p from to \p to.
+ *
+ * Those that \p from does not have are cleared on \p to.
+ */
+
+static void copy_b_request(mlt_properties to, mlt_properties from)
+{
+    int i;
+
+    for (i = 0; b_request_names[i]; i++) {
+        if (mlt_properties_get(from, b_request_names[i]))
+            mlt_properties_pass_property(to, from, b_request_names[i]);
+        else
+            mlt_properties_clear(to, b_request_names[i]);
+    }
+}
+
+/** Set up the b frame for the request chosen by b_image_size().
+ */
+
+static void request_b_image(
+    mlt_frame a_frame, mlt_frame b_frame, int native, int b_width, int b_height)
+{
+    mlt_properties a_props = MLT_FRAME_PROPERTIES(a_frame);
+    mlt_properties b_props = MLT_FRAME_PROPERTIES(b_frame);
+
+    if (!native) {
+        // Set the rescale interpolation to match the frame
+        mlt_properties_set(b_props,
+                           "consumer.rescale",
+                           mlt_properties_get(a_props, "consumer.rescale"));
+        // Disable padding (resize filter)
+        mlt_properties_set_int(b_props, "distort", 1);
+    } else {
+        mlt_properties_set_int(b_props, "rescale_width", b_width);
+        mlt_properties_set_int(b_props, "rescale_height", b_height);
+
+        const char *b_resource = mlt_properties_get(MLT_PRODUCER_PROPERTIES(
+                                                        mlt_frame_get_original_producer(b_frame)),
+                                                    "resource");
+        // Check if we are applied as a filter inside a transition
+        if (b_resource && !strcmp("<track>", b_resource)) {
+            // Set the rescale interpolation to match the frame
+            mlt_properties_set(b_props,
+                               "consumer.rescale",
+                               mlt_properties_get(a_props, "consumer.rescale"));
+        } else {
+            // Suppress padding and aspect normalization.
+            mlt_properties_set(b_props, "consumer.rescale", "none");
+        }
+    }
+}
+
 /** Get the image.
 */
 
@@ -432,40 +648,60 @@ static int transition_get_image(mlt_frame a_frame,
         *height = normalized_height;
     }
 
+    // When the tractor allows it, render the b frame on another thread while the
+    // a frame is rendered. Request it as below, expecting the a frame at the
+    // requested size; the request is checked against the actual a frame below.
+    int prefetch_b = 0;
+    int prefetch_native = 0;
+    int prefetch_width = b_width;
+    int prefetch_height = b_height;
+    mlt_properties b_request = NULL;
+    if (mlt_properties_get_int(b_props, "parallel_tracks")) {
+        double scale_width = mlt_profile_scale_width(profile, *width);
+        double scale_height = mlt_profile_scale_height(profile, *height);
+        mlt_service_lock(MLT_TRANSITION_SERVICE(transition));
+        mlt_rect result
+            = get_rect(properties, position, length, normalized_width, normalized_height);
+        mlt_service_unlock(MLT_TRANSITION_SERVICE(transition));
+        result.x *= scale_width;
+        result.y *= scale_height;
+        result.w *= scale_width;
+        result.h *= scale_height;
+        if (!mlt_properties_get_int(properties, "fill"))
+            fit_rect(&result, consumer_ar, b_ar, b_width, b_height);
+        prefetch_native = b_image_size(b_frame,
+                                       properties,
+                                       result,
+                                       scale_width,
+                                       scale_height,
+                                       *width,
+                                       *height,
+                                       &prefetch_width,
+                                       &prefetch_height);
+        // Keep what the request changes in case the a frame needs another request
+        b_request = mlt_properties_new();
+        copy_b_request(b_request, b_props);
+        request_b_image(a_frame, b_frame, prefetch_native, prefetch_width, prefetch_height);
+        mlt_properties_set_int(b_props, "consumer.progressive", 1);
+        prefetch_b
+            = !mlt_frame_prefetch_image(b_frame, b_format, prefetch_width, prefetch_height, 0);
+    }
+
     // Fetch the a frame image
     *format = mlt_image_rgba;
     int error = mlt_frame_get_image(a_frame, image, format, width, height, 1);
-    if (error || !image)
+    if (error || !image) {
+        mlt_properties_close(b_request);
         return error;
+    }
 
     // Calculate the region now
     double scale_width = mlt_profile_scale_width(profile, *width);
     double scale_height = mlt_profile_scale_height(profile, *height);
-    mlt_rect result = {0, 0, normalized_width, normalized_height, 1.0};
 
     mlt_service_lock(MLT_TRANSITION_SERVICE(transition));
 
-    if (mlt_properties_get(properties, "rect")) {
-        // Determine length and obtain cycle
-        double cycle = mlt_properties_get_double(properties, "cycle");
-
-        // Allow a repeat cycle
-        if (cycle >= 1)
-            length = cycle;
-        else if (cycle > 0)
-            length *= cycle;
-
-        mlt_position anim_pos = repeat_position(properties, "rect", position, length);
-        result = mlt_properties_anim_get_rect(properties, "rect", anim_pos, length);
-        if (mlt_properties_get(properties, "rect")
-            && strchr(mlt_properties_get(properties, "rect"), '%')) {
-            result.x *= normalized_width;
-            result.y *= normalized_height;
-            result.w *= normalized_width;
-            result.h *= normalized_height;
-        }
-        result.o = (result.o == DBL_MIN) ? 1.0 : MIN(result.o, 1.0);
-    }
+    mlt_rect result = get_rect(properties, position, length, normalized_width, normalized_height);
 
     int threads = mlt_properties_get_int(properties, "threads");
     threads = CLAMP(threads, 0, mlt_slices_count_normal());
@@ -482,71 +718,30 @@ static int transition_get_image(mlt_frame a_frame,
     int fill = mlt_properties_get_int(properties, "fill");
     int distort = mlt_properties_get_int(properties, "distort");
 
-    if (!fill) {
-        double geometry_dar = result.w * consumer_ar / result.h;
-
-        if (b_dar > geometry_dar) {
-            result.w = MIN(result.w, b_width * b_ar / consumer_ar);
-            result.h = result.w * consumer_ar / b_dar;
-        } else {
-            result.h = MIN(result.h, b_height);
-            result.w = result.h * b_dar / consumer_ar;
-        }
-    }
+    if (!fill)
+        fit_rect(&result, consumer_ar, b_ar, b_width, b_height);
 
     // Fetch the b frame image
-    if (scale_width != 1.0 || scale_height != 1.0) {
-        // Scale request of b frame image to consumer scale maintaining its aspect ratio.
-        b_height = CLAMP(*height, 1, MLT_AFFINE_MAX_DIMENSION);
-        b_width = MAX(b_height * b_dar / b_ar, 1);
-        if (b_width > MLT_AFFINE_MAX_DIMENSION) {
-            b_width = CLAMP(*width, 1, MLT_AFFINE_MAX_DIMENSION);
-            b_height = MAX(b_width * b_ar / b_dar, 1);
-        }
-        // Set the rescale interpolation to match the frame
-        mlt_properties_set(b_props,
-                           "consumer.rescale",
-                           mlt_properties_get(a_props, "consumer.rescale"));
-        // Disable padding (resize filter)
-        mlt_properties_set_int(b_props, "distort", 1);
-    } else if (mlt_properties_get_int(b_props, "always_scale")
-               || (!mlt_properties_get_int(b_props, "interpolation_not_required")
-                   && (fill || distort || b_width > result.w || b_height > result.h
-                       || mlt_properties_get_int(properties, "b_scaled")))) {
-        // Request b frame image scaled to what is needed.
-        b_height = CLAMP(result.h, 1, MLT_AFFINE_MAX_DIMENSION);
-        b_width = MAX(b_height * b_dar / b_ar, 1);
-        if (b_width > MLT_AFFINE_MAX_DIMENSION) {
-            b_width = CLAMP(result.w, 1, MLT_AFFINE_MAX_DIMENSION);
-            b_height = MAX(b_width * b_ar / b_dar, 1);
-        }
-        // Set the rescale interpolation to match the frame
-        mlt_properties_set(b_props,
-                           "consumer.rescale",
-                           mlt_properties_get(a_props, "consumer.rescale"));
-        // Disable padding (resize filter)
-        mlt_properties_set_int(b_props, "distort", 1);
-    } else {
-        // Request at resolution of b frame image. This only happens when not using fill or distort mode
-        // and the image is smaller than the rect with the intention to prevent scaling of the
-        // image and merely position and possibly transform.
-        mlt_properties_set_int(b_props, "rescale_width", b_width);
-        mlt_properties_set_int(b_props, "rescale_height", b_height);
-
-        const char *b_resource = mlt_properties_get(MLT_PRODUCER_PROPERTIES(
-                                                        mlt_frame_get_original_producer(b_frame)),
-                                                    "resource");
-        // Check if we are applied as a filter inside a transition
-        if (b_resource && !strcmp("<track>", b_resource)) {
-            // Set the rescale interpolation to match the frame
-            mlt_properties_set(b_props,
-                               "consumer.rescale",
-                               mlt_properties_get(a_props, "consumer.rescale"));
-        } else {
-            // Suppress padding and aspect normalization.
-            mlt_properties_set(b_props, "consumer.rescale", "none");
-        }
+    int native = b_image_size(b_frame,
+                              properties,
+                              result,
+                              scale_width,
+                              scale_height,
+                              *width,
+                              *height,
+                              &b_width,
+                              &b_height);
+    if (prefetch_b && native != prefetch_native) {
+        // The a frame did not come back as expected, and the prefetch set up the b frame for
+        // another kind of request. Discard it and undo that before rendering b again.
+        mlt_frame_prefetch_cancel(b_frame);
+        copy_b_request(b_props, b_request);
+        prefetch_b = 0;
     }
+    mlt_properties_close(b_request);
+    // Otherwise a prefetch at another size is rendered again with the same set up
+    if (!prefetch_b)
+        request_b_image(a_frame, b_frame, native, b_width, b_height);
     mlt_log_debug(MLT_TRANSITION_SERVICE(transition),
                   "requesting image B at resolution %dx%d\n",
                   b_width,
@@ -425,10 +425,12 @@ static void on_start_tractor(deserialise_context context, const xmlChar *name, c
     track_service(context->destructors, service, (mlt_destructor) mlt_tractor_close);
     mlt_properties_set_lcnumeric(MLT_SERVICE_PROPERTIES(service), context->lc_numeric);
 
+    mlt_properties_begin_update(properties);
     for (; atts != NULL && *atts != NULL; atts += 2)
-        mlt_properties_set_string(MLT_SERVICE_PROPERTIES(service),
+        mlt_properties_set_string(properties,
                                   (const char *) atts[0],
                                   atts[1] == NULL ? "" : (const char *) atts[1]);
+    mlt_properties_commit_update(properties);
 
     if (mlt_properties_get(properties, "id") != NULL)
         mlt_properties_set_data(context->producer_map,
@@ -484,10 +486,12 @@ static void on_start_multitrack(deserialise_context context,
     if (type == mlt_tractor_type) {
         mlt_service service = MLT_SERVICE(mlt_tractor_multitrack(MLT_TRACTOR(parent)));
         mlt_properties properties = MLT_SERVICE_PROPERTIES(service);
+        mlt_properties_begin_update(properties);
         for (; atts != NULL && *atts != NULL; atts += 2)
             mlt_properties_set_string(properties,
                                       (const char *) atts[0],
                                       atts[1] == NULL ? "" : (const char *) atts[1]);
+        mlt_properties_commit_update(properties);
 
         if (mlt_properties_get(properties, "id") != NULL)
             mlt_properties_set_data(context->producer_map,
@@ -522,6 +526,7 @@ static void on_start_playlist(deserialise_context context, const xmlChar *name,
 
     track_service(context->destructors, service, (mlt_destructor) mlt_playlist_close);
 
+    mlt_properties_begin_update(properties);
     for (; atts != NULL && *atts != NULL; atts += 2) {
         mlt_properties_set_string(properties,
                                   (const char *) atts[0],
@@ -531,6 +536,7 @@ static void on_start_playlist(deserialise_context context, const xmlChar *name,
         if (xmlStrcmp(atts[0], _x("out")) == 0)
             mlt_properties_set_string(properties, "_xml.out", (const char *) atts[1]);
     }
+    mlt_properties_commit_update(properties);
 
     if (mlt_properties_get(properties, "id") != NULL)
         mlt_properties_set_data(context->producer_map,
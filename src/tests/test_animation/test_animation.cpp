@@ -1056,6 +1056,91 @@ private Q_SLOTS:
             QVERIFY(boun <= 100.1);
         }
     }
+
+    void ManyKeysForwardAndBackward()
+    {
+        Properties p;
+        QString s;
+        for (int i = 0; i < 1000; i++)
+            s += QStringLiteral("%1=%2 %2 %2 %2 1;").arg(i * 10).arg(i);
+        p.set("foo", s.toLatin1().constData());
+        for (int i = 0; i < 999; i++) {
+            QCOMPARE(p.anim_get_double("foo", i * 10), double(i));
+            QCOMPARE(p.anim_get_double("foo", i * 10 + 5), i + 0.5);
+        }
+        for (int i = 998; i >= 0; i--) {
+            mlt_rect r = p.anim_get_rect("foo", i * 10 + 5);
+            QCOMPARE(r.x, i + 0.5);
+            QCOMPARE(r.h, i + 0.5);
+            QCOMPARE(r.o, 1.0);
+        }
+        QCOMPARE(p.anim_get_double("foo", -10), 0.0);
+        QCOMPARE(p.anim_get_double("foo", 20000), 999.0);
+
+        // Editing the animation must refresh the baked values.
+        p.anim_set("foo", 100.0, 505);
+        QCOMPARE(p.anim_get_double("foo", 500), 50.0);
+        QCOMPARE(p.anim_get_double("foo", 505), 100.0);
+        QCOMPARE(p.anim_get_double("foo", 510), 51.0);
+        Animation a = p.get_animation("foo");
+        QCOMPARE(a.key_count(), 1001);
+        a.remove(505);
+        QCOMPARE(p.anim_get_double("foo", 505), 50.5);
+    }
+
+    void GetDoubleSequential_data()
+    {
+        QTest::addColumn<int>("keys");
+        QTest::newRow("10 keys") << 10;
+        QTest::newRow("1k keys") << 1000;
+        QTest::newRow("100k keys") << 100000;
+    }
+
+    // Each iteration reads every frame once as a renderer would, so the
+    // time per frame should stay flat as the number of keys grows.
+    void GetDoubleSequential()
+    {
+        QFETCH(int, keys);
+        const int kFrames = keys * 10;
+        Properties p;
+        QString s;
+        for (int i = 0; i < keys; i++)
+            s += QStringLiteral("%1~=%2;").arg(i * 10).arg(i % 97);
+        p.set("foo", s.toLatin1().constData());
+        p.anim_get_double("foo", 0);
+        QBENCHMARK {
+            double sum = 0.0;
+            for (int i = 0; i < kFrames; i++)
+                sum += p.anim_get_double("foo", i);
+            QVERIFY(sum > 0.0);
+        }
+    }
+
+    void GetRectSequential_data()
+    {
+        QTest::addColumn<int>("keys");
+        QTest::newRow("10 keys") << 10;
+        QTest::newRow("1k keys") << 1000;
+        QTest::newRow("100k keys") << 100000;
+    }
+
+    void GetRectSequential()
+    {
+        QFETCH(int, keys);
+        const int kFrames = keys * 10;
+        Properties p;
+        QString s;
+        for (int i = 0; i < keys; i++)
+            s += QStringLiteral("%1=%2 %2 100 100 1;").arg(i * 10).arg(i % 97);
+        p.set("foo", s.toLatin1().constData());
+        p.anim_get_rect("foo", 0);
+        QBENCHMARK {
+            double sum = 0.0;
+            for (int i = 0; i < kFrames; i++)
+                sum += p.anim_get_rect("foo", i).w;
+            QVERIFY(sum > 0.0);
+        }
+    }
 };
 
 QTEST_APPLESS_MAIN(TestAnimation)
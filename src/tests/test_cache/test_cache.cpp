@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest>
+
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+static int released = 0;
+
+static void countingDestructor(void *)
+{
+    released++;
+}
+
+static mlt_frame makeFrame(mlt_position position, mlt_image_format format, int width, int height)
+{
+    mlt_frame frame = mlt_frame_init(nullptr);
+    mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+    int size = mlt_image_format_size(format, width, height, nullptr);
+    auto image = static_cast<uint8_t *>(mlt_pool_alloc(size));
+    memset(image, 0, size);
+    mlt_frame_set_image(frame, image, size, mlt_pool_release);
+    mlt_properties_set_position(properties, "original_position", position);
+    mlt_properties_set_int(properties, "format", format);
+    mlt_properties_set_int(properties, "width", width);
+    mlt_properties_set_int(properties, "height", height);
+    return frame;
+}
+
+static void putFrame(mlt_cache cache, mlt_position position, mlt_image_format format)
+{
+    mlt_frame frame = makeFrame(position, format, 4, 4);
+    mlt_cache_put_frame(cache, frame);
+    mlt_frame_close(frame);
+}
+
+static bool hasFrame(mlt_cache cache, mlt_position position)
+{
+    mlt_frame frame = mlt_cache_get_frame(cache, position);
+    mlt_frame_close(frame);
+    return frame != nullptr;
+}
+
+static int imageFormat(mlt_frame frame)
+{
+    return mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "format");
+}
+
+static int cacheStat(mlt_cache cache, const char *name)
+{
+    Properties stats;
+    mlt_cache_get_stats(cache, stats.get_properties());
+    return stats.get_int(name);
+}
+
+class TestCache : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestCache() { Factory::init(); }
+
+private Q_SLOTS:
+
+    void GetFindsPutItem()
+    {
+        mlt_cache cache = mlt_cache_init();
+        int object = 0, other = 0, data = 42;
+        mlt_cache_put(cache, &object, &data, sizeof(data), nullptr);
+        mlt_cache_item item = mlt_cache_get(cache, &object);
+        QVERIFY(item != nullptr);
+        QCOMPARE(mlt_cache_item_data(item, nullptr), &data);
+        mlt_cache_item_close(item);
+        QVERIFY(mlt_cache_get(cache, &other) == nullptr);
+        QCOMPARE(cacheStat(cache, "hits"), 1);
+        QCOMPARE(cacheStat(cache, "misses"), 1);
+        mlt_cache_close(cache);
+    }
+
+    void PutEvictsLeastRecentlyUsed()
+    {
+        mlt_cache cache = mlt_cache_init();
+        int a = 0, b = 0, c = 0;
+        mlt_cache_set_size(cache, 2);
+        released = 0;
+        mlt_cache_put(cache, &a, &a, 1, countingDestructor);
+        mlt_cache_put(cache, &b, &b, 1, countingDestructor);
+        // Using a makes b the least recently used
+        mlt_cache_item_close(mlt_cache_get(cache, &a));
+        mlt_cache_put(cache, &c, &c, 1, countingDestructor);
+        QCOMPARE(released, 1);
+        QCOMPARE(cacheStat(cache, "evictions"), 1);
+        QVERIFY(mlt_cache_get(cache, &b) == nullptr);
+        mlt_cache_item item = mlt_cache_get(cache, &a);
+        QVERIFY(item != nullptr);
+        mlt_cache_item_close(item);
+        item = mlt_cache_get(cache, &c);
+        QVERIFY(item != nullptr);
+        mlt_cache_item_close(item);
+        mlt_cache_close(cache);
+    }
+
+    void PutEvictsBeyondMaxBytes()
+    {
+        mlt_cache cache = mlt_cache_init();
+        int a = 0, b = 0;
+        mlt_cache_set_max_bytes(cache, 100);
+        mlt_cache_put(cache, &a, &a, 60, nullptr);
+        mlt_cache_put(cache, &b, &b, 60, nullptr);
+        QCOMPARE(cacheStat(cache, "count"), 1);
+        QCOMPARE(cacheStat(cache, "bytes"), 60);
+        QCOMPARE(cacheStat(cache, "evictions"), 1);
+        QVERIFY(mlt_cache_get(cache, &a) == nullptr);
+        mlt_cache_close(cache);
+    }
+
+    void GetFrameFindsMostRecentlyUsedImage()
+    {
+        mlt_cache cache = mlt_cache_init();
+        putFrame(cache, 5, mlt_image_rgba);
+        putFrame(cache, 5, mlt_image_yuv422);
+        mlt_frame frame = mlt_cache_get_frame(cache, 5);
+        QVERIFY(frame != nullptr);
+        QCOMPARE(imageFormat(frame), int(mlt_image_yuv422));
+        mlt_frame_close(frame);
+        frame = mlt_cache_get_frame_image(cache, 5, mlt_image_rgba, 0, 0);
+        QVERIFY(frame != nullptr);
+        mlt_frame_close(frame);
+        frame = mlt_cache_get_frame(cache, 5);
+        QVERIFY(frame != nullptr);
+        QCOMPARE(imageFormat(frame), int(mlt_image_rgba));
+        mlt_frame_close(frame);
+        QVERIFY(mlt_cache_get_frame(cache, 6) == nullptr);
+        QCOMPARE(cacheStat(cache, "hits"), 3);
+        QCOMPARE(cacheStat(cache, "misses"), 1);
+        mlt_cache_close(cache);
+    }
+
+    void SharedFrameCacheKeepsEachCacheSize()
+    {
+        mlt_cache shared = mlt_cache_shared_frames();
+        mlt_cache_set_max_bytes(shared, 1 << 30);
+        mlt_cache cache = mlt_cache_init();
+        mlt_cache other = mlt_cache_init();
+        mlt_cache_set_size(cache, 2);
+        mlt_cache_set_size(other, 2);
+        putFrame(cache, 0, mlt_image_rgba);
+        putFrame(cache, 1, mlt_image_rgba);
+        putFrame(other, 0, mlt_image_rgba);
+        putFrame(other, 1, mlt_image_rgba);
+        putFrame(cache, 2, mlt_image_rgba);
+        QCOMPARE(cacheStat(shared, "count"), 4);
+        QVERIFY(!hasFrame(cache, 0));
+        QVERIFY(hasFrame(cache, 1));
+        QVERIFY(hasFrame(cache, 2));
+        QVERIFY(hasFrame(other, 0));
+        QVERIFY(hasFrame(other, 1));
+        mlt_cache_close(cache);
+        mlt_cache_close(other);
+        QCOMPARE(cacheStat(shared, "count"), 0);
+        mlt_cache_set_max_bytes(shared, 0);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestCache)
+
+#include "test_cache.moc"
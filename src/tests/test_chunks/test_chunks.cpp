@@ -0,0 +1,203 @@
+/*
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ */
+
+#include <chunks.h>
+#include <QtTest>
+
+#include <climits>
+
+#ifdef HAVE_LIBAVFORMAT
+extern "C" {
+#include <libavformat/avformat.h>
+}
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+/** Render frames [in, out] of a colour clip with audio to target as melt -chunks does. */
+static bool render(Profile &profile, const char *target, int in, int out, const char *only = nullptr)
+{
+    Producer producer(profile, "colour:red");
+    Consumer consumer(profile, "avformat", target);
+    if (!producer.is_valid() || !consumer.is_valid())
+        return false;
+    producer.set("out", 99);
+    producer.set_in_and_out(in, out);
+    consumer.set("f", "matroska");
+    consumer.set("vcodec", "mpeg4");
+    consumer.set("acodec", "pcm_s16le");
+    consumer.set("g", 10);
+    consumer.set("terminate_on_pause", 1);
+    if (only && !strcmp(only, "video")) {
+        consumer.set("an", 1);
+        consumer.set("audio_off", 1);
+    } else if (only && !strcmp(only, "audio")) {
+        consumer.set("vn", 1);
+        consumer.set("video_off", 1);
+    }
+    consumer.connect(producer);
+    consumer.run();
+    return true;
+}
+
+/** Count the video packets of a file and get its duration in microseconds. */
+static bool probe(const char *filename, int &frames, int64_t &duration)
+{
+    AVFormatContext *context = nullptr;
+    AVPacket *pkt = av_packet_alloc();
+    frames = 0;
+    duration = 0;
+    if (!pkt || avformat_open_input(&context, filename, nullptr, nullptr) < 0
+        || avformat_find_stream_info(context, nullptr) < 0) {
+        av_packet_free(&pkt);
+        return false;
+    }
+    duration = context->duration;
+    while (av_read_frame(context, pkt) >= 0) {
+        if (context->streams[pkt->stream_index]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+            frames++;
+        av_packet_unref(pkt);
+    }
+    avformat_close_input(&context);
+    av_packet_free(&pkt);
+    return true;
+}
+#endif
+
+class TestChunks : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestChunks() {}
+
+private Q_SLOTS:
+
+    void ChunksCoverTheRangeWithoutGaps_data()
+    {
+        QTest::addColumn<int>("in");
+        QTest::addColumn<int>("out");
+        QTest::addColumn<int>("count");
+        QTest::newRow("even") << 0 << 99 << 4;
+        QTest::newRow("uneven") << 10 << 1009 << 7;
+        QTest::newRow("one frame each") << 5 << 12 << 8;
+        QTest::newRow("long") << 0 << 2000000000 << 16;
+    }
+
+    void ChunksCoverTheRangeWithoutGaps()
+    {
+        QFETCH(int, in);
+        QFETCH(int, out);
+        QFETCH(int, count);
+        QCOMPARE(chunk_start(in, out, count, 0), in);
+        QCOMPARE(chunk_start(in, out, count, count), out + 1);
+        for (int i = 0; i < count; i++)
+            QVERIFY(chunk_start(in, out, count, i) < chunk_start(in, out, count, i + 1));
+    }
+
+    void ChunkSizesDifferByAtMostOneFrame()
+    {
+        int in = 3, out = 3 + 29970 - 1, count = 11;
+        int smallest = INT_MAX, largest = 0;
+        for (int i = 0; i < count; i++) {
+            int size = chunk_start(in, out, count, i + 1) - chunk_start(in, out, count, i);
+            smallest = qMin(smallest, size);
+            largest = qMax(largest, size);
+        }
+        QVERIFY(largest - smallest <= 1);
+    }
+
+    void ChunksBeyondTheLengthAreEmpty()
+    {
+        int in = 0, out = 2, count = 5;
+        int frames = 0;
+        for (int i = 0; i < count; i++) {
+            int size = chunk_start(in, out, count, i + 1) - chunk_start(in, out, count, i);
+            QVERIFY(size == 0 || size == 1);
+            frames += size;
+        }
+        QCOMPARE(frames, 3);
+        QCOMPARE(chunk_start(in, out, count, -1), in);
+        QCOMPARE(chunk_start(in, out, count, count + 1), out + 1);
+    }
+
+    void ChunkTargetKeepsTheExtension()
+    {
+        char *name = chunk_target("out.mp4", 0);
+        QCOMPARE(name, "out.chunk000.mp4");
+        free(name);
+        name = chunk_target("/tmp/dir.d/out", 12);
+        QCOMPARE(name, "/tmp/dir.d/out.chunk012");
+        free(name);
+        name = chunk_target("renders/.hidden", 3);
+        QCOMPARE(name, "renders/.hidden.chunk003");
+        free(name);
+    }
+
+#ifdef HAVE_LIBAVFORMAT
+    void JoinedChunksMatchASingleRender()
+    {
+        Factory::init();
+        Profile profile;
+        profile.set_width(320);
+        profile.set_height(240);
+        profile.set_frame_rate(25, 1);
+        profile.set_sample_aspect(1, 1);
+        profile.set_display_aspect(4, 3);
+        profile.set_progressive(1);
+        profile.set_explicit(1);
+
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray single = dir.filePath("single.mkv").toUtf8();
+        QByteArray joined = dir.filePath("joined.mkv").toUtf8();
+        const int in = 0, out = 99, count = 3;
+        int starts[count];
+
+        if (!render(profile, single.constData(), in, out))
+            QSKIP("the avformat consumer is not available");
+        for (int i = 0; i <= count; i++) {
+            char *chunk = chunk_target(joined.constData(), i);
+            if (i < count) {
+                int start = chunk_start(in, out, count, i);
+                starts[i] = start - in;
+                QVERIFY(render(profile,
+                               chunk,
+                               start,
+                               chunk_start(in, out, count, i + 1) - 1,
+                               "video"));
+            } else {
+                QVERIFY(render(profile, chunk, in, out, "audio"));
+            }
+            free(chunk);
+        }
+        QCOMPARE(join_chunks(joined.constData(), "matroska", starts, count, 1, 25, 1), 0);
+
+        int single_frames, joined_frames;
+        int64_t single_duration, joined_duration;
+        QVERIFY(probe(single.constData(), single_frames, single_duration));
+        QVERIFY(probe(joined.constData(), joined_frames, joined_duration));
+        QCOMPARE(single_frames, out - in + 1);
+        QCOMPARE(joined_frames, single_frames);
+        QVERIFY(qAbs(joined_duration - single_duration) < AV_TIME_BASE / 25);
+    }
+#endif
+};
+
+QTEST_APPLESS_MAIN(TestChunks)
+
+#include "test_chunks.moc"
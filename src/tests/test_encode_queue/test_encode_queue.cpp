@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <encode_queue.h>
+#include <QtTest>
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+// An audio frame of the hand-off tests, in bytes
+static const int FRAME_LENGTH = 64;
+
+// A fifo of 128 bytes: 4 seconds of 8 Hz stereo 16-bit samples
+static sample_fifo small_fifo()
+{
+    return sample_fifo_init(8, 2, 2, 0);
+}
+
+/** Fetch audio frames from a hand-off as the audio encoder thread of the consumer does. */
+class AudioEncoder
+{
+public:
+    explicit AudioEncoder(audio_handoff *handoff)
+        : m_handoff(handoff)
+        , m_thread(&AudioEncoder::run, this)
+    {}
+
+    ~AudioEncoder() { join(); }
+
+    void join()
+    {
+        if (m_thread.joinable())
+            m_thread.join();
+    }
+
+    int frames() const { return m_frames; }
+    int result() const { return m_result; }
+    const std::vector<uint8_t> &bytes() const { return m_bytes; }
+
+private:
+    void run()
+    {
+        uint8_t buffer[FRAME_LENGTH];
+        for (;;) {
+            // The audio advances one second per frame.
+            int eof = audio_handoff_wait(m_handoff, FRAME_LENGTH, m_frames, nullptr);
+            if (eof < 0) {
+                m_result = -1;
+                break;
+            }
+            if (sample_fifo_used(m_handoff->fifo) < FRAME_LENGTH) {
+                m_result = 1;
+                break;
+            }
+            sample_fifo_fetch(m_handoff->fifo, buffer, FRAME_LENGTH);
+            m_bytes.insert(m_bytes.end(), buffer, buffer + FRAME_LENGTH);
+            m_frames++;
+            audio_handoff_fetched(m_handoff);
+        }
+    }
+
+    audio_handoff *m_handoff;
+    std::atomic<int> m_frames{0};
+    std::atomic<int> m_result{0};
+    std::vector<uint8_t> m_bytes;
+    std::thread m_thread;
+};
+
+class TestEncodeQueue : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestEncodeQueue() {}
+
+private Q_SLOTS:
+
+    void StageQueuePassesItemsInOrder()
+    {
+        stage_queue queue;
+        stage_queue_init(&queue, 4);
+        std::thread producer([&] {
+            for (intptr_t i = 1; i <= 1000; i++)
+                stage_queue_push(&queue, (void *) i);
+            stage_queue_close(&queue, 0);
+        });
+        intptr_t expected = 1;
+        void *item;
+        while ((item = stage_queue_pop(&queue))) {
+            QCOMPARE((intptr_t) item, expected);
+            expected++;
+        }
+        producer.join();
+        QCOMPARE(expected, (intptr_t) 1001);
+        stage_queue_free(&queue, nullptr);
+    }
+
+    void StageQueueDrainsAfterClose()
+    {
+        stage_queue queue;
+        stage_queue_init(&queue, 4);
+        QCOMPARE(stage_queue_push(&queue, (void *) 1), 0);
+        QCOMPARE(stage_queue_push(&queue, (void *) 2), 0);
+        stage_queue_close(&queue, 0);
+        QVERIFY(stage_queue_push(&queue, (void *) 3) != 0);
+        QCOMPARE((intptr_t) stage_queue_pop(&queue), (intptr_t) 1);
+        QCOMPARE((intptr_t) stage_queue_pop(&queue), (intptr_t) 2);
+        QVERIFY(stage_queue_pop(&queue) == nullptr);
+        stage_queue_free(&queue, nullptr);
+    }
+
+    void StageQueueAbortWakesAPusherAndDropsItems()
+    {
+        static int destroyed;
+        stage_queue queue;
+        destroyed = 0;
+        stage_queue_init(&queue, 1);
+        QCOMPARE(stage_queue_push(&queue, (void *) 1), 0);
+        std::atomic<int> blocked{-1};
+        std::thread producer([&] { blocked = stage_queue_push(&queue, (void *) 2); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        QCOMPARE(blocked.load(), -1);
+        stage_queue_close(&queue, 1);
+        producer.join();
+        QCOMPARE(blocked.load(), 1);
+        QVERIFY(stage_queue_pop(&queue) == nullptr);
+        stage_queue_free(&queue, [](void *) { destroyed++; });
+        QCOMPARE(destroyed, 1);
+    }
+
+    void SampleFifoKeepsSamplesAcrossTheEnd()
+    {
+        sample_fifo fifo = small_fifo();
+        uint8_t in[100], out[100];
+        uint8_t next_in = 0, next_out = 0;
+        for (int round = 0; round < 50; round++) {
+            int count = 4 * (1 + round % 25);
+            for (int i = 0; i < count; i++)
+                in[i] = next_in++;
+            QCOMPARE(sample_fifo_append(fifo, in, count), count);
+            QCOMPARE(sample_fifo_used(fifo), count);
+            QCOMPARE(sample_fifo_fetch(fifo, out, count), count);
+            for (int i = 0; i < count; i++)
+                QCOMPARE(out[i], (uint8_t) (next_out + i));
+            next_out += count;
+        }
+        sample_fifo_close(fifo);
+    }
+
+    void SampleFifoAppendsOnlyWhatFits()
+    {
+        sample_fifo fifo = small_fifo();
+        uint8_t in[200] = {0};
+        QCOMPARE(sample_fifo_append(fifo, in, 200), 128);
+        QCOMPARE(sample_fifo_append(fifo, in, 4), 0);
+        QCOMPARE(sample_fifo_used(fifo), 128);
+        sample_fifo_close(fifo);
+    }
+
+    void SampleFifoFetchesPlanes()
+    {
+        sample_fifo fifo = small_fifo();
+        // Stereo 16-bit frames whose samples are (left = 2n, right = 2n + 1)
+        uint16_t in[40], planes[2][10];
+        for (int i = 0; i < 40; i++)
+            in[i] = i;
+        // Start near the end of the buffer so that the planar fetch wraps.
+        uint8_t skip[120];
+        sample_fifo_append(fifo, skip, sizeof(skip));
+        sample_fifo_fetch(fifo, skip, sizeof(skip));
+        QCOMPARE(sample_fifo_append(fifo, (uint8_t *) in, sizeof(in)), (int) sizeof(in));
+        QCOMPARE(sample_fifo_fetch_planar(fifo, (uint8_t *) planes, 10, sizeof(planes[0])), 10);
+        for (int i = 0; i < 10; i++) {
+            QCOMPARE(planes[0][i], (uint16_t) (2 * i));
+            QCOMPARE(planes[1][i], (uint16_t) (2 * i + 1));
+        }
+        QCOMPARE(sample_fifo_used(fifo), (int) sizeof(in) / 2);
+        sample_fifo_close(fifo);
+    }
+
+    void SampleFifoPassesBytesBetweenThreads()
+    {
+        sample_fifo fifo = small_fifo();
+        const int total = 1000000;
+        std::thread producer([&] {
+            uint8_t in[60];
+            for (int sent = 0; sent < total;) {
+                int count = qMin((int) sizeof(in), total - sent);
+                for (int i = 0; i < count; i++)
+                    in[i] = (uint8_t) (sent + i);
+                int appended = sample_fifo_append(fifo, in, count);
+                sent += appended;
+                if (!appended)
+                    std::this_thread::yield();
+            }
+        });
+        uint8_t out[52];
+        bool same = true;
+        for (int received = 0; received < total;) {
+            int fetched = sample_fifo_fetch(fifo, out, sizeof(out));
+            for (int i = 0; i < fetched; i++)
+                same = same && out[i] == (uint8_t) (received + i);
+            received += fetched;
+            if (!fetched)
+                std::this_thread::yield();
+        }
+        producer.join();
+        QVERIFY(same);
+        sample_fifo_close(fifo);
+    }
+
+    void AudioHandoffWaitsForTheVideo()
+    {
+        audio_handoff handoff;
+        uint8_t in[3 * FRAME_LENGTH / 2] = {0};
+        audio_handoff_init(&handoff, 1);
+        handoff.fifo = small_fifo();
+        AudioEncoder encoder(&handoff);
+
+        // The video has not started, so the audio must not be encoded yet.
+        QCOMPARE(audio_handoff_append(&handoff, nullptr, in, sizeof(in)), 0);
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        QCOMPARE(encoder.frames(), 0);
+
+        // The video reached the second frame of audio, so both whole frames can be encoded.
+        audio_handoff_video(&handoff, 1.5, 0);
+        QCOMPARE(audio_handoff_append(&handoff, nullptr, in, sizeof(in)), 0);
+        for (int i = 0; i < 100 && encoder.frames() < 2; i++)
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        QCOMPARE(encoder.frames(), 2);
+
+        // The rest is encoded at the end of the audio, leaving no whole frame.
+        audio_handoff_finish(&handoff);
+        encoder.join();
+        QCOMPARE(encoder.frames(), 3);
+        QCOMPARE(encoder.result(), 1);
+        sample_fifo_close(handoff.fifo);
+        audio_handoff_close(&handoff);
+    }
+
+    void AudioHandoffEncodesAheadWhenTheFifoIsFull()
+    {
+        audio_handoff handoff;
+        std::vector<uint8_t> in(40 * FRAME_LENGTH);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = (uint8_t) (i * 7);
+        audio_handoff_init(&handoff, 1);
+        handoff.fifo = small_fifo();
+        AudioEncoder encoder(&handoff);
+
+        // The video never moves, so only waiting for room lets the audio through.
+        QCOMPARE(audio_handoff_append(&handoff, nullptr, in.data(), in.size()), 0);
+        audio_handoff_finish(&handoff);
+        encoder.join();
+        QCOMPARE(encoder.result(), 1);
+        QVERIFY(encoder.bytes() == in);
+        sample_fifo_close(handoff.fifo);
+        audio_handoff_close(&handoff);
+    }
+
+    void AudioHandoffFollowsTheVideoEncoder()
+    {
+        audio_handoff handoff;
+        std::vector<uint8_t> in(200 * FRAME_LENGTH);
+        for (size_t i = 0; i < in.size(); i++)
+            in[i] = (uint8_t) (i * 13);
+        audio_handoff_init(&handoff, 1);
+        handoff.fifo = small_fifo();
+        AudioEncoder encoder(&handoff);
+        std::thread video([&] {
+            for (int i = 1; i <= 100; i++) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+                audio_handoff_video(&handoff, i, 0);
+            }
+            audio_handoff_video(&handoff, 100, 1);
+        });
+
+        // Each frame carries a quarter of an audio frame, as when not pipelined.
+        for (size_t i = 0; i < in.size(); i += FRAME_LENGTH / 4)
+            QCOMPARE(audio_handoff_append(&handoff, nullptr, &in[i], FRAME_LENGTH / 4), 0);
+        video.join();
+        audio_handoff_finish(&handoff);
+        encoder.join();
+        QVERIFY(encoder.bytes() == in);
+        sample_fifo_close(handoff.fifo);
+        audio_handoff_close(&handoff);
+    }
+
+    void AudioHandoffAbortWakesBothSides()
+    {
+        audio_handoff handoff;
+        std::vector<uint8_t> in(10 * FRAME_LENGTH);
+        audio_handoff_init(&handoff, 1);
+        handoff.fifo = small_fifo();
+
+        // Nothing encodes, so the consumer thread waits for room until the abort.
+        std::atomic<int> appended{-1};
+        std::thread consumer(
+            [&] { appended = audio_handoff_append(&handoff, nullptr, in.data(), in.size()); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        QCOMPARE(appended.load(), -1);
+        audio_handoff_abort(&handoff);
+        consumer.join();
+        QCOMPARE(appended.load(), 1);
+
+        AudioEncoder encoder(&handoff);
+        encoder.join();
+        QCOMPARE(encoder.result(), -1);
+        sample_fifo_close(handoff.fifo);
+        audio_handoff_close(&handoff);
+    }
+
+    void AudioHandoffPassesTheChannelMap()
+    {
+        audio_handoff handoff;
+        mlt_properties frame = mlt_properties_new();
+        mlt_properties encoder = mlt_properties_new();
+        uint8_t in[FRAME_LENGTH] = {0};
+        audio_handoff_init(&handoff, 0);
+        handoff.fifo = small_fifo();
+        mlt_properties_set(frame, "meta.map.audio.0.channels", "2");
+        mlt_properties_set(frame, "other", "1");
+        QCOMPARE(audio_handoff_append(&handoff, frame, in, sizeof(in)), 0);
+        QCOMPARE(audio_handoff_wait(&handoff, FRAME_LENGTH, 0.0, encoder), 0);
+        QCOMPARE(mlt_properties_get(encoder, "0.channels"), "2");
+        QVERIFY(mlt_properties_get(encoder, "other") == nullptr);
+        mlt_properties_close(frame);
+        mlt_properties_close(encoder);
+        sample_fifo_close(handoff.fifo);
+        audio_handoff_close(&handoff);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestEncodeQueue)
+
+#include "test_encode_queue.moc"
@@ -19,6 +19,8 @@
 #include <QString>
 #include <QtTest>
 
+#include <thread>
+
 #include <mlt++/Mlt.h>
 using namespace Mlt;
 
@@ -46,6 +48,10 @@ private:
         self->checkOwner(owner);
     }
 
+    static void onCount(mlt_properties, int *count, mlt_event_data) { ++*count; }
+    static void onChanged(mlt_properties, int *counts, mlt_event_data) { ++counts[0]; }
+    static void onBatch(mlt_properties, int *counts, mlt_event_data) { ++counts[1]; }
+
 private Q_SLOTS:
 
     void ListenToPropertyChanged()
@@ -90,6 +96,184 @@ private Q_SLOTS:
         producer.set("foo", 1);
         delete event;
     }
+
+    void FireById()
+    {
+        Profile profile;
+        Producer producer(profile, "noise");
+        mlt_properties properties = producer.get_properties();
+        int count = 0;
+        QCOMPARE(mlt_events_lookup(properties, "test-event"), -1);
+        mlt_events_register(properties, "test-event");
+        int id = mlt_events_lookup(properties, "test-event");
+        QVERIFY(id >= 0);
+        QVERIFY(!mlt_events_has_listeners(properties, "test-event"));
+        QCOMPARE(mlt_events_fire_id(properties, id, mlt_event_data_none()), 0);
+
+        mlt_events_listen(properties, &count, "test-event", (mlt_listener) onCount);
+        QVERIFY(mlt_events_has_listeners(properties, "test-event"));
+        QCOMPARE(mlt_events_fire_id(properties, id, mlt_event_data_none()), 1);
+        QCOMPARE(mlt_events_fire(properties, "test-event", mlt_event_data_none()), 1);
+        QCOMPARE(count, 2);
+
+        mlt_events_disconnect(properties, &count);
+        QVERIFY(!mlt_events_has_listeners(properties, "test-event"));
+        QCOMPARE(mlt_events_fire_id(properties, id, mlt_event_data_none()), 0);
+        QCOMPARE(count, 2);
+    }
+
+    void LookupManyEvents()
+    {
+        Profile profile;
+        Producer producer(profile, "noise");
+        mlt_properties properties = producer.get_properties();
+        int first = mlt_events_lookup(properties, "property-changed");
+        QVERIFY(first >= 0);
+        char name[32];
+        for (int i = 0; i < 100; i++) {
+            snprintf(name, sizeof(name), "test-event-%d", i);
+            mlt_events_register(properties, name);
+        }
+        QCOMPARE(mlt_events_lookup(properties, "property-changed"), first);
+        int previous = first;
+        for (int i = 0; i < 100; i++) {
+            snprintf(name, sizeof(name), "test-event-%d", i);
+            int id = mlt_events_lookup(properties, name);
+            QVERIFY(id > previous);
+            previous = id;
+        }
+        QCOMPARE(mlt_events_lookup(properties, "test-event-100"), -1);
+        int count = 0;
+        mlt_events_listen(properties, &count, "test-event-99", (mlt_listener) onCount);
+        QCOMPARE(mlt_events_fire(properties, "test-event-99", mlt_event_data_none()), 1);
+        QCOMPARE(count, 1);
+    }
+
+    void ManyListeners()
+    {
+        Profile profile;
+        Producer producer(profile, "noise");
+        mlt_properties properties = producer.get_properties();
+        int counts[20] = {0};
+        for (int i = 0; i < 20; i++)
+            mlt_events_listen(properties, &counts[i], "property-changed", (mlt_listener) onCount);
+        for (int i = 0; i < 20; i += 2)
+            mlt_events_disconnect(properties, &counts[i]);
+        producer.set("foo", 1);
+        for (int i = 0; i < 20; i++)
+            QCOMPARE(counts[i], i % 2);
+    }
+
+    void UpdateDefersPropertyChanged()
+    {
+        Profile profile;
+        Producer producer(profile, "noise");
+        mlt_properties properties = producer.get_properties();
+        int changed = 0;
+        int batches = 0;
+        mlt_events_listen(properties, &changed, "property-changed", (mlt_listener) onCount);
+        mlt_events_listen(properties, &batches, "properties-changed", (mlt_listener) onCount);
+
+        mlt_properties_begin_update(properties);
+        producer.set("foo", 1);
+        producer.set("bar", 1);
+        mlt_properties_begin_update(properties);
+        producer.set("foo", 2);
+        mlt_properties_commit_update(properties);
+        QCOMPARE(changed, 0);
+        mlt_properties_commit_update(properties);
+        QCOMPARE(changed, 2);
+        QCOMPARE(batches, 1);
+        QCOMPARE(producer.get_int("foo"), 2);
+
+        producer.set("foo", 3);
+        QCOMPARE(changed, 3);
+        QCOMPARE(batches, 1);
+    }
+
+    void UpdateSkipsPropertyChangedForBatchListeners()
+    {
+        Profile profile;
+        Producer producer(profile, "noise");
+        mlt_properties properties = producer.get_properties();
+        int counts[2] = {0, 0};
+        int producerChanged = 0;
+        mlt_events_listen_batched(properties,
+                                  counts,
+                                  "property-changed",
+                                  (mlt_listener) onChanged);
+        mlt_events_listen(properties, counts, "properties-changed", (mlt_listener) onBatch);
+        mlt_events_listen(properties,
+                          &producerChanged,
+                          "producer-changed",
+                          (mlt_listener) onCount);
+
+        mlt_properties_begin_update(properties);
+        producer.set("in", 1);
+        producer.set("out", 10);
+        producer.set("length", 20);
+        mlt_properties_commit_update(properties);
+        QCOMPARE(counts[0], 0);
+        QCOMPARE(counts[1], 1);
+        QCOMPARE(producerChanged, 1);
+
+        producer.set("foo", 1);
+        QCOMPARE(counts[0], 1);
+        QCOMPARE(counts[1], 1);
+    }
+
+    void UpdateFiresPropertyChangedToListenersSharingData()
+    {
+        Profile profile;
+        Producer producer(profile, "noise");
+        mlt_properties properties = producer.get_properties();
+        int counts[2] = {0, 0};
+        mlt_events_listen(properties, counts, "property-changed", (mlt_listener) onChanged);
+        mlt_events_listen(properties, counts, "properties-changed", (mlt_listener) onBatch);
+
+        mlt_properties_begin_update(properties);
+        producer.set("foo", 1);
+        producer.set("bar", 1);
+        mlt_properties_commit_update(properties);
+        QCOMPARE(counts[0], 2);
+        QCOMPARE(counts[1], 1);
+    }
+
+    void PassReachesTimewarpClip()
+    {
+        Profile profile;
+        Producer producer(profile, "timewarp", "2.0:noise");
+        QVERIFY(producer.is_valid());
+        Properties source;
+        source.set("in", 5);
+        source.set("out", 49);
+        producer.pass_list(source, "in out");
+
+        Frame *frame = producer.get_frame();
+        QVERIFY(frame != nullptr);
+        Producer clip(mlt_frame_get_original_producer(frame->get_frame()));
+        QVERIFY(clip.is_valid());
+        QCOMPARE(clip.get_in(), 5);
+        QCOMPARE(clip.get_out(), 49);
+        delete frame;
+    }
+
+    void UpdateOnlyDefersOwnThread()
+    {
+        Profile profile;
+        Producer producer(profile, "noise");
+        mlt_properties properties = producer.get_properties();
+        int changed = 0;
+        mlt_events_listen(properties, &changed, "property-changed", (mlt_listener) onCount);
+
+        mlt_properties_begin_update(properties);
+        producer.set("foo", 1);
+        std::thread other([&producer] { producer.set("bar", 1); });
+        other.join();
+        QCOMPARE(changed, 1);
+        mlt_properties_commit_update(properties);
+        QCOMPARE(changed, 2);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestEvents)
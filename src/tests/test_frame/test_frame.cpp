@@ -20,6 +20,36 @@
 #include <QtTest>
 using namespace Mlt;
 
+static int countingGetImage(mlt_frame frame,
+                            uint8_t **image,
+                            mlt_image_format *format,
+                            int *width,
+                            int *height,
+                            int)
+{
+    mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+    mlt_properties_set_int(properties, "calls", mlt_properties_get_int(properties, "calls") + 1);
+    int size = mlt_image_format_size(*format, *width, *height, NULL);
+    *image = (uint8_t *) malloc(size);
+    mlt_frame_set_image(frame, *image, size, free);
+    return 0;
+}
+
+static int countingGetAudio(mlt_frame frame,
+                            void **buffer,
+                            mlt_audio_format *format,
+                            int *,
+                            int *channels,
+                            int *samples)
+{
+    mlt_properties properties = MLT_FRAME_PROPERTIES(frame);
+    mlt_properties_set_int(properties, "calls", mlt_properties_get_int(properties, "calls") + 1);
+    int size = mlt_audio_format_size(*format, *samples, *channels);
+    *buffer = malloc(size);
+    mlt_frame_set_audio(frame, *buffer, *format, size, free);
+    return 0;
+}
+
 class TestFrame : public QObject
 {
     Q_OBJECT
@@ -93,6 +123,91 @@ private Q_SLOTS:
         QCOMPARE(f1.ref_count(), 2);
         mlt_frame_close(frame);
     }
+
+    void PrefetchImageIsUsedWithSameArguments()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_frame_push_get_image(frame, countingGetImage);
+        QCOMPARE(mlt_frame_prefetch_image(frame, mlt_image_rgba, 65, 37, 0), 0);
+        mlt_image_format format = mlt_image_rgba;
+        int width = 65;
+        int height = 37;
+        uint8_t *image = NULL;
+        QCOMPARE(mlt_frame_get_image(frame, &image, &format, &width, &height, 0), 0);
+        QVERIFY(image != NULL);
+        QCOMPARE(width, 65);
+        QCOMPARE(height, 37);
+        QCOMPARE(mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "calls"), 1);
+        mlt_frame_close(frame);
+    }
+
+    void PrefetchImageIsRenderedAgainWithOtherArguments()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_frame_push_get_image(frame, countingGetImage);
+        QCOMPARE(mlt_frame_prefetch_image(frame, mlt_image_rgba, 65, 37, 0), 0);
+        mlt_image_format format = mlt_image_rgba;
+        int width = 33;
+        int height = 19;
+        uint8_t *image = NULL;
+        QCOMPARE(mlt_frame_get_image(frame, &image, &format, &width, &height, 0), 0);
+        QVERIFY(image != NULL);
+        QCOMPARE(width, 33);
+        QCOMPARE(height, 19);
+        QCOMPARE(mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "calls"), 2);
+        mlt_frame_close(frame);
+    }
+
+    void PrefetchAudioIsUsedWithSameArguments()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_frame_push_audio(frame, (void *) countingGetAudio);
+        QCOMPARE(mlt_frame_prefetch_audio(frame, mlt_audio_s16, 48000, 2, 1920), 0);
+        mlt_audio_format format = mlt_audio_s16;
+        int frequency = 48000;
+        int channels = 2;
+        int samples = 1920;
+        void *buffer = NULL;
+        QCOMPARE(mlt_frame_get_audio(frame, &buffer, &format, &frequency, &channels, &samples), 0);
+        QVERIFY(buffer != NULL);
+        QCOMPARE(samples, 1920);
+        QCOMPARE(mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "calls"), 1);
+        mlt_frame_close(frame);
+    }
+
+    void PrefetchAudioIsRenderedAgainWithOtherArguments()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_frame_push_audio(frame, (void *) countingGetAudio);
+        QCOMPARE(mlt_frame_prefetch_audio(frame, mlt_audio_s16, 48000, 2, 1920), 0);
+        mlt_audio_format format = mlt_audio_s16;
+        int frequency = 48000;
+        int channels = 2;
+        int samples = 1601;
+        void *buffer = NULL;
+        QCOMPARE(mlt_frame_get_audio(frame, &buffer, &format, &frequency, &channels, &samples), 0);
+        QVERIFY(buffer != NULL);
+        QCOMPARE(samples, 1601);
+        QCOMPARE(mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "calls"), 2);
+        mlt_frame_close(frame);
+    }
+
+    void PrefetchImageIsRenderedAgainAfterCancel()
+    {
+        mlt_frame frame = mlt_frame_init(NULL);
+        mlt_frame_push_get_image(frame, countingGetImage);
+        QCOMPARE(mlt_frame_prefetch_image(frame, mlt_image_rgba, 65, 37, 0), 0);
+        mlt_frame_prefetch_cancel(frame);
+        QCOMPARE(mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "calls"), 1);
+        mlt_image_format format = mlt_image_rgba;
+        int width = 65;
+        int height = 37;
+        uint8_t *image = NULL;
+        QCOMPARE(mlt_frame_get_image(frame, &image, &format, &width, &height, 0), 0);
+        QVERIFY(image != NULL);
+        QCOMPARE(mlt_properties_get_int(MLT_FRAME_PROPERTIES(frame), "calls"), 2);
+        mlt_frame_close(frame);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestFrame)
@@ -29,6 +29,80 @@ class TestImage : public QObject
 public:
     TestImage() { Factory::init(); }
 
+private:
+    static QByteArray randomBytes(int size)
+    {
+        QByteArray bytes(size, 0);
+        for (int i = 0; i < size; i++)
+            bytes[i] = char(QRandomGenerator::global()->bounded(256));
+        return bytes;
+    }
+
+    // Convert an image with the imageconvert filter as a frame would.
+    // If alpha is given, it is set on the frame first and replaced by the frame's alpha after.
+    static QByteArray convert(const QByteArray &in,
+                              mlt_image_format from,
+                              mlt_image_format to,
+                              int width,
+                              int height,
+                              QByteArray *alpha = nullptr)
+    {
+        Profile profile;
+        Filter filter(profile, "imageconvert");
+        mlt_frame frame = mlt_frame_init(nullptr);
+        mlt_properties_set_int(MLT_FRAME_PROPERTIES(frame), "width", width);
+        mlt_properties_set_int(MLT_FRAME_PROPERTIES(frame), "height", height);
+        auto image = static_cast<uint8_t *>(mlt_pool_alloc(in.size()));
+        memcpy(image, in.constData(), in.size());
+        mlt_frame_set_image(frame, image, in.size(), mlt_pool_release);
+        if (alpha && !alpha->isEmpty()) {
+            auto a = static_cast<uint8_t *>(mlt_pool_alloc(alpha->size()));
+            memcpy(a, alpha->constData(), alpha->size());
+            mlt_frame_set_alpha(frame, a, alpha->size(), mlt_pool_release);
+        }
+        mlt_filter_process(filter.get_filter(), frame);
+        mlt_image_format format = from;
+        QByteArray out;
+        if (!frame->convert_image(frame, &image, &format, to)) {
+            out = QByteArray(reinterpret_cast<const char *>(image),
+                             mlt_image_format_size(to, width, height, nullptr));
+            if (alpha) {
+                uint8_t *a = mlt_frame_get_alpha(frame);
+                *alpha = a ? QByteArray(reinterpret_cast<const char *>(a), width * height)
+                           : QByteArray();
+            }
+        }
+        mlt_frame_close(frame);
+        return out;
+    }
+
+    // Zero the last pixel of each row of an odd width, which the converters from formats with
+    // pairs of pixels sharing chroma leave unset.
+    static void clearLastColumn(QByteArray &image, int width, int height, int bytes)
+    {
+        if (width % 2)
+            for (int line = 0; line < height; line++)
+                memset(image.data() + ((line + 1) * width - 1) * bytes, 0, bytes);
+    }
+
+    static void addWidths(bool odd = false)
+    {
+        QTest::addColumn<int>("width");
+        QTest::newRow("2") << 2;
+        QTest::newRow("12") << 12;
+        QTest::newRow("16") << 16;
+        QTest::newRow("36") << 36;
+        QTest::newRow("1920") << 1920;
+        if (odd) {
+            QTest::newRow("1") << 1;
+            QTest::newRow("7") << 7;
+            QTest::newRow("9") << 9;
+            QTest::newRow("17") << 17;
+            QTest::newRow("35") << 35;
+            QTest::newRow("1921") << 1921;
+        }
+    }
+
 private Q_SLOTS:
 
     void DefaultConstructor()
@@ -129,6 +203,263 @@ private Q_SLOTS:
         i.init_alpha();
         QVERIFY(i.plane(3) != nullptr);
     }
+
+    // The converters may use SIMD, but they must match the scalar macros in mlt_frame.h exactly.
+
+    void ConvertYuv422ToRgbaMatchesScalar_data() { addWidths(); }
+
+    void ConvertYuv422ToRgbaMatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 3;
+        QByteArray yuv = randomBytes(width * height * 2);
+        QByteArray expected(width * height * 4, 0);
+        for (int i = 0; i < width * height; i++) {
+            int y = uint8_t(yuv[2 * i]);
+            int u = uint8_t(yuv[4 * (i / 2) + 1]);
+            int v = uint8_t(yuv[4 * (i / 2) + 3]);
+            int r, g, b;
+            YUV2RGB_601_SCALED(y, u, v, r, g, b);
+            expected[4 * i] = char(r);
+            expected[4 * i + 1] = char(g);
+            expected[4 * i + 2] = char(b);
+            expected[4 * i + 3] = char(0xff);
+        }
+        QCOMPARE(convert(yuv, mlt_image_yuv422, mlt_image_rgba, width, height), expected);
+    }
+
+    void ConvertRgbToYuv422MatchesScalar_data() { addWidths(); }
+
+    void ConvertRgbToYuv422MatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 3;
+        QByteArray rgb = randomBytes(width * height * 3);
+        QByteArray expected(width * height * 2, 0);
+        for (int i = 0; i < width * height; i += 2) {
+            int y0, y1, u0, u1, v0, v1;
+            int r = uint8_t(rgb[3 * i]), g = uint8_t(rgb[3 * i + 1]), b = uint8_t(rgb[3 * i + 2]);
+            RGB2YUV_601_SCALED(r, g, b, y0, u0, v0);
+            r = uint8_t(rgb[3 * i + 3]), g = uint8_t(rgb[3 * i + 4]), b = uint8_t(rgb[3 * i + 5]);
+            RGB2YUV_601_SCALED(r, g, b, y1, u1, v1);
+            expected[2 * i] = char(y0);
+            expected[2 * i + 1] = char((u0 + u1) >> 1);
+            expected[2 * i + 2] = char(y1);
+            expected[2 * i + 3] = char((v0 + v1) >> 1);
+        }
+        QCOMPARE(convert(rgb, mlt_image_rgb, mlt_image_yuv422, width, height), expected);
+    }
+
+    void ConvertYuv420pToRgbMatchesScalar_data() { addWidths(); }
+
+    void ConvertYuv420pToRgbMatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 4;
+        QByteArray yuv = randomBytes(width * height * 3 / 2);
+        const int uOffset = width * height;
+        const int vOffset = uOffset + width * height / 4;
+        QByteArray expected(width * height * 3, 0);
+        for (int line = 0; line < height; line++) {
+            for (int x = 0; x < width; x++) {
+                int i = line * width + x;
+                int c = (line / 2) * (width / 2) + x / 2;
+                int y = uint8_t(yuv[i]);
+                int u = uint8_t(yuv[uOffset + c]);
+                int v = uint8_t(yuv[vOffset + c]);
+                int r, g, b;
+                YUV2RGB_601_SCALED(y, u, v, r, g, b);
+                expected[3 * i] = char(r);
+                expected[3 * i + 1] = char(g);
+                expected[3 * i + 2] = char(b);
+            }
+        }
+        QCOMPARE(convert(yuv, mlt_image_yuv420p, mlt_image_rgb, width, height), expected);
+    }
+
+    void ConvertYuv422ToRgbMatchesScalar_data() { addWidths(true); }
+
+    void ConvertYuv422ToRgbMatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 3;
+        QByteArray yuv = randomBytes(width * height * 2);
+        QByteArray expected(width * height * 3, 0);
+        for (int line = 0; line < height; line++) {
+            for (int x = 0; x < width / 2 * 2; x++) {
+                const char *p = yuv.constData() + line * width * 2;
+                int y = uint8_t(p[2 * x]);
+                int u = uint8_t(p[4 * (x / 2) + 1]);
+                int v = uint8_t(p[4 * (x / 2) + 3]);
+                int r, g, b;
+                YUV2RGB_601_SCALED(y, u, v, r, g, b);
+                int i = line * width + x;
+                expected[3 * i] = char(r);
+                expected[3 * i + 1] = char(g);
+                expected[3 * i + 2] = char(b);
+            }
+        }
+        QByteArray actual = convert(yuv, mlt_image_yuv422, mlt_image_rgb, width, height);
+        clearLastColumn(actual, width, height, 3);
+        QCOMPARE(actual, expected);
+    }
+
+    void ConvertRgbaToYuv422MatchesScalar_data() { addWidths(true); }
+
+    void ConvertRgbaToYuv422MatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 3;
+        QByteArray rgba = randomBytes(width * height * 4);
+        QByteArray expected(width * height * 2, 0);
+        QByteArray expectedAlpha(width * height, 0);
+        for (int line = 0; line < height; line++) {
+            for (int x = 0; x < width; x += 2) {
+                int i = line * width + x;
+                int y0, y1, u0, u1, v0, v1;
+                int r = uint8_t(rgba[4 * i]);
+                int g = uint8_t(rgba[4 * i + 1]);
+                int b = uint8_t(rgba[4 * i + 2]);
+                RGB2YUV_601_SCALED(r, g, b, y0, u0, v0);
+                expectedAlpha[i] = rgba[4 * i + 3];
+                expected[2 * i] = char(y0);
+                if (x + 1 == width) {
+                    // The last pixel of an odd width keeps its own U
+                    expected[2 * i + 1] = char(u0);
+                    break;
+                }
+                r = uint8_t(rgba[4 * i + 4]);
+                g = uint8_t(rgba[4 * i + 5]);
+                b = uint8_t(rgba[4 * i + 6]);
+                RGB2YUV_601_SCALED(r, g, b, y1, u1, v1);
+                expectedAlpha[i + 1] = rgba[4 * i + 7];
+                expected[2 * i + 1] = char((u0 + u1) >> 1);
+                expected[2 * i + 2] = char(y1);
+                expected[2 * i + 3] = char((v0 + v1) >> 1);
+            }
+        }
+        QByteArray alpha;
+        QCOMPARE(convert(rgba, mlt_image_rgba, mlt_image_yuv422, width, height, &alpha), expected);
+        QCOMPARE(alpha, expectedAlpha);
+    }
+
+    void ConvertYuv420pToYuv422MatchesScalar_data() { addWidths(true); }
+
+    void ConvertYuv420pToYuv422MatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 4;
+        const int size = mlt_image_format_size(mlt_image_yuv420p, width, height, nullptr);
+        QByteArray yuv = randomBytes(size);
+        const int uOffset = width * height;
+        const int vOffset = uOffset + (width / 2) * (height / 2);
+        QByteArray expected(width * height * 2, 0);
+        for (int line = 0; line < height; line++) {
+            for (int x = 0; x < width / 2 * 2; x++) {
+                int i = line * width + x;
+                int c = (line / 2) * (width / 2) + x / 2;
+                expected[2 * i] = yuv[i];
+                expected[2 * i + 1] = yuv[(x % 2 ? vOffset : uOffset) + c];
+            }
+        }
+        QByteArray actual = convert(yuv, mlt_image_yuv420p, mlt_image_yuv422, width, height);
+        clearLastColumn(actual, width, height, 2);
+        QCOMPARE(actual, expected);
+    }
+
+    void ConvertYuv420pToRgbaMatchesScalar_data() { addWidths(true); }
+
+    void ConvertYuv420pToRgbaMatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 4;
+        const int size = mlt_image_format_size(mlt_image_yuv420p, width, height, nullptr);
+        QByteArray yuv = randomBytes(size);
+        QByteArray alpha = randomBytes(width * height);
+        const int uOffset = width * height;
+        const int vOffset = uOffset + (width / 2) * (height / 2);
+        QByteArray expected(width * height * 4, 0);
+        for (int line = 0; line < height; line++) {
+            for (int x = 0; x < width / 2 * 2; x++) {
+                int i = line * width + x;
+                int c = (line / 2) * (width / 2) + x / 2;
+                int y = uint8_t(yuv[i]);
+                int u = uint8_t(yuv[uOffset + c]);
+                int v = uint8_t(yuv[vOffset + c]);
+                int r, g, b;
+                YUV2RGB_601_SCALED(y, u, v, r, g, b);
+                expected[4 * i] = char(r);
+                expected[4 * i + 1] = char(g);
+                expected[4 * i + 2] = char(b);
+                expected[4 * i + 3] = alpha[i];
+            }
+        }
+        QByteArray actual = convert(yuv, mlt_image_yuv420p, mlt_image_rgba, width, height, &alpha);
+        clearLastColumn(actual, width, height, 4);
+        QCOMPARE(actual, expected);
+    }
+
+    void ConvertYuv422ToYuv420pMatchesScalar_data() { addWidths(true); }
+
+    void ConvertYuv422ToYuv420pMatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 4;
+        QByteArray yuv = randomBytes(width * height * 2);
+        const int uOffset = width * height;
+        const int vOffset = uOffset + (width / 2) * (height / 2);
+        QByteArray expected(vOffset + (width / 2) * (height / 2), 0);
+        for (int line = 0; line < height; line++) {
+            const char *p = yuv.constData() + line * width * 2;
+            for (int x = 0; x < width; x++)
+                expected[line * width + x] = p[2 * x];
+            // U and V are taken from the even lines
+            for (int x = 0; line % 2 == 0 && x < width / 2; x++) {
+                expected[uOffset + (line / 2) * (width / 2) + x] = p[4 * x + 1];
+                expected[vOffset + (line / 2) * (width / 2) + x] = p[4 * x + 3];
+            }
+        }
+        QByteArray actual = convert(yuv, mlt_image_yuv422, mlt_image_yuv420p, width, height);
+        QCOMPARE(actual.left(expected.size()), expected);
+    }
+
+    void ConvertRgbToRgbaMatchesScalar_data() { addWidths(true); }
+
+    void ConvertRgbToRgbaMatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 3;
+        QByteArray rgb = randomBytes(width * height * 3);
+        QByteArray alpha = randomBytes(width * height);
+        QByteArray expected(width * height * 4, 0);
+        for (int i = 0; i < width * height; i++) {
+            expected[4 * i] = rgb[3 * i];
+            expected[4 * i + 1] = rgb[3 * i + 1];
+            expected[4 * i + 2] = rgb[3 * i + 2];
+            expected[4 * i + 3] = alpha[i];
+        }
+        QCOMPARE(convert(rgb, mlt_image_rgb, mlt_image_rgba, width, height, &alpha), expected);
+    }
+
+    void ConvertRgbaToRgbMatchesScalar_data() { addWidths(true); }
+
+    void ConvertRgbaToRgbMatchesScalar()
+    {
+        QFETCH(int, width);
+        const int height = 3;
+        QByteArray rgba = randomBytes(width * height * 4);
+        QByteArray expected(width * height * 3, 0);
+        QByteArray expectedAlpha(width * height, 0);
+        for (int i = 0; i < width * height; i++) {
+            expected[3 * i] = rgba[4 * i];
+            expected[3 * i + 1] = rgba[4 * i + 1];
+            expected[3 * i + 2] = rgba[4 * i + 2];
+            expectedAlpha[i] = rgba[4 * i + 3];
+        }
+        QByteArray alpha;
+        QCOMPARE(convert(rgba, mlt_image_rgba, mlt_image_rgb, width, height, &alpha), expected);
+        QCOMPARE(alpha, expectedAlpha);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestImage)
@@ -263,6 +263,79 @@ private Q_SLOTS:
         delete pp2;
         delete pp3;
     }
+
+    void ClipIndexFollowsEdits()
+    {
+        Playlist pl(profile);
+        Producer p(profile, "noise");
+        pl.append(p, 0, 9);
+        pl.blank(4);
+        pl.append(p, 0, 19);
+        pl.append(p, 0, 4);
+
+        // Clips of 10, 5, 20 and 5 frames
+        QCOMPARE(pl.get_clip_index_at(-1), 0);
+        QCOMPARE(pl.get_clip_index_at(9), 0);
+        QCOMPARE(pl.get_clip_index_at(10), 1);
+        QCOMPARE(pl.get_clip_index_at(15), 2);
+        QCOMPARE(pl.get_clip_index_at(34), 2);
+        QCOMPARE(pl.get_clip_index_at(35), 3);
+        QCOMPARE(pl.get_clip_index_at(40), 4);
+        QCOMPARE(pl.clip_start(3), 35);
+
+        pl.move(3, 0);
+        QCOMPARE(pl.get_clip_index_at(4), 0);
+        QCOMPARE(pl.get_clip_index_at(5), 1);
+        QCOMPARE(pl.clip_start(3), 20);
+
+        pl.resize_clip(3, 0, 9);
+        QCOMPARE(pl.get_clip_index_at(29), 3);
+        QCOMPARE(pl.get_clip_index_at(30), 4);
+
+        pl.split(3, 4);
+        QCOMPARE(pl.count(), 5);
+        QCOMPARE(pl.clip_start(4), 25);
+        QCOMPARE(pl.get_clip_index_at(24), 3);
+        QCOMPARE(pl.get_clip_index_at(25), 4);
+
+        pl.remove(0);
+        QCOMPARE(pl.get_clip_index_at(0), 0);
+        QCOMPARE(pl.get_clip_index_at(10), 1);
+        QCOMPARE(pl.clip_start(3), 20);
+    }
+
+    static void onPrefetch(mlt_properties, void *data, mlt_event_data event_data)
+    {
+        auto prefetch = static_cast<mlt_event_data_prefetch *>(
+            mlt_event_data_to_object(event_data));
+        auto list = static_cast<QList<QPair<int, int>> *>(data);
+        list->append(qMakePair(int(prefetch->position), prefetch->count));
+    }
+
+    void PrefetchSpansClips()
+    {
+        Playlist pl(profile);
+        Producer p1(profile, "noise");
+        Producer p2(profile, "noise");
+        QList<QPair<int, int>> hints1, hints2;
+        mlt_events_listen(p1.get_properties(), &hints1, "producer-prefetch", onPrefetch);
+        mlt_events_listen(p2.get_properties(), &hints2, "producer-prefetch", onPrefetch);
+        pl.append(p1, 100, 109);
+        pl.blank(4);
+        pl.append(p2, 50, 59);
+
+        // Positions 5-9 are in the first clip, 10-14 are blank, and 15-16 are in the last clip.
+        QCOMPARE(mlt_playlist_prefetch(pl.get_playlist(), 5, 12), 0);
+        QCOMPARE(hints1.count(), 1);
+        QCOMPARE(hints1[0], qMakePair(105, 5));
+        QCOMPARE(hints2.count(), 1);
+        QCOMPARE(hints2[0], qMakePair(50, 2));
+
+        // Positions past the end are ignored.
+        QCOMPARE(mlt_playlist_prefetch(pl.get_playlist(), 25, 10), 0);
+        QCOMPARE(hints1.count(), 1);
+        QCOMPARE(hints2.count(), 1);
+    }
 };
 
 QTEST_APPLESS_MAIN(TestPlaylist)
@@ -59,6 +59,20 @@ private Q_SLOTS:
 
         delete cutService;
     }
+
+    void MeltSkipsOnlyChunkOptionValues()
+    {
+        Profile profile;
+        const char *chunks[] = {"noise", "-chunks", "4", "a=b", nullptr};
+        const char *chunk[] = {"noise", "-chunk", "1", "a=b", nullptr};
+        for (auto argv : {chunks, chunk}) {
+            Producer melt(profile, "melt", reinterpret_cast<const char *>(argv));
+            QVERIFY(melt.is_valid());
+            Producer first(static_cast<mlt_producer>(melt.get_data("first_producer")));
+            QVERIFY(first.is_valid());
+            QCOMPARE(first.get("a"), "b");
+        }
+    }
 };
 
 QTEST_APPLESS_MAIN(TestProducer)
@@ -28,7 +28,10 @@ extern "C" {
 #include <framework/mlt_animation.h>
 #include <framework/mlt_property.h>
 }
+#include <atomic>
 #include <cfloat>
+#include <thread>
+#include <vector>
 
 static const bool kRunLongTests = true;
 
@@ -423,6 +426,59 @@ private Q_SLOTS:
         QCOMPARE(p.get("new key"), "value");
     }
 
+    void ManyPropertiesAreFound()
+    {
+        Properties p;
+        char name[32];
+        for (int i = 0; i < 1000; i++) {
+            snprintf(name, sizeof(name), "key.%d", i);
+            p.set(name, i);
+        }
+        QCOMPARE(p.count(), 1000);
+        for (int i = 0; i < 1000; i++) {
+            snprintf(name, sizeof(name), "key.%d", i);
+            QCOMPARE(p.get_int(name), i);
+        }
+        QVERIFY(p.get("key.1000") == 0);
+        p.rename("key.500", "renamed");
+        QVERIFY(p.get("key.500") == 0);
+        QCOMPARE(p.get_int("renamed"), 500);
+        QCOMPARE(p.get_int("key.501"), 501);
+    }
+
+    void RenameWhileReading()
+    {
+        Properties p;
+        char name[32];
+        for (int i = 0; i < 100; i++) {
+            snprintf(name, sizeof(name), "key.%d", i);
+            p.set(name, i);
+        }
+        p.set("a", -1);
+        std::atomic<bool> done(false);
+        std::atomic<int> errors(0);
+        std::vector<std::thread> readers;
+        for (int t = 0; t < 4; t++) {
+            readers.emplace_back([&, t]() {
+                char key[32];
+                for (int i = t; !done; i++) {
+                    snprintf(key, sizeof(key), "key.%d", i % 100);
+                    if (p.get_int(key) != i % 100)
+                        errors++;
+                }
+            });
+        }
+        // Retired index tables are freed while the readers keep looking up
+        for (int i = 0; i < 10000; i++)
+            p.rename(i % 2 ? "b" : "a", i % 2 ? "a" : "b");
+        done = true;
+        for (auto &reader : readers)
+            reader.join();
+        QCOMPARE(errors.load(), 0);
+        QCOMPARE(p.get_int("a"), -1);
+        QVERIFY(p.rename("a", "key.0"));
+    }
+
     void SequenceDetected()
     {
         Properties p;
@@ -1510,6 +1566,45 @@ private Q_SLOTS:
         QCOMPARE(p.get_int("foo"), 123);
         QCOMPARE(p.get_double("foo"), 123.4);
     }
+
+    void GetIntConcurrentReaders_data()
+    {
+        QTest::addColumn<int>("threads");
+        QTest::newRow("1 thread") << 1;
+        QTest::newRow("4 threads") << 4;
+        QTest::newRow("16 threads") << 16;
+    }
+
+    // Each iteration performs threads * kReads lookups, so compare the
+    // reported time per iteration across rows to see how readers scale.
+    void GetIntConcurrentReaders()
+    {
+        QFETCH(int, threads);
+        const int kNames = 200;
+        const int kReads = 100000;
+        Properties p;
+        std::vector<QByteArray> names;
+        for (int i = 0; i < kNames; i++) {
+            names.push_back(QByteArray("meta.key.") + QByteArray::number(i));
+            p.set(names.back().constData(), i);
+        }
+        QBENCHMARK {
+            std::vector<std::thread> readers;
+            std::vector<int> sums(threads, 0);
+            for (int t = 0; t < threads; t++) {
+                readers.emplace_back([&, t]() {
+                    int sum = 0;
+                    for (int i = 0; i < kReads; i++)
+                        sum += p.get_int(names[(i + t) % kNames].constData());
+                    sums[t] = sum;
+                });
+            }
+            for (auto &reader : readers)
+                reader.join();
+            for (int t = 0; t < threads; t++)
+                QCOMPARE(sums[t], kReads / kNames * (kNames * (kNames - 1) / 2));
+        }
+    }
 };
 
 QTEST_APPLESS_MAIN(TestProperties)
@@ -0,0 +1,222 @@
+/*
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <seek_index.h>
+#include <QtTest>
+
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+
+class TestSeekIndex : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestSeekIndex() {}
+
+private:
+    seek_index_entry entries[3] = {{0, 564}, {3003, 188000}, {6006, -1}};
+
+    seek_index_t index()
+    {
+        seek_index_t index;
+        index.size = 1000000;
+        index.mtime = 1700000000;
+        index.stream = 1;
+        index.time_base_num = 1;
+        index.time_base_den = 90000;
+        index.first_pts = 0;
+        index.vfr = 0;
+        index.end_pts = 9009;
+        index.count = 3;
+        index.capacity = 3;
+        index.entries = entries;
+        return index;
+    }
+
+    static struct stat media(int64_t size, int64_t mtime)
+    {
+        struct stat stat_buff;
+        memset(&stat_buff, 0, sizeof(stat_buff));
+        stat_buff.st_size = size;
+        stat_buff.st_mtime = mtime;
+        return stat_buff;
+    }
+
+private Q_SLOTS:
+
+    void SaveThenLoadRoundTrips()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray path = dir.filePath("media.ts.mltidx").toUtf8();
+        seek_index_t saved = index();
+        QCOMPARE(seek_index_save(&saved, path.constData()), 0);
+
+        struct stat stat_buff = media(saved.size, saved.mtime);
+        seek_index_t *loaded = seek_index_load(path.constData(), &stat_buff, 1, 1, 90000);
+        QVERIFY(loaded != nullptr);
+        QCOMPARE(loaded->size, saved.size);
+        QCOMPARE(loaded->mtime, saved.mtime);
+        QCOMPARE(loaded->stream, saved.stream);
+        QCOMPARE(loaded->time_base_num, 1);
+        QCOMPARE(loaded->time_base_den, 90000);
+        QCOMPARE(loaded->first_pts, saved.first_pts);
+        QCOMPARE(loaded->vfr, saved.vfr);
+        QCOMPARE(loaded->end_pts, saved.end_pts);
+        QCOMPARE(loaded->count, saved.count);
+        for (int i = 0; i < 3; i++) {
+            QCOMPARE(loaded->entries[i].pts, entries[i].pts);
+            QCOMPARE(loaded->entries[i].pos, entries[i].pos);
+        }
+        seek_index_close(loaded);
+    }
+
+    void LoadRejectsChangedMedia()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray path = dir.filePath("media.ts.mltidx").toUtf8();
+        seek_index_t saved = index();
+        QCOMPARE(seek_index_save(&saved, path.constData()), 0);
+
+        struct stat resized = media(saved.size + 1, saved.mtime);
+        struct stat touched = media(saved.size, saved.mtime + 1);
+        struct stat same = media(saved.size, saved.mtime);
+        QVERIFY(!seek_index_load(path.constData(), &resized, 1, 1, 90000));
+        QVERIFY(!seek_index_load(path.constData(), &touched, 1, 1, 90000));
+        QVERIFY(!seek_index_load(path.constData(), &same, 0, 1, 90000));
+        QVERIFY(!seek_index_load(path.constData(), &same, 1, 1001, 30000));
+    }
+
+    void LoadRejectsTruncatedFile()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray path = dir.filePath("media.ts.mltidx").toUtf8();
+        seek_index_t saved = index();
+        QCOMPARE(seek_index_save(&saved, path.constData()), 0);
+
+        // Drop the last half of the last entry
+        FILE *file = fopen(path.constData(), "rb");
+        QVERIFY(file != nullptr);
+        QByteArray bytes(1024, 0);
+        int size = fread(bytes.data(), 1, bytes.size(), file);
+        fclose(file);
+        file = fopen(path.constData(), "wb");
+        QVERIFY(file != nullptr);
+        fwrite(bytes.constData(), 1, size - 8, file);
+        fclose(file);
+
+        struct stat stat_buff = media(saved.size, saved.mtime);
+        QVERIFY(!seek_index_load(path.constData(), &stat_buff, 1, 1, 90000));
+    }
+
+    void ConcurrentSavesLeaveValidIndex()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray path = dir.filePath("media.ts.mltidx").toUtf8();
+
+        // Enough entries that the writes overlap
+        std::vector<seek_index_entry> many(20000);
+        for (size_t i = 0; i < many.size(); i++)
+            many[i] = {int64_t(i) * 3003, int64_t(i) * 188000};
+        seek_index_t saved = index();
+        saved.count = many.size();
+        saved.entries = many.data();
+
+        std::vector<std::thread> writers;
+        std::atomic<int> errors(0);
+        for (int i = 0; i < 8; i++)
+            writers.emplace_back([&] {
+                for (int j = 0; j < 10; j++)
+                    errors += seek_index_save(&saved, path.constData());
+            });
+        for (auto &writer : writers)
+            writer.join();
+        QCOMPARE(errors.load(), 0);
+
+        struct stat stat_buff = media(saved.size, saved.mtime);
+        seek_index_t *loaded = seek_index_load(path.constData(), &stat_buff, 1, 1, 90000);
+        QVERIFY(loaded != nullptr);
+        QCOMPARE(loaded->count, saved.count);
+        QCOMPARE(loaded->entries[saved.count - 1].pos, many.back().pos);
+        seek_index_close(loaded);
+        QCOMPARE(QDir(dir.path()).entryList(QDir::Files).size(), 1);
+    }
+
+    void FindReturnsKeyframeAtOrBefore()
+    {
+        seek_index_t index = this->index();
+        QVERIFY(!seek_index_find(&index, -1));
+        QCOMPARE(seek_index_find(&index, 0), &entries[0]);
+        QCOMPARE(seek_index_find(&index, 3002), &entries[0]);
+        QCOMPARE(seek_index_find(&index, 3003), &entries[1]);
+        QCOMPARE(seek_index_find(&index, 9009), &entries[2]);
+        // Past the end of the index the demuxer seeks instead
+        QVERIFY(!seek_index_find(&index, 9010));
+        index.end_pts = INT64_MAX;
+        QCOMPARE(seek_index_find(&index, 90000), &entries[2]);
+    }
+
+    void AppendStopsWhenTimestampsGoBack()
+    {
+        seek_index_t index;
+        memset(&index, 0, sizeof(index));
+        // Two segments of an MPEG-TS whose timestamps restart
+        QCOMPARE(seek_index_append(&index, 3003, 564), 0);
+        QCOMPARE(seek_index_append(&index, 6006, 188000), 0);
+        QCOMPARE(seek_index_append(&index, 6006, 188188), 0);
+        QCOMPARE(seek_index_append(&index, 0, 376000), 1);
+        QCOMPARE(index.count, int64_t(2));
+        QCOMPARE(index.entries[0].pts, int64_t(3003));
+        QCOMPARE(index.entries[1].pts, int64_t(6006));
+        QCOMPARE(index.entries[1].pos, int64_t(188000));
+        free(index.entries);
+    }
+
+    void AppendGrows()
+    {
+        seek_index_t index;
+        memset(&index, 0, sizeof(index));
+        for (int i = 0; i < 1000; i++)
+            QCOMPARE(seek_index_append(&index, i * 3003, i * 188000), 0);
+        QCOMPARE(index.count, int64_t(1000));
+        QVERIFY(index.capacity >= index.count);
+        QCOMPARE(index.entries[999].pos, int64_t(999) * 188000);
+        free(index.entries);
+    }
+
+    void LoadMissingFileFails()
+    {
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        QByteArray path = dir.filePath("missing.mltidx").toUtf8();
+        struct stat stat_buff = media(1000, 0);
+        QVERIFY(!seek_index_load(path.constData(), &stat_buff, 0, 1, 25));
+    }
+};
+
+QTEST_APPLESS_MAIN(TestSeekIndex)
+
+#include "test_seek_index.moc"
@@ -0,0 +1,154 @@
+/*
+ * Copyright (C) 2026 Meltytech, LLC
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with consumer library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include <QtTest>
+
+#include <atomic>
+#include <thread>
+
+#include <mlt++/Mlt.h>
+using namespace Mlt;
+
+static const int kJobs = 64;
+
+struct Record
+{
+    std::atomic<int> runs[kJobs];
+    std::atomic<int> badIds;
+    std::atomic<int> callerJobs;
+    std::atomic<int> callerIdMismatches;
+    std::thread::id caller;
+    int count;
+};
+
+static int recordJob(int id, int idx, int jobs, void *cookie)
+{
+    auto record = static_cast<Record *>(cookie);
+    bool isCaller = std::this_thread::get_id() == record->caller;
+    record->runs[idx]++;
+    if (id < 0 || id > record->count || jobs != kJobs)
+        record->badIds++;
+    if (isCaller)
+        record->callerJobs++;
+    if (isCaller != (id == record->count))
+        record->callerIdMismatches++;
+    return 0;
+}
+
+static int innerJob(int, int, int, void *cookie)
+{
+    static_cast<std::atomic<int> *>(cookie)->fetch_add(1);
+    return 0;
+}
+
+static int outerJob(int, int, int, void *cookie)
+{
+    // Every worker can be blocked here at once, so the inner jobs must run on the callers.
+    mlt_slices_run_normal(-2, innerJob, cookie);
+    return 0;
+}
+
+class TestSlices : public QObject
+{
+    Q_OBJECT
+
+public:
+    TestSlices()
+    {
+        // Few workers make it likely that all of them wait inside a nested run.
+        qputenv("MLT_SLICES_COUNT", "2");
+        Factory::init();
+    }
+
+private:
+    static void initRecord(Record &record)
+    {
+        for (auto &runs : record.runs)
+            runs = 0;
+        record.badIds = 0;
+        record.callerJobs = 0;
+        record.callerIdMismatches = 0;
+        record.caller = std::this_thread::get_id();
+        record.count = mlt_slices_count_normal();
+    }
+
+    static void verifyRecord(Record &record)
+    {
+        for (int i = 0; i < kJobs; i++)
+            QCOMPARE(record.runs[i].load(), 1);
+        QCOMPARE(record.badIds.load(), 0);
+        QCOMPARE(record.callerIdMismatches.load(), 0);
+    }
+
+private Q_SLOTS:
+
+    void SubmitThenWaitRunsEveryJobOnce()
+    {
+        Record record;
+        initRecord(record);
+        mlt_slices_task task = mlt_slices_submit_normal(kJobs, recordJob, &record);
+        QVERIFY(task != nullptr);
+        mlt_slices_wait(task);
+        verifyRecord(record);
+    }
+
+    void RunUsesSliceCountAsCallerId()
+    {
+        Record record;
+        initRecord(record);
+        QCOMPARE(record.count, 2);
+        mlt_slices_run_normal(kJobs, recordJob, &record);
+        verifyRecord(record);
+    }
+
+    void WaitRunsJobsOnCaller()
+    {
+        // Occupy every worker so that the caller has to run the submitted jobs.
+        std::atomic<int> release(0);
+        int count = mlt_slices_count_normal();
+        mlt_slices_task busy = mlt_slices_submit_normal(
+            count,
+            [](int, int, int, void *cookie) {
+                auto release = static_cast<std::atomic<int> *>(cookie);
+                while (!release->load())
+                    std::this_thread::yield();
+                return 0;
+            },
+            &release);
+        Record record;
+        initRecord(record);
+        mlt_slices_task task = mlt_slices_submit_normal(kJobs, recordJob, &record);
+        mlt_slices_wait(task);
+        release = 1;
+        mlt_slices_wait(busy);
+        verifyRecord(record);
+        QVERIFY(record.callerJobs.load() > 0);
+    }
+
+    void NestedRunDoesNotDeadlock()
+    {
+        std::atomic<int> inner(0);
+        int count = mlt_slices_count_normal();
+        mlt_slices_run_normal(count * 2, outerJob, &inner);
+        QCOMPARE(inner.load(), count * 2 * count * 2);
+    }
+};
+
+QTEST_APPLESS_MAIN(TestSlices)
+
+#include "test_slices.moc"